@@ -50,6 +50,19 @@ public:
 	virtual		float	readFloat	()	= 0;	//
 	virtual		bool	readBlock	(void* buffer, u32 byteSize)	= 0;
 	virtual		ESTATUS	getStatus	()	= 0;
+
+	// Zero copy access : returns the next byteSize (decrypted) bytes without consuming them,
+	// NULL if the stream does not buffer or not enough data is left. Use skip() to consume.
+	virtual		const u8*	peek	(u32 /*byteSize*/)	{ return 0; }
+	virtual		bool	skip		(u32 byteSize) {
+		u8 tmp[256];
+		while(byteSize) {
+			u32 cnt = (byteSize < sizeof(tmp)) ? byteSize : sizeof(tmp);
+			if(!readBlock(tmp, cnt)) { return false; }
+			byteSize -= cnt;
+		}
+		return true;
+	}
 	
 	// Socket specialized
 	virtual		IWriteStream* getWriteStream()  = 0;
@@ -26,6 +26,9 @@ public:
 
 	// writing
 	virtual size_t writeTmp(void * ptr, size_t size) = 0;
+
+	// Optional : allocate the final size up front, writes still start at offset 0.
+	virtual void   reserve (size_t size);
 };
 
 #endif // ITmpFile_h
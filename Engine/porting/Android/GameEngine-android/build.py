@@ -134,6 +134,10 @@ class PlaygroundBuilder:
         self.copyfile('../../../porting/FileDelete.cpp', './jni/Android/')
         self.copyfile('../../../porting/FileDelete.h', './jni/Android/')
 
+        # buffered read stream
+        self.copyfile('../../../porting/CBufferedReadFileStream.cpp', './jni/Android/')
+        self.copyfile('../../../porting/CBufferedReadFileStream.h', './jni/Android/')
+
         # remove unused files (their presence could make build break)
         self.rmfile('./jni/source/Core/CKLBStream.cpp')
         self.rmfile('./jni/source/Rendering/FontSystem.cpp')
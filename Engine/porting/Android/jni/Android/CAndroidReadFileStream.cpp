@@ -39,19 +39,16 @@ const CAndroidReadFileStream::LOCLIST CAndroidReadFileStream::m_toplevel[3] = {
 };
 
 CAndroidReadFileStream::CAndroidReadFileStream()
-: m_bReadOnly(true)
-, m_fd(-1)
-, m_fp(0)
+: CBufferedReadFileStream()
+, m_bReadOnly(true)
 , m_eStat(CLOSED)
 , m_fullpath(0)
 , m_writeStream(0)
-, m_decrypter()
 {}
 
 CAndroidReadFileStream::~CAndroidReadFileStream()
 {
-    if(m_fp) fclose(m_fp);
-    m_fd = -1;
+    // m_fp は CBufferedReadFileStream 側で閉じる
     m_eStat = CLOSED;    
     delete [] m_fullpath;
 }
@@ -88,6 +85,7 @@ CAndroidReadFileStream::openStream(const char * path, const char * home)
     	pStream->m_eStat = NOT_FOUND;
     	return pStream;
     }
+    pStream->attachFile();
         
     // オープンに成功したので正常終了ステータスにする。
     pStream->m_eStat = NORMAL;
@@ -110,67 +108,7 @@ CAndroidReadFileStream::getSize()
         return -1;
     }
 
-    return file_stats.st_size - (m_decrypter.m_useNew ? 4 : 0);
-}
-
-s32
-CAndroidReadFileStream::getPosition()
-{
-    return (s32)(ftell(m_fp) - (m_decrypter.m_useNew ? 4 : 0));
-}
-
-u8       
-CAndroidReadFileStream::readU8()
-{
-    // とりあえず動かすため、fgetc() で実装する。
-	u8 val = fgetc(m_fp);
-	decrypt(&val,1);
-	return (u8)val;
-}
-
-u16      
-CAndroidReadFileStream::readU16()
-{
-    u8 buf[2];
-    if(1 == fread(buf, 2, 1, m_fp)) {
-		decrypt(buf,2);
-        u16 ret = ((u16)buf[0] << 8) | (u16)buf[1];
-        return ret;
-    }
-    return 0;
-}
-
-u32      
-CAndroidReadFileStream::readU32()
-{
-    u8 buf[4];
-    if(1 == fread(buf, 4, 1, m_fp)) {
-		decrypt(buf,4);
-        u32 ret = ((u32)buf[0] << 24) | ((u16)buf[1] <<16) | ((u16)buf[2] << 8) | (u16)buf[3];
-        return ret;
-    }
-    return 0;
-}
-
-float    
-CAndroidReadFileStream::readFloat()
-{
-    float f;
-    if(1 == fread(&f, sizeof(float), 1, m_fp)) {
-		decrypt(&f, sizeof(float));
-        return f;
-    }
-    return 0.0f;
-}
-
-bool     
-CAndroidReadFileStream::readBlock(void * buffer, u32 byteSize)
-{
-    u32 cnt;
-    
-    cnt = fread(buffer, 1, byteSize, m_fp);
-	decrypt(buffer, cnt);
-    return (cnt == byteSize) ? true : false; 
+    return file_stats.st_size - m_decrypter.m_header_size;
 }
 
 IReadStream::ESTATUS  
@@ -187,25 +125,3 @@ CAndroidReadFileStream::getWriteStream()
     return m_writeStream;
 }
 
-
-int
-CAndroidReadFileStream::readU16arr(u16 *pBufferU16, int items)
-{
-    int cnt = fread(pBufferU16, sizeof(u16), items, m_fp);
-    decrypt(pBufferU16,sizeof(u16) * cnt);
-
-    // iOS と Android/ARM では元々big endian なので、バイトオーダーの入れ替えは特に不要。
-    // Windows 環境ではこれを使用して読む必要が生じるため、互換のために用意する。
-    return cnt;
-}
-
-int
-CAndroidReadFileStream::readU32arr(u32 *pBufferU32, int items)
-{
-    int cnt = fread(pBufferU32, sizeof(u32), items, m_fp);
-    decrypt(pBufferU32,sizeof(u32) * cnt);
-
-    // iOS と Android/ARM では元々big endian なので、バイトオーダーの入れ替えは特に不要。
-    // Windows 環境ではこれを使用して読む必要が生じるため、互換のために用意する。
-    return cnt;
-}
@@ -23,12 +23,12 @@
 
 #include "BaseType.h"
 #include "FileSystem.h"
-#include "encryptFile.h"
+#include "CBufferedReadFileStream.h"
 
 class CAndroidWriteFileStream;
 
 // ファイルアクセスクラス実装
-class CAndroidReadFileStream : public IReadStream
+class CAndroidReadFileStream : public CBufferedReadFileStream
 {
 	friend class CAndroidWriteFileStream;
 private:
@@ -52,53 +52,16 @@ public:
     static CAndroidReadFileStream * openAssets(const char * path, const char * home);
 
     s32     getSize();
-    s32     getPosition();
-    u8      readU8();
-    u16     readU16();
-    u32     readU32();
-    float   readFloat();
-    bool    readBlock(void * buffer, u32 byteSize);
     ESTATUS getStatus();
-    
-    int		readU16arr(u16 * pBufferU16, int items);
-    int		readU32arr(u32 * pBufferU32, int items);
 
     IWriteStream * getWriteStream();
 private:
 
     const char	  * m_fullpath;
     ESTATUS     m_eStat;
-    FILE      * m_fp;
-    int         m_fd;
 
     bool		m_bReadOnly;
     CAndroidWriteFileStream * m_writeStream;
-
-public:
-	inline u32 decryptSetup(const u8* ptr) {
-		u8 hdr[4];
-		hdr[0] = 0;
-		hdr[1] = 0;
-		hdr[2] = 0;
-		hdr[3] = 0;
-
-		if (m_fp) {
-			fread(hdr, 1, 4, m_fp); 
-		}
-
-		u32 res = m_decrypter.decryptSetup(ptr, hdr);
-		if (res == 0) {
-			if (m_fp) {
-				fseek(m_fp, 0, SEEK_SET);
-			}
-		}
-		return res;
-	}
-private:
-    CDecryptBaseClass m_decrypter;
-    inline void decrypt(void* ptr, u32 length) {
-        m_decrypter.decryptBlck(ptr, length);
-    }
 };
 
 
@@ -29,6 +29,7 @@
 #include <linux/ioctl.h>
 #include <sys/vfs.h>
 #include <android/log.h>
+#include <EGL/egl.h>
 #include "CAndroidPathConv.h"
 #include "CAndroidRequest.h"
 #include "CAndroidTmpFile.h"
@@ -610,9 +611,9 @@ CAndroidRequest::getTextInfo(const char* utf8String, void * pFont, STextInfo* pR
 }
 
 void*
-CAndroidRequest::getGLExtension(const char*)
+CAndroidRequest::getGLExtension(const char* ext)
 {
-	return 0;
+	return (void*)eglGetProcAddress(ext);
 }
 
 const char *
@@ -1549,15 +1550,18 @@ void CAndroidRequest::mutexUnlock	(void* mutex)
 	}
 }
 
+// Auto-reset event like the Win32 version : a wakeup sent before the sleep is not lost.
 struct EventMutex {
 	pthread_mutex_t		mutex;
 	pthread_cond_t		cond;
+	bool				signaled;
 };
 
 void* CAndroidRequest::allocEventLock()
 {
 	EventMutex* pEvent = new EventMutex();
 	if (pEvent) {
+		pEvent->signaled = false;
 		bool err = false;
 		if (pthread_mutex_init(&pEvent->mutex, NULL) == 0) {
 			if (pthread_cond_init(&pEvent->cond, NULL) == 0) {
@@ -1584,6 +1588,7 @@ void CAndroidRequest::freeEventLock	(void* lock)
 	if (pEvent) {
 		pthread_mutex_destroy	(&pEvent->mutex);
 		pthread_cond_destroy	(&pEvent->cond);		
+		delete pEvent;
 	}
 }
 
@@ -1594,8 +1599,11 @@ void CAndroidRequest::eventSleep(void* lock)
 		// Own mutex [Lock]
 		pthread_mutex_lock		(&pEvent->mutex);
 		// [Unlock] and go to [Sleep], atomically.
-		pthread_cond_wait		(&pEvent->cond, &pEvent->mutex);
+		while (!pEvent->signaled) {
+			pthread_cond_wait	(&pEvent->cond, &pEvent->mutex);
+		}
 		// [Lock] on wake up.
+		pEvent->signaled = false;
 		
 		// [Unlock] again.
 		pthread_mutex_unlock	(&pEvent->mutex);
@@ -1609,6 +1617,7 @@ void CAndroidRequest::eventWakeup(void* lock)
 		// Own mutex [Lock]
 		pthread_mutex_lock		(&pEvent->mutex);
 
+		pEvent->signaled = true;
 		pthread_cond_broadcast	(&pEvent->cond);
 
 		// [Unlock] again.
@@ -44,6 +44,7 @@ CAndroidWriteFileStream::CAndroidWriteFileStream(CAndroidReadFileStream& rdStrea
     }
     rdStream.m_fd = m_fd;
     rdStream.m_fp = m_fp;    
+    rdStream.resetBuffer(0);
     m_eStat = NORMAL;
 }
 
@@ -0,0 +1,339 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+//
+//  CBufferedReadFileStream.cpp
+//
+#include <string.h>
+
+#include "CBufferedReadFileStream.h"
+#include "CKLBBenchmark.h"
+
+// Physical reads end on this boundary whenever the buffer allows it.
+#define READ_ALIGN			(4096)
+// Blocks at least this big are read and decrypted directly into the caller memory.
+#define DIRECT_READ_SIZE	(CBufferedReadFileStream::BUFFER_SIZE / 2)
+
+CBufferedReadFileStream::CBufferedReadFileStream()
+: m_fp          (NULL)
+, m_fd          (-1)
+, m_decrypter   ()
+, m_buffer      (NULL)
+, m_bufSize     (0)
+, m_bufPos      (0)
+, m_bufEnd      (0)
+, m_filePos     (0)
+, m_eof         (false)
+{
+}
+
+CBufferedReadFileStream::~CBufferedReadFileStream()
+{
+	if(m_fp) { fclose(m_fp); }
+	m_fp = NULL;
+	m_fd = -1;
+	delete [] m_buffer;
+}
+
+void
+CBufferedReadFileStream::attachFile()
+{
+	// The stream does its own (larger) buffering, avoid the extra stdio copy.
+	if(m_fp) { setvbuf(m_fp, NULL, _IONBF, 0); }
+	resetBuffer(0);
+}
+
+void
+CBufferedReadFileStream::resetBuffer(u32 filePos)
+{
+	m_bufPos  = 0;
+	m_bufEnd  = 0;
+	m_filePos = filePos;
+	m_eof     = false;
+}
+
+u32
+CBufferedReadFileStream::decryptSetup(const u8* ptr)
+{
+	u8 hdr[16];
+	memset(hdr, 0, sizeof(hdr));
+	if (m_fp) {
+		fread(hdr, 1, 16, m_fp);
+	}
+
+	u32 res = m_decrypter.decryptSetup(ptr, hdr);
+	if (m_fp) {
+		fseek(m_fp, m_decrypter.m_header_size, SEEK_SET);
+	}
+	resetBuffer(m_decrypter.m_header_size);
+	return res;
+}
+
+u32
+CBufferedReadFileStream::readFile(void * buffer, u32 byteSize)
+{
+	u32 cnt = m_fp ? (u32)fread(buffer, 1, byteSize, m_fp) : 0;
+	if(cnt < byteSize) { m_eof = true; }
+	m_filePos += cnt;
+
+	// Whole chunk decrypted at once.
+	m_decrypter.decryptBlck(buffer, cnt);
+	return cnt;
+}
+
+bool
+CBufferedReadFileStream::fill(u32 byteSize)
+{
+	u32 avail = m_bufEnd - m_bufPos;
+	if(avail >= byteSize)	{ return true;  }
+	if(m_eof || !m_fp)		{ return false; }
+
+	if(!m_buffer) {
+		// Small files only get a buffer of their own size.
+		u32 size   = BUFFER_SIZE;
+		s32 remain = getSize() - getPosition();
+		if(remain >= 0 && (u32)remain < size) {
+			size = ((u32)remain > byteSize) ? (u32)remain : byteSize;
+		}
+		m_buffer = new u8[size];
+		if(!m_buffer) { return false; }
+		m_bufSize = size;
+	}
+	if(byteSize > m_bufSize) { return false; }
+
+	if(avail && m_bufPos) {
+		memmove(m_buffer, m_buffer + m_bufPos, avail);
+	}
+	m_bufPos = 0;
+	m_bufEnd = avail;
+
+	while(m_bufEnd < byteSize && !m_eof) {
+		u32 chunk = m_bufSize - m_bufEnd;
+		u32 tail  = (m_filePos + chunk) & (READ_ALIGN - 1);
+		if(tail < chunk) { chunk -= tail; }
+		m_bufEnd += readFile(m_buffer + m_bufEnd, chunk);
+	}
+	return m_bufEnd >= byteSize;
+}
+
+u32
+CBufferedReadFileStream::read(void * buffer, u32 byteSize)
+{
+	u8 * dst  = (u8 *)buffer;
+	u32  done = 0;
+	while(done < byteSize) {
+		u32 left  = byteSize - done;
+		u32 avail = m_bufEnd - m_bufPos;
+		if(avail) {
+			u32 cnt = (avail < left) ? avail : left;
+			memcpy(dst + done, m_buffer + m_bufPos, cnt);
+			m_bufPos += cnt;
+			done     += cnt;
+		} else if(left >= DIRECT_READ_SIZE || left >= (u32)(getSize() - getPosition())) {
+			// Large block or rest of the file : no need to go through the buffer.
+			done += readFile(dst + done, left);
+			break;
+		} else if(!fill(1)) {
+			break;
+		}
+	}
+	return done;
+}
+
+s32
+CBufferedReadFileStream::getPosition()
+{
+	return (s32)(m_filePos - (m_bufEnd - m_bufPos)) - m_decrypter.m_header_size;
+}
+
+u8
+CBufferedReadFileStream::readU8()
+{
+	if(!fill(1)) { return 0; }
+	return m_buffer[m_bufPos++];
+}
+
+u16
+CBufferedReadFileStream::readU16()
+{
+	if(!fill(2)) { return 0; }
+	const u8 * buf = m_buffer + m_bufPos;
+	m_bufPos += 2;
+	return ((u16)buf[0] << 8) | (u16)buf[1];
+}
+
+u32
+CBufferedReadFileStream::readU32()
+{
+	if(!fill(4)) { return 0; }
+	const u8 * buf = m_buffer + m_bufPos;
+	m_bufPos += 4;
+	return ((u32)buf[0] << 24) | ((u32)buf[1] << 16) | ((u32)buf[2] << 8) | (u32)buf[3];
+}
+
+float
+CBufferedReadFileStream::readFloat()
+{
+	float f;
+	if(!fill(sizeof(float))) { return 0.0f; }
+	memcpy(&f, m_buffer + m_bufPos, sizeof(float));
+	m_bufPos += sizeof(float);
+	return f;
+}
+
+bool
+CBufferedReadFileStream::readBlock(void * buffer, u32 byteSize)
+{
+	return read(buffer, byteSize) == byteSize;
+}
+
+int
+CBufferedReadFileStream::readU16arr(u16 * pBufferU16, int items)
+{
+	return (int)(read(pBufferU16, sizeof(u16) * items) / sizeof(u16));
+}
+
+int
+CBufferedReadFileStream::readU32arr(u32 * pBufferU32, int items)
+{
+	return (int)(read(pBufferU32, sizeof(u32) * items) / sizeof(u32));
+}
+
+const u8 *
+CBufferedReadFileStream::peek(u32 byteSize)
+{
+	if(byteSize > BUFFER_SIZE || !fill(byteSize)) {
+		return NULL;
+	}
+	return m_buffer + m_bufPos;
+}
+
+bool
+CBufferedReadFileStream::skip(u32 byteSize)
+{
+	u32 avail = m_bufEnd - m_bufPos;
+	if(byteSize <= avail) {
+		m_bufPos += byteSize;
+		return true;
+	}
+	byteSize -= avail;
+	m_bufPos  = m_bufEnd;
+
+	// Beyond the buffer : seek and move the key stream along.
+	s32 size   = getSize();
+	u32 target = m_filePos + byteSize;
+	if(!m_fp || (size >= 0 && target > (u32)(size + m_decrypter.m_header_size))) {
+		return false;
+	}
+	if(fseek(m_fp, target, SEEK_SET)) {
+		return false;
+	}
+	m_filePos = target;
+	m_decrypter.gotoOffset(target - m_decrypter.m_header_size);
+	return true;
+}
+
+#ifdef INTERNAL_BENCH
+#include "CPFInterface.h"
+
+// Reads the asset given as argument (whole file, readU8, readU32, 256 byte blocks, peek + skip)
+// and checks every access path returns the same decrypted bytes as the whole file read.
+static bool benchReadStream(u32 loops) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const char* asset = CKLBBenchmark::getArgument();
+	if(!asset) {
+		pltf.logging("[BENCH] READSTREAM needs an asset path\n");
+		return true;
+	}
+
+	IReadStream* pStream = pltf.openReadStream(asset, pltf.useEncryption());
+	s32 size = (pStream && pStream->getStatus() == IReadStream::NORMAL) ? pStream->getSize() : -1;
+	delete pStream;
+	if(size <= 0) { return false; }
+
+	u8 * ref = new u8[size];
+	u8 * dst = new u8[size];
+	if(!ref || !dst) {
+		delete [] ref;
+		delete [] dst;
+		return false;
+	}
+
+	enum { WHOLE, BYTES, WORDS, BLOCKS, SKIPS, PASSES };
+	static const char* labels[PASSES] = { "whole file", "readU8", "readU32", "256 byte blocks", "peek + skip" };
+	s64 times[PASSES] = { 0, 0, 0, 0, 0 };
+	bool ok = true;
+	for(u32 l = 0; ok && l < loops; l++) {
+		for(u32 pass = WHOLE; ok && pass < PASSES; pass++) {
+			pStream = pltf.openReadStream(asset, pltf.useEncryption());
+			if(!pStream) { ok = false; break; }
+			u8 * out = (pass == WHOLE) ? ref : dst;
+			u32  pos = 0;
+			s64  t0  = CKLBBenchmark::now();
+			switch(pass) {
+			case WHOLE:
+				ok = pStream->readBlock(out, size);
+				pos = size;
+				break;
+			case BYTES:
+				for(; pos < (u32)size; pos++) { out[pos] = pStream->readU8(); }
+				break;
+			case WORDS:
+				for(; pos + 4 <= (u32)size; pos += 4) {
+					u32 v = pStream->readU32();
+					out[pos] = (u8)(v >> 24); out[pos+1] = (u8)(v >> 16); out[pos+2] = (u8)(v >> 8); out[pos+3] = (u8)v;
+				}
+				break;
+			case BLOCKS:
+				for(; pos < (u32)size; pos += 256) {
+					u32 cnt = ((u32)size - pos < 256) ? (u32)size - pos : 256;
+					ok &= pStream->readBlock(out + pos, cnt);
+				}
+				pos = size;
+				break;
+			case SKIPS:
+				// 64 bytes read, 4 KB skipped : the skip leaves the buffer, seeks and moves the key stream.
+				while(ok && pos < (u32)size) {
+					u32 cnt = ((u32)size - pos < 64) ? (u32)size - pos : 64;
+					const u8 * p = pStream->peek(cnt);
+					if(p) { ok = (memcmp(p, ref + pos, cnt) == 0); }
+					ok = ok && pStream->readBlock(out + pos, cnt);
+					pos += cnt;
+					u32 gap = ((u32)size - pos < 4096) ? (u32)size - pos : 4096;
+					ok = ok && pStream->skip(gap);
+					memcpy(out + pos, ref + pos, gap);	// Skipped bytes are not compared.
+					pos += gap;
+					ok = ok && (pStream->getPosition() == (s32)pos);
+				}
+				break;
+			}
+			times[pass] += CKLBBenchmark::now() - t0;
+			delete pStream;
+			ok = ok && (pass == WHOLE || memcmp(ref, dst, pos) == 0);
+			if(!ok) {
+				pltf.logging("[BENCH] READSTREAM %s differs from the whole file read\n", labels[pass]);
+			}
+		}
+	}
+	for(u32 pass = WHOLE; pass < PASSES; pass++) {
+		CKLBBenchmark::report(labels[pass], loops, times[pass]);
+	}
+	delete [] ref;
+	delete [] dst;
+	return ok;
+}
+
+static CKLBBenchmark gBenchReadStream("READSTREAM", benchReadStream);
+#endif
@@ -0,0 +1,91 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+//
+//  CBufferedReadFileStream.h
+//
+
+#ifndef CBufferedReadFileStream_h
+#define CBufferedReadFileStream_h
+
+#include <stdio.h>
+#include "BaseType.h"
+#include "FileSystem.h"
+#include "encryptFile.h"
+
+/*!
+* \class CBufferedReadFileStream
+* \brief Buffered, decrypting file read stream shared by the platform backends.
+*
+* The file is read in large chunks aligned on the buffer size and every chunk
+* is decrypted with a single call, so readU8/readU16/readU32 and small blocks
+* are served from memory instead of one fread + decrypt each.
+* Large blocks bypass the buffer and are read and decrypted in place.
+*
+* The platform classes only open the file (m_fd / m_fp) and provide getSize,
+* getStatus and getWriteStream.
+*/
+class CBufferedReadFileStream : public IReadStream
+{
+public:
+	enum {
+		BUFFER_SIZE = 128 * 1024	// Power of 2 : file reads are aligned on it.
+	};
+
+	virtual ~CBufferedReadFileStream();
+
+	// Read the 16 byte header, setup the decrypter and skip the header.
+	u32		decryptSetup(const u8* ptr);
+
+	s32		getPosition	();
+	u8		readU8		();
+	u16		readU16		();
+	u32		readU32		();
+	float	readFloat	();
+	bool	readBlock	(void * buffer, u32 byteSize);
+
+	int		readU16arr	(u16 * pBufferU16, int items);
+	int		readU32arr	(u32 * pBufferU32, int items);
+
+	const u8*	peek	(u32 byteSize);
+	bool		skip	(u32 byteSize);
+
+protected:
+	CBufferedReadFileStream();
+
+	// Must be called once m_fp is open : stdio buffering is disabled, the stream does its own.
+	void	attachFile	();
+
+	// Drop buffered data, the next read starts at physical offset filePos.
+	void	resetBuffer	(u32 filePos);
+
+	FILE			  * m_fp;
+	int					m_fd;
+	CDecryptBaseClass	m_decrypter;
+
+private:
+	bool	fill		(u32 byteSize);
+	u32		read		(void * buffer, u32 byteSize);
+	u32		readFile	(void * buffer, u32 byteSize);
+
+	u8		  * m_buffer;
+	u32			m_bufSize;		// Allocated size of m_buffer.
+	u32			m_bufPos;		// Next byte to return.
+	u32			m_bufEnd;		// End of valid (decrypted) data.
+	u32			m_filePos;		// Physical file offset matching m_bufEnd.
+	bool		m_eof;
+};
+
+#endif
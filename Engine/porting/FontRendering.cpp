@@ -17,117 +17,99 @@
 
 #include "CPFInterface.h"
 #include "CKLBUtility.h"
+#include "CKLBBenchmark.h"
 #include "utf8.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FNT_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define FNT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 // Prototype to avoid warning.
 void test();
 
 class FntDebug {
 public:
 	static void check();
-private:
-	static void checkTreeRec(u32 depth, u32 idx, u32 code);
 };
 
 // ==========================================================================================
 //   Global Static Variables
 // ==========================================================================================
 
-/*static*/ CharDictionnary	CharDictionnary::s_dicoArray[DICO_ELEMENT_COUNT];
-/*static*/ u16				CharDictionnary::s_freeList = 0xFFFF;
-/*static*/ u16				CharDictionnary::s_usedList = 0xFFFF;
-
-/*static*/ CharCache		CharCache::s_cacheArray[CHAR_CACHE_SIZE];
-/*static*/ u16				CharCache::s_cacheStart		= 0xFFFF;
-/*static*/ u16				CharCache::s_cacheEnd		= 0;// First allocated object.
-/*static*/ u16				CharCache::s_allocCounter	= 0;
+/*static*/ CharCache::Stripe	CharCache::s_stripes[GLYPH_CACHE_STRIPES];
+/*static*/ u32				CharCache::s_budget			= GLYPH_CACHE_DEFAULT_BUDGET;
+/*static*/ bool				CharCache::s_init			= false;
 
 /*static*/ FontObject*		FontObject::s_list			= NULL;
 /*static*/ bool				FontObject::s_init			= false;
 /*static*/ FT_Library		FontObject::s_library;
 /*static*/ FontObject::FONTALIAS	FontObject::g_fonts[5];
 /*static*/ u32				FontObject::g_fontInstalled	= 0;
-
-/*static*/ MemoryBlock*		MemoryBlock::s_blockList	= NULL;
-/*static*/ u16				MemoryBlock::s_blockCounter	= 0;
+/*static*/ FontObject::TEXTINFO	FontObject::s_textInfo[TEXT_INFO_CACHE_SIZE];
+/*static*/ void*			FontObject::s_textInfoMutex	= NULL;
+/*static*/ u32				FontObject::s_layoutHits	= 0;
+/*static*/ u32				FontObject::s_layoutMisses	= 0;
 
 // ==========================================================================================
 //   Global reboot function
 // ==========================================================================================
 
 int g_checkCount = 0;
-int g_counterChar;
 
 void FntDebug::check() {
-	/*
-	// 1. For each font
-	FontObject* pFnt = FontObject::s_list;
-	int totalCount = 0;
-	while (pFnt) {
-//		printf("===== Font : '%s' [%i]\n", pFnt->m_name, pFnt->m_refCount);
-		g_counterChar = 0;
-		// 2. Parse the cache tree and lookup.
-		checkTreeRec(0,pFnt->m_dicoStart, 0);
-		pFnt = pFnt->m_next;
-//		printf("===== Has %i unicode entry\n", g_counterChar);
-		totalCount += g_counterChar;
-	}
-//	printf("===== Total %i charFont, Alloc Total : %i\n", totalCount, CharCache::s_allocCounter);
-	g_checkCount++;
-	*/
-}
-
-void FntDebug::checkTreeRec(u32 depth, u32 idx, u32 code) {
-	if (depth < 8) {
-		CharDictionnary* pEntry = &CharDictionnary::s_dicoArray[idx];
-//		printf("D:%i %04i ", depth, idx);
-
-		for (u32 n=0; n < depth; n++) {
-//			printf(" ");
-		}
-
-		for (u32 n=0; n < 16; n++) {
-			if (pEntry->m_idxTbl[n] != 0xFFFF) {
-//				printf("[%2i]%04i ", n, pEntry->m_idxTbl[n]);
-			} else {
-//				printf("[%2i]NULL ", n);
+	// Each cached glyph must be reachable from its hash bucket and its LRU list.
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		CharCache::Stripe& stripe = CharCache::s_stripes[s];
+		if (!stripe.mutex) { continue; }
+
+		MUTEX_LOCK(stripe.mutex);
+		u32 lruCount = 0;
+		u32 memUsed  = 0;
+		CharCache* pChar = stripe.lruHead;
+		while (pChar) {
+			u32 hash = CharCache::hashKey(pChar->m_pFontObj, pChar->m_unicode);
+			if (CharCache::find(stripe, hash, pChar->m_pFontObj, pChar->m_unicode) != pChar) {
+				klb_assertAlways("Glyph %08X not in hash table", pChar->m_unicode);
 			}
+			memUsed += pChar->m_memSize;
+			lruCount++;
+			pChar = pChar->m_lruNext;
 		}
-//		printf("\n");
-		
-		for (int n=0; n < 16; n++) {
-			if (pEntry->m_idxTbl[n] != 0xFFFF) {
-				checkTreeRec(depth + 1, pEntry->m_idxTbl[n], (code << 4) | n);
-			}
-		}
-	} else {
-		CharCache* pChar = &CharCache::s_cacheArray[idx];
-		if (pChar->m_unicode != code) {
-			klb_assertAlways(" Adr Code : %08X <-> Char : %08X\n", code, pChar->m_unicode);
-		} else {
-//			printf(" Char : %08X\n", code);
-			g_counterChar++;
+		if ((lruCount != stripe.count) || (memUsed != stripe.memUsed)) {
+			klb_assertAlways("Glyph cache stripe %i corrupted", s);
 		}
+		MUTEX_UNLOCK(stripe.mutex);
 	}
+	g_checkCount++;
 }
 
 namespace FontSystem {
 	void reboot() {
 		// Release Font
 		FontObject::releaseFontSystem();
-		// Clean Dictionnary entries.
-		CharDictionnary::reboot();
 		// Clean Character cache.
 		CharCache::reboot();
-		// Clean Memory Block
-		MemoryBlock::reboot();
+	}
+
+	void setCacheBudget(u32 byteSize) {
+		CharCache::setBudget(byteSize);
+	}
+
+	void getCacheStats(SGlyphCacheStats* pStats) {
+		CharCache::getStats(pStats);
+	}
+
+	void resetCacheStats() {
+		CharCache::resetStats();
 	}
 } // end FontSystem
 
 /*static*/ void test() {
 	FontObject::test();
-	CharDictionnary::test();
-	MemoryBlock::test();
 	CharCache::test();
 }
 
@@ -150,340 +132,349 @@ namespace FontSystem {
 	}
 }
 
-/*static*/ void CharDictionnary::test() {
-	DEBUG_PRINT("Char Dictionnary Test====\n");
-	u16 p		= s_freeList;
-	u16 prev	= 0xFFFF;
-	DEBUG_PRINT("Forward Parse Free List.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		prev = p;
-		p = s_dicoArray[p].m_next;
-	}
-
-	p = prev;
-	DEBUG_PRINT("Backward Parse free list.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		p = s_dicoArray[p].m_prev;
-	}
-
-	p		= s_usedList;
-	prev	= 0xFFFF;
-	DEBUG_PRINT("Forward Parse used List.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		prev = p;
-		p = s_dicoArray[p].m_next;
-	}
-
-	p = (u16)prev;
-	DEBUG_PRINT("Backward Parse used list.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		p = s_dicoArray[p].m_prev;
-	};
-}
-
 /*static*/ void CharCache::test() {
 	DEBUG_PRINT("Char Cache Test====\n");
-	DEBUG_PRINT("\tAlloc Count : %i\n",s_allocCounter);
-
-	u16 p		= s_cacheStart;
-	u16 prev	= 0xFFFF;
-	DEBUG_PRINT("Forward Parse Allocated List.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		prev = p;
-		p = s_cacheArray[p].m_next;
-	}
-
-	if ((prev != s_cacheEnd) && (s_cacheStart != 0xFFFF)) {
-		DEBUG_PRINT("ERROR !!! Char cache");
-	}
-
-	p = prev;
-	DEBUG_PRINT("Backward Parse Allocated list.\n");
-	while (p != 0xFFFF) {
-		DEBUG_PRINT("\t%4X\n",p);
-		p = s_cacheArray[p].m_prev;
+	SGlyphCacheStats stats;
+	getStats(&stats);
+	DEBUG_PRINT("\tGlyphs : %i, Memory : %i / %i\n", stats.glyphCount, stats.memoryUsed, stats.memoryBudget);
+	DEBUG_PRINT("\tHit : %i, Miss : %i, Evict : %i\n", stats.hits, stats.misses, stats.evictions);
+	DEBUG_PRINT("\tLayout Hit : %i, Miss : %i\n", stats.layoutHits, stats.layoutMisses);
+
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		Stripe& stripe = s_stripes[s];
+		if (!stripe.mutex) { continue; }
+
+		MUTEX_LOCK(stripe.mutex);
+		DEBUG_PRINT("Stripe %i : %i glyphs, LRU order.\n", s, stripe.count);
+		CharCache* p	= stripe.lruHead;
+		CharCache* prev	= NULL;
+		while (p) {
+			DEBUG_PRINT("\t%8X U+%04X pin:%i\n", p, p->m_unicode, p->m_pinCount);
+			prev = p;
+			p = p->m_lruNext;
+		}
+		if (prev != stripe.lruTail) {
+			DEBUG_PRINT("ERROR !!! Char cache");
+		}
+		MUTEX_UNLOCK(stripe.mutex);
 	}
 }
 
-/*static*/ void MemoryBlock::test() {
-}
-
-
 // ==========================================================================================
 //   Implementation CharCache
 // ==========================================================================================
 
-struct SubEntry {
-public:
-	u16 offsetBitTable;
-};
-
 CharCache::CharCache() {
 }
 
 CharCache::~CharCache() {
+	KLBDELETEA(m_ptr);
 }
 
-// ==========================================================================================
-//   Implementation CharDictionnary
-// ==========================================================================================
-
-CharDictionnary::CharDictionnary()
-{
-	m_next = 0xFFFF;
-	m_prev = 0xFFFF;
-	memset(m_idxTbl, 0xFF, 16 * sizeof(u16));
-}
-
-/*static*/ CharCache* CharDictionnary::getChar(u32 uniCode, FontObject* pFont) {
-	FntDebug::check();	// Only place with one check.
-
-	CharCache* pEntry = findEntry(pFont, uniCode);
-
-	if (pEntry == NULL) {
-		CharDictionnary* pParse = &s_dicoArray[pFont->m_dicoStart];
-		u32 copyCode = uniCode;
-		for (int n=0; n < 7; n++) {
-			u16 idx = pParse->m_idxTbl[copyCode>>28];
-			if (idx == 0xFFFF) {
-				idx = CharDictionnary::createDicoEntry();
-				pParse->m_idxTbl[copyCode>>28] = idx;
-				if (idx == 0xFFFF) {
-					return NULL;
-				}
-				pParse = &s_dicoArray[idx];
-			} else {
-				pParse = &s_dicoArray[idx];
+/*static*/ bool CharCache::init() {
+	if (!s_init) {
+		IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+		for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+			Stripe& stripe = s_stripes[s];
+			for (u32 n=0; n < GLYPH_CACHE_BUCKETS; n++) {
+				stripe.buckets[n] = NULL;
+			}
+			stripe.lruHead		= NULL;
+			stripe.lruTail		= NULL;
+			stripe.memUsed		= 0;
+			stripe.count		= 0;
+			stripe.hits			= 0;
+			stripe.misses		= 0;
+			stripe.evictions	= 0;
+			stripe.mutex		= pfif.allocMutex();
+			if (!stripe.mutex) {
+				return false;
 			}
-			copyCode <<=4;
-		}
-
-		u16 idxChar;
-		pEntry = CharCache::createEntry(uniCode, &idxChar, pFont);
-		if (pEntry) {
-			pParse->m_idxTbl[copyCode>>28] = idxChar;
 		}
+		s_init = true;
 	}
-	return pEntry;
+	return true;
 }
 
-/*static*/ CharCache* CharDictionnary::findEntry(FontObject* pFont, u32 uniCode) {
-	CharDictionnary* pParse = &s_dicoArray[pFont->m_dicoStart];
-	u16 idx = 0;
-	for (int n=0; n < 8; n++) {
-		idx = pParse->m_idxTbl[uniCode>>28];
-		if (idx == 0xFFFF) {
-			break;
+/*static*/ void CharCache::reboot() {
+	if (s_init) {
+		IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+		for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+			Stripe& stripe = s_stripes[s];
+			CharCache* pChar = stripe.lruHead;
+			while (pChar) {
+				CharCache* pNext = pChar->m_lruNext;
+				KLBDELETE(pChar);
+				pChar = pNext;
+			}
+			pfif.freeMutex(stripe.mutex);
+			stripe.mutex = NULL;
 		}
-		pParse = &s_dicoArray[idx];
-		uniCode <<=4;
+		s_init = false;
 	}
+}
 
-	if (idx != 0xFFFF) {
-		return &CharCache::s_cacheArray[idx];
-	} else {
-		return NULL;
-	}
+/*static*/ u32 CharCache::hashKey(FontObject* pFont, u32 uniCode) {
+	// Mix font pointer and code point (murmur3 finalizer).
+	u32 h = ((u32)(uintptr_t)pFont) ^ (uniCode * 0x9E3779B1);
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
 }
 
-/*static*/ u16		 CharDictionnary::createDicoEntry() {
-	if (s_freeList == 0xFFFF && s_usedList == 0xFFFF) {
-		for (int n=0; n < DICO_ELEMENT_COUNT; n++) {
-			s_dicoArray[n].m_next = n+1;
-			s_dicoArray[n].m_prev = n-1;
+/*static*/ CharCache* CharCache::find(Stripe& stripe, u32 hash, FontObject* pFont, u32 uniCode) {
+	CharCache* pChar = stripe.buckets[(hash / GLYPH_CACHE_STRIPES) & (GLYPH_CACHE_BUCKETS-1)];
+	while (pChar) {
+		if ((pChar->m_unicode == uniCode) && (pChar->m_pFontObj == pFont)) {
+			return pChar;
 		}
-		s_dicoArray[DICO_ELEMENT_COUNT-1].m_next = 0xFFFF;
-
-		s_usedList = 0xFFFF;
-		s_freeList = 0;
+		pChar = pChar->m_hashNext;
 	}
+	return NULL;
+}
 
-	if (s_freeList != 0xFFFF) {
-		if (s_dicoArray[s_freeList].m_next != 0xFFFF) {
-			s_dicoArray[s_dicoArray[s_freeList].m_next].m_prev = s_dicoArray[s_freeList].m_prev;
-		}
-
-		if (s_dicoArray[s_freeList].m_prev != 0xFFFF) {
-			s_dicoArray[s_dicoArray[s_freeList].m_prev].m_next = s_dicoArray[s_freeList].m_next;			
-		}
-
-		if (s_usedList != 0xFFFF) {
-			s_dicoArray[s_usedList].m_prev = s_freeList;
-		}
-		
-		u16 nextFree = s_dicoArray[s_freeList].m_next;
+/*static*/ void CharCache::unlinkLRU(Stripe& stripe, CharCache* pChar) {
+	if (pChar->m_lruPrev)	{ pChar->m_lruPrev->m_lruNext = pChar->m_lruNext; }
+	else					{ stripe.lruHead = pChar->m_lruNext; }
+	if (pChar->m_lruNext)	{ pChar->m_lruNext->m_lruPrev = pChar->m_lruPrev; }
+	else					{ stripe.lruTail = pChar->m_lruPrev; }
+}
 
-		s_dicoArray[s_freeList].m_next = s_usedList;
-		s_dicoArray[s_freeList].m_prev = 0xFFFF;
-		memset(s_dicoArray[s_freeList].m_idxTbl, 0xFF, 16 * sizeof(u16));
+/*static*/ void CharCache::pushLRU(Stripe& stripe, CharCache* pChar) {
+	pChar->m_lruPrev = NULL;
+	pChar->m_lruNext = stripe.lruHead;
+	if (stripe.lruHead)	{ stripe.lruHead->m_lruPrev = pChar; }
+	else				{ stripe.lruTail = pChar; }
+	stripe.lruHead = pChar;
+}
 
-		s_usedList = s_freeList;
-		s_freeList = nextFree;
-		return s_usedList;
-	} else {
-		return 0xFFFF;
+/*static*/ void CharCache::remove(Stripe& stripe, CharCache* pChar) {
+	u32 hash = hashKey(pChar->m_pFontObj, pChar->m_unicode);
+	CharCache** ppLink = &stripe.buckets[(hash / GLYPH_CACHE_STRIPES) & (GLYPH_CACHE_BUCKETS-1)];
+	while (*ppLink != pChar) {
+		ppLink = &(*ppLink)->m_hashNext;
 	}
-}
+	*ppLink = pChar->m_hashNext;
 
-/*static*/ void CharDictionnary::destroyTree(u16 entry, u16 depth) {
-	if (entry != 0xFFFF) {
-		if (depth <= 7) {
-			u16* p16 = s_dicoArray[entry].m_idxTbl;
-			for (int n=0; n < 16; n++) {
-				destroyTree(p16[n], depth+1);
-			}
+	unlinkLRU(stripe, pChar);
+	stripe.memUsed -= pChar->m_memSize;
+	stripe.count--;
+	KLBDELETE(pChar);
+}
 
-			removeEntry(entry);
+/*static*/ void CharCache::trim(Stripe& stripe, u32 budget) {
+	// Evict from least recently used, skip glyphs currently being drawn.
+	CharCache* pChar = stripe.lruTail;
+	while (pChar && (stripe.memUsed > budget)) {
+		CharCache* pPrev = pChar->m_lruPrev;
+		if (pChar->m_pinCount == 0) {
+			remove(stripe, pChar);
+			stripe.evictions++;
 		}
+		pChar = pPrev;
 	}
 }
 
-/*static*/ void CharDictionnary::removeEntry(u16 entry) {
-	if (s_dicoArray[entry].m_next != 0xFFFF) {
-		s_dicoArray[s_dicoArray[entry].m_next].m_prev = s_dicoArray[entry].m_prev;
+/*static*/ CharCache* CharCache::acquire(u32 uniCode, FontObject* pFont) {
+	u32 hash		= hashKey(pFont, uniCode);
+	u32 stripeIdx	= hash & (GLYPH_CACHE_STRIPES-1);
+	Stripe& stripe	= s_stripes[stripeIdx];
+
+	MUTEX_LOCK(stripe.mutex);
+	CharCache* pChar = find(stripe, hash, pFont, uniCode);
+	if (pChar) {
+		stripe.hits++;
+		unlinkLRU(stripe, pChar);
+		pushLRU(stripe, pChar);
+		pChar->m_pinCount++;
+		MUTEX_UNLOCK(stripe.mutex);
+		return pChar;
 	}
+	stripe.misses++;
+	MUTEX_UNLOCK(stripe.mutex);
 
-	if (s_dicoArray[entry].m_prev != 0xFFFF) {
-		s_dicoArray[s_dicoArray[entry].m_prev].m_next = s_dicoArray[entry].m_next;			
-	} else {
-		s_usedList = s_dicoArray[entry].m_next;
+	// Rasterize outside of the stripe lock : only the font face is locked.
+	CharCache* pNew = rasterize(pFont, uniCode);
+	if (!pNew) {
+		return NULL;
 	}
-
-	s_dicoArray[entry].m_next = s_freeList;
-	s_dicoArray[entry].m_prev = 0xFFFF;
-
-	if (s_freeList != 0xFFFF) {
-		s_dicoArray[s_freeList].m_prev = entry;
+	pNew->m_stripe = stripeIdx;
+
+	MUTEX_LOCK(stripe.mutex);
+	pChar = find(stripe, hash, pFont, uniCode);
+	if (pChar) {
+		// Another thread inserted the same glyph meanwhile.
+		KLBDELETE(pNew);
+		unlinkLRU(stripe, pChar);
+		pushLRU(stripe, pChar);
+	} else {
+		pChar = pNew;
+		CharCache** ppBucket = &stripe.buckets[(hash / GLYPH_CACHE_STRIPES) & (GLYPH_CACHE_BUCKETS-1)];
+		pChar->m_hashNext	= *ppBucket;
+		*ppBucket			= pChar;
+		pushLRU(stripe, pChar);
+		stripe.memUsed += pChar->m_memSize;
+		stripe.count++;
 	}
-
-	s_freeList = entry;
+	pChar->m_pinCount++;
+	trim(stripe, s_budget / GLYPH_CACHE_STRIPES);
+	MUTEX_UNLOCK(stripe.mutex);
+	return pChar;
 }
 
-/*static*/ void	CharDictionnary::removeDicoEntry(u16 startEntry, u32 unicode) {
-	removeDicoEntryRec(startEntry, 0, unicode,startEntry);
+/*static*/ void CharCache::release(CharCache* pChar) {
+	Stripe& stripe = s_stripes[pChar->m_stripe];
+	MUTEX_LOCK(stripe.mutex);
+	klb_assert(pChar->m_pinCount, "Glyph released more than acquired");
+	pChar->m_pinCount--;
+	MUTEX_UNLOCK(stripe.mutex);
 }
 
-/*static*/ u16 CharDictionnary::removeDicoEntryRec(u16 entry, u32 depth, u32 unicode,u16 startEntry) {
-	if (depth < 7) {
-		u16 next = s_dicoArray[entry].m_idxTbl[unicode>>28];
-		u16 idx  = 0xFFFF;
-		if (next != 0xFFFF) {
-			idx = removeDicoEntryRec(next, depth + 1, unicode << 4, startEntry);
-			if (idx != 0xFFFF) {
-				s_dicoArray[entry].m_idxTbl[unicode>>28] = 0xFFFF;
+/*static*/ void CharCache::purgeFont(FontObject* pFont) {
+	if (!s_init) { return; }
+
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		Stripe& stripe = s_stripes[s];
+		MUTEX_LOCK(stripe.mutex);
+		CharCache* pChar = stripe.lruHead;
+		while (pChar) {
+			CharCache* pNext = pChar->m_lruNext;
+			if (pChar->m_pFontObj == pFont) {
+				klb_assert(pChar->m_pinCount == 0, "Font destroyed while its text is being rendered");
+				remove(stripe, pChar);
 			}
+			pChar = pNext;
 		}
-	} else {
-		// Remove entry.
-		s_dicoArray[entry].m_idxTbl[unicode>>28] = 0xFFFF;
+		MUTEX_UNLOCK(stripe.mutex);
 	}
+}
 
-	u16* p16 = s_dicoArray[entry].m_idxTbl;
-	if ((p16[0] == 0xFFFF) && (p16[1] == 0xFFFF) && (p16[2] == 0xFFFF) && (p16[3] == 0xFFFF) && (p16[4] == 0xFFFF) && (p16[5] == 0xFFFF) && (p16[6] == 0xFFFF) && (p16[7] == 0xFFFF) 
-		&& (p16[8] == 0xFFFF) && (p16[9] == 0xFFFF) && (p16[10] == 0xFFFF) && (p16[11] == 0xFFFF) && (p16[12] == 0xFFFF) && (p16[13] == 0xFFFF) && (p16[14] == 0xFFFF) && (p16[15] == 0xFFFF)) {
+/*static*/ void CharCache::setBudget(u32 byteSize) {
+	s_budget = byteSize;
+	if (!s_init) { return; }
 
-		if (entry != startEntry) {	// Never delete the root node
-			removeEntry(entry);
-		}
-
-		return entry;
-	} else {
-		return 0xFFFF;
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		Stripe& stripe = s_stripes[s];
+		MUTEX_LOCK(stripe.mutex);
+		trim(stripe, s_budget / GLYPH_CACHE_STRIPES);
+		MUTEX_UNLOCK(stripe.mutex);
 	}
 }
 
-// ==========================================================================================
-//   Implementation Memory Block
-// ==========================================================================================
-
-/*static*/ void MemoryBlock::reboot() {
-	MemoryBlock* parse = s_blockList;
-	while (parse) {
-		MemoryBlock* next = parse->m_next;
-		delete parse;
-		parse = next;
+/*static*/ void CharCache::getStats(SGlyphCacheStats* pStats) {
+	pStats->hits			= 0;
+	pStats->misses			= 0;
+	pStats->evictions		= 0;
+	pStats->glyphCount		= 0;
+	pStats->memoryUsed		= 0;
+	pStats->memoryBudget	= s_budget;
+	pStats->layoutHits		= FontObject::s_layoutHits;
+	pStats->layoutMisses	= FontObject::s_layoutMisses;
+	if (!s_init) { return; }
+
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		Stripe& stripe = s_stripes[s];
+		MUTEX_LOCK(stripe.mutex);
+		pStats->hits		+= stripe.hits;
+		pStats->misses		+= stripe.misses;
+		pStats->evictions	+= stripe.evictions;
+		pStats->glyphCount	+= stripe.count;
+		pStats->memoryUsed	+= stripe.memUsed;
+		MUTEX_UNLOCK(stripe.mutex);
 	}
-	s_blockList		= NULL;
-	s_blockCounter	= 0;
 }
 
-/*static*/ void MemoryBlock::freeBlock(u16 blockID, u16 subID) {
-	MemoryBlock* parse = s_blockList;
-	MemoryBlock* prev  = NULL;
-	while (parse) {
-		if (parse->m_id == blockID) {
-			parse->m_allocFlag &= ~(1<<subID);	// Reset flag subID
-
-			if (parse->m_allocFlag == 0) {
-				if (parse != s_blockList) {	// Better to keep always ONE block as we need to render text anyway.
-					// ... prev is then ALWAYS a valid pointer.
-					prev->m_next = parse->m_next;
-					delete parse;
-				}
-			}
-			break;
-		}
-		prev  = parse;
-		parse = parse->m_next;
+/*static*/ void CharCache::resetStats() {
+	FontObject::s_layoutHits	= 0;
+	FontObject::s_layoutMisses	= 0;
+	if (!s_init) { return; }
+
+	for (u32 s=0; s < GLYPH_CACHE_STRIPES; s++) {
+		Stripe& stripe = s_stripes[s];
+		MUTEX_LOCK(stripe.mutex);
+		stripe.hits			= 0;
+		stripe.misses		= 0;
+		stripe.evictions	= 0;
+		MUTEX_UNLOCK(stripe.mutex);
 	}
 }
 
-/*static*/ bool MemoryBlock::allocBlock(u16* returnBlock, u16* returnSubID, u8** ppData) {
-	MemoryBlock* parse = s_blockList;
-	while (parse) {
-		u32 flag = parse->m_allocFlag; 
-		if (flag != 0xFFFFFFFF) {
-			u16 size = 16;
-			u16 mask = (1 << size)-1;
-			u16 idx  = 0;
-
-			// log free bit search : 5 iteration only.
-			while (size > 1) {
-				if (((flag>>idx) & mask) != mask) {
-					// Lower part
-				} else {
-					// Higher part
-					idx += size;
-				}
-				size >>= 1;
-				mask >>= size;
-			}
+/*static*/ CharCache* CharCache::rasterize(FontObject* pFont, u32 uniCode) {
+	CharCache* pItem = NULL;
+
+	MUTEX_LOCK(pFont->m_faceMutex);
 
-			if (((flag>>idx) & mask) == mask) {
-				// Higher part
-				idx++;
+	// Render Glyph
+	FT_GlyphSlot glyphslt = pFont->renderChar(uniCode);
+	if (glyphslt) {
+		FT_Bitmap* bmp	= &glyphslt->bitmap;
+		u32 tblOffset	= ((bmp->width * bmp->rows) + 3) & ~3;
+		u32 tblSize		= ((bmp->width+31)>>5)*(bmp->rows<<2);	// number of 32 bit mask for storage.
+		u32 memSize		= tblOffset + tblSize;
+
+		pItem = KLBNEW(CharCache);
+		u8* ptrBuff = pItem ? KLBNEWA(u8, memSize ? memSize : 4) : NULL;
+		if (ptrBuff) {
+			pItem->m_unicode	= uniCode;
+			pItem->m_width		= bmp->width;
+			pItem->m_height		= bmp->rows;
+			pItem->m_offsetX	= glyphslt->bitmap_left;
+			pItem->m_offsetY	= -glyphslt->bitmap_top;
+			pItem->m_advanceX	= (s8)(glyphslt->advance.x >> 6);
+			pItem->m_advanceY	= (s8)(glyphslt->advance.y >> 6);
+			pItem->m_tblOffset	= tblOffset;
+			pItem->m_ptr		= ptrBuff;
+			pItem->m_pFontObj	= pFont;
+			pItem->m_hashNext	= NULL;
+			pItem->m_lruPrev	= NULL;
+			pItem->m_lruNext	= NULL;
+			pItem->m_memSize	= memSize + sizeof(CharCache);
+			pItem->m_pinCount	= 0;
+			pItem->m_stripe		= 0;
+
+			u8* write	= pItem->m_ptr;
+			u8* src		= bmp->buffer;
+			for (int y=0; y < bmp->rows; y++) {
+				memcpy(write, src, bmp->width);
+				src		+= bmp->pitch;
+				write	+= bmp->width;
 			}
-			parse->m_allocFlag |= 1<<idx;
-			*returnBlock	= parse->m_id;
-			*returnSubID	= idx;
-			*ppData			= &parse->m_mem[MB_BLOCK_ITEM_SIZE * idx];
-			return true;
-		}
-		parse = parse->m_next;
-	}
 
-	parse = new MemoryBlock();
-	if (parse) {
-		parse->m_next	= s_blockList;
-		s_blockList		= parse;
+			u32* p = (u32*)&pItem->m_ptr[pItem->m_tblOffset];
+			for (int x=0; x < bmp->width; x += 32) {
+				bool last = (x + 32) >= bmp->width;
+				u32 ex = 32;
 
-		parse->m_allocFlag	= 1;
-		parse->m_id			= s_blockCounter++;
-		parse->partSize		= MB_BLOCK_ITEM_SIZE;
+				if (last) {
+					if (bmp->width != 32) {
+						ex = bmp->width & 0x1F;
+					}
+				}
 
-		*returnBlock	= parse->m_id;
-		*returnSubID	= 0;
-		*ppData			= &parse->m_mem[0];
+				for (int y=0; y < bmp->rows; y++) {
+					u32 mask = 0;
 
-		return true;
-	} else {
-		return false;
+					u8* ptr = &pItem->m_ptr[x + (y * bmp->width)]; 
+					for (u32 xi=0; xi < ex; xi++) {
+						if (*ptr++) {
+							mask |= 1 << xi;
+						}
+					}
+					*p++ = mask;
+				}
+			}
+		} else if (pItem) {
+			pItem->m_ptr = NULL;
+			KLBDELETE(pItem);
+			pItem = NULL;
+		}
 	}
+
+	MUTEX_UNLOCK(pFont->m_faceMutex);
+	return pItem;
 }
 
 /*static*/ const char* FontObject::getFileFromFontName(const char* fontName, char* tmpBuffer) {
@@ -536,6 +527,11 @@ CharDictionnary::CharDictionnary()
 			// s_list modified by destroyFont
 			destroyFont(s_list, true);
 		}
+		purgeTextInfo(NULL);
+		if (s_textInfoMutex) {
+			CPFInterface::getInstance().platform().freeMutex(s_textInfoMutex);
+			s_textInfoMutex = NULL;
+		}
 		FT_Done_FreeType( s_library );
 		for (u32 n=0; n < g_fontInstalled; n++) {
 			delete g_fonts[n].physicalName;		// Porting layer 'new'
@@ -654,8 +650,11 @@ CharDictionnary::CharDictionnary()
 				pFont->m_lenName	= lenN;
 				pFont->m_name		= fontName ? CKLBUtility::copyString(fontName) : NULL;
 				pFont->m_hasKerning = FT_HAS_KERNING( face );
-				pFont->m_dicoStart	= CharDictionnary::createDicoEntry();
-				if (pFont->m_dicoStart != 0xFFFF) {
+				pFont->m_faceMutex	= CPFInterface::getInstance().platform().allocMutex();
+				if (!s_textInfoMutex) {
+					s_textInfoMutex = CPFInterface::getInstance().platform().allocMutex();
+				}
+				if (pFont->m_faceMutex && s_textInfoMutex && CharCache::init()) {
 					return pFont;
 				}
 				destroyFont(pFont);
@@ -689,10 +688,13 @@ CharDictionnary::CharDictionnary()
 				pFont->m_next->m_prev = pFont->m_prev;
 			}
 			
-			// 2. Destroy face
+			// 2. Drop cached glyphs, destroy face
+			CharCache::purgeFont(pFont);
+			purgeTextInfo(pFont);
 			FT_Done_Face ( pFont->m_face );
-
-			CharDictionnary::destroyTree(pFont->m_dicoStart, 0);
+			if (pFont->m_faceMutex) {
+				CPFInterface::getInstance().platform().freeMutex(pFont->m_faceMutex);
+			}
 
 			// 3. Destroy object
 			delete pFont;
@@ -705,13 +707,6 @@ FontObject::FontObject()
 
 FontObject::~FontObject()
 {
-	// Scan all the allocated character and remove any pointer reference to font object.
-	for (int n=0; n < CharCache::s_allocCounter; n++) {
-		if (CharCache::s_cacheArray[n].m_pFontObj == this) {
-			CharCache::s_cacheArray[n].m_pFontObj = NULL;
-		}
-	}
-
 	KLBDELETEA(m_name);
 	m_name = NULL;
 }
@@ -734,122 +729,204 @@ FT_GlyphSlot FontObject::renderChar(u32 unicode) {
 	}
 }
 
-/*static*/ CharCache* CharCache::createEntry(u32 uniCode, u16* outIdx, FontObject* pFont) {
-	CharCache* pItem = NULL;
+// ==========================================================================================
+//   Glyph span kernels
+// ==========================================================================================
 
-	// Render Glyph
-	FT_GlyphSlot glyphslt = pFont->renderChar(uniCode);
-	
-	// Add to block	
-	u16 blockIdx;
-	u16 blockCharIdx;
-	u8* ptrBuff;
-
-	if (glyphslt && MemoryBlock::allocBlock(&blockIdx, &blockCharIdx, &ptrBuff)) {
-		u16 idx;
-		if (s_allocCounter < CHAR_CACHE_SIZE) {
-			idx = s_allocCounter++;
-		} else {
-			idx = s_cacheEnd;
-			CharCache* pItem = &s_cacheArray[idx];
-			// 1.Remove from link list -> maintain head AND queue.
-			if (pItem->m_prev != 0xFFFF) {
-				s_cacheArray[pItem->m_prev].m_next = 0xFFFF;
-				s_cacheEnd = pItem->m_prev;
-			} else {
-				s_cacheEnd = s_cacheStart; // Should never arrive
+//
+// Write one glyph row to the target, 'mask' has one bit per covered source pixel.
+// Fully covered 16 / 4 pixel runs take the vector path, partial runs are per pixel.
+// Target pixel is the text color with the glyph coverage as alpha (no blending with target).
+//
+static inline void spanWrite8888(u8* dst, const u8* src, u32 mask, u32 rgb32) {
+	while (mask) {
+		if ((mask & 0xFFFF) == 0xFFFF) {
+#if defined(FNT_SIMD_SSE2)
+			__m128i col	= _mm_set1_epi32(rgb32);
+			__m128i a	= _mm_loadu_si128((const __m128i*)src);
+			__m128i z	= _mm_setzero_si128();
+			__m128i lo	= _mm_unpacklo_epi8(z, a);	// coverage in high byte of each 16 bit.
+			__m128i hi	= _mm_unpackhi_epi8(z, a);
+			_mm_storeu_si128((__m128i*)&dst[ 0], _mm_or_si128(col, _mm_unpacklo_epi16(z, lo)));
+			_mm_storeu_si128((__m128i*)&dst[16], _mm_or_si128(col, _mm_unpackhi_epi16(z, lo)));
+			_mm_storeu_si128((__m128i*)&dst[32], _mm_or_si128(col, _mm_unpacklo_epi16(z, hi)));
+			_mm_storeu_si128((__m128i*)&dst[48], _mm_or_si128(col, _mm_unpackhi_epi16(z, hi)));
+#elif defined(FNT_SIMD_NEON)
+			uint8x16x4_t px;
+			px.val[0] = vdupq_n_u8((u8)(rgb32));
+			px.val[1] = vdupq_n_u8((u8)(rgb32>>8));
+			px.val[2] = vdupq_n_u8((u8)(rgb32>>16));
+			px.val[3] = vld1q_u8(src);
+			vst4q_u8(dst, px);
+#else
+			u32* d = (u32*)dst;
+			for (u32 n=0; n < 16; n++) {
+				d[n] = rgb32 | ((u32)src[n] << 24);
 			}
+#endif
+			dst  += 16*4;
+			src  += 16;
+			mask >>= 16;
+			continue;
+		}
 
-			// 2.Remove data from block
-			MemoryBlock::freeBlock(pItem->m_blockIndex, pItem->m_blockCharIndex);
+		// Write RGBA then overwrite alpha.
+		#define RGB(idx)	(*((u32*)(&dst[idx<<2])))=rgb32
+
+		switch (mask & 0xF) {
+		case 0x0: break;
+		case 0x1: RGB(0); dst[ 3] = src[0]; break;
+		case 0x2: RGB(1); dst[ 7] = src[1]; break;
+		case 0x3: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; break;
+		case 0x4: RGB(2); dst[11] = src[2]; break;
+		case 0x5: RGB(0); dst[ 3] = src[0]; RGB(2); dst[11] = src[2]; break;
+		case 0x6: RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; break;
+		case 0x7: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; break;
+		case 0x8: RGB(3); dst[15] = src[3]; break;
+		case 0x9: RGB(0); dst[ 3] = src[0]; RGB(3); dst[15] = src[3]; break;
+		case 0xA: RGB(1); dst[ 7] = src[1]; RGB(3); dst[15] = src[3]; break;
+		case 0xB: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(3); dst[15] = src[3]; break;
+		case 0xC: RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
+		case 0xD: RGB(0); dst[ 3] = src[0]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
+		case 0xE: RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
+		case 0xF: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
+		}
+		#undef RGB
+		dst += 4*4;
+		src += 4;
+		mask >>= 4;
+	}
+}
 
-			// 3.Remove entry from dictionnary
-			if (pItem->m_pFontObj) {
-				CharDictionnary::removeDicoEntry(pItem->m_pFontObj->m_dicoStart, pItem->m_unicode);
+static inline void spanWrite4444(u16* dst, const u8* src, u32 mask, u16 rgb16) {
+	while (mask) {
+		if ((mask & 0xFF) == 0xFF) {
+#if defined(FNT_SIMD_SSE2)
+			__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), _mm_setzero_si128());
+			_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_set1_epi16(rgb16), _mm_srli_epi16(a, 4)));
+#elif defined(FNT_SIMD_NEON)
+			uint16x8_t a = vshrq_n_u16(vmovl_u8(vld1_u8(src)), 4);
+			vst1q_u16(dst, vorrq_u16(vdupq_n_u16(rgb16), a));
+#else
+			for (u32 n=0; n < 8; n++) {
+				dst[n] = rgb16 | (src[n]>>4);
 			}
+#endif
+			dst  += 8;
+			src  += 8;
+			mask >>= 8;
+			continue;
 		}
-		
-		pItem = &s_cacheArray[idx];
-		*outIdx = idx;
-		pItem->m_unicode = uniCode;
-
-		// Add to link list
-		pItem->m_next	 = s_cacheStart;
-		pItem->m_prev	 = 0xFFFF;
-		if (s_cacheStart != 0xFFFF) {
-			s_cacheArray[s_cacheStart].m_prev = idx;
+
+		#define RGBA(idx)	dst[idx]=(rgb16 | (src[idx]>>4))
+
+		switch (mask & 0xF) {
+		case 0x0: break;
+		case 0x1: RGBA(0); break;
+		case 0x2: RGBA(1); break;
+		case 0x3: RGBA(0); RGBA(1); break;
+		case 0x4: RGBA(2); break;
+		case 0x5: RGBA(0); RGBA(2); break;
+		case 0x6: RGBA(1); RGBA(2); break;
+		case 0x7: RGBA(0); RGBA(1); RGBA(2); break;
+		case 0x8: RGBA(3); break;
+		case 0x9: RGBA(0); RGBA(3); break;
+		case 0xA: RGBA(1); RGBA(3); break;
+		case 0xB: RGBA(0); RGBA(1); RGBA(3); break;
+		case 0xC: RGBA(2); RGBA(3); break;
+		case 0xD: RGBA(0); RGBA(2); RGBA(3); break;
+		case 0xE: RGBA(1); RGBA(2); RGBA(3); break;
+		case 0xF: RGBA(0); RGBA(1); RGBA(2); RGBA(3); break;
 		}
-		s_cacheStart = idx;	// s_cacheEnd is 0 by default -> always point to first allocated item.
-
-		FT_Bitmap* bmp		= &glyphslt->bitmap;
-		pItem->m_width		= bmp->width;
-		pItem->m_height		= bmp->rows;
-		pItem->m_offsetX	= glyphslt->bitmap_left;
-		pItem->m_offsetY	= -glyphslt->bitmap_top;
-		pItem->m_advanceX	= (s8)(glyphslt->advance.x >> 6);
-		pItem->m_advanceY	= (s8)(glyphslt->advance.y >> 6);
-		pItem->m_blockIndex	= blockIdx;
-		pItem->m_blockCharIndex = blockCharIdx;
-		pItem->m_ptr		= ptrBuff;
-		pItem->m_pFontObj	= pFont;
-
-		u8* write	= pItem->m_ptr;
-		u8* src		= bmp->buffer;
-//#define PRESKIP
-
-#ifdef PRESKIP
-		write++;
-#endif
-		for (int y=0; y < bmp->rows; y++) {
-#ifdef PRESKIP
-			u8 start = 0xFF;
-			for (int x=0; x < bmp->width; x++) {
-				if ((*src) && (start==0xFF)) {
-					start = x;
-				}
-				*write++ = *src++;
+		#undef RGBA
+		dst += 4;
+		src += 4;
+		mask >>= 4;
+	}
+}
+
+/*static*/ u32* FontObject::decodeText(const char* text, u32* stackBuffer, u32 stackSize, u32* pCount) {
+	unsigned count = stackSize;
+	int err = wind_utf8ucs4(text, (unsigned*)stackBuffer, &count);
+	if (err == 0) {
+		*pCount = count;
+		return stackBuffer;
+	}
+
+	if (err == WIND_ERR_OVERRUN) {
+		// Longer than the stack buffer : measure and decode into heap.
+		if (wind_utf8ucs4(text, NULL, &count) == 0) {
+			u32* buffer = KLBNEWA(u32, count);
+			if (buffer && (wind_utf8ucs4(text, (unsigned*)buffer, &count) == 0)) {
+				*pCount = count;
+				return buffer;
 			}
-			write[-(bmp->width+1)] = start;
-			write++;
-#else
-			memcpy(write, src, bmp->width);
-			src		+= bmp->pitch;
-			write	+= bmp->width;
-#endif
+			KLBDELETEA(buffer);
 		}
+	}
+	*pCount = 0;
+	return NULL;
+}
 
-		pItem->m_tblOffset = ((pItem->m_width * bmp->rows) + 3) & 0xFFFC;
-		u32 size = ((bmp->width+31)>>5)*(bmp->rows<<2);	// number of 32 bit mask for storage. 
-		if ((pItem->m_tblOffset < MB_BLOCK_ITEM_SIZE) && ((pItem->m_tblOffset+size) <= MB_BLOCK_ITEM_SIZE)) {
-			u32* p = (u32*)&pItem->m_ptr[pItem->m_tblOffset];
-			for (int x=0; x < bmp->width; x += 32) {
-				bool last = (x + 32) >= bmp->width;
-				u32 ex = 32;
+// ==========================================================================================
+//   Layout cache
+// ==========================================================================================
 
-				if (last) {
-					if (bmp->width != 32) {
-						ex = bmp->width & 0x1F;
-					}
-				}
+static u32 hashText(const char* text, u32* pLen) {
+	// FNV-1a
+	u32 h = 2166136261u;
+	const u8* p = (const u8*)text;
+	while (*p) {
+		h = (h ^ *p++) * 16777619u;
+	}
+	*pLen = (u32)((const char*)p - text);
+	return h;
+}
 
-				for (int y=0; y < bmp->rows; y++) {
-					u32 mask = 0;
+/*static*/ bool FontObject::findTextInfo(FontObject* pFont, const char* text, u32 hash, STextInfo* result) {
+	bool found = false;
+	MUTEX_LOCK(s_textInfoMutex);
+	TEXTINFO& entry = s_textInfo[hash & (TEXT_INFO_CACHE_SIZE-1)];
+	if ((entry.pFont == pFont) && (entry.hash == hash) && (strcmp(entry.text, text) == 0)) {
+		*result = entry.info;
+		found = true;
+		s_layoutHits++;
+	} else {
+		s_layoutMisses++;
+	}
+	MUTEX_UNLOCK(s_textInfoMutex);
+	return found;
+}
 
-					u8* ptr = &pItem->m_ptr[x + (y * bmp->width)]; 
-					for (u32 xi=0; xi < ex; xi++) {
-						if (*ptr++) {
-							mask |= 1 << xi;
-						}
-					}
-					*p++ = mask;
-				}
-			}
-		} else {
-			klb_assertAlways("Font char does not fit into cache size : MB_BLOCK_ITEM_SIZE");
+/*static*/ void FontObject::storeTextInfo(FontObject* pFont, const char* text, u32 hash, const STextInfo* info) {
+	const char* copy = CKLBUtility::copyString(text);
+	if (!copy) { return; }
+
+	MUTEX_LOCK(s_textInfoMutex);
+	TEXTINFO& entry = s_textInfo[hash & (TEXT_INFO_CACHE_SIZE-1)];
+	const char* old	= entry.text;
+	entry.pFont	= pFont;
+	entry.text	= copy;
+	entry.hash	= hash;
+	entry.info	= *info;
+	MUTEX_UNLOCK(s_textInfoMutex);
+
+	KLBDELETEA(old);
+}
+
+/*static*/ void FontObject::purgeTextInfo(FontObject* pFont) {
+	if (!s_textInfoMutex) { return; }
+
+	MUTEX_LOCK(s_textInfoMutex);
+	for (u32 n=0; n < TEXT_INFO_CACHE_SIZE; n++) {
+		TEXTINFO& entry = s_textInfo[n];
+		if (entry.text && ((pFont == NULL) || (entry.pFont == pFont))) {
+			KLBDELETEA(entry.text);
+			entry.text	= NULL;
+			entry.pFont	= NULL;
 		}
 	}
-
-	return pItem;
+	MUTEX_UNLOCK(s_textInfoMutex);
 }
 
 void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32 colorARGB8888, u32 buffWidth, u32 buffHeight, s32 strideByte, bool use4444) {
@@ -869,15 +946,15 @@ void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32
 			  | ((colorARGB8888 >> 0) & 0x00F0)		// Blue
 			  ;
 
-	u32 arrayUnicode[1500];
-	u32 charCount = 1500;
+	u32 stackUnicode[256];
+	u32 charCount;
+	u32* arrayUnicode = decodeText(text, stackUnicode, 256, &charCount);
 
-	if (wind_utf8ucs4(text, arrayUnicode, &charCount) == 0)
 	for (u32 n=0; n < charCount; n++) {
 		u32 charcode = arrayUnicode[n];
 		// DEBUG_PRINT("RENDERING; letter: %x(%c)", charcode, (char)charcode);
 
-		CharCache* pChar = CharDictionnary::getChar(charcode, this);
+		CharCache* pChar = CharCache::acquire(charcode, this);
 		
 		if (pChar) {
 			//========================================
@@ -929,6 +1006,7 @@ void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32
 
 			if ((Wwidth<=0) || (Wheight<=0)) {
 				currX += pChar->m_advanceX;
+				CharCache::release(pChar);
 				continue;
 			}
 			// DEBUG_PRINT("RENDERING; survived clipping");
@@ -977,72 +1055,18 @@ void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32
 				//  Rendering
 				//----------------------------------------
 				u32* pMaskInfo	= (u32*)&pChar->m_ptr[pChar->m_tblOffset + ((pChar->m_height<<2)*(slab>>5)) + (startY<<2)];
-#ifdef PRESKIP
-				u8* buffSrc		= &pChar->m_ptr[1];
-				s32 strideSrc	= pChar->m_width - 1;
-#else
 				u8* buffSrc		= pChar->m_ptr;
 				s32 strideSrc	= pChar->m_width;
-#endif
 				u32 roundX		= (((startX & 0x1F)>>2)<<2);
 				u8* pSrcL		= &buffSrc		[roundX + (startY * strideSrc) + slab];
 
 				if (use4444) {
 					u16* pDstL	= (u16*)(&Buffer8888	[(px<<1) + (py * strideByte) + (slab << 1)]);
 					u16* pDstE	= &pDstL[Wheight * (strideByte >> 1)];
-				
-					//
-					// Could do a fct ptr here if various rendering needed (ie alpha)
-					// fct(pDstL, pDstE, pSrcL, pMaskInfo, clipMask, roundX, rgb32)
-					//
+
 					while (pDstL < pDstE) {
-						//
-						// Render the slab
-						//
-						// 1. recompute roundX with start : roundX += roundX - start>roundX)
-
-	#ifdef PRESKIP
-						s32 delta = pSrcL[-1] - roundX;
-						delta	= (delta < 0) ? 0 : (delta>>2)<<2;
-						roundX	+= delta;
-	#endif
 						u32 mask = (*pMaskInfo++) & clipMask;
-						mask >>= roundX;
-	#ifdef PRESKIP
-						u8* src = &pSrcL[delta];
-	#else
-						u8* src = pSrcL;
-	#endif
-						u16* dst = pDstL;
-
-						while (mask) {
-							// Write RGBA then overwrite alpha.
-							// #define RGBA(idx,alpha)	dst[idx]=(rgb16 | ((src[idx] >>1)>>4))
-							#define RGBA(idx)	dst[idx]=(rgb16 | (src[idx]>>4))
-
-							switch (mask & 0xF) {
-							case 0x0: break;
-							case 0x1: RGBA(0); break;
-							case 0x2: RGBA(1); break;
-							case 0x3: RGBA(0); RGBA(1); break;
-							case 0x4: RGBA(2); break;
-							case 0x5: RGBA(0); RGBA(2); break;
-							case 0x6: RGBA(1); RGBA(2); break;
-							case 0x7: RGBA(0); RGBA(1); RGBA(2); break;
-							case 0x8: RGBA(3); break;
-							case 0x9: RGBA(0); RGBA(3); break;
-							case 0xA: RGBA(1); RGBA(3); break;
-							case 0xB: RGBA(0); RGBA(1); RGBA(3); break;
-							case 0xC: RGBA(2); RGBA(3); break;
-							case 0xD: RGBA(0); RGBA(2); RGBA(3); break;
-							case 0xE: RGBA(1); RGBA(2); RGBA(3); break;
-							case 0xF: RGBA(0); RGBA(1); RGBA(2); RGBA(3); break;
-							}
-							#undef RGBA
-							dst += 4;
-							src += 4;
-							mask >>= 4;
-						}
+						spanWrite4444(pDstL, pSrcL, mask >> roundX, rgb16);
 
 						pSrcL += strideSrc;
 						pDstL += strideByte>>1;
@@ -1050,61 +1074,10 @@ void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32
 				} else {
 					u8* pDstL		= &Buffer8888	[(px<<2) + (py * strideByte) + (slab << 2)];
 					u8* pDstE		= &pDstL		[Wheight * strideByte];
-				
-					//
-					// Could do a fct ptr here if various rendering needed (ie alpha)
-					// fct(pDstL, pDstE, pSrcL, pMaskInfo, clipMask, roundX, rgb32)
-					//
+
 					while (pDstL < pDstE) {
-						//
-						// Render the slab
-						//
-						// 1. recompute roundX with start : roundX += roundX - start>roundX)
-
-	#ifdef PRESKIP
-						s32 delta = pSrcL[-1] - roundX;
-						delta	= (delta < 0) ? 0 : (delta>>2)<<2;
-						roundX	+= delta;
-	#endif
 						u32 mask = (*pMaskInfo++) & clipMask;
-						mask >>= roundX;
-	#ifdef PRESKIP
-						u8* src = &pSrcL[delta];
-	#else
-						u8* src = pSrcL;
-	#endif
-						u8* dst = pDstL;
-
-						#define DBG(idx)	(*((u32*)(&dst[idx<<2])))=0xFFFF00FF;
-						// DBG(0);
-
-						while (mask) {
-							// Write RGBA then overwrite alpha.
-							#define RGB(idx)	(*((u32*)(&dst[idx<<2])))=rgb32
-
-							switch (mask & 0xF) {
-							case 0x0: break;
-							case 0x1: RGB(0); dst[ 3] = src[0]; break;
-							case 0x2: RGB(1); dst[ 7] = src[1]; break;
-							case 0x3: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; break;
-							case 0x4: RGB(2); dst[11] = src[2]; break;
-							case 0x5: RGB(0); dst[ 3] = src[0]; RGB(2); dst[11] = src[2]; break;
-							case 0x6: RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; break;
-							case 0x7: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; break;
-							case 0x8: RGB(3); dst[15] = src[3]; break;
-							case 0x9: RGB(0); dst[ 3] = src[0]; RGB(3); dst[15] = src[3]; break;
-							case 0xA: RGB(1); dst[ 7] = src[1]; RGB(3); dst[15] = src[3]; break;
-							case 0xB: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(3); dst[15] = src[3]; break;
-							case 0xC: RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
-							case 0xD: RGB(0); dst[ 3] = src[0]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
-							case 0xE: RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
-							case 0xF: RGB(0); dst[ 3] = src[0]; RGB(1); dst[ 7] = src[1]; RGB(2); dst[11] = src[2]; RGB(3); dst[15] = src[3]; break;
-							}
-							#undef RGB
-							dst += 4*4;
-							src += 4;
-							mask >>= 4;
-						}
+						spanWrite8888(pDstL, pSrcL, mask >> roundX, rgb32);
 
 						pSrcL += strideSrc;
 						pDstL += strideByte;
@@ -1112,20 +1085,33 @@ void FontObject::renderText	(s32 x, s32 y, const char* text, u8* Buffer8888, u32
 				}
 			}
 			currX += pChar->m_advanceX;
+			CharCache::release(pChar);
 		}
 	}
+
+	if (arrayUnicode != stackUnicode) {
+		KLBDELETEA(arrayUnicode);
+	}
 }
 
 void FontObject::getTextInfo(const char* text, STextInfo* result) {
+	u32 len;
+	u32 hash = hashText(text, &len);
+	bool cacheable = (len <= TEXT_INFO_MAX_LENGTH);
+	if (cacheable && findTextInfo(this, text, hash, result)) {
+		return;
+	}
+
 	s32 currX = 0;
 	s32 maxX  = 0;
-	u32 arrayUnicode[1500];
-	u32 charCount = 1500;
-	if (wind_utf8ucs4(text, arrayUnicode, &charCount) == 0) {
+	u32 stackUnicode[TEXT_INFO_MAX_LENGTH];
+	u32 charCount;
+	u32* arrayUnicode = decodeText(text, stackUnicode, TEXT_INFO_MAX_LENGTH, &charCount);
+	if (arrayUnicode) {
 		for (u32 n=0; n < charCount; n++) {
 			u32 charcode = arrayUnicode[n];
 
-			CharCache* pChar = CharDictionnary::getChar(charcode, this);
+			CharCache* pChar = CharCache::acquire(charcode, this);
 		
 			if (pChar) {
 				s32 Wwidth		= pChar->m_width;
@@ -1135,6 +1121,7 @@ void FontObject::getTextInfo(const char* text, STextInfo* result) {
 					maxX = ex;
 				}
 				currX 		   += pChar->m_advanceX;
+				CharCache::release(pChar);
 			}
 		}
 
@@ -1147,6 +1134,13 @@ void FontObject::getTextInfo(const char* text, STextInfo* result) {
 		result->descent = met->descender>> 6;
 		result->top		= result->ascent + (result->height - (result->ascent - result->descent)) / 3.0f;
 		result->bottom	= result->top - result->height;
+
+		if (arrayUnicode != stackUnicode) {
+			KLBDELETEA(arrayUnicode);
+		}
+		if (cacheable) {
+			storeTextInfo(this, text, hash, result);
+		}
 	} else {
 		result->height	= 0.0f;
 		result->ascent  = 0.0f;
@@ -1158,3 +1152,118 @@ void FontObject::getTextInfo(const char* text, STextInfo* result) {
 	// 		result->height, result->ascent, result->descent, result->top, result->bottom);
 }
 
+
+#ifdef INTERNAL_BENCH
+// Default font at 24 px : acquire / release the ASCII set once cached (hits),
+// then cycle 2048 CJK glyphs through a 64 KB budget (misses + evictions).
+static bool benchGlyphCache(u32 loops) {
+	FontObject* pFont = FontObject::createFont(NULL, 24);
+	if (!pFont) { return false; }
+
+	SGlyphCacheStats before;
+	CharCache::getStats(&before);
+	bool ok = true;
+
+	// Warm up.
+	for (u32 c = 32; c < 127; c++) {
+		CharCache* pChar = CharCache::acquire(c, pFont);
+		if (!pChar) { ok = false; break; }
+		CharCache::release(pChar);
+	}
+
+	s64 timeHit = 0;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 c = 32; c < 127; c++) {
+			CharCache* pChar = CharCache::acquire(c, pFont);
+			if (!pChar) { ok = false; break; }
+			CharCache::release(pChar);
+		}
+		timeHit += CKLBBenchmark::now() - t0;
+	}
+
+	CharCache::setBudget(64 * 1024);
+	u32 missLoops	= (loops + 99) / 100;
+	s64 timeMiss	= 0;
+	for (u32 l = 0; ok && (l < missLoops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 c = 0x4E00; c < 0x4E00 + 2048; c++) {
+			CharCache* pChar = CharCache::acquire(c, pFont);
+			if (!pChar) { ok = false; break; }
+			CharCache::release(pChar);
+		}
+		timeMiss += CKLBBenchmark::now() - t0;
+	}
+	CharCache::setBudget(before.memoryBudget);
+
+	SGlyphCacheStats after;
+	CharCache::getStats(&after);
+	FontObject::destroyFont(pFont);
+
+	CKLBBenchmark::report("ASCII acquire, cached",		loops * 95,			timeHit);
+	CKLBBenchmark::report("CJK acquire, 64 KB budget",	missLoops * 2048,	timeMiss);
+	CPFInterface::getInstance().platform().logging("[BENCH] hits:%i misses:%i evictions:%i\n",
+		after.hits - before.hits, after.misses - before.misses, after.evictions - before.evictions);
+	return ok;
+}
+
+static CKLBBenchmark gBenchGlyphCache("GLYPHCACHE", benchGlyphCache);
+#endif
+
+#ifdef INTERNAL_BENCH
+// Default font at 24 px : render one line in ARGB8888 and ARGB4444 buffers,
+// measure the same text (layout cache hit) and 256 different texts (misses).
+// A cached measurement must match the measurement that filled the cache.
+static bool benchText(u32 loops) {
+	enum { WIDTH = 512, HEIGHT = 64 };
+	static const char* line = "The quick brown fox jumps over the lazy dog 0123456789";
+
+	FontObject* pFont = FontObject::createFont(NULL, 24);
+	if (!pFont) { return false; }
+	u8* pBuffer = KLBNEWA(u8, WIDTH * HEIGHT * 4);
+	if (!pBuffer) {
+		FontObject::destroyFont(pFont);
+		return false;
+	}
+
+	char texts[256][32];
+	for (u32 n = 0; n < 256; n++) { sprintf(texts[n], "Score %u pts", n * 7919); }
+
+	STextInfo first;
+	STextInfo cached;
+	pFont->getTextInfo(line, &first);
+	pFont->getTextInfo(line, &cached);
+	bool ok = (memcmp(&first, &cached, sizeof(STextInfo)) == 0);
+
+	s64 time8888	= 0;
+	s64 time4444	= 0;
+	s64 timeHit		= 0;
+	s64 timeMiss	= 0;
+	for (u32 l = 0; l < loops; l++) {
+		s64 t0 = CKLBBenchmark::now();
+		pFont->renderText(0, 40, line, pBuffer, 0xFFFFFFFF, WIDTH, HEIGHT, WIDTH * 4, false);
+		s64 t1 = CKLBBenchmark::now();
+		pFont->renderText(0, 40, line, pBuffer, 0xFFFFFFFF, WIDTH, HEIGHT, WIDTH * 2, true);
+		s64 t2 = CKLBBenchmark::now();
+		for (u32 n = 0; n < 16; n++) { pFont->getTextInfo(line, &cached); }
+		s64 t3 = CKLBBenchmark::now();
+		for (u32 n = 0; n < 16; n++) { pFont->getTextInfo(texts[(l * 16 + n) & 255], &cached); }
+		s64 t4 = CKLBBenchmark::now();
+		time8888	+= t1 - t0;
+		time4444	+= t2 - t1;
+		timeHit		+= t3 - t2;
+		timeMiss	+= t4 - t3;
+	}
+
+	KLBDELETEA(pBuffer);
+	FontObject::destroyFont(pFont);
+
+	CKLBBenchmark::report("renderText 54 chars, 8888",	loops,		time8888);
+	CKLBBenchmark::report("renderText 54 chars, 4444",	loops,		time4444);
+	CKLBBenchmark::report("getTextInfo, same text",		loops * 16,	timeHit);
+	CKLBBenchmark::report("getTextInfo, 256 texts",		loops * 16,	timeMiss);
+	return ok;
+}
+
+static CKLBBenchmark gBenchText("TEXT", benchText);
+#endif
@@ -32,17 +32,35 @@
 // ==========================================================================================
 //   Definitions
 // ==========================================================================================
-struct CharDictionnary;
 struct CharCache;
-struct MemoryBlock;
 class  FntDebug;
+
+#define TEXT_INFO_CACHE_SIZE		(128)	// Power of 2.
+#define TEXT_INFO_MAX_LENGTH		(256)	// Longer strings are measured every time.
+
+//
+// Glyph cache statistics, summed over all stripes.
+//
+struct SGlyphCacheStats {
+	u32	hits;
+	u32	misses;
+	u32	evictions;
+	u32	glyphCount;
+	u32	memoryUsed;		// Bytes (glyph bitmap, mask table and entry).
+	u32	memoryBudget;	// Bytes.
+	u32	layoutHits;		// getTextInfo served from the layout cache.
+	u32	layoutMisses;
+};
+
 namespace FontSystem {
 	void reboot();
+	void setCacheBudget(u32 byteSize);
+	void getCacheStats(SGlyphCacheStats* pStats);
+	void resetCacheStats();
 };
 
 struct FontObject {
 	friend class FntDebug;
-	friend struct CharDictionnary;
 	friend struct CharCache;
 public:
 	static bool	registerFont(const char* logicalName, const char* physicalFont, bool asDefault);
@@ -69,10 +87,10 @@ private:
 	FontObject* m_next;
 	
 	FT_Face		m_face;
+	void*		m_faceMutex;	// FT_Face glyph slot is not thread safe : serialize rasterization.
 	u32			m_lenName;
 	u32 		m_size;
 	u32			m_refCount;
-	u16			m_dicoStart;
 	FT_Bool		m_hasKerning;
 	const char*	m_name;
 
@@ -86,23 +104,53 @@ private:
 	static u32			g_fontInstalled;
 
 	static const char* getFileFromFontName(const char* fontName, char* tmpBuffer);
+	static u32* decodeText(const char* text, u32* stackBuffer, u32 stackSize, u32* pCount);
+
+	//
+	// Layout cache : getTextInfo result for (font, text), direct mapped by text hash.
+	//
+	struct TEXTINFO {
+		FontObject*	pFont;
+		const char*	text;
+		u32			hash;
+		STextInfo	info;
+	};
+
+	static bool	findTextInfo	(FontObject* pFont, const char* text, u32 hash, STextInfo* result);
+	static void	storeTextInfo	(FontObject* pFont, const char* text, u32 hash, const STextInfo* info);
+	static void	purgeTextInfo	(FontObject* pFont);	// NULL : all fonts.
+
+	static TEXTINFO		s_textInfo[TEXT_INFO_CACHE_SIZE];
+	static void*		s_textInfoMutex;
+	static u32			s_layoutHits;
+	static u32			s_layoutMisses;
 };
 
-#define CHAR_CACHE_SIZE	(512)
+//
+// Glyph cache : hashed by (font, unicode), LRU eviction against a memory budget.
+// Split in independent stripes, each with its own lock, table and LRU list,
+// so that text can be rasterized from several threads.
+// Font objects are created / destroyed from the main thread only.
+//
+#define GLYPH_CACHE_STRIPES			(8)
+#define GLYPH_CACHE_BUCKETS			(256)	// Per stripe, power of 2.
+#define GLYPH_CACHE_DEFAULT_BUDGET	(2*1024*1024)
 
 struct CharCache {
 	friend class FntDebug;
-	friend struct CharDictionnary;
 	friend struct FontObject;
 public:
-	static CharCache* createEntry(u32 uniCode, u16* outIndex, FontObject* pFont);
-	
+	// Returned entry is pinned until release() : it can not be evicted while in use.
+	static CharCache* acquire(u32 uniCode, FontObject* pFont);
+	static void release(CharCache* pChar);
+
+	static void purgeFont(FontObject* pFont);
+	static void setBudget(u32 byteSize);
+	static void getStats(SGlyphCacheStats* pStats);
+	static void resetStats();
+
 	static void test();
-	static void reboot() {
-		s_cacheStart	= 0xFFFF;
-		s_cacheEnd		= 0;
-		s_allocCounter	= 0;
-	}
+	static void reboot();
 
 	u8* m_ptr;
 	FontObject* m_pFontObj;
@@ -112,11 +160,13 @@ public:
 	s32 m_offsetX;
 	s32	m_offsetY;
 private:
-	u16	m_next;
-	u16 m_prev;
+	CharCache*	m_hashNext;
+	CharCache*	m_lruPrev;		// More recently used.
+	CharCache*	m_lruNext;		// Less recently used.
+	u32			m_memSize;
+	u16			m_pinCount;
+	u16			m_stripe;
 public:
-	u16 m_blockIndex;
-	u16	m_blockCharIndex;
 	u16 m_tblOffset;
 	// ---- Rendering box
 	u8  m_width;
@@ -128,62 +178,30 @@ private:
 	CharCache();
 	~CharCache();
 
-	static u16 s_cacheStart;
-	static u16 s_cacheEnd;
-	static CharCache s_cacheArray[CHAR_CACHE_SIZE];
-	static u16 s_allocCounter;
-};
-
-struct CharDictionnary {
-	friend struct FontObject;
-	friend class FntDebug;
-public:
-	static CharCache* getChar(u32 uniCode, FontObject* pFont);
-	static void	removeDicoEntry(u16 startEntry, u32 unicode);
-	static void destroyTree(u16 entry, u16 depth);
-	static void removeEntry(u16 entry);
-
-	static void reboot() {
-		s_freeList = s_usedList = 0xFFFF;
-	}
-	static void test();
-private:
-	CharDictionnary();
-
-	static const u32 DICO_ELEMENT_COUNT = 1000;
-	static CharCache*	findEntry(FontObject* pFont,u32 uniCode);
-	static CharCache*	createEntry(FontObject* pFont, u32 uniCode);
-	static u16			createDicoEntry();
-	static u16			removeDicoEntryRec(u16 entry, u32 depth, u32 unicode, u16 startEntry);
-
-	static CharDictionnary	s_dicoArray[DICO_ELEMENT_COUNT];
-	static u16				s_freeList;
-	static u16				s_usedList;
-
-	u16			m_next;			// 2
-	u16			m_prev;			// 2
-	u16			m_idxTbl[16];	// 8 byte
-};
-
-#define	MB_BLOCK_ITEM_SIZE	(64*64)
-
-struct MemoryBlock {
-	friend class FntDebug;
+	struct Stripe {
+		void*		mutex;
+		CharCache*	buckets[GLYPH_CACHE_BUCKETS];
+		CharCache*	lruHead;
+		CharCache*	lruTail;
+		u32			memUsed;
+		u32			count;
+		u32			hits;
+		u32			misses;
+		u32			evictions;
+	};
 
-	static void test();
-	static void reboot();
-	static void freeBlock(u16 blockID, u16 subID);
-	static bool allocBlock(u16* returnBlock, u16* returnSubID, u8** ppData);
-private:
-	static MemoryBlock*	s_blockList;
-	static u16			s_blockCounter;
-
-	MemoryBlock*	m_next;
-	u16				m_id;
-	u32				m_allocFlag;
-	u32				partSize;
-	// Aligned by partSize.
-	u8				m_mem[32*MB_BLOCK_ITEM_SIZE];
+	static bool			init();
+	static u32			hashKey(FontObject* pFont, u32 uniCode);
+	static CharCache*	find(Stripe& stripe, u32 hash, FontObject* pFont, u32 uniCode);
+	static CharCache*	rasterize(FontObject* pFont, u32 uniCode);
+	static void			unlinkLRU(Stripe& stripe, CharCache* pChar);
+	static void			pushLRU(Stripe& stripe, CharCache* pChar);
+	static void			remove(Stripe& stripe, CharCache* pChar);
+	static void			trim(Stripe& stripe, u32 budget);
+
+	static Stripe		s_stripes[GLYPH_CACHE_STRIPES];
+	static u32			s_budget;
+	static bool			s_init;
 };
 
 #endif // H_FNT_RENDERING_KLB_
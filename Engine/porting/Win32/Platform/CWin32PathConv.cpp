@@ -19,13 +19,27 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 #include "CWin32PathConv.h"
 #include "CPFInterface.h"
+#include "CKLBBenchmark.h"
+
+#define MANIFEST_PATH_MAX	(1024)
+
+CWin32PathConv::CWin32PathConv()
+: m_build		(false)
+, m_external	(NULL)
+, m_install		(NULL)
+, m_manifest	(false)
+, m_installFiles(true)
+{
+	InitializeCriticalSection(&m_lock);
+}
 
-CWin32PathConv::CWin32PathConv() : m_build(false), m_external(NULL), m_install(NULL) {}
 CWin32PathConv::~CWin32PathConv() {
     delete [] m_external;
     delete [] m_install;
+	DeleteCriticalSection(&m_lock);
 }
 
 CWin32PathConv&
@@ -53,7 +67,6 @@ CWin32PathConv::makePath(const char * path, const char * suffix, const char * ba
     //strcat(buf, "/");
     strcat(buf, path);
     if(suffix) { strcat(buf, suffix); }
-    CPFInterface::getInstance().platform().logging("fullpath: %s", buf);
     return (const char *)buf;
 }
 
@@ -67,6 +80,46 @@ CWin32PathConv::checkExists(const char * path)
     return bResult;
 }
 
+void
+CWin32PathConv::scanDir(char * path, u32 baseLen, u32 relLen)
+{
+	WIN32_FIND_DATAA fd;
+	strcpy(path + baseLen + relLen, "*");
+	HANDLE hFind = FindFirstFileA(path, &fd);
+	if(hFind == INVALID_HANDLE_VALUE) { return; }
+	do {
+		const char* name = fd.cFileName;
+		if(name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) { continue; }
+
+		u32 nameLen = strlen(name);
+		if(baseLen + relLen + nameLen + 2 >= MANIFEST_PATH_MAX) { continue; }
+		memcpy(path + baseLen + relLen, name, nameLen + 1);
+		if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			path[baseLen + relLen + nameLen]		= '/';
+			path[baseLen + relLen + nameLen + 1]	= 0;
+			scanDir(path, baseLen, relLen + nameLen + 1);
+		} else {
+			m_installFiles.insert(path + baseLen, relLen + nameLen);
+		}
+	} while(FindNextFileA(hFind, &fd));
+	FindClose(hFind);
+}
+
+void
+CWin32PathConv::buildManifest()
+{
+	// Called under m_lock.
+	if(m_manifest) { return; }
+
+	char path[MANIFEST_PATH_MAX];
+	u32 baseLen = strlen(m_install);
+	if(baseLen + 2 < MANIFEST_PATH_MAX) {
+		strcpy(path, m_install);
+		scanDir(path, baseLen, 0);
+	}
+	m_manifest = true;
+}
+
 const char *
 CWin32PathConv::fullpath(const char * url, const char * suffix, bool* isReadOnly)
 {
@@ -76,13 +129,23 @@ CWin32PathConv::fullpath(const char * url, const char * suffix, bool* isReadOnly
 
     if (!strncmp(url, "asset://", 8)) {
         const char * path;
+		// External files override the install ones and are not tracked : one stat per lookup.
         path = makePath(url + 8, suffix, m_external);
         if(checkExists(path)) {
 			if (isReadOnly) { *isReadOnly = false; }
 			return path;
 		}
         delete [] path;
-        
+
+		// Install tree does not change : found in the manifest without any syscall.
+		EnterCriticalSection(&m_lock);
+		buildManifest();
+		bool inInstall = m_installFiles.find(url + 8, strlen(url + 8), suffix, suffix ? strlen(suffix) : 0)
+						!= CKLBNameTable::NOT_FOUND;
+		LeaveCriticalSection(&m_lock);
+		if (inInstall) { return makePath(url + 8, suffix, m_install); }
+
+		// Not in the manifest (folder, unusual path...) : probe the file system.
         path = makePath(url + 8, suffix, m_install);
         if(checkExists(path)) { return path; }
         delete [] path;
@@ -129,3 +192,101 @@ CWin32PathConv::build()
     create_external();
     m_build = true;
 }
+
+#ifdef INTERNAL_BENCH
+// Reference lookup used before the manifest : stat of base + relative path.
+static bool benchProbe(char * buf, const char * base, const char * rel)
+{
+	u32 baseLen	= strlen(base);
+	u32 relLen	= strlen(rel);
+	if(baseLen + relLen >= MANIFEST_PATH_MAX) { return false; }
+	memcpy(buf, base, baseLen);
+	memcpy(buf + baseLen, rel, relLen + 1);
+	struct stat st;
+	return (stat(buf, &st) == 0);
+}
+
+// "BENCH PATHCONV <loops> <list>" : the list file holds one asset:// URL per line, for example
+// the assets loaded through startup and a scene load. Each URL is resolved with fullpath(),
+// with the stat probes used before the manifest (external, then install), and opened with
+// openReadStream(). fullpath() must name the same file as the probes, every found file must open.
+static bool benchPathConv(u32 loops)
+{
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const char* list = CKLBBenchmark::getArgument();
+	if(!list) {
+		pltf.logging("[BENCH] PATHCONV needs an asset list file\n");
+		return true;
+	}
+
+	IReadStream* pStream = pltf.openReadStream(list, false);
+	s32 size	= (pStream && (pStream->getStatus() == IReadStream::NORMAL)) ? pStream->getSize() : -1;
+	char* text	= (size > 0) ? new char [size + 1] : NULL;
+	bool ok		= text && pStream->readBlock(text, size);
+	delete pStream;
+	if(!ok) {
+		delete [] text;
+		pltf.logging("[BENCH] PATHCONV can not read '%s'\n", list);
+		return false;
+	}
+	text[size] = 0;
+
+	// Lines cut in place, anything else than asset:// is ignored.
+	enum { MAX_URLS = 16384 };
+	static const char* urls[MAX_URLS];
+	u32 count	= 0;
+	char* parse	= text;
+	while(*parse && (count < MAX_URLS)) {
+		char* line = parse;
+		while(*parse && (*parse != '\n') && (*parse != '\r')) { parse++; }
+		if(*parse) { *parse++ = 0; }
+		if(!strncmp(line, "asset://", 8)) { urls[count++] = line; }
+	}
+
+	CWin32PathConv& conv	= CWin32PathConv::getInstance();
+	const char* external	= conv.external();
+	const char* install		= conv.install();
+	char probe[MANIFEST_PATH_MAX];
+	s64 timeFull	= 0;
+	s64 timeProbe	= 0;
+	s64 timeOpen	= 0;
+	u32 found		= 0;
+	for(u32 l = 0; ok && (l < loops); l++) {
+		found = 0;
+		for(u32 n = 0; ok && (n < count); n++) {
+			s64 t0 = CKLBBenchmark::now();
+			const char* path = conv.fullpath(urls[n]);
+			s64 t1 = CKLBBenchmark::now();
+			bool exists = benchProbe(probe, external, urls[n] + 8) || benchProbe(probe, install, urls[n] + 8);
+			s64 t2 = CKLBBenchmark::now();
+			ok = path ? (exists && !strcmp(path, probe)) : !exists;
+			if(!ok) {
+				pltf.logging("[BENCH] PATHCONV '%s' : fullpath '%s', probe '%s'\n", urls[n], path ? path : "(none)", exists ? probe : "(none)");
+			}
+			delete [] path;
+
+			if(ok && exists) {
+				IReadStream* pRead = pltf.openReadStream(urls[n], pltf.useEncryption());
+				ok = pRead && (pRead->getStatus() == IReadStream::NORMAL);
+				delete pRead;
+				if(!ok) {
+					pltf.logging("[BENCH] PATHCONV '%s' does not open\n", urls[n]);
+				}
+				found++;
+			}
+			timeFull	+= t1 - t0;
+			timeProbe	+= t2 - t1;
+			timeOpen	+= CKLBBenchmark::now() - t2;
+		}
+	}
+	CKLBBenchmark::report("fullpath (manifest)", loops * count, timeFull);
+	CKLBBenchmark::report("stat probes", loops * count, timeProbe);
+	CKLBBenchmark::report("openReadStream", loops * found, timeOpen);
+	pltf.logging("[BENCH] %i URLs, %i found\n", count, found);
+
+	delete [] text;
+	return ok;
+}
+
+static CKLBBenchmark gBenchPathConv("PATHCONV", benchPathConv);
+#endif
@@ -20,7 +20,10 @@
 #ifndef CWin32PathConv_h
 #define CWin32PathConv_h
 
+#include <Windows.h>
+#include "BaseType.h"
 #include "Win32FileLocation.h"
+#include "CKLBNameTable.h"
 
 class CWin32PathConv
 {
@@ -46,6 +49,13 @@ private:
     void		 create_external();
     void		 create_install	();
 
+	// Manifest : files of the install tree, which never changes while running.
+	// Limitation : the external tree is not in it. Downloads, sqlite and streams write there
+	// without going through this class, so an asset:// lookup still stats the external path
+	// first. The manifest only saves the install probe.
+	void		 buildManifest	();
+	void		 scanDir		(char * path, u32 baseLen, u32 relLen);
+
 private:
     bool                m_build;
     const char      *   m_external;
@@ -53,6 +63,10 @@ private:
 
 	const char		*	g_pathInstall;
 	const char		*	g_pathExtern;
+
+	CRITICAL_SECTION	m_lock;
+	bool				m_manifest;			// Install tree scanned
+	CKLBNameTable		m_installFiles;		// Relative paths, case insensitive
 };
 
 #endif
@@ -32,21 +32,17 @@
 #include "CWin32WriteFileStream.h"
 
 CWin32ReadFileStream::CWin32ReadFileStream()
-: m_bReadOnly   (true)
-, m_fd          (-1)
-, m_fp          (NULL)
+: CBufferedReadFileStream()
+, m_bReadOnly   (true)
 , m_eStat       (CLOSED)
 , m_fullpath    (NULL)
 , m_writeStream (NULL)
-, m_decrypter   ()
 {
 }
 
 CWin32ReadFileStream::~CWin32ReadFileStream()
 {
-	//if(m_fd > 0) { _close(m_fd); }
-    if(m_fp) { fclose(m_fp); }
-    m_fd    = -1;
+	// m_fp is closed by CBufferedReadFileStream.
     m_eStat = CLOSED;
     
     delete [] m_fullpath;
@@ -84,6 +80,7 @@ CWin32ReadFileStream::openStream(const char * path, const char * /*home*/)
             pStream->m_eStat = NOT_FOUND;
             return pStream;
         }
+        pStream->attachFile();
         
         pStream->m_eStat = NORMAL;
         return pStream;
@@ -111,65 +108,6 @@ CWin32ReadFileStream::getSize()
 	return file_stats.st_size - m_decrypter.m_header_size;
 }
 
-s32
-CWin32ReadFileStream::getPosition()
-{
-    return (s32)(ftell(m_fp) - m_decrypter.m_header_size);
-}
-
-u8       
-CWin32ReadFileStream::readU8()
-{
-	u8 val = fgetc(m_fp);
-	decrypt(&val,1);
-	return (u8)val;
-}
-
-u16      
-CWin32ReadFileStream::readU16()
-{
-	u8 buf[2];
-	if(1 == fread(buf, 2, 1, m_fp)) {
-		decrypt(buf,2);
-		u16 ret = ((u16)buf[0] << 8) | (u16)buf[1];
-		return ret;
-	}
-	return 0;
-}
-
-u32      
-CWin32ReadFileStream::readU32()
-{
-	u8 buf[4];
-	if(1 == fread(buf, 4, 1, m_fp)) {
-		decrypt(buf,4);
-		u32 ret = ((u32)buf[0] << 24) | ((u16)buf[1] <<16) | ((u16)buf[2] << 8) | (u16)buf[3];
-		return ret;
-	}
-	return 0;
-}
-
-float    
-CWin32ReadFileStream::readFloat()
-{
-	float f;
-	if(1 == fread(&f, sizeof(float), 1, m_fp)) {
-		decrypt(&f, sizeof(float));
-		return f;
-	}
-	return 0.0f;
-}
-
-bool     
-CWin32ReadFileStream::readBlock(void * buffer, u32 byteSize)
-{
-	u32 cnt;
-    
-	cnt = fread(buffer, 1, byteSize, m_fp);
-	decrypt(buffer, cnt);
-	return (cnt == byteSize) ? true : false; 
-}
-
 IReadStream::ESTATUS  
 CWin32ReadFileStream::getStatus()
 {
@@ -185,19 +123,3 @@ CWin32ReadFileStream::getWriteStream()
     }
     return m_writeStream;
 }
-
-int
-CWin32ReadFileStream::readU16arr(u16 *pBufferU16, int items)
-{
-    int cnt = fread(pBufferU16, sizeof(u16), items, m_fp);
-	decrypt(pBufferU16,sizeof(u16) * cnt);    
-    return cnt;
-}
-
-int
-CWin32ReadFileStream::readU32arr(u32 *pBufferU32, int items)
-{
-    int cnt = fread(pBufferU32, sizeof(u32), items, m_fp);    
-	decrypt(pBufferU32,sizeof(u32) * cnt);
-    return cnt;
-}
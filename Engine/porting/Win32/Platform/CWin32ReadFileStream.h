@@ -23,57 +23,31 @@
 #include <stdio.h>
 #include "BaseType.h"
 #include "FileSystem.h"
-#include "encryptFile.h"
+#include "CBufferedReadFileStream.h"
 
 class CWin32WriteFileStream;
 
-class CWin32ReadFileStream : public IReadStream
+class CWin32ReadFileStream : public CBufferedReadFileStream
 {
     friend class CWin32WriteFileStream;
 private:
     CWin32ReadFileStream();
     
-	CDecryptBaseClass   m_decrypter;
-	inline void decrypt(void* ptr, u32 length) {
-        m_decrypter.decryptBlck(ptr, length);
-    }
 public:
     virtual ~CWin32ReadFileStream();
-	inline void decryptSetup(const u8* ptr) {
-		u8 hdr[16];
-		if (m_fp) {
-			fread(hdr, 1, 16, m_fp); 
-		}
-
-		u32 res = m_decrypter.decryptSetup(ptr, hdr);
-		if (m_fp) {
-			fseek(m_fp, m_decrypter.m_header_size, SEEK_SET);
-		}
-    }
 
     static CWin32ReadFileStream * openStream(const char * path, const char * home);
     
     static CWin32ReadFileStream * openAssets(const char * path, const char * home);
     
     s32     getSize		();
-    s32     getPosition	();
-    u8      readU8		();
-    u16     readU16		();
-    u32     readU32		();
-    float   readFloat	();
-    bool    readBlock	(void * buffer, u32 byteSize);
     ESTATUS getStatus	();
     
-    int     readU16arr	(u16 * pBufferU16, int items);
-    int     readU32arr	(u32 * PBufferU32, int items);
-    
     IWriteStream * getWriteStream();
 
 private:
     const char* m_fullpath;
     ESTATUS     m_eStat;
-    FILE      * m_fp;
-    int         m_fd;
     bool        m_bReadOnly;
     CWin32WriteFileStream * m_writeStream;
 };
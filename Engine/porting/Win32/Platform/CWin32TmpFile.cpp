@@ -41,6 +41,20 @@ CWin32TmpFile::~CWin32TmpFile()
 	delete [] m_fullpath;
 }
 
+void
+CWin32TmpFile::reserve(size_t size)
+{
+	if(m_hHandle == INVALID_HANDLE_VALUE) { return; }
+	// Set the end of file once, the data is then written without growing the file.
+	LARGE_INTEGER pos;
+	pos.QuadPart = size;
+	if(SetFilePointerEx(m_hHandle, pos, NULL, FILE_BEGIN)) {
+		SetEndOfFile(m_hHandle);
+	}
+	pos.QuadPart = 0;
+	SetFilePointerEx(m_hHandle, pos, NULL, FILE_BEGIN);
+}
+
 size_t
 CWin32TmpFile::writeTmp(void * ptr, size_t size)
 {
@@ -26,6 +26,7 @@ public:
 	virtual ~CWin32TmpFile();
 
 	virtual size_t	writeTmp(void * ptr, size_t size);
+	virtual void	reserve	(size_t size);
 
 	inline bool		isReady	() { return (m_hHandle) ? true : false; }
 private:
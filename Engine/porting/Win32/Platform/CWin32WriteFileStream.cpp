@@ -51,6 +51,7 @@ CWin32WriteFileStream::CWin32WriteFileStream(CWin32ReadFileStream& rdStream)
     }
     rdStream.m_fd = m_fd;
     rdStream.m_fp = m_fp;    
+    rdStream.resetBuffer(0);
     m_eStat = NORMAL;
 }
 
@@ -16,6 +16,8 @@
 #include "CKLBNodeVirtualDocument.h"
 
 #include "CKLBTexturePacker.h"
+#include "CKLBWorkerPool.h"
+#include "CKLBBenchmark.h"
 TexturePacker& mgrPacker = TexturePacker::getInstance();
 
 static u32 convertARGB32_RGBA8(u32 argb) {
@@ -41,6 +43,132 @@ u16 getTo4444(u32 color) {
 	return col;
 }
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VDOC_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+//
+// Span kernels.
+// Blending is done two channels at a time inside a 32 bit word (8.8 per channel, no carry
+// as a + na = 256), or four pixels at a time with SSE2. Results are bit exact with the
+// per channel formula : (dst * (256 - alpha) + src * alpha) >> 8
+//
+
+static inline void fillSpan32(u32* p, s32 count, u32 color) {
+#ifdef VDOC_SIMD_SSE2
+	__m128i col = _mm_set1_epi32(color);
+	while (count >= 4) {
+		_mm_storeu_si128((__m128i*)p, col);
+		p		+= 4;
+		count	-= 4;
+	}
+#else
+	while (count >= 4) {
+		p[0] = color; p[1] = color; p[2] = color; p[3] = color;
+		p		+= 4;
+		count	-= 4;
+	}
+#endif
+	while (count-- > 0) {
+		*p++ = color;
+	}
+}
+
+static inline void fillSpan16(u16* p, s32 count, u16 color) {
+	if (count && (((size_t)p) & 2)) {
+		*p++ = color;
+		count--;
+	}
+	fillSpan32((u32*)p, count >> 1, color | (color << 16));
+	if (count & 1) {
+		p[count - 1] = color;
+	}
+}
+
+// Constant color blend : preRB / preGA are the pre multiplied color channels (alpha * c) in 8.8 lanes.
+static inline void blendSpan32(u32* p, s32 count, u32 preRB, u32 preGA, u32 nalpha) {
+#ifdef VDOC_SIMD_SSE2
+	__m128i z	= _mm_setzero_si128();
+	__m128i na	= _mm_set1_epi16((short)nalpha);
+	// Lane order of unpacked pixel : c0,c1,c2,c3
+	__m128i pre	= _mm_set_epi16((short)(preGA>>16), (short)(preRB>>16), (short)(preGA & 0xFFFF), (short)(preRB & 0xFFFF),
+								(short)(preGA>>16), (short)(preRB>>16), (short)(preGA & 0xFFFF), (short)(preRB & 0xFFFF));
+	while (count >= 4) {
+		__m128i d	= _mm_loadu_si128((const __m128i*)p);
+		__m128i lo	= _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, z), na), pre), 8);
+		__m128i hi	= _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, z), na), pre), 8);
+		_mm_storeu_si128((__m128i*)p, _mm_packus_epi16(lo, hi));
+		p		+= 4;
+		count	-= 4;
+	}
+#endif
+	while (count-- > 0) {
+		u32 d	= *p;
+		u32 rb	= (((d & 0x00FF00FF)		* nalpha + preRB) >> 8) & 0x00FF00FF;
+		u32 ga	= ((((d >> 8) & 0x00FF00FF)	* nalpha + preGA) >> 8) & 0x00FF00FF;
+		*p++	= rb | (ga << 8);
+	}
+}
+
+// Image row blend, source pixel alpha modulated by global alpha (0..256).
+static inline void blendImageSpan32(u32* dst, const u32* src, s32 count, u32 galpha) {
+#ifdef VDOC_SIMD_SSE2
+	__m128i z	= _mm_setzero_si128();
+	__m128i ga	= _mm_set1_epi16((short)galpha);
+	__m128i v256= _mm_set1_epi16(256);
+	while (count >= 4) {
+		__m128i s	= _mm_loadu_si128((const __m128i*)src);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(s, 24), z)) == 0xFFFF) {
+			// Fully transparent source : nothing to do.
+			dst		+= 4;
+			src		+= 4;
+			count	-= 4;
+			continue;
+		}
+		__m128i d	= _mm_loadu_si128((const __m128i*)dst);
+		__m128i sl	= _mm_unpacklo_epi8(s, z);
+		__m128i sh	= _mm_unpackhi_epi8(s, z);
+		// Per pixel alpha broadcast to the 4 channels.
+		__m128i al	= _mm_shufflehi_epi16(_mm_shufflelo_epi16(sl, 0xFF), 0xFF);
+		__m128i ah	= _mm_shufflehi_epi16(_mm_shufflelo_epi16(sh, 0xFF), 0xFF);
+		al			= _mm_srli_epi16(_mm_mullo_epi16(al, ga), 8);		// ca
+		ah			= _mm_srli_epi16(_mm_mullo_epi16(ah, ga), 8);
+		al			= _mm_add_epi16(al, _mm_srli_epi16(al, 7));			// 0..256
+		ah			= _mm_add_epi16(ah, _mm_srli_epi16(ah, 7));
+		__m128i lo	= _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, z), _mm_sub_epi16(v256, al)), _mm_mullo_epi16(sl, al));
+		__m128i hi	= _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, z), _mm_sub_epi16(v256, ah)), _mm_mullo_epi16(sh, ah));
+		_mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+		dst		+= 4;
+		src		+= 4;
+		count	-= 4;
+	}
+#endif
+	while (count-- > 0) {
+		u32 s	= *src++;
+		u32 ca	= (galpha * (s >> 24)) >> 8;
+		if (ca) {
+			u32 alpha	= ca + (ca >> 7);
+			u32 nalpha	= 256 - alpha;
+			u32 d		= *dst;
+			u32 rb		= (((d & 0x00FF00FF)		* nalpha + (s & 0x00FF00FF)			* alpha) >> 8) & 0x00FF00FF;
+			u32 gb		= ((((d >> 8) & 0x00FF00FF)	* nalpha + ((s >> 8) & 0x00FF00FF)	* alpha) >> 8) & 0x00FF00FF;
+			*dst = rb | (gb << 8);
+		}
+		dst++;
+	}
+}
+
+void RenderContext::setWindow(const RenderContext& base, s32 x, s32 y, s32 width, s32 height) {
+	*this			= base;
+	pBuffer			= (u32*)&((u8*)base.pBuffer)[(x + (y * base.stride)) * base.format];
+	offsetX			= base.offsetX + x;
+	offsetY			= base.offsetY + y;
+	targetWidth		= width;
+	targetHeight	= height;
+	setClip(0, 0, width, height);
+}
+
 void RenderContext::setClip	(s32 x0, s32 y0, s32 x1, s32 y1) {
 	if (x0 < 0)				{ x0 = 0; }
 	if (y0 < 0)				{ y0 = 0; }
@@ -116,6 +244,15 @@ void RenderContext::setPixelClip4444(s32 x1, s32 y1, u16 color) {
 }
 
 void RenderContext::drawLine(s32 x1, s32 y1, s32 x2, s32 y2, u32 color) {
+	// Horizontal / vertical line : clipped once and drawn as a span.
+	// (4444 blending uses a different precision per pixel, only opaque color there)
+	if (((x1 == x2) || (y1 == y2)) && ((format == 4) || ((color>>24) == 255))) {
+		if (x1 > x2) { s32 t = x1; x1 = x2; x2 = t; }
+		if (y1 > y2) { s32 t = y1; y1 = y2; y2 = t; }
+		fillRect(x1, y1, x2 + 1, y2 + 1, color, false);
+		return;
+	}
+
 	x2 -= offsetX;
 	x1 -= offsetX;
 	y2 -= offsetY;
@@ -199,36 +336,25 @@ void RenderContext::fillRect(s32 x0, s32 y0, s32 x1, s32 y1, u32 color, bool for
 	if (x1 > clipX1)	{ x1 = clipX1; }
 	if (y1 > clipY1)	{ y1 = clipY1; }
 
+	s32 width = x1 - x0;
+	if ((width <= 0) || (y0 >= y1)) {
+		return;
+	}
+
 	if (((color>>24) == 255) || (forceFill)) {
-		//
-		// OPTIMIZE : use fully ptr, avoid x,y increment, use memcpy32.
-		//
 		if (format == 4) {
 			u32* pBuf = &pBuffer[x0 + (stride * y0)];
-
-			s32 startX0 = x0;
 			while (y0 < y1) {
-				x0 = startX0;
-				while (x0 < x1) {
-					*pBuf++ = color;
-					x0++;
-				}
-				pBuf += stride - (x1 - startX0);	// Delta Stride.
+				fillSpan32(pBuf, width, color);
+				pBuf += stride;
 				y0++;
 			}
 		} else {
-			u16* pBuf = (u16*)&(((u8*)pBuffer)[x0 + (stride * format * y0)]);
-
+			u16* pBuf = &((u16*)pBuffer)[x0 + (stride * y0)];
 			u16 color16 = getTo4444(color);
-
-			s32 startX0 = x0;
 			while (y0 < y1) {
-				x0 = startX0;
-				while (x0 < x1) {
-					*pBuf++ = color16;
-					x0++;
-				}
-				pBuf += stride - (x1 - startX0);	// Delta Stride.
+				fillSpan16(pBuf, width, color16);
+				pBuf += stride;
 				y0++;
 			}
 		}
@@ -254,32 +380,16 @@ void RenderContext::fillRect(s32 x0, s32 y0, s32 x1, s32 y1, u32 color, bool for
 		// Dst is also RGBA
 		//
 		if (format == 4) {
-			u32* pBuf = &pBuffer[x0 + (stride * y0)];
-
-			s32 startX0 = x0;
+			u32* pBuf	= &pBuffer[x0 + (stride * y0)];
+			u32 preRB	= cb | (cr << 16);
+			u32 preGA	= cg | (ca << 16);
 			while (y0 < y1) {
-				x0 = startX0;
-				while (x0 < x1) {
-					u8* p8Buf = (u8*)pBuf;
-
-					int b = ((p8Buf[0] * nalpha) + cb)>>8;
-					int g = ((p8Buf[1] * nalpha) + cg)>>8;
-					int r = ((p8Buf[2] * nalpha) + cr)>>8;
-					int ar= ((p8Buf[3] * nalpha) + ca)>>8; // Do NOT use scale (255 vs 256)
-
-					p8Buf	[0] = b;  // B
-					p8Buf	[1] = g;  // G
-					p8Buf	[2] = r;  // R
-					p8Buf	[3] = ar; // A
-
-					pBuf++;
-					x0++;
-				}
-				pBuf += stride - (x1 - startX0);	// Delta Stride.
+				blendSpan32(pBuf, width, preRB, preGA, nalpha);
+				pBuf += stride;
 				y0++;
 			}
 		} else {
-			u16* pBuf = (u16*)&(((u8*)pBuffer)[x0 + (stride * format * y0)]);
+			u16* pBuf = &((u16*)pBuffer)[x0 + (stride * y0)];
 
 			// 8.8 -> 4.8 precision, then at correct place for addition
 			cb >>= 4; cb <<= 4;
@@ -301,7 +411,7 @@ void RenderContext::fillRect(s32 x0, s32 y0, s32 x1, s32 y1, u32 color, bool for
 					*pBuf++ = (r & 0xF000) | (g & 0x0F00) | (b & 0x00F0) | (ar & 0x000F);
 					x0++;
 				}
-				pBuf += stride - (x1 - startX0);	// Delta Stride in pixel
+				pBuf += stride - width;	// Delta Stride in pixel
 				y0++;
 			}
 		}
@@ -470,7 +580,13 @@ void RenderContext::drawImage(s32 x , s32 y , SDrawCommand* pCommand  , u8 alpha
 	int galpha		= alpha + (alpha>>7);		// 0..256
 	// int gnalpha		= 256 - galpha;				// 256..0
 
-	if (format == 4) {
+	if ((format == 4) && (!pCommand->swap)) {
+		for (int y=0; y < sdy; y++) {
+			blendImageSpan32((u32*)pBuf, (const u32*)pix, sdx, galpha);
+			pBuf += stride * 4;
+			pix  += lstride;
+		}
+	} else if (format == 4) {
 		for (int y=0; y < sdy; y++) {
 			for (int x=0; x < sdx; x++) {
 				// 0..255 Alpha
@@ -576,6 +692,22 @@ void dumpVirtualDocState(void* pDoc) {
 
 #endif
 
+//
+// Band rasterization.
+//
+
+#if (VDOC_RASTER_WORKERS > 0)
+#define USE_RASTER_WORKERS
+#endif
+
+static u32						gm_bandList		[VDOC_BAND_MAX];
+static u32						gm_bandCount	= 0;
+static u32						gm_docCount		= 0;
+
+#ifdef USE_RASTER_WORKERS
+static CKLBWorkerPool			gm_rasterPool	(VDOC_RASTER_WORKERS);
+#endif
+
 CKLBNodeVirtualDocument::CKLBNodeVirtualDocument()
 :m_commandArray		(NULL)
 ,m_commandMaxCount	(0)
@@ -601,6 +733,8 @@ CKLBNodeVirtualDocument::CKLBNodeVirtualDocument()
 //,m_surfA			(NULL_IDX)
 //,m_surfB			(NULL_IDX)
 ,m_bHasChanged		(false)
+,m_bandSize			(0)
+,m_bandCount		(0)
 {
 	m_deleteRender = false; // Force own management of sprite on destruction.
 	for(int i = 0; i < 2; i++) {
@@ -619,6 +753,8 @@ CKLBNodeVirtualDocument::CKLBNodeVirtualDocument()
 	}
 
 	m_format = TexturePacker::getCurrentModeTexture();
+	invalidateBands();
+	gm_docCount++;
 #ifdef DEBUG_TEXTURE_PACKER
 	registerVirtualDoc(this);
 #endif
@@ -627,6 +763,12 @@ CKLBNodeVirtualDocument::CKLBNodeVirtualDocument()
 CKLBNodeVirtualDocument::~CKLBNodeVirtualDocument() {
 	clearRessources(true, true);
 	freeDocument();
+	gm_docCount--;
+#ifdef USE_RASTER_WORKERS
+	if (gm_docCount == 0) {
+		gm_rasterPool.release();
+	}
+#endif
 #ifdef DEBUG_TEXTURE_PACKER
 	unregisterVirtualDoc(this);
 	mgrPacker.scan(this);
@@ -955,6 +1097,7 @@ bool CKLBNodeVirtualDocument::setViewPortSize(u32 width, u32 height, float align
 	this->renderContext.targetHeight	= m_viewPortHeight;
 
 	m_bHasChanged = true;
+	invalidateBands();
 
 	return success;
 }
@@ -1448,27 +1591,144 @@ void CKLBNodeVirtualDocument::forceRefresh() {
 	markUpMatrixAndColor();
 }
 
-void CKLBNodeVirtualDocument::renderDocument() {
-	// klb_assert((_CrtCheckMemory() != 0), "Heap Error !");
+/*static*/ void CKLBNodeVirtualDocument::bandJob(void* pCtx, u32 index) {
+	((CKLBNodeVirtualDocument*)pCtx)->renderBand(gm_bandList[index]);
+}
 
-	if (!m_bDisplay)	{ return; }
+static inline u32 hashMix(u32 h, u32 v) {
+	// FNV-1a on 32 bit words.
+	return (h ^ v) * 16777619u;
+}
 
+/*static*/ u32 CKLBNodeVirtualDocument::hashCommand(SDrawCommand* pDCom, STextInfo* pFontInfo, void** pFont) {
+	u32 h = 2166136261u;
+	h = hashMix(h, pDCom->command);
+	h = hashMix(h, ((u16)pDCom->x0) | (((u32)(u16)pDCom->y0) << 16));
+	h = hashMix(h, ((u16)pDCom->x1) | (((u32)(u16)pDCom->y1) << 16));
+	h = hashMix(h, pDCom->color);
+
+	switch (pDCom->command) {
+	case DRAWIMAGE:
+		h = hashMix(h, ((u16)pDCom->sx0) | (((u32)(u16)pDCom->sy0) << 16));
+		h = hashMix(h, ((u16)pDCom->sdx) | (((u32)(u16)pDCom->sdy) << 16));
+		h = hashMix(h, pDCom->swap ? 1 : 0);
+		// Fall through
+	case DRAWIMAGETILED:
+		h = hashMix(h, (u32)(size_t)pDCom->ptr);
+		break;
+	case DRAWTEXT:
+		{
+			h = hashMix(h, (u32)(size_t)pFont[pDCom->fntIdx]);
+			h = hashMix(h, (u32)(s32)pFontInfo[pDCom->fntIdx].ascent);
+			const u8* p = (const u8*)pDCom->txt;
+			while (*p) {
+				h = hashMix(h, *p++);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return h;
+}
 
-	RenderContext* pCtx = &renderContext;
-	// pCtx->pBuffer		= m_softwareBufferTile[m_currBuff];
-	pCtx->pBuffer		= m_drawarea[m_currBuff].softwareBufTile;
-	pCtx->offsetX		= m_tileXStart;
-	pCtx->offsetY		= m_tileYStart;
-	pCtx->format		= m_drawarea[m_currBuff].format;
+void CKLBNodeVirtualDocument::invalidateBands() {
+	for (u32 n = 0; n < VDOC_BAND_MAX; n++) {
+		m_bandSig[0][n] = 0;
+		m_bandSig[1][n] = 0;
+	}
+}
 
-	// Clipping absolute buffer coordinate.
-	pCtx->setClip	(0, 0, m_viewPortWidth, m_viewPortHeight);
+// Compute the content signature of each band of the current target surface.
+u32 CKLBNodeVirtualDocument::computeBands(u32* pSignature) {
+	// Non scrolling document may clear the whole buffer when drawing text : single band.
+	s32 extent		= m_isVertical ? m_viewPortHeight : m_viewPortWidth;
+	s32 bandSize	= (extent + VDOC_BAND_MAX - 1) / VDOC_BAND_MAX;
+	if (bandSize < VDOC_BAND_MIN_SIZE)	{ bandSize = VDOC_BAND_MIN_SIZE; }
+	if ((!m_bScroll) || (bandSize > extent)) { bandSize = extent; }
+	u32 bandCount	= (extent + bandSize - 1) / bandSize;
+
+	if ((bandSize != m_bandSize) || (bandCount != m_bandCount)) {
+		m_bandSize	= bandSize;
+		m_bandCount	= bandCount;
+		invalidateBands();
+	}
+
+	for (u32 b = 0; b < bandCount; b++) {
+		u32 h = hashMix(2166136261u, m_bgColor);
+		h = hashMix(h, m_isVertical ? 1 : 0);
+		h = hashMix(h, m_tileXStart);
+		h = hashMix(h, m_tileYStart + (b * bandSize));
+		pSignature[b] = h;
+	}
+
+	for (u32 n = 0; n < m_CurrentCommand; n++) {
+		SDrawCommand* pDCom = &m_commandArray[n];
+		s32 x0, x1, y0, y1;
+		if(pDCom->x0 <= pDCom->x1) { x0 = pDCom->x0; x1 = pDCom->x1; } else { x0 = pDCom->x1; x1 = pDCom->x0; }
+		if(pDCom->y0 <= pDCom->y1) { y0 = pDCom->y0; y1 = pDCom->y1; } else { y0 = pDCom->y1; y1 = pDCom->y0; }
+
+		// Same rejection as the tile : skip instruction.
+		if ((x1 <= m_tileXStart) || (x0 >= m_tileXEnd) || (y1 <= m_tileYStart) || (y0 >= m_tileYEnd)) {
+			continue;
+		}
+
+		// Lines are inclusive, glyphs may go out of the text box : widen to find the bands.
+		s32 margin = (pDCom->command == DRAWTEXT) ? (y1 - y0) : 1;
+		s32 start, end;
+		if (m_isVertical) {
+			start	= y0 - margin - m_tileYStart;
+			end		= y1 + margin - m_tileYStart;
+		} else {
+			start	= x0 - margin - m_tileXStart;
+			end		= x1 + margin - m_tileXStart;
+		}
+		if (start < 0)		{ start = 0; }
+		if (end >= extent)	{ end = extent - 1; }
+		if (end < start)	{ continue; }
+
+		u32 h = hashCommand(pDCom, fontInfo, font);
+		for (s32 b = start / bandSize; b <= end / bandSize; b++) {
+			pSignature[b] = hashMix(pSignature[b], h);
+		}
+	}
 
-	// Force tile fill at current coordinate. (relative coordinate fill, different from absolute instruction)
-	pCtx->fillRect	(	m_tileXStart,
-						m_tileYStart,
-						m_viewPortWidth  + m_tileXStart,
-						m_viewPortHeight + m_tileYStart, m_bgColor, true);
+	for (u32 b = 0; b < bandCount; b++) {
+		pSignature[b] |= 1;	// 0 is reserved for invalid.
+	}
+	return bandCount;
+}
+
+void CKLBNodeVirtualDocument::renderBand(u32 band) {
+	s32 bandX, bandY, bandW, bandH;
+	if (m_isVertical) {
+		bandX = 0;
+		bandY = band * m_bandSize;
+		bandW = m_viewPortWidth;
+		bandH = m_viewPortHeight - bandY;
+	} else {
+		bandX = band * m_bandSize;
+		bandY = 0;
+		bandW = m_viewPortWidth - bandX;
+		bandH = m_viewPortHeight;
+	}
+	if (m_isVertical) {
+		if (bandH > m_bandSize) { bandH = m_bandSize; }
+	} else {
+		if (bandW > m_bandSize) { bandW = m_bandSize; }
+	}
+
+	RenderContext ctx;
+	RenderContext* pCtx = &ctx;
+	pCtx->setWindow(renderContext, bandX, bandY, bandW, bandH);
+
+	s32 docX0 = pCtx->offsetX;
+	s32 docY0 = pCtx->offsetY;
+	s32 docX1 = docX0 + bandW;
+	s32 docY1 = docY0 + bandH;
+
+	// Force band fill at current coordinate. (relative coordinate fill, different from absolute instruction)
+	pCtx->fillRect	(docX0, docY0, docX1, docY1, m_bgColor, true);
 
 	// Render at absolute coordinate.
 	for (u32 n = 0; n < m_CurrentCommand; n++) {
@@ -1487,6 +1747,18 @@ void CKLBNodeVirtualDocument::renderDocument() {
 			// skip instruction.
 			continue;
 		}
+
+		// Same widening as computeBands().
+		s32 margin = (pDCom->command == DRAWTEXT) ? (y1 - y0) : 1;
+		if (
+			 (x1 + margin < docX0) || (x0 - margin >= docX1)
+			 ||
+			 (y1 + margin < docY0) || (y0 - margin >= docY1)
+		   )
+		{
+			continue;
+		}
+
 		switch (m_commandArray[n].command) {
 		default:
 			klb_assertAlways("Unknow draw command.");
@@ -1504,8 +1776,8 @@ void CKLBNodeVirtualDocument::renderDocument() {
 			break;
 		case DRAWIMAGETILED:
 			{
-				// Set clip.
-				pCtx->setClip(pDCom->x0, pDCom->y0, pDCom->x1, pDCom->y1);
+				// Set clip (document space to band space).
+				pCtx->setClip(pDCom->x0 - docX0, pDCom->y0 - docY0, pDCom->x1 - docX0, pDCom->y1 - docY0);
 				
 				// Draw Images
 				for (s32 y = 0; y < pDCom->y1; y += (pDCom->y1 - pDCom->y0)) {
@@ -1515,16 +1787,62 @@ void CKLBNodeVirtualDocument::renderDocument() {
 				}
 
 				// Restore clip
-				pCtx->setClip(0,0,this->m_viewPortWidth,this->m_viewPortHeight);
+				pCtx->setClip(0, 0, bandW, bandH);
 			}
 			break;
 		}
 	}
+}
+
+void CKLBNodeVirtualDocument::renderDocument() {
+	// klb_assert((_CrtCheckMemory() != 0), "Heap Error !");
+
+	if (!m_bDisplay)	{ return; }
+
+
+	RenderContext* pCtx = &renderContext;
+	// pCtx->pBuffer		= m_softwareBufferTile[m_currBuff];
+	pCtx->pBuffer		= m_drawarea[m_currBuff].softwareBufTile;
+	pCtx->offsetX		= m_tileXStart;
+	pCtx->offsetY		= m_tileYStart;
+	pCtx->format		= m_drawarea[m_currBuff].format;
+
+	// Clipping absolute buffer coordinate.
+	pCtx->setClip	(0, 0, m_viewPortWidth, m_viewPortHeight);
+
+	//
+	// Only bands whose content signature changed since their last rasterization are drawn.
+	// (surface 1 shares the buffer of surface 0 when not scrolling)
+	//
+	u32* pLastSig = m_bandSig[m_bScroll ? m_currBuff : 0];
+	u32  signature[VDOC_BAND_MAX];
+	u32  bandCount = computeBands(signature);
+
+	gm_bandCount	= 0;
+	for (u32 b = 0; b < bandCount; b++) {
+		if (signature[b] != pLastSig[b]) {
+			pLastSig[b] = signature[b];
+			gm_bandList[gm_bandCount++] = b;
+		}
+	}
+
+#ifdef USE_RASTER_WORKERS
+	if (gm_bandCount >= VDOC_RASTER_PARALLEL_MIN) {
+		gm_rasterPool.run(bandJob, this, gm_bandCount);
+	} else
+#endif
+	{
+		for (u32 n = 0; n < gm_bandCount; n++) {
+			renderBand(gm_bandList[n]);
+		}
+	}
 
 	updateDynSprites(0);
 	updateDynSprites(1);
-	mgrPacker.updateTexture(m_drawarea[0].surf_handle);
-	mgrPacker.updateTexture(m_drawarea[1].surf_handle);
+	if (gm_bandCount) {
+		// Only the rendered surface changed.
+		mgrPacker.updateTexture(m_drawarea[m_currBuff].surf_handle);
+	}
 }
 
 void CKLBNodeVirtualDocument::updateDynSprites(u8 currBuff) {
@@ -1621,3 +1939,88 @@ void CKLBNodeVirtualDocument::setPriority(u32 renderPriority)
 	m_drawarea[0].tile->changeOrder(pRdrMgr, renderPriority);
 	m_drawarea[1].tile->changeOrder(pRdrMgr, renderPriority);
 }
+
+#ifdef INTERNAL_BENCH
+// 512x512 buffers : opaque and 50% alpha full fills, rectangle outlines, in 8888 and 4444.
+// The 8888 blend is checked against the per channel formula on a noisy buffer.
+static bool benchRaster(u32 loops) {
+	enum { SIZE = 512 };
+	u32* pBuffer	= KLBNEWA(u32, SIZE * SIZE);
+	u32* pRef		= KLBNEWA(u32, SIZE * SIZE);
+	if (!pBuffer || !pRef) {
+		KLBDELETEA(pBuffer);
+		KLBDELETEA(pRef);
+		return false;
+	}
+
+	RenderContext ctx;
+	ctx.pBuffer		= pBuffer;
+	ctx.clipX0		= 0;
+	ctx.clipY0		= 0;
+	ctx.clipX1		= SIZE;
+	ctx.clipY1		= SIZE;
+	ctx.offsetX		= 0;
+	ctx.offsetY		= 0;
+	ctx.targetWidth	= SIZE;
+	ctx.targetHeight= SIZE;
+
+	//
+	// Bit exactness of the blend kernel.
+	//
+	ctx.stride	= SIZE;
+	ctx.format	= 4;
+	u32 seed	= 12345;
+	for (u32 n = 0; n < SIZE * SIZE; n++) {
+		seed = (seed * 1103515245) + 12345;
+		pBuffer[n] = seed ^ (seed >> 16);
+	}
+	memcpy(pRef, pBuffer, SIZE * SIZE * sizeof(u32));
+	u32 color	= 0x80C04020;
+	u8* pCol	= (u8*)&color;
+	int alpha	= pCol[3]; alpha += alpha>>7;
+	int nalpha	= 256 - alpha;
+	u8* p8Ref	= (u8*)pRef;
+	for (u32 n = 0; n < SIZE * SIZE * 4; n++) {
+		p8Ref[n] = (u8)(((p8Ref[n] * nalpha) + (alpha * pCol[n & 3])) >> 8);
+	}
+	ctx.fillRect(0, 0, SIZE, SIZE, color, false);
+	bool ok = (memcmp(pRef, pBuffer, SIZE * SIZE * sizeof(u32)) == 0);
+
+	//
+	// Timing.
+	//
+	static const char* labels[2][3] = {
+		{ "8888 fill 512x512", "8888 blend 512x512", "8888 64 rectangles" },
+		{ "4444 fill 512x512", "4444 blend 512x512", "4444 64 rectangles" },
+	};
+	for (u32 f = 0; f < 2; f++) {
+		ctx.format	= (f == 0) ? 4 : 2;	// Stride is in pixels : the 4444 case uses half of the buffer.
+		s64 timeFill	= 0;
+		s64 timeBlend	= 0;
+		s64 timeRect	= 0;
+		for (u32 l = 0; l < loops; l++) {
+			s64 t0 = CKLBBenchmark::now();
+			ctx.fillRect(0, 0, SIZE, SIZE, 0xFF336699, false);
+			s64 t1 = CKLBBenchmark::now();
+			ctx.fillRect(0, 0, SIZE, SIZE, 0x80996633, false);
+			s64 t2 = CKLBBenchmark::now();
+			for (s32 r = 0; r < 64; r++) {
+				ctx.drawRect(r * 4, r * 4, SIZE - r * 4, SIZE - r * 4, 0xFFFFFFFF);
+			}
+			s64 t3 = CKLBBenchmark::now();
+			timeFill	+= t1 - t0;
+			timeBlend	+= t2 - t1;
+			timeRect	+= t3 - t2;
+		}
+		CKLBBenchmark::report(labels[f][0], loops, timeFill);
+		CKLBBenchmark::report(labels[f][1], loops, timeBlend);
+		CKLBBenchmark::report(labels[f][2], loops, timeRect);
+	}
+
+	KLBDELETEA(pBuffer);
+	KLBDELETEA(pRef);
+	return ok;
+}
+
+static CKLBBenchmark gBenchRaster("RASTER", benchRaster);
+#endif
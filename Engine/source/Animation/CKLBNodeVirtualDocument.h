@@ -19,6 +19,15 @@
 #include "CKLBNode.h"
 #include "string.h"
 
+// Viewport buffers are split in bands along the scroll axis : only bands whose
+// content changed are rasterized again.
+#define VDOC_BAND_MAX				(16)
+#define VDOC_BAND_MIN_SIZE			(32)	// Pixels.
+// Worker threads used to rasterize dirty bands (0 : main thread only).
+#define VDOC_RASTER_WORKERS			(2)
+// Minimum number of dirty bands before the workers are used.
+#define VDOC_RASTER_PARALLEL_MIN	(3)
+
 enum ECOMMAND {
 	DRAWLINE,
 	DRAWRECT,
@@ -66,6 +75,7 @@ struct RenderContext {
 		this->offsetY = offsetY;
 	}
 
+	void setWindow	(const RenderContext& base, s32 x, s32 y, s32 width, s32 height);	// Sub rectangle of base, in buffer space.
 	void setClip	(s32 x0, s32 y0, s32 x1, s32 y1);				//Only command in buffer space (no translate)
 	void drawLine	(s32 x0, s32 y0, s32 x1, s32 y1, u32 color);
 	void drawRect	(s32 x0, s32 y0, s32 x1, s32 y1, u32 color);
@@ -140,6 +150,14 @@ protected:
 	void	setTargetSurface(u8 index, s32 offsetX, s32 offsetY);
 	void	updateDynSprites(u8 index);
 
+	void	invalidateBands	();
+	u32		computeBands	(u32* pSignature);
+	void	renderBand		(u32 band);
+	static
+	u32		hashCommand		(SDrawCommand* pDCom, STextInfo* pFontInfo, void** pFont);
+	static
+	void	bandJob			(void* pCtx, u32 index);
+
 
 	float			m_alignOffsetX;
 	float			m_alignOffsetY;
@@ -216,6 +234,11 @@ protected:
 	s32				m_documentHeight;
 
 	RenderContext	renderContext;
+
+	// Band dirty tracking, per viewport buffer.
+	u32				m_bandSig	[2][VDOC_BAND_MAX];		// 0 : must be rasterized.
+	s32				m_bandSize;
+	u32				m_bandCount;
 };
 
 #endif
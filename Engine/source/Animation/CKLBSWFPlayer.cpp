@@ -21,6 +21,7 @@
 #include "mem.h"
 #include "Message.h"
 #include "CKLBUtility.h"
+#include "CKLBBenchmark.h"
 
 // ================================================================================
 //   Asset Plugin.
@@ -80,25 +81,26 @@ struct SSound {
 
 CKLBSWFAsset::CKLBSWFAsset()
 :CKLBAsset()
+,m_parentSWF			(NULL)
+,m_msPerFrame			(16)	// around 60 fps default.
 ,m_aConstants			(NULL)
 ,m_aChars				(NULL)
+,m_uiShapeCount			(0)
+,m_pIndex				(NULL)
+,m_shapes				(NULL)
+,m_uiSoundCount			(0)
+,m_sounds				(NULL)
 ,m_aMatrixData			(NULL)
 ,m_aMatrixType			(NULL)
 ,m_aMatrixDataIndex		(NULL)
 ,m_aStreamInstruction	(NULL)
-,m_aMovieInfo			(NULL)
+,m_uiMovieCount			(0)	
 ,m_alistCacheEntries	(NULL)
-,m_parentSWF			(NULL)
-,m_aBitmapLoaded		(NULL)
+,m_aTimeline			(NULL)
+,m_aMovieInfo			(NULL)
 ,m_subAssets			(NULL)
-,m_pIndex				(NULL)
-,m_shapes				(NULL)
-,m_sounds				(NULL)
+,m_aBitmapLoaded		(NULL)
 ,m_isMaster				(false)
-,m_msPerFrame			(16)	// around 60 fps default.
-,m_uiMovieCount			(0)	
-,m_uiShapeCount			(0)
-,m_uiSoundCount			(0)
 {
 }
 
@@ -123,6 +125,15 @@ CKLBSWFAsset::~CKLBSWFAsset() {
 		}
 		KLBDELETEA(m_alistCacheEntries);	m_alistCacheEntries		= NULL; 
 	}
+	if (m_aTimeline) {
+		for (u32 n=0; n < m_uiMovieCount; n++) {
+			if (m_aTimeline[n]) {
+				releaseTimeline(m_aTimeline[n]);
+				KLBDELETE(m_aTimeline[n]);
+			}
+		}
+		KLBDELETEA(m_aTimeline);			m_aTimeline				= NULL;
+	}
 	if (m_aMovieInfo)			{	KLBDELETEA(m_aMovieInfo);			m_aMovieInfo			= NULL;	}
 	if (m_pIndex)				{	KLBDELETEA(m_pIndex);				m_pIndex				= NULL; }
 	if (m_shapes)				{
@@ -469,8 +480,9 @@ bool CKLBSWFAsset::LoadData(u8* pData) {
 				m_aMovieInfo	= KLBNEWA(u32,size);
 				m_aBitmapLoaded	= KLBNEWA(CKLBImageAsset*,m_uiMovieCount);
 				m_alistCacheEntries	= KLBNEWA(SCacheEntry*, m_aStreamSize);
+				m_aTimeline			= KLBNEWA(STimeline*, m_uiMovieCount);
 
-				if (m_aMovieInfo && m_aBitmapLoaded && m_alistCacheEntries) {
+				if (m_aMovieInfo && m_aBitmapLoaded && m_alistCacheEntries && m_aTimeline) {
 					for (int n = 0; n < size; n++) {
 						m_aMovieInfo[n] = READU32P(pData);
 					}
@@ -478,6 +490,7 @@ bool CKLBSWFAsset::LoadData(u8* pData) {
 					// Faster than init in loop.
 					memset32(m_aBitmapLoaded,		0, m_uiMovieCount * sizeof(CKLBImageAsset*  )	);
 					memset32(m_alistCacheEntries,	0, m_uiMovieCount * sizeof(SCacheEntry*		)	);
+					memset32(m_aTimeline,			0, m_uiMovieCount * sizeof(STimeline*		)	);
 
 					//
 					// Create sub movies ressource automatically.
@@ -971,11 +984,30 @@ void CKLBSWFMovie::gotoFrame(u16 frame) {
 	}
 }
 
+u16 CKLBSWFMovie::getFrameCount() {
+	CKLBSWFAsset::STimeline* pTimeline = m_player->getTimeline(m_movieID, m_movieStartCode);
+	return pTimeline ? pTimeline->m_frameCount : 0;
+}
+
 u16 CKLBSWFMovie::findCodeFrame(char* label, u16* pFrameNum) {
 	u16 uiFrame     = 0;
 	u32 movieCode   = m_movieStartCode;
 
 	if (label) {
+		CKLBSWFAsset::STimeline* pTimeline = m_player->getTimeline(m_movieID, m_movieStartCode);
+		if (pTimeline) {
+			// Compiled timeline : only scan the label table.
+			for (u32 n = 0; n < pTimeline->m_labelCount; n++) {
+				if (CKLBUtility::safe_strcmp(this->m_player->m_aConstants[pTimeline->m_labelIdx[n]], label) == 0) {
+					if (pFrameNum) {
+						*pFrameNum = pTimeline->m_labelFrame[n];
+					}
+					return (u16)pTimeline->m_labelCode[n];
+				}
+			}
+			movieCode = m_movieEndCode;
+		}
+
 		//
 		// 
 		// search failure return start frame : always a valid frame => Avoid a lot of test within the player runtime.
@@ -1044,6 +1076,18 @@ u16 CKLBSWFMovie::findCodeFrame(u16 frame) {
 	u16 uiFrame	    = 0;
 	u32 movieCode   = m_movieStartCode;
 
+	if (frame != 0) {
+		CKLBSWFAsset::STimeline* pTimeline = m_player->getTimeline(m_movieID, m_movieStartCode);
+		if (pTimeline) {
+			// Same result as the scan below, without walking the stream.
+			if (frame <= pTimeline->m_frameCount + 1) {
+				return pTimeline->m_frameCode[frame] - 4;
+			} else {
+				return m_movieStartCode + 4;
+			}
+		}
+	}
+
 	//
 	// 
 	// search failure return start frame : always a valid frame => Avoid a lot of test within the player runtime.
@@ -1247,6 +1291,255 @@ void CKLBSWFAsset::restoreSceneGraph(CKLBSWFMovie* node, u16 frame) {
 	}
 }
 
+CKLBSWFAsset::STimeline* CKLBSWFAsset::getTimeline(u16 movieID, u32 startCode) {
+	if ((m_aTimeline == NULL) || (movieID >= m_uiMovieCount)) {
+		return NULL;
+	}
+
+	STimeline* pTimeline = m_aTimeline[movieID];
+	if (pTimeline == NULL) {
+		// Compiled once, kept even if invalid to avoid parsing the stream again.
+		pTimeline = compileTimeline(movieID);
+		m_aTimeline[movieID] = pTimeline;
+	}
+
+	return (pTimeline && pTimeline->m_valid && (pTimeline->m_frameCode[0] == startCode)) ? pTimeline : NULL;
+}
+
+/*static*/
+void CKLBSWFAsset::releaseTimeline(STimeline* pTimeline) {
+	if (pTimeline->m_frameCode)		{ KLBDELETEA(pTimeline->m_frameCode);	pTimeline->m_frameCode	= NULL; }
+	if (pTimeline->m_labelCode)		{ KLBDELETEA(pTimeline->m_labelCode);	pTimeline->m_labelCode	= NULL; }
+	if (pTimeline->m_labelIdx)		{ KLBDELETEA(pTimeline->m_labelIdx);	pTimeline->m_labelIdx	= NULL; }
+	if (pTimeline->m_labelFrame)	{ KLBDELETEA(pTimeline->m_labelFrame);	pTimeline->m_labelFrame	= NULL; }
+	if (pTimeline->m_keyOffset)		{ KLBDELETEA(pTimeline->m_keyOffset);	pTimeline->m_keyOffset	= NULL; }
+	if (pTimeline->m_keyEntries)	{ KLBDELETEA(pTimeline->m_keyEntries);	pTimeline->m_keyEntries	= NULL; }
+	if (pTimeline->m_work)			{ KLBDELETEA(pTimeline->m_work);		pTimeline->m_work		= NULL; }
+	pTimeline->m_valid = false;
+}
+
+/*static*/
+u32 CKLBSWFAsset::applyDelta(const u32* pStream, u32 code, SDisplayEntry* pList, u16* pCount) {
+	u16 count = *pCount;
+
+	switch (pStream[code]) {
+	case SHOW_FRAME:
+		return code + 4;
+	case PLAY_SOUND:
+		return code + 2;
+	case REMOVE_OBJECT:
+		{
+			u16 layer = (u16)pStream[code + 1];
+			for (u32 n = 0; n < count; n++) {
+				if (pList[n].m_layer == layer) {
+					pList[n] = pList[--count];	// Order does not matter, layer is the key.
+					break;
+				}
+			}
+			*pCount = count;
+		}
+		return code + 2;
+	case PLACE_OBJECT_CLIP:
+	case PLACE_OBJECT:
+		{
+			u16 movieID		= (u16)pStream[code + 1];
+			u16 matrixIdx	= (u16)pStream[code + 2];
+			u16 colorIdx	= (u16)pStream[code + 3];
+			u16 layer		= (u16)pStream[code + 4];
+
+			SDisplayEntry* pEntry = NULL;
+			for (u32 n = 0; n < count; n++) {
+				if (pList[n].m_layer == layer) {
+					pEntry = &pList[n];
+					break;
+				}
+			}
+
+			// Same rules as the player : a different movie ID replaces the object.
+			if (movieID != NULL_IDX) {
+				if (pEntry == NULL) {
+					pEntry = &pList[count++];
+					pEntry->m_layer		= layer;
+					pEntry->m_movieID	= NULL_IDX;
+				}
+
+				if (pEntry->m_movieID != movieID) {
+					pEntry->m_movieID	= movieID;
+					pEntry->m_matrixIdx	= NULL_IDX;
+					pEntry->m_colorIdx	= NULL_IDX;
+				}
+			}
+
+			if (pEntry) {
+				if (matrixIdx != NULL_IDX)	{ pEntry->m_matrixIdx	= matrixIdx;	}
+				if (colorIdx  != NULL_IDX)	{ pEntry->m_colorIdx	= colorIdx;		}
+			}
+			*pCount = count;
+		}
+		return code + ((pStream[code] == PLACE_OBJECT_CLIP) ? 6 : 5);
+	default:
+		klb_assertAlways("Invalid code");
+		return code + 1;
+	}
+}
+
+CKLBSWFAsset::STimeline* CKLBSWFAsset::compileTimeline(u16 movieID) {
+	STimeline* pTimeline = KLBNEW(STimeline);
+	if (pTimeline == NULL) {
+		return NULL;
+	}
+	memset(pTimeline, 0, sizeof(STimeline));	// m_valid = false
+
+	int movieIndex = movieID * SIZE_MOVIE_INFO;
+	if (m_aMovieInfo[movieIndex + CODE_FRAMECOUNT] >= 32768) {
+		// Image or shape : no timeline.
+		return pTimeline;
+	}
+
+	const u32*	pStream	= m_aStreamInstruction;
+	u32			start	= m_aMovieInfo[movieIndex + CODE_STARTINDEX];
+	u32			end		= m_aMovieInfo[movieIndex + CODE_ENDINDEX];
+
+	//
+	// Pass 1 : validate stream, count frames and labels.
+	//
+	u32 showCount	= 0;
+	u32 labelCount	= 0;
+	u32 code		= start;
+	while (code < end) {
+		switch (pStream[code]) {
+		case SHOW_FRAME:
+			if ((u16)pStream[code + 1] != NULL_IDX) {
+				labelCount++;
+			}
+			showCount++;
+			code += 4;
+			break;
+		case PLACE_OBJECT:		code += 5;	break;
+		case PLACE_OBJECT_CLIP:	code += 6;	break;
+		case REMOVE_OBJECT:
+		case PLAY_SOUND:		code += 2;	break;
+		default:
+			// Bit packed extension : player keeps replaying from the stream.
+			return pTimeline;
+		}
+	}
+
+	// First SHOW_FRAME is the custom frame "0".
+	if ((code != end) || (showCount < 2) || (showCount > NULL_IDX)) {
+		return pTimeline;
+	}
+
+	u32 frameCount	= showCount - 1;
+	u32 keyCount	= ((frameCount - 1) / SWF_KEYFRAME_INTERVAL) + 1;
+
+	pTimeline->m_frameCount	= (u16)frameCount;
+	pTimeline->m_labelCount	= (u16)labelCount;
+	pTimeline->m_keyCount	= (u16)keyCount;
+	pTimeline->m_frameCode	= KLBNEWA(u32, frameCount + 2);
+	pTimeline->m_keyOffset	= KLBNEWA(u32, keyCount + 1);
+	if (labelCount) {
+		pTimeline->m_labelCode	= KLBNEWA(u32, labelCount);
+		pTimeline->m_labelIdx	= KLBNEWA(u16, labelCount);
+		pTimeline->m_labelFrame	= KLBNEWA(u16, labelCount);
+	}
+
+	u32				workMax		= 16;
+	u32				keyMax		= 64;
+	SDisplayEntry*	pWork		= KLBNEWA(SDisplayEntry, workMax);
+	SDisplayEntry*	pKeys		= KLBNEWA(SDisplayEntry, keyMax);
+
+	if ((pTimeline->m_frameCode == NULL) || (pTimeline->m_keyOffset == NULL) || (pWork == NULL) || (pKeys == NULL)
+	||	(labelCount && ((pTimeline->m_labelCode == NULL) || (pTimeline->m_labelIdx == NULL) || (pTimeline->m_labelFrame == NULL)))) {
+		goto fail;
+	}
+
+	{
+		//
+		// Pass 2 : play the display list, record frame start and snapshots.
+		//
+		u32 keyUsed		= 0;
+		u32 label		= 0;
+		u32 frame		= 0;
+		u16 count		= 0;
+		u16 maxCount	= 0;
+
+		pTimeline->m_frameCode[0] = start;
+		code = start;
+		while (code < end) {
+			if (pStream[code] == SHOW_FRAME) {
+				u16 lblIdx = (u16)pStream[code + 1];
+				if (lblIdx != NULL_IDX) {
+					pTimeline->m_labelCode [label]	= code;
+					pTimeline->m_labelIdx  [label]	= lblIdx;
+					pTimeline->m_labelFrame[label]	= (u16)(frame + 1);
+					label++;
+				}
+
+				code += 4;
+				frame++;
+				pTimeline->m_frameCode[frame] = code;
+
+				// Snapshot taken before frames 1, N+1, 2N+1...
+				if ((frame <= frameCount) && (((frame - 1) % SWF_KEYFRAME_INTERVAL) == 0)) {
+					if (keyUsed + count > keyMax) {
+						while (keyUsed + count > keyMax) { keyMax *= 2; }
+						SDisplayEntry* pNewKeys = KLBNEWA(SDisplayEntry, keyMax);
+						if (pNewKeys == NULL) {
+							goto fail;
+						}
+						memcpy(pNewKeys, pKeys, keyUsed * sizeof(SDisplayEntry));
+						KLBDELETEA(pKeys);
+						pKeys = pNewKeys;
+					}
+
+					pTimeline->m_keyOffset[(frame - 1) / SWF_KEYFRAME_INTERVAL] = keyUsed;
+					memcpy(&pKeys[keyUsed], pWork, count * sizeof(SDisplayEntry));
+					keyUsed += count;
+				}
+			} else {
+				// A place may add one entry.
+				if (count == workMax) {
+					if (workMax >= NULL_IDX) {
+						goto fail;
+					}
+					workMax = (workMax * 2 > NULL_IDX) ? NULL_IDX : workMax * 2;
+					SDisplayEntry* pNewWork = KLBNEWA(SDisplayEntry, workMax);
+					if (pNewWork == NULL) {
+						goto fail;
+					}
+					memcpy(pNewWork, pWork, count * sizeof(SDisplayEntry));
+					KLBDELETEA(pWork);
+					pWork = pNewWork;
+				}
+
+				code = applyDelta(pStream, code, pWork, &count);
+				if (count > maxCount) {
+					maxCount = count;
+				}
+			}
+		}
+		pTimeline->m_keyOffset[keyCount] = keyUsed;
+
+		pTimeline->m_work = KLBNEWA(SDisplayEntry, maxCount ? maxCount : 1);
+		if (pTimeline->m_work == NULL) {
+			goto fail;
+		}
+
+		pTimeline->m_maxEntries	= maxCount;
+		pTimeline->m_keyEntries	= pKeys;
+		pTimeline->m_valid		= true;
+		KLBDELETEA(pWork);
+		return pTimeline;
+	}
+
+fail:
+	if (pWork) { KLBDELETEA(pWork); }
+	if (pKeys) { KLBDELETEA(pKeys); }
+	releaseTimeline(pTimeline);
+	return pTimeline;
+}
+
 /*virtual*/
 CKLBNode* CKLBSWFMovie::clone(CKLBNode* newItem, CKLBNode* parent, CKLBNode* brother, bool transferSpriteOwnership) {
 	if (newItem == NULL) {
@@ -1296,7 +1589,11 @@ CKLBNode* CKLBSWFMovie::clone(CKLBNode* newItem, CKLBNode* parent, CKLBNode* bro
 void CKLBSWFMovie::nextFrame(u16 frame) {
 	int mode = SWF_NORMAL;
 	if (m_isPlaying != STOPPED) {
-		if ((frame < this->m_uiFrame) || (m_uiFrame == NULL_IDX)) {	// May be able to optimize condition.
+		if ((frame != NULL_IDX)
+		&&	((frame < this->m_uiFrame) || (frame > this->m_uiFrame + SWF_KEYFRAME_INTERVAL))
+		&&	seekFrame(frame)) {
+			// Display list restored from the compiled timeline, only the requested frame is left to execute.
+		} else if ((frame < this->m_uiFrame) || (m_uiFrame == NULL_IDX)) {	// May be able to optimize condition.
 			m_uiFrame = 1;
 			// clearSubTree();
 			m_movieCode = this->m_movieStartCode + SKIP_SHOW;
@@ -1535,85 +1832,9 @@ nextInstruction:
 						klb_assertNull(movie, "Null pointer");
 
 						if (movie) {
-							//
-							// Setup matrix / color matrix, movie play etc...
-							//
-
-							#define A			(0)
-							#define B			(1)
-							#define C			(2)
-							#define D			(3)
-							#define TX			(4)
-							#define TY			(5)
-
 							// Marking for object destruction when owner movie loop.
 							movie->m_updateFrame = m_uiFrame;
-							if (matrixIdx != NULL_IDX) {
-								int idx = m_player->m_aMatrixDataIndex[matrixIdx];
-								float* pFL = movie->m_matrix.m_matrix;
-								switch (m_player->m_aMatrixType[matrixIdx]) {
-								case MATRIX_TG:
-									// Thru. no break.
-									pFL[A]  = m_player->m_aMatrixData[idx++];
-									pFL[D]  = m_player->m_aMatrixData[idx++];
-									pFL[B]  = m_player->m_aMatrixData[idx++];
-									pFL[C]  = m_player->m_aMatrixData[idx++];
-								case MATRIX_T:
-									pFL[TX] = m_player->m_aMatrixData[idx++];
-									pFL[TY] = m_player->m_aMatrixData[idx++];
-									break;
-								case MATRIX_TS:
-									pFL[A]  = m_player->m_aMatrixData[idx++];
-									pFL[D]  = m_player->m_aMatrixData[idx++];
-									pFL[TX] = m_player->m_aMatrixData[idx++];
-									pFL[TY] = m_player->m_aMatrixData[idx++];
-									pFL[B]  = 0.0f;
-									pFL[C]  = 0.0f;
-									break;
-								case MATRIX_COL:
-									// N/A Here
-									break;
-								case MATRIX_ID:
-									pFL[A]  = 1.0f;
-									pFL[D]  = 1.0f;
-									pFL[TX] = 0.0f;
-									pFL[TY] = 0.0f;
-									pFL[B]  = 0.0f;
-									pFL[C]  = 0.0f;
-									break;
-								}
-
-								// Update type of local matrix.
-								movie->m_matrix.m_type = m_player->m_aMatrixType[matrixIdx];
-
-								#undef A
-								#undef B
-								#undef C
-								#undef D
-								#undef TX
-								#undef TY
-
-								movie->markUpMatrix();
-							}
-
-							if (matrixColIdx != NULL_IDX) {
-								float* pFL = movie->m_localColorMatrix.m_vector;
-								if (m_player->m_aMatrixType[matrixColIdx] == 0) {
-									*pFL++  = 1.0f;
-									*pFL++  = 1.0f;
-									*pFL++  = 1.0f;
-									*pFL++  = 1.0f;
-								} else {
-									int idx = m_player->m_aMatrixDataIndex[matrixColIdx];
-									*pFL++	= m_player->m_aMatrixData[idx++];	// R
-									*pFL++	= m_player->m_aMatrixData[idx++];	// G
-									*pFL++	= m_player->m_aMatrixData[idx++];	// B
-									*pFL	= m_player->m_aMatrixData[idx];		// A
-								}
-								movie->m_pColorMatrix	= &movie->m_colorMatrix;
-								movie->m_useParentColor	= false;
-								movie->markUpColor();
-							}
+							applyPlace(movie, matrixIdx, matrixColIdx);
 						}
 					}
 			
@@ -1689,6 +1910,170 @@ nextInstruction:
 	}
 }
 
+void CKLBSWFMovie::applyPlace(CKLBNode* pMovie, u16 matrixIdx, u16 colorIdx) {
+	//
+	// Setup matrix / color matrix from the precomputed arrays.
+	//
+
+	#define A			(0)
+	#define B			(1)
+	#define C			(2)
+	#define D			(3)
+	#define TX			(4)
+	#define TY			(5)
+
+	if (matrixIdx != NULL_IDX) {
+		int idx = m_player->m_aMatrixDataIndex[matrixIdx];
+		float* pFL = pMovie->m_matrix.m_matrix;
+		switch (m_player->m_aMatrixType[matrixIdx]) {
+		case MATRIX_TG:
+			// Thru. no break.
+			pFL[A]  = m_player->m_aMatrixData[idx++];
+			pFL[D]  = m_player->m_aMatrixData[idx++];
+			pFL[B]  = m_player->m_aMatrixData[idx++];
+			pFL[C]  = m_player->m_aMatrixData[idx++];
+		case MATRIX_T:
+			pFL[TX] = m_player->m_aMatrixData[idx++];
+			pFL[TY] = m_player->m_aMatrixData[idx++];
+			break;
+		case MATRIX_TS:
+			pFL[A]  = m_player->m_aMatrixData[idx++];
+			pFL[D]  = m_player->m_aMatrixData[idx++];
+			pFL[TX] = m_player->m_aMatrixData[idx++];
+			pFL[TY] = m_player->m_aMatrixData[idx++];
+			pFL[B]  = 0.0f;
+			pFL[C]  = 0.0f;
+			break;
+		case MATRIX_COL:
+			// N/A Here
+			break;
+		case MATRIX_ID:
+			pFL[A]  = 1.0f;
+			pFL[D]  = 1.0f;
+			pFL[TX] = 0.0f;
+			pFL[TY] = 0.0f;
+			pFL[B]  = 0.0f;
+			pFL[C]  = 0.0f;
+			break;
+		}
+
+		// Update type of local matrix.
+		pMovie->m_matrix.m_type = m_player->m_aMatrixType[matrixIdx];
+
+		pMovie->markUpMatrix();
+	}
+
+	if (colorIdx != NULL_IDX) {
+		float* pFL = pMovie->m_localColorMatrix.m_vector;
+		if (m_player->m_aMatrixType[colorIdx] == 0) {
+			*pFL++  = 1.0f;
+			*pFL++  = 1.0f;
+			*pFL++  = 1.0f;
+			*pFL++  = 1.0f;
+		} else {
+			int idx = m_player->m_aMatrixDataIndex[colorIdx];
+			*pFL++	= m_player->m_aMatrixData[idx++];	// R
+			*pFL++	= m_player->m_aMatrixData[idx++];	// G
+			*pFL++	= m_player->m_aMatrixData[idx++];	// B
+			*pFL	= m_player->m_aMatrixData[idx];		// A
+		}
+		pMovie->m_pColorMatrix	= &pMovie->m_colorMatrix;
+		pMovie->m_useParentColor	= false;
+		pMovie->markUpColor();
+	}
+
+	#undef A
+	#undef B
+	#undef C
+	#undef D
+	#undef TX
+	#undef TY
+}
+
+bool CKLBSWFMovie::seekFrame(u16 frame) {
+	CKLBSWFAsset::STimeline* pTimeline = m_player->getTimeline(m_movieID, m_movieStartCode);
+	if ((pTimeline == NULL) || (frame == 0) || (frame > pTimeline->m_frameCount)) {
+		return false;
+	}
+
+	//
+	// 1. Display list before the requested frame : closest snapshot + stream delta.
+	//
+	u32 key		= (frame - 1) / SWF_KEYFRAME_INTERVAL;
+	u16 count	= (u16)(pTimeline->m_keyOffset[key + 1] - pTimeline->m_keyOffset[key]);
+	CKLBSWFAsset::SDisplayEntry* pList = pTimeline->m_work;
+	memcpy(pList, &pTimeline->m_keyEntries[pTimeline->m_keyOffset[key]], count * sizeof(CKLBSWFAsset::SDisplayEntry));
+
+	const u32*	pStream	= m_player->m_aStreamInstruction;
+	u32			code	= pTimeline->m_frameCode[(key * SWF_KEYFRAME_INTERVAL) + 1];
+	u32			target	= pTimeline->m_frameCode[frame];
+	while (code < target) {
+		code = CKLBSWFAsset::applyDelta(pStream, code, pList, &count);
+	}
+
+	//
+	// 2. Remove nodes not in the display list (or replaced by another movie).
+	//
+	CKLBNode* pChild = m_pChild;
+	while (pChild) {
+		CKLBNode* pChildNext = ((CKLBSWFMovie*)pChild)->m_pBrother;
+		bool keep = false;
+		for (u32 n = 0; n < count; n++) {
+			if (pList[n].m_layer == pChild->getLayer()) {
+				keep = (pList[n].m_movieID == pChild->m_movieID);
+				break;
+			}
+		}
+
+		if (!keep) {
+			removeMovie(pChild);
+			KLBDELETE(pChild);
+		}
+		pChild = pChildNext;
+	}
+
+	//
+	// 3. Create missing nodes, apply transform and color.
+	//
+	for (u32 n = 0; n < count; n++) {
+		CKLBSWFAsset::SDisplayEntry* pEntry = &pList[n];
+		CKLBNode* pMovie = getNode(pEntry->m_layer);
+		if (pMovie == NULL) {
+			pMovie = addMovie(pEntry->m_movieID, pEntry->m_layer);	// Default matrix / color set at creation.
+			if (pMovie == NULL) {
+				continue;
+			}
+		} else {
+			// Node kept : restore creation defaults not overridden by the display list.
+			if (pEntry->m_matrixIdx == NULL_IDX) {
+				float* pFL = pMovie->m_matrix.m_matrix;
+				pFL[0] = 1.0f;	pFL[1] = 0.0f;	pFL[2] = 0.0f;
+				pFL[3] = 1.0f;	pFL[4] = 0.0f;	pFL[5] = 0.0f;
+				pMovie->m_matrix.m_type = MATRIX_ID;
+				pMovie->markUpMatrix();
+			}
+
+			if ((pEntry->m_colorIdx == NULL_IDX) && (pMovie->m_useParentColor == false)) {
+				float* pFL = pMovie->m_localColorMatrix.m_vector;
+				pFL[0] = 1.0f;	pFL[1] = 1.0f;	pFL[2] = 1.0f;	pFL[3] = 1.0f;
+				pMovie->m_useParentColor = true;
+				pMovie->markUpColor();
+			}
+		}
+
+		pMovie->m_updateFrame = frame;
+		applyPlace(pMovie, pEntry->m_matrixIdx, pEntry->m_colorIdx);
+	}
+
+	m_uiFrame		= frame;
+	m_movieCode		= target;
+	m_firstFrame	= false;
+	if (m_flashRoot) {
+		m_flashRoot->m_rebuildSort = true;
+	}
+	return true;
+}
+
 // -----------------------------------------------------------------
 //   Tree marking and update.
 /*virtual*/
@@ -1775,3 +2160,79 @@ void CKLBSWFMovie::removeMovie(CKLBNode* pMovie) {
 
 // LATER RP : may need some API extension to free all sub movies also ?
 // LATER RP : may need some API to replace bitmaps already loaded, ...
+
+#ifdef INTERNAL_BENCH
+static u32 countChildren(CKLBNode* pNode) {
+	u32 count = 0;
+	for (CKLBNode* pChild = pNode->getChild(); pChild; pChild = pChild->getBrother()) {
+		count++;
+	}
+	return count;
+}
+
+// "BENCH SWF <loops> <asset>" : root movie of the asset, seek forward frame by frame,
+// backward from the last frame, and to pseudo random frames.
+// Seeking to the same frame from the first or the last frame must give the same display list.
+static bool benchSWFSeek(u32 loops) {
+	const char* asset = CKLBBenchmark::getArgument();
+	if (!asset) {
+		CPFInterface::getInstance().platform().logging("[BENCH] SWF needs an asset path\n");
+		return true;
+	}
+
+	u32 handle;
+	CKLBSWFAsset* pAsset = (CKLBSWFAsset*)CKLBUtility::loadAssetScript(asset, &handle);
+	if (!pAsset) { return false; }
+
+	SMatrix2D mat;
+	CKLBSWFMovie* pMovie = (CKLBSWFMovie*)pAsset->addMovieA(NULL, 0, &mat, 0, NULL, 0);
+	if (!pMovie) {
+		CKLBDataHandler::releaseHandle(handle);
+		return false;
+	}
+	pMovie->setPlay(false);
+
+	u16 frames	= pMovie->getFrameCount();
+	bool ok		= (frames != 0);
+	if (ok) {
+		s64 timeForward		= 0;
+		s64 timeBackward	= 0;
+		s64 timeRandom		= 0;
+		u32 seed			= 12345;
+		for (u32 l = 0; l < loops; l++) {
+			s64 t0 = CKLBBenchmark::now();
+			for (u16 f = 1; f <= frames; f++) { pMovie->gotoFrame(f); }
+			s64 t1 = CKLBBenchmark::now();
+			for (u16 f = frames; f >= 1; f--) { pMovie->gotoFrame(f); }
+			s64 t2 = CKLBBenchmark::now();
+			for (u32 n = 0; n < frames; n++) {
+				seed = (seed * 1103515245) + 12345;
+				pMovie->gotoFrame((u16)(((seed >> 8) % frames) + 1));
+			}
+			s64 t3 = CKLBBenchmark::now();
+			timeForward		+= t1 - t0;
+			timeBackward	+= t2 - t1;
+			timeRandom		+= t3 - t2;
+		}
+
+		u16 check = (frames / 2) + 1;
+		pMovie->gotoFrame(1);
+		pMovie->gotoFrame(check);
+		u32 fromStart = countChildren(pMovie);
+		pMovie->gotoFrame(frames);
+		pMovie->gotoFrame(check);
+		ok = (countChildren(pMovie) == fromStart);
+
+		CKLBBenchmark::report("seek forward, per frame",	loops * frames, timeForward);
+		CKLBBenchmark::report("seek backward, per frame",	loops * frames, timeBackward);
+		CKLBBenchmark::report("seek random",				loops * frames, timeRandom);
+	} else {
+		CPFInterface::getInstance().platform().logging("[BENCH] SWF stream can not be compiled\n");
+	}
+
+	CKLBUtility::deleteNode(pMovie, handle);
+	return ok;
+}
+
+static CKLBBenchmark gBenchSWFSeek("SWF", benchSWFSeek);
+#endif
@@ -73,6 +73,12 @@
 #define GOTO_AND_STOP			(2)
 #define SHOW_FRAME_ONLY			(0xFFFF)
 
+//
+// Compiled timeline : a display list snapshot is stored every N frames,
+// seeking applies at most N-1 frames of delta from the closest snapshot.
+//
+#define SWF_KEYFRAME_INTERVAL	(16)
+
 typedef unsigned int u32;
 typedef unsigned short int u16;
 typedef unsigned char u8;
@@ -111,6 +117,8 @@ public:
 	void			setPriority			(u32 order);
 	u16				findCodeFrame		(char* label, u16* pFrameNum);
 	void			gotoFrame			(u16 frame);
+	// Number of frames, 0 when the movie stream can not be compiled.
+	u16				getFrameCount		();
 	void			setPlay				(bool play) {
 		if (play != m_playMode) {
 			m_playMode = play;
@@ -194,6 +202,8 @@ private:
 	void			freeTables			();
 	CKLBNode*		addMovie			(u16 movieID, u16 layer);
 	void			removeMovie			(CKLBNode* pNode);
+	void			applyPlace			(CKLBNode* pMovie, u16 matrixIdx, u16 colorIdx);
+	bool			seekFrame			(u16 frame);
 	u16				findCodeFrame		(u16 frame);
 	void			rebuildSort			();
 	void			rebuildRecurse		(CKLBNode* pNode, u32* pIndex, CKLBRenderingManager& pRdr);
@@ -254,6 +264,37 @@ private:
 	CKLBNode*	findNode			(char* name);
 	u16			findMovie			(char* name);
 
+	//-------------------------------------
+	// Compiled timeline.
+	// Built once per movie definition on first seek : frame -> stream index,
+	// label -> frame and a display list snapshot every SWF_KEYFRAME_INTERVAL frames.
+	struct SDisplayEntry {
+		u16				m_layer;
+		u16				m_movieID;
+		u16				m_matrixIdx;	// NULL_IDX : default matrix given at creation.
+		u16				m_colorIdx;		// NULL_IDX : use parent color.
+	};
+
+	struct STimeline {
+		u32*			m_frameCode;	// [frameCount + 2] : stream index of first instruction of frame N (1 based).
+		u32*			m_labelCode;	// [labelCount]     : stream index of the SHOW_FRAME holding the label.
+		u16*			m_labelIdx;		// [labelCount]     : constant pool index of the label.
+		u16*			m_labelFrame;	// [labelCount]     : frame number of the label.
+		u32*			m_keyOffset;	// [keyCount + 1]   : first entry of each snapshot in m_keyEntries.
+		SDisplayEntry*	m_keyEntries;	// Display list state BEFORE frame (key * SWF_KEYFRAME_INTERVAL) + 1.
+		SDisplayEntry*	m_work;			// [maxEntries]     : scratch display list used when seeking.
+		u16				m_frameCount;
+		u16				m_labelCount;
+		u16				m_keyCount;
+		u16				m_maxEntries;
+		bool			m_valid;		// false : stream uses instructions the compiler does not support.
+	};
+
+	STimeline*	getTimeline			(u16 movieID, u32 startCode);
+	STimeline*	compileTimeline		(u16 movieID);
+	static void	releaseTimeline		(STimeline* pTimeline);
+	static u32	applyDelta			(const u32* pStream, u32 code, SDisplayEntry* pList, u16* pCount);
+
 	CKLBSWFAsset*	m_parentSWF;
 
 	// Animation frame rate : number of millisecond per frame.
@@ -308,6 +349,7 @@ private:
 	};
 
 	SCacheEntry**			m_alistCacheEntries;
+	STimeline**				m_aTimeline;
 	u32*					m_aMovieInfo; // Array of [movie count * 8] entries.
 	CKLBSWFAsset*			m_subAssets;
 	CKLBImageAsset**		m_aBitmapLoaded;
@@ -15,9 +15,15 @@
 */
 #include "CKLBSplineNode.h"
 #include "Message.h"
+#include "CKLBBenchmark.h"
 
 #define		VECTORSIZE	(4)
 
+// Segments tested forward from the cursor before switching to a binary search.
+#define		SEGMENT_LINEAR_STEP	(4)
+// Splines evaluated together in animateSplines().
+#define		SPLINE_BATCH		(16)
+
 // ##########################################
 //
 // --- Instance ---
@@ -40,7 +46,13 @@ CKLBSplineNode::CKLBSplineNode()
 , m_target          (NULL)
 , m_splines         (NULL)
 , m_splinesKeyCount (NULL)
-, m_splineLastKey   (NULL)
+, m_splineCursor    (NULL)
+, m_segTime         (NULL)
+, m_segCoefA        (NULL)
+, m_segCoefB        (NULL)
+, m_segCoefC        (NULL)
+, m_segCoefD        (NULL)
+, m_segInvLen       (NULL)
 , m_tag             (NULL)
 , m_refCounter      (NULL)
 , m_pingpong        (false)
@@ -245,29 +257,37 @@ void CKLBSplineNode::cleanSplines() {
 	m_splinesKeyCount = NULL;
 //	KLBDELETEA(m_splineLocalTime);
 //	m_splineLocalTime = NULL;
-	KLBDELETEA(m_splineLastKey);
-	m_splineLastKey = NULL;
+	KLBDELETEA(m_splineCursor);
+	m_splineCursor = NULL;
+	KLBDELETEA(m_segTime);
+	m_segTime	= NULL;
+	KLBDELETEA(m_segCoefA);	// B, C, D and InvLen share the same allocation.
+	m_segCoefA	= NULL;
+	m_segCoefB	= NULL;
+	m_segCoefC	= NULL;
+	m_segCoefD	= NULL;
+	m_segInvLen	= NULL;
 }
 
-bool CKLBSplineNode::setParamCount(u8 splineCount, u8 maxKeyCount) {
+bool CKLBSplineNode::setParamCount(u8 splineCount, u16 maxKeyCount) {
 	m_uiTotalTime	= 0;
 	m_uiMaxKeyCount	= maxKeyCount;
 
 	stop();
 	cleanSplines();
 
-	m_allKeys		= KLBNEWA(s32, maxKeyCount * splineCount * 4 * sizeof(s32));	// Time, Left, Right, Value
+	m_allKeys		= KLBNEWA(s32, maxKeyCount * splineCount * VECTORSIZE);	// Time, Value, Right, Left
 	m_target		= KLBNEWA(u8 , splineCount);
 	m_splinesKeyCount= KLBNEWA(u32 , splineCount);
 	m_splines		= KLBNEWA(s32* , splineCount);
 //	m_splineLocalTime= KLBNEWA(s32 , splineCount);
-	m_splineLastKey	= KLBNEWA(u16, splineCount);
+	m_splineCursor	= KLBNEWA(u32, splineCount);
 
 	if (m_allKeys	&& m_target 
 					&& m_splinesKeyCount 
 					&& m_splines 
 					// && m_splineLocalTime 
-					&& m_splineLastKey) {
+					&& m_splineCursor) {
 		m_uiSplineCount	= splineCount;
 
 		for (int n = 0; n < splineCount; n++) {
@@ -275,7 +295,7 @@ bool CKLBSplineNode::setParamCount(u8 splineCount, u8 maxKeyCount) {
 			m_splines[n]			= &m_allKeys[n * maxKeyCount * 4];
 			m_target[n]				= 0;
 			// m_splineLocalTime[n]	= 0;
-			m_splineLastKey[n]		= 0;
+			m_splineCursor[n]		= 0;
 		}
 
 		return true;
@@ -298,6 +318,11 @@ void CKLBSplineNode::addKeys(u8 splineIndex, u32 time, s16 value) {
 void CKLBSplineNode::addKeysFixed(u8 splineIndex, u32 time, s32 fixedValue) {
 	klb_assert(splineIndex < m_uiSplineCount, "Invalid index");
 
+	if (m_splinesKeyCount[splineIndex] >= m_uiMaxKeyCount) {
+		klb_assertAlways("Too many keys for spline %i", splineIndex);
+		return;
+	}
+
 	// Find new key index and update key counter
 	u32 idx = m_splinesKeyCount[splineIndex]++;
 
@@ -336,13 +361,232 @@ void CKLBSplineNode::generateAnimation() {
 		}
 
 		//
-		vector[0 + 2]					= vector[6];					// P0 Right tangent
-		vector[(keyCount-1) * 4 + 3]	= vector[(keyCount-2) * 4 + 2];	// Pn Left  tangent
-
+		if (keyCount >= 2) {
+			vector[0 + 2]					= vector[6];					// P0 Right tangent
+			vector[(keyCount-1) * 4 + 3]	= vector[(keyCount-2) * 4 + 2];	// Pn Left  tangent
+		}
 	}
 	m_loop				= false;
 	m_timeMultiplier	= 256;
 	m_mode				= 2;
+
+	generateSegments();
+}
+
+void CKLBSplineNode::generateSegments() {
+	u32 total = m_uiSplineCount * m_uiMaxKeyCount;
+
+	KLBDELETEA(m_segTime);
+	KLBDELETEA(m_segCoefA);
+	m_segTime	= KLBNEWA(s32,   total);
+	m_segCoefA	= KLBNEWA(float, total * 5);
+	if (!m_segTime || !m_segCoefA) {
+		KLBDELETEA(m_segTime);
+		KLBDELETEA(m_segCoefA);
+		m_segTime	= NULL;
+		m_segCoefA	= NULL;
+		m_uiSplineCount = 0;	// Force node to do nothing.
+		return;
+	}
+	m_segCoefB	= &m_segCoefA[total];
+	m_segCoefC	= &m_segCoefB[total];
+	m_segCoefD	= &m_segCoefC[total];
+	m_segInvLen	= &m_segCoefD[total];
+
+	//
+	// Expand the Hermite form used by interpolateKey() into a cubic polynomial :
+	//   value = p0.h00(u) + t0.h10(u) + p1.h01(u) + t1.(u^2 - u^3)
+	// and apply the 16.16 -> float conversion at the same time.
+	//
+	const double scale = 1.0 / 65535.0;
+	for (u32 spIdx = 0; spIdx < m_uiSplineCount; spIdx++) {
+		const s32*	vector	= m_splines[spIdx];
+		u32			keyCount= m_splinesKeyCount[spIdx];
+		u32			base	= spIdx * m_uiMaxKeyCount;
+
+		for (u32 kIdx = 0; kIdx < keyCount; kIdx++) {
+			const s32* key	= &vector[kIdx * VECTORSIZE];
+			u32 seg			= base + kIdx;
+			double p0		= key[1];
+
+			m_segTime[seg]	= key[0];
+			if (kIdx + 1 < keyCount) {
+				const s32* next	= &key[VECTORSIZE];
+				double t0		= key[2];
+				double p1		= next[1];
+				double t1		= next[3];
+				s32 delta		= next[0] - key[0];
+
+				m_segCoefA [seg]	= (float)(p0 * scale);
+				m_segCoefB [seg]	= (float)(t0 * scale);
+				m_segCoefC [seg]	= (float)(((-3.0 * p0) - (2.0 * t0) + (3.0 * p1) + t1) * scale);
+				m_segCoefD [seg]	= (float)((( 2.0 * p0) +        t0  - (2.0 * p1) - t1) * scale);
+				m_segInvLen[seg]	= delta ? (1.0f / delta) : 0.0f;
+			} else {
+				// After last key : keep last value.
+				m_segCoefA [seg]	= (float)(p0 * scale);
+				m_segCoefB [seg]	= 0.0f;
+				m_segCoefC [seg]	= 0.0f;
+				m_segCoefD [seg]	= 0.0f;
+				m_segInvLen[seg]	= 0.0f;
+			}
+		}
+		m_splineCursor[spIdx] = 0;
+	}
+}
+
+/**
+	Return the segment to use at 'time' :
+	the last key before 'time' (first key and last key included as clamp).
+	Normal playback moves forward a few keys at most, so try from the cursor first
+	and use a binary search for seeks.
+ */
+static u32 findSegment(const s32* pTime, u32 keyCount, u32 cursor, s32 time) {
+	u32 last = keyCount - 1;
+	u32 lo;
+	u32 hi;
+
+	if (cursor > last) {
+		cursor = last;
+	}
+
+	if ((cursor > 0) && (pTime[cursor] >= time)) {
+		// Backward.
+		lo = 0;
+		hi = cursor - 1;
+	} else {
+		for (u32 n = 0; n < SEGMENT_LINEAR_STEP; n++) {
+			if ((cursor >= last) || (pTime[cursor + 1] >= time)) {
+				return cursor;
+			}
+			cursor++;
+		}
+		lo = cursor;
+		hi = last;
+	}
+
+	// Smallest segment s in [lo..hi] with (s == last) or (pTime[s+1] >= time)
+	while (lo < hi) {
+		u32 mid = (lo + hi) >> 1;
+		if (pTime[mid + 1] >= time) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return lo;
+}
+
+void CKLBSplineNode::animateSplines(s32 time) {
+	float	u	[SPLINE_BATCH];
+	float	a	[SPLINE_BATCH];
+	float	b	[SPLINE_BATCH];
+	float	c	[SPLINE_BATCH];
+	float	d	[SPLINE_BATCH];
+	float	res	[SPLINE_BATCH];
+	u8		tgt	[SPLINE_BATCH];
+
+	if (!m_segTime) {
+		return;	// generateAnimation() not called.
+	}
+
+	bool modColor = false;
+
+	for (u32 first = 0; first < m_uiSplineCount; first += SPLINE_BATCH) {
+		//
+		// 1. Locate segment of each spline and gather its coefficients.
+		//
+		u32 count = 0;
+		u32 end   = first + SPLINE_BATCH;
+		if (end > m_uiSplineCount) {
+			end = m_uiSplineCount;
+		}
+
+		for (u32 n = first; n < end; n++) {
+			u32 keyCount = m_splinesKeyCount[n];
+			if (keyCount == 0) {
+				continue;
+			}
+
+			const s32*	pTime	= &m_segTime[n * m_uiMaxKeyCount];
+			u32			seg		= findSegment(pTime, keyCount, m_splineCursor[n], time);
+			m_splineCursor[n]	= seg;
+
+			u32 idx		= (n * m_uiMaxKeyCount) + seg;
+			float t		= (float)(time - pTime[seg]) * m_segInvLen[idx];
+			u	[count]	= (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+			a	[count]	= m_segCoefA[idx];
+			b	[count]	= m_segCoefB[idx];
+			c	[count]	= m_segCoefC[idx];
+			d	[count]	= m_segCoefD[idx];
+			tgt	[count]	= m_target[n];
+			count++;
+		}
+
+		//
+		// 2. Evaluate all splines at once (no branch, vectorizable).
+		//
+		for (u32 n = 0; n < count; n++) {
+			res[n] = ((((d[n] * u[n]) + c[n]) * u[n]) + b[n]) * u[n] + a[n];
+		}
+
+		//
+		// 3. Apply to node.
+		//
+		for (u32 n = 0; n < count; n++) {
+			float fValue = res[n];
+			switch (tgt[n]) {
+			case MODIFY_X:
+				this->setTranslate(fValue,m_matrix.m_matrix[MAT_TY]);
+				break;
+			case MODIFY_Y:
+				this->setTranslate(m_matrix.m_matrix[MAT_TX],fValue);
+				break;
+			case MODIFY_SCALE:
+				this->setScale(fValue,fValue);
+				break;
+			case MODIFY_R:
+				m_localColorMatrix.m_vector[0] = fValue;
+				modColor = true;
+				break;
+			case MODIFY_G:
+				m_localColorMatrix.m_vector[1] = fValue;
+				modColor = true;
+				break;
+			case MODIFY_B:
+				m_localColorMatrix.m_vector[2] = fValue;
+				modColor = true;
+				break;
+			case MODIFY_A:
+				m_localColorMatrix.m_vector[3] = fValue;
+				modColor = true;
+				break;
+			case MODIFY_ROT:
+				this->setRotation(fValue);
+				break;
+			}
+		}
+	}
+
+	if (modColor) {
+		applyColorChange();
+	}
+}
+
+void CKLBSplineNode::applyColorChange() {
+	this->m_status |= CMATRIX_CHANGE;
+	markUpTree();
+
+	if (	(m_localColorMatrix.m_vector[0] != 1.0f) || 
+			(m_localColorMatrix.m_vector[1] != 1.0f) || 
+			(m_localColorMatrix.m_vector[2] != 1.0f) || 
+			(m_localColorMatrix.m_vector[3] != 1.0f) ) {
+		m_pColorMatrix		= &m_colorMatrix;
+		m_useParentColor	= false;
+	} else {
+		m_pColorMatrix		= this->m_parent->m_pColorMatrix;
+		m_useParentColor	= true;
+	}
 }
 
 void CKLBSplineNode::setAnimation(s32 milliSecondsPlayTime, s32 timeShift, u32 type, s32* keys, u32 keycount, u32 affected, float* arrayParam) {
@@ -470,34 +714,22 @@ void CKLBSplineNode::animate(u32 deltaTimeMilli) {
 		time = 0;
 	}
 
-	// Perform each spline.
-	for (u32 n = 0; n < m_uiSplineCount; n++) {
-		s32* pData;
-		s32 uiMaxSize;
-
-		if (m_mode == 1) {
-			pData		= m_aKeyVector;
-			uiMaxSize	= m_uiTotalKeyCount * VECTORSIZE;
-		} else {
-			pData		= (s32*)m_splines[n];
-			uiMaxSize	= (m_splinesKeyCount[n] * VECTORSIZE);
-		}
+	if (m_mode == 2) {
+		// Multi key splines (generateAnimation)
+		animateSplines(time);
+	} else if (m_uiSplineCount) {
+		// Single preset / user key vector (setAnimation)
+		s32* pData		= m_aKeyVector;
+		s32 uiMaxSize	= m_uiTotalKeyCount * VECTORSIZE;
 
 		if (time < m_uiLastLocalTime) {
 			// First time, or time backward.
 			uiIdx = VECTORSIZE;
 		} else {
-			if (m_mode == 1) {
-				if (m_uiLastKey<VECTORSIZE) {
-					m_uiLastKey = VECTORSIZE;
-				}
-				uiIdx = m_uiLastKey;
-			} else {
-				if (m_splineLastKey[n]<VECTORSIZE) {
-					m_splineLastKey[n] = VECTORSIZE;
-				}
-				uiIdx = m_splineLastKey[n];
+			if (m_uiLastKey<VECTORSIZE) {
+				m_uiLastKey = VECTORSIZE;
 			}
+			uiIdx = m_uiLastKey;
 		}
 
 		//
@@ -531,11 +763,7 @@ void CKLBSplineNode::animate(u32 deltaTimeMilli) {
 		uiIdx -= VECTORSIZE;
 
 		// Save Last Key.
-		if (m_mode == 1) {
-			m_uiLastKey = uiIdx;
-		} else {
-			m_splineLastKey[n] = uiIdx;
-		}
+		m_uiLastKey = uiIdx;
 
 		// Go to first vector element.
 		uiIdx++;
@@ -546,91 +774,38 @@ void CKLBSplineNode::animate(u32 deltaTimeMilli) {
 		s32 value    = interpolateKey(uiDt, &pData[uiIdx]);
 		float fValue = value / 65535.0f;
 
-		bool modColor = false;
-
-		if (m_mode == 1) {
-			bool modifCoord = ((m_applyMask & (ANM_X_COORD_0 | ANM_Y_COORD_1)) != 0); 
-			if (modifCoord) {
-				float tx = (m_applyMask & ANM_X_COORD_0) ? m_base[0] + (m_base[1] * fValue) : this->m_matrix.m_matrix[MAT_TX];
-				float ty = (m_applyMask & ANM_Y_COORD_1) ? m_base[2] + (m_base[3] * fValue) : this->m_matrix.m_matrix[MAT_TY];
+		bool modifCoord = ((m_applyMask & (ANM_X_COORD_0 | ANM_Y_COORD_1)) != 0); 
+		if (modifCoord) {
+			float tx = (m_applyMask & ANM_X_COORD_0) ? m_base[0] + (m_base[1] * fValue) : this->m_matrix.m_matrix[MAT_TX];
+			float ty = (m_applyMask & ANM_Y_COORD_1) ? m_base[2] + (m_base[3] * fValue) : this->m_matrix.m_matrix[MAT_TY];
 
-				this->setTranslate(tx,ty);
-			}
+			this->setTranslate(tx,ty);
+		}
 
-			bool modifRot = (m_applyMask & ANM_ROTATION_COORD_9) != 0;
-			if (m_applyMask & (ANM_SCALE_COORD_2 | ANM_SCALEX_COORD_7 | ANM_SCALEY_COORD_8)) {
-				if (modifRot) {
-					this->setScaleRotation(	m_base[4]  + (m_base[5]  * fValue),
-											m_base[6]  + (m_base[7]  * fValue),
-											m_base[16] + (m_base[17] * fValue)
-										  );
-				} else {
-					this->setScale(	m_base[4] + (m_base[5] * fValue),
-									m_base[6] + (m_base[7] * fValue));
-				}
+		bool modifRot = (m_applyMask & ANM_ROTATION_COORD_9) != 0;
+		if (m_applyMask & (ANM_SCALE_COORD_2 | ANM_SCALEX_COORD_7 | ANM_SCALEY_COORD_8)) {
+			if (modifRot) {
+				this->setScaleRotation(	m_base[4]  + (m_base[5]  * fValue),
+										m_base[6]  + (m_base[7]  * fValue),
+										m_base[16] + (m_base[17] * fValue)
+									  );
 			} else {
-				if (modifRot) {
-					this->setRotation(m_base[16] + (m_base[17] * fValue));
-				}
+				this->setScale(	m_base[4] + (m_base[5] * fValue),
+								m_base[6] + (m_base[7] * fValue));
 			}
-
-			if (m_applyMask & (ANM_R_COLOR_3 | ANM_G_COLOR_4 | ANM_B_COLOR_5 | ANM_A_COLOR_6)) 
-			{
-				modColor = true;
-				if (m_applyMask & ANM_R_COLOR_3) { m_localColorMatrix.m_vector[0] = m_base[8 ] + (m_base[9 ] * fValue); }
-				if (m_applyMask & ANM_G_COLOR_4) { m_localColorMatrix.m_vector[1] = m_base[10] + (m_base[11] * fValue); }
-				if (m_applyMask & ANM_B_COLOR_5) { m_localColorMatrix.m_vector[2] = m_base[12] + (m_base[13] * fValue); }
-				if (m_applyMask & ANM_A_COLOR_6) { m_localColorMatrix.m_vector[3] = m_base[14] + (m_base[15] * fValue); }
-			}
-
 		} else {
-			switch (m_target[n]) {
-			case MODIFY_X:
-				this->setTranslate(fValue,m_matrix.m_matrix[MAT_TY]);
-				break;
-			case MODIFY_Y:
-				this->setTranslate(m_matrix.m_matrix[MAT_TX],fValue);
-				break;
-			case MODIFY_SCALE:
-				this->setScale(fValue,fValue);
-				break;
-			case MODIFY_R:
-				m_localColorMatrix.m_vector[0] = fValue;
-				modColor = true;
-				break;
-			case MODIFY_G:
-				m_localColorMatrix.m_vector[1] = fValue;
-				modColor = true;
-				break;
-			case MODIFY_B:
-				m_localColorMatrix.m_vector[2] = fValue;
-				modColor = true;
-				break;
-			case MODIFY_A:
-				m_localColorMatrix.m_vector[3] = fValue;
-				modColor = true;
-				break;
-			case MODIFY_ROT:
-				this->setRotation(fValue);
-				break;
+			if (modifRot) {
+				this->setRotation(m_base[16] + (m_base[17] * fValue));
 			}
 		}
 
-		if (modColor)
+		if (m_applyMask & (ANM_R_COLOR_3 | ANM_G_COLOR_4 | ANM_B_COLOR_5 | ANM_A_COLOR_6)) 
 		{
-			this->m_status |= CMATRIX_CHANGE;
-			markUpTree();
-
-			if (	(m_localColorMatrix.m_vector[0] != 1.0f) || 
-					(m_localColorMatrix.m_vector[1] != 1.0f) || 
-					(m_localColorMatrix.m_vector[2] != 1.0f) || 
-					(m_localColorMatrix.m_vector[3] != 1.0f) ) {
-				m_pColorMatrix		= &m_colorMatrix;
-				m_useParentColor	= false;
-			} else {
-				m_pColorMatrix		= this->m_parent->m_pColorMatrix;
-				m_useParentColor	= true;
-			}
+			if (m_applyMask & ANM_R_COLOR_3) { m_localColorMatrix.m_vector[0] = m_base[8 ] + (m_base[9 ] * fValue); }
+			if (m_applyMask & ANM_G_COLOR_4) { m_localColorMatrix.m_vector[1] = m_base[10] + (m_base[11] * fValue); }
+			if (m_applyMask & ANM_B_COLOR_5) { m_localColorMatrix.m_vector[2] = m_base[12] + (m_base[13] * fValue); }
+			if (m_applyMask & ANM_A_COLOR_6) { m_localColorMatrix.m_vector[3] = m_base[14] + (m_base[15] * fValue); }
+			applyColorChange();
 		}
 	}
 
@@ -1225,3 +1400,75 @@ s32 CKLBSplineNode::interpolateKey(s32 interpolation, s32* vectorData) {
 	// Value as is, Tangent as 16.16 format.
 	return ( ( (((s64)p0)*pTbl[0]) + ((((s64)t0)*pTbl[1])) + (((s64)p1)*pTbl[2]) + ((((s64)t1)*pTbl[3])) )>>TBLRESOLUTIONBIT);
 }
+
+#ifdef INTERNAL_BENCH
+// 2048 nodes, each with 4 splines of 128 keys (different values per node) : play the whole track
+// at 60 fps, all nodes per frame, then seek every node to pseudo random times.
+// Playback and seek must land on the same values for the same time.
+static bool benchSplineNode(u32 loops) {
+	enum { NODES = 2048, KEYS = 128, KEY_TIME = 33, FRAME = 16 };
+	static const u8 targets[4] = {	CKLBSplineNode::MODIFY_X, CKLBSplineNode::MODIFY_Y,
+									CKLBSplineNode::MODIFY_SCALE, CKLBSplineNode::MODIFY_A };
+
+	CKLBSplineNode** pNodes = KLBNEWA(CKLBSplineNode*, NODES);
+	if (!pNodes) { return false; }
+	bool ok = true;
+	for (u32 n = 0; n < NODES; n++) {
+		pNodes[n] = ok ? KLBNEW(CKLBSplineNode) : NULL;
+		ok = ok && pNodes[n] && pNodes[n]->setParamCount(4, KEYS);
+		for (u8 sp = 0; ok && (sp < 4); sp++) {
+			pNodes[n]->setTarget(sp, targets[sp]);
+			for (u32 k = 0; k < KEYS; k++) {
+				pNodes[n]->addKeys(sp, k * KEY_TIME, (s16)(((k * 37 + sp * 11 + n * 7) % 200) - 100));
+			}
+		}
+		if (ok) { pNodes[n]->generateAnimation(); }
+	}
+
+	u32 frames		= ((KEYS - 1) * KEY_TIME) / FRAME;
+	u32 checkFrame	= frames / 3;
+	float checkX[NODES];
+	s64 timePlay	= 0;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		for (u32 n = 0; n < NODES; n++) { pNodes[n]->play(); }
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 f = 1; f < frames; f++) {
+			for (u32 n = 0; n < NODES; n++) { pNodes[n]->animate(FRAME); }
+			if (f == checkFrame) {
+				for (u32 n = 0; n < NODES; n++) { checkX[n] = pNodes[n]->m_matrix.m_matrix[MAT_TX]; }
+			}
+		}
+		timePlay += CKLBBenchmark::now() - t0;
+	}
+
+	u32 seed		= 12345;
+	s64 timeSeek	= 0;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; n < NODES; n++) {
+			seed = (seed * 1103515245) + 12345;
+			pNodes[n]->play();
+			pNodes[n]->animate(((seed >> 8) % frames) * FRAME);
+		}
+		timeSeek += CKLBBenchmark::now() - t0;
+	}
+
+	for (u32 n = 0; n < NODES; n++) {
+		if (!pNodes[n]) { continue; }
+		if (ok && loops) {
+			pNodes[n]->play();
+			pNodes[n]->animate(checkFrame * FRAME);
+			ok = (pNodes[n]->m_matrix.m_matrix[MAT_TX] == checkX[n]);
+		}
+		pNodes[n]->stop();
+		KLBDELETE(pNodes[n]);
+	}
+	KLBDELETEA(pNodes);
+
+	CKLBBenchmark::report("play 2048 nodes x 4x128 keys, per frame",	loops * (frames - 1),	timePlay);
+	CKLBBenchmark::report("random seek, per node",						loops * NODES,			timeSeek);
+	return ok;
+}
+
+static CKLBBenchmark gBenchSplineNode("SPLINE", benchSplineNode);
+#endif
@@ -80,7 +80,7 @@ public:
 
 	void			setAnimation		(s32 milliSecondsPlayTime, s32 timeShift, u32 type, s32* keys, u32 keycount, u32 affected, float* arrayParam);
 
-	bool			setParamCount		(u8 splineCount, u8 maxKeyCount);
+	bool			setParamCount		(u8 splineCount, u16 maxKeyCount);
 	void			setTarget			(u8 splineIndex, u8 targetParameter);
 	void			addKeys				(u8 splineIndex, u32 time, s16 value);
 	void			addKeysFixed		(u8 splineIndex, u32 time, s32 fixed16Value);
@@ -96,6 +96,9 @@ public:
 
 private:
 	void			cleanSplines();
+	void			generateSegments	();
+	void			animateSplines		(s32 time);
+	void			applyColorChange	();
 
 	s32 			interpolateKey		(s32 interpolation, s32* vectorData);
 	s32*			m_aKeyVector;
@@ -118,8 +121,21 @@ private:
 	s32*			m_allKeys;
 	u32*			m_splinesKeyCount;
 //	s32*			m_splineLocalTime;
-	u16*			m_splineLastKey;
+	u32*			m_splineCursor;		// Current segment of each spline.
 	s32**			m_splines;
+
+	//
+	// Precomputed segments (generateAnimation), structure of arrays.
+	// Spline n, segment k is at [n * m_uiMaxKeyCount + k].
+	// value(u) = ((D * u + C) * u + B) * u + A , u = (time - keyTime) * invLen in [0..1]
+	// Last segment of a spline is constant (end value).
+	//
+	s32*			m_segTime;
+	float*			m_segCoefA;
+	float*			m_segCoefB;
+	float*			m_segCoefC;
+	float*			m_segCoefD;
+	float*			m_segInvLen;
 	void*			m_tag;
 	s32				m_uiTotalTime;
 	u32				m_uiMaxKeyCount;
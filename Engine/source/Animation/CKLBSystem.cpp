@@ -14,6 +14,9 @@
    limitations under the License.
 */
 #include "CKLBNode.h"
+#include "CKLBWorkerPool.h"
+#include "CKLBBenchmark.h"
+#include <string.h>
 
 //
 // Just some wrapping code to avoid dependancy between the game framework class and node system.
@@ -96,4 +99,320 @@ CKLBNode* gm_animatedList = NULL;
 //	end -= start;
 //	end /= 1000; // To nano -> uSec
 //	CPFInterface::getInstance().platform().logging("Anim : %i, Count : %i, SWF : %i\n",(s32)end, count, countSWF);
-}
\ No newline at end of file
+}
+//
+// Dirty node list and sub tree recomputation.
+//
+
+#if (NODE_RECOMPUTE_WORKERS > 0)
+#define USE_RECOMPUTE_WORKERS
+#endif
+
+#define DIRTY_LIST_MIN_SIZE		(256)
+#define DIRTY_MAX_PASS			(3)
+
+struct SRecomputeJob {
+	CKLBNode*	pRoot;
+	CKLBNode*	pDeferHead;
+	CKLBNode*	pDeferTail;
+};
+
+static CKLBNode**		gm_dirtyList	= NULL;
+static u32				gm_dirtyCount	= 0;
+static u32				gm_dirtyMax		= 0;
+
+static SRecomputeJob*	gm_jobs			= NULL;
+static u32				gm_jobMax		= 0;
+
+#ifdef USE_RECOMPUTE_WORKERS
+static CKLBWorkerPool	gm_recomputePool(NODE_RECOMPUTE_WORKERS);
+#endif
+
+/*static*/void CKLBSystem::addToDirty(CKLBNode* pNode) {
+	klb_assert(pNode, "null pointer");
+
+	if (gm_dirtyCount >= gm_dirtyMax) {
+		u32 newMax = gm_dirtyMax ? (gm_dirtyMax * 2) : DIRTY_LIST_MIN_SIZE;
+		CKLBNode** pNewList = KLBNEWA(CKLBNode*, newMax);
+		if (!pNewList) {
+			klb_assertAlways("Dirty node list allocation failed");
+			return;
+		}
+		if (gm_dirtyList) {
+			memcpy(pNewList, gm_dirtyList, sizeof(CKLBNode*) * gm_dirtyCount);
+			KLBDELETEA(gm_dirtyList);
+		}
+		gm_dirtyList	= pNewList;
+		gm_dirtyMax		= newMax;
+	}
+
+	pNode->m_status		|= CKLBNode::DIRTY_LISTED;
+	pNode->m_dirtyIndex	 = gm_dirtyCount;
+	gm_dirtyList[gm_dirtyCount++] = pNode;
+}
+
+/*static*/void CKLBSystem::removeFromDirty(CKLBNode* pNode) {
+	u32 idx = pNode->m_dirtyIndex;
+	if ((idx < gm_dirtyCount) && (gm_dirtyList[idx] == pNode)) {
+		gm_dirtyList[idx] = NULL;
+	}
+	pNode->m_status &= ~CKLBNode::DIRTY_LISTED;
+}
+
+/*static*/void CKLBSystem::deferCustom(SRecomputeJob* pJob, CKLBNode* pNode) {
+	pNode->m_deferStatus	= pNode->m_status & CKLBNode::ANY_CHANGE;
+	pNode->m_pDeferNext		= NULL;
+	if (pJob->pDeferTail) {
+		pJob->pDeferTail->m_pDeferNext = pNode;
+	} else {
+		pJob->pDeferHead = pNode;
+	}
+	pJob->pDeferTail = pNode;
+}
+
+/*static*/u32 CKLBSystem::collectDirtyRoots(u32 count) {
+	if (gm_jobMax < count) {
+		KLBDELETEA(gm_jobs);
+		gm_jobs		= KLBNEWA(SRecomputeJob, count);
+		gm_jobMax	= gm_jobs ? count : 0;
+	}
+
+	//
+	// 1. Tag all visible nodes of the list (invisible nodes keep their flags and
+	//    will be registered again by visibleSelf()).
+	//
+	for (u32 n = 0; n < count; n++) {
+		CKLBNode* pNode = gm_dirtyList[n];
+		if (pNode) {
+			pNode->m_status &= ~CKLBNode::DIRTY_LISTED;
+			if (pNode->isVisible()) {
+				pNode->m_status |= CKLBNode::DIRTY_ROOT;
+			} else {
+				gm_dirtyList[n] = NULL;
+			}
+		}
+	}
+
+	//
+	// 2. A node with a tagged ancestor is recomputed by the ancestor recursion,
+	//    others are the sub tree roots.
+	//
+	u32 rootCount = 0;
+	for (u32 n = 0; n < count; n++) {
+		CKLBNode* pNode = gm_dirtyList[n];
+		if (!pNode) { continue; }
+
+		CKLBNode* pUp = pNode->m_parent;
+		while (pUp && ((pUp->m_status & CKLBNode::DIRTY_ROOT) == 0)) {
+			pUp = pUp->m_parent;
+		}
+
+		if (pUp) {
+			// Make sure the recursion from the ancestor goes down to this node.
+			CKLBNode* pPath = pNode->m_parent;
+			while (pPath != pUp) {
+				pPath->m_status |= CKLBNode::MARKED;
+				pPath = pPath->m_parent;
+			}
+			pUp->m_status |= CKLBNode::MARKED;
+		} else {
+			// Upper nodes are not visited : clear their marking.
+			CKLBNode* pPath = pNode->m_parent;
+			while (pPath) {
+				pPath->m_status &= ~CKLBNode::MARKED;
+				pPath = pPath->m_parent;
+			}
+
+			if (gm_jobs) {
+				SRecomputeJob* pJob = &gm_jobs[rootCount++];
+				pJob->pRoot			= pNode;
+				pJob->pDeferHead	= NULL;
+				pJob->pDeferTail	= NULL;
+			} else {
+				// No job buffer : recompute directly.
+				pNode->recompute();
+			}
+		}
+	}
+
+	//
+	// 3. Remove tags.
+	//
+	for (u32 n = 0; n < count; n++) {
+		CKLBNode* pNode = gm_dirtyList[n];
+		if (pNode) {
+			pNode->m_status &= ~CKLBNode::DIRTY_ROOT;
+		}
+	}
+
+	return rootCount;
+}
+
+/*static*/void CKLBSystem::recomputeJob(void* /*pCtx*/, u32 index) {
+	SRecomputeJob* pJob = &gm_jobs[index];
+	pJob->pRoot->recomputeNode(pJob);
+}
+
+/*static*/void CKLBSystem::processDirtyRoots(u32 rootCount) {
+#ifdef USE_RECOMPUTE_WORKERS
+	if (rootCount >= NODE_RECOMPUTE_PARALLEL_MIN) {
+		gm_recomputePool.run(recomputeJob, NULL, rootCount);
+
+		//
+		// Merge : deferred custom recomputation, in sub tree registration order then tree order.
+		//
+		for (u32 n = 0; n < rootCount; n++) {
+			CKLBNode* pNode = gm_jobs[n].pDeferHead;
+			while (pNode) {
+				CKLBNode* pNext		= pNode->m_pDeferNext;
+				pNode->m_pDeferNext	= NULL;
+				pNode->m_status		= (pNode->m_status & ~CKLBNode::ANY_CHANGE) | pNode->m_deferStatus;
+				pNode->recomputeCustom();
+				pNode->m_status		&= ~CKLBNode::ANY_CHANGE;
+				pNode = pNext;
+			}
+		}
+		return;
+	}
+#endif
+
+	for (u32 n = 0; n < rootCount; n++) {
+		gm_jobs[n].pRoot->recompute();
+	}
+}
+
+/*static*/void CKLBSystem::performRecompute() {
+	//
+	// recomputeCustom() may mark nodes again, perform a few passes so that
+	// those changes are applied in the same frame. Anything left goes to next frame.
+	//
+	for (u32 pass = 0; (pass < DIRTY_MAX_PASS) && gm_dirtyCount; pass++) {
+		u32 count		= gm_dirtyCount;
+		u32 rootCount	= collectDirtyRoots(count);
+		processDirtyRoots(rootCount);
+
+		// Keep only the nodes registered during this pass.
+		u32 remain = gm_dirtyCount - count;
+		for (u32 n = 0; n < remain; n++) {
+			CKLBNode* pNode = gm_dirtyList[count + n];
+			gm_dirtyList[n] = pNode;
+			if (pNode) {
+				pNode->m_dirtyIndex = n;
+			}
+		}
+		gm_dirtyCount = remain;
+	}
+}
+
+/*static*/void CKLBSystem::releaseRecompute() {
+#ifdef USE_RECOMPUTE_WORKERS
+	gm_recomputePool.release();
+#endif
+
+	for (u32 n = 0; n < gm_dirtyCount; n++) {
+		if (gm_dirtyList[n]) {
+			gm_dirtyList[n]->m_status &= ~CKLBNode::DIRTY_LISTED;
+		}
+	}
+	KLBDELETEA(gm_dirtyList);
+	KLBDELETEA(gm_jobs);
+	gm_dirtyList	= NULL;
+	gm_dirtyCount	= 0;
+	gm_dirtyMax		= 0;
+	gm_jobs			= NULL;
+	gm_jobMax		= 0;
+}
+
+#ifdef INTERNAL_BENCH
+// Detached tree : root, top node, 500 groups x 100 leaves (50502 nodes). Each frame moves 1% of
+// the nodes : 505 scattered leaves (independent sub trees, recomputed by the workers), or 5 whole
+// groups. Both are compared with moving the top node, which recomputes the full tree.
+// Cost should follow the number of modified nodes, not the tree size.
+static bool benchRecompute(u32 loops) {
+	enum { GROUPS = 500, LEAVES = 100, MOVED_LEAVES = (GROUPS * (LEAVES + 1) + 1) / 100, MOVED_GROUPS = GROUPS / 100 };
+	CKLBNode* pRoot = KLBNEW(CKLBNode);
+	CKLBNode* pTop  = KLBNEW(CKLBNode);
+	CKLBNode** pGroups = KLBNEWA(CKLBNode*, GROUPS);
+	CKLBNode** pLeaves = KLBNEWA(CKLBNode*, GROUPS * LEAVES);
+	if (pRoot && pTop) {
+		pRoot->asRoot();
+		pRoot->addNode(pTop);
+	}
+	bool ok = pRoot && pTop && pGroups && pLeaves;
+	if (ok) {
+		for (u32 g = 0; ok && (g < GROUPS); g++) {
+			pGroups[g] = KLBNEW(CKLBNode);
+			ok = (pGroups[g] != NULL);
+			if (!ok) { break; }
+			pTop->addNode(pGroups[g]);
+			pGroups[g]->setTranslate((float)g, 0.0f);
+			for (u32 l = 0; l < LEAVES; l++) {
+				CKLBNode* pLeaf = KLBNEW(CKLBNode);
+				pLeaves[g * LEAVES + l] = pLeaf;
+				ok = (pLeaf != NULL);
+				if (!ok) { break; }
+				pGroups[g]->addNode(pLeaf);
+				pLeaf->setTranslate((float)l, 0.0f);
+			}
+		}
+	}
+	if (!ok) {
+		if (pRoot) {
+			KLBDELETE(pRoot);	// Deletes the nodes already added.
+		} else if (pTop) {
+			KLBDELETE(pTop);
+		}
+		KLBDELETEA(pGroups);
+		KLBDELETEA(pLeaves);
+		return false;
+	}
+	CKLBSystem::performRecompute();	// Also flushes the nodes already dirty in the scene.
+
+	s64 timeLeaves	= 0;
+	s64 timeGroups	= 0;
+	s64 timeAll		= 0;
+	u32 seed		= 12345;
+	for (u32 n = 0; ok && (n < loops); n++) {
+		float pos = (float)(n + 1);
+		u32 picked[MOVED_LEAVES];
+		for (u32 m = 0; m < MOVED_LEAVES; m++) {
+			seed		= seed * 1103515245 + 12345;
+			picked[m]	= (seed >> 8) % (GROUPS * LEAVES);
+		}
+		u32 firstGroup	= (n * MOVED_GROUPS) % GROUPS;
+
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 m = 0; m < MOVED_LEAVES; m++) { pLeaves[picked[m]]->setTranslate(pos, pos); }
+		CKLBSystem::performRecompute();
+		s64 t1 = CKLBBenchmark::now();
+		for (u32 m = 0; m < MOVED_GROUPS; m++) { pGroups[(firstGroup + m) % GROUPS]->setTranslate(pos, pos); }
+		CKLBSystem::performRecompute();
+		s64 t2 = CKLBBenchmark::now();
+		pTop->setTranslate(pos, 0.0f);
+		CKLBSystem::performRecompute();
+		s64 t3 = CKLBBenchmark::now();
+
+		timeLeaves	+= t1 - t0;
+		timeGroups	+= t2 - t1;
+		timeAll		+= t3 - t2;
+
+		// Composed position = top + group + leaf.
+		for (u32 m = 0; ok && (m < MOVED_LEAVES); m++) {
+			CKLBNode* pLeaf	= pLeaves[picked[m]];
+			CKLBNode* pGroup= pGroups[picked[m] / LEAVES];
+			ok = (pLeaf->m_composedMatrix.m_matrix[MAT_TX] == pos + pGroup->getTranslateX() + pLeaf->getTranslateX())
+			  && (pLeaf->m_composedMatrix.m_matrix[MAT_TY] == pGroup->getTranslateY() + pLeaf->getTranslateY());
+		}
+	}
+	KLBDELETE(pRoot);
+	KLBDELETEA(pGroups);
+	KLBDELETEA(pLeaves);
+
+	CKLBBenchmark::report("1% : 505 leaves, 505 sub trees",	loops, timeLeaves);
+	CKLBBenchmark::report("1% : 5 groups (505 nodes)",		loops, timeGroups);
+	CKLBBenchmark::report("full tree (50502 nodes)",		loops, timeAll);
+	return ok;
+}
+
+static CKLBBenchmark gBenchRecompute("RECOMPUTE", benchRecompute);
+#endif
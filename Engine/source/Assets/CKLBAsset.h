@@ -342,6 +342,8 @@ private:
 public:
 	void		unloadAsset					();
 	void		restoreAsset				();
+	// Reload the content of a texture asset from its source file (main thread only).
+	bool		reloadAsset					(CKLBAbstractAsset* pAsset);
 
 	CKLBAbstractAsset* 
 				loadAssetByFileName	(const char* fileName, IKLBAssetPlugin* plugin = NULL, bool noStream = false, bool useAsync = false);
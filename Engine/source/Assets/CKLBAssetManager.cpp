@@ -258,53 +258,66 @@ void
 CKLBAssetManager::restoreAsset() {
 	if (m_unloaded) {
 		m_unloaded = false;
+
+		// New GL context : the shadowed state does not match the driver anymore.
+		dglStateReset();
 		TexturePacker::getInstance().reloadSurfaces();
 
 		for (int n=0; n < m_maxAssetEntry; n++) {
 			if (!m_assetRecord[n].m_isFree) {
 				if (m_assetRecord[n].m_pAsset) {
-					if (m_assetRecord[n].m_pAsset->m_fileSource) {
-						// We have the file of the original data
-						// TEXTURE ONLY for now.
-						// So waste of search time here...
-						IKLBAssetPlugin* plg = this->m_pAssetDecoders;
-						while (plg) {
-							if (plg->charHeader() == 'T') {
-								// Need to skip header also.
-								plg->setReloadingAsset(m_assetRecord[n].m_pAsset);
-
-								IPlatformRequest& pfif = CPFInterface::getInstance().platform();
-								IReadStream * pReadStream = pfif.openReadStream(m_assetRecord[n].m_pAsset->m_fileSource, pfif.useEncryption());
-
-								if (pReadStream && (pReadStream->getStatus() == IReadStream::NORMAL)) {
-									int size = pReadStream->getSize() - pReadStream->getPosition();
-									if (size) {
-										size -= 8;
-										pReadStream->readU32(); // Ignore Header
-										pReadStream->readU32(); // Ignore Size
-										u8* pBuffer = KLBNEWA(u8,size);
-										if (pBuffer) {
-											if (pReadStream->readBlock(pBuffer, size)) {
-												plg->loadAsset(pBuffer, size);
-											}
-											KLBDELETEA(pBuffer);
-										}
-									}
-								}
-
-								if (pReadStream) {
-									delete pReadStream;
-								}
-
-								plg->setReloadingAsset(NULL);
-							}
-							plg = plg->m_pNext;
+					reloadAsset(m_assetRecord[n].m_pAsset);
+				}
+			}
+		}
+	}
+}
+
+bool
+CKLBAssetManager::reloadAsset(CKLBAbstractAsset* pAsset) {
+	if (!pAsset->m_fileSource) {
+		return false;
+	}
+
+	bool res = false;
+
+	// We have the file of the original data
+	// TEXTURE ONLY for now.
+	// So waste of search time here...
+	IKLBAssetPlugin* plg = this->m_pAssetDecoders;
+	while (plg) {
+		if (plg->charHeader() == 'T') {
+			// Need to skip header also.
+			plg->setReloadingAsset(pAsset);
+
+			IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+			IReadStream * pReadStream = pfif.openReadStream(pAsset->m_fileSource, pfif.useEncryption());
+
+			if (pReadStream && (pReadStream->getStatus() == IReadStream::NORMAL)) {
+				int size = pReadStream->getSize() - pReadStream->getPosition();
+				if (size) {
+					size -= 8;
+					pReadStream->readU32(); // Ignore Header
+					pReadStream->readU32(); // Ignore Size
+					u8* pBuffer = KLBNEWA(u8,size);
+					if (pBuffer) {
+						if (pReadStream->readBlock(pBuffer, size)) {
+							res = (plg->loadAsset(pBuffer, size) != NULL);
 						}
+						KLBDELETEA(pBuffer);
 					}
 				}
 			}
+
+			if (pReadStream) {
+				delete pReadStream;
+			}
+
+			plg->setReloadingAsset(NULL);
 		}
+		plg = plg->m_pNext;
 	}
+	return res;
 }
 
 CKLBAbstractAsset*
@@ -14,22 +14,9 @@
    limitations under the License.
 */
 #include "CKLBPropertyBag.h"
+#include "CKLBBenchmark.h"
 #include <string.h>
 
-/*
-u32 CKLBPropertyBag::propAlloc		= 0;
-u32 CKLBPropertyBag::bagAlloc		= 0;
-u32 CKLBPropertyBag::stringAlloc	= 0;
-bool CKLBPropertyBag::deletionFlag	= false;
-
-//
-// Global Array
-//
-CKLBPropertyBag			CKLBPropertyBag::bags			[MAX_PROPERTYBAG_COUNT];
-CKLBPropertyBag::_v		CKLBPropertyBag::properties		[MAX_PROP_BUFFER_COUNT];
-u8						CKLBPropertyBag::propertyTypes	[MAX_PROP_BUFFER_COUNT];
-char					CKLBPropertyBag::strings		[STRING_BUFFER_SIZE];
-*/
 CKLBPropertyBag		*	CKLBPropertyBag::ms_begin = 0;
 CKLBPropertyBag		*	CKLBPropertyBag::ms_end   = 0;
 
@@ -44,45 +31,22 @@ enum E_TYPE {
 
 /*static*/ CKLBPropertyBag*	CKLBPropertyBag::getPropertyBag() {
 	return KLBNEW(CKLBPropertyBag);
-/*
-	// 1. Perform compaction
-	compact();
-
-	// 2. Allocate
-	for (u32 n=0; n < bagAlloc; n++) {
-		if (bags[n].m_free) {
-			return &bags[n];
-		}
-	}
-
-	// 3. Not found : Extend...
-	if (bagAlloc < MAX_PROPERTYBAG_COUNT) {
-		// ok
-		bags[bagAlloc].m_free = true;		
-		return &bags[bagAlloc++];
-	} else {
-		// Reach full end.
-		klb_assertAlways("Property Bag Pool fully used.");
-		return NULL;
-	}
-*/
 }
 
 /*static*/ void CKLBPropertyBag::releasePropertyBag(CKLBPropertyBag* pBag) {
 	KLBDELETE(pBag);
-/*
-	pBag->m_free = true;
-	deletionFlag = true;
-*/
 }
 	
 CKLBPropertyBag::CKLBPropertyBag()
-: m_prev            (NULL)
-, m_next            (NULL)
-, m_propertyValues  (NULL)
+: m_propertyValues  (NULL)
 , m_propertyTypes   (NULL)
+, m_hashIndex       (NULL)
+, m_blocks          (NULL)
 , m_propertyCount   (0)
 , m_propertyMax     (0)
+, m_hashMask        (0)
+, m_prev            (NULL)
+, m_next            (NULL)
 {
 	m_prev = ms_end;
 	if(m_prev) {
@@ -95,12 +59,17 @@ CKLBPropertyBag::CKLBPropertyBag()
 
 CKLBPropertyBag::~CKLBPropertyBag() {
 
-	// プロパティの持つ名前(およびstringと一体になっている)を破棄
-	for(int i = 0; i < m_propertyCount; i++) {
-		KLBDELETEA(m_propertyValues[i].name);
+	// 名前と文字列値はアリーナにまとめて確保されているので、ブロック単位で破棄
+	SBlock* pBlock = m_blocks;
+	while(pBlock) {
+		SBlock* pNext = pBlock->next;
+		u8* raw = (u8*)pBlock;
+		KLBDELETEA(raw);
+		pBlock = pNext;
 	}
 	KLBDELETEA(m_propertyValues);
 	KLBDELETEA(m_propertyTypes);
+	KLBDELETEA(m_hashIndex);
 
 	// 自身をリンクから切り離す
 	if(m_prev) {
@@ -117,97 +86,54 @@ CKLBPropertyBag::~CKLBPropertyBag() {
 
 bool CKLBPropertyBag::init() {
 	return true;
-/*
-	bool res = true;
-	
-	this->m_propertyValues	= &properties		[propAlloc];
-	this->m_propertyTypes	= &propertyTypes	[propAlloc];
-	this->m_propertyCount	= 0;
-	this->m_free			= !res;
-	return res;
-*/
 }
 
-const char*	CKLBPropertyBag::allocateName(const char* originalName, int addlen) {
-	u32 len = strlen(originalName) + 1;
-	char * buf = KLBNEWA(char, len + addlen);
-	memcpy(buf, originalName, len);
-	return (const char *)buf;
+/*static*/
+u32 CKLBPropertyBag::hashName(const char* name, u32* pLen) {
+	// FNV-1a
+	u32 hash = 2166136261u;
+	const u8* p = (const u8*)name;
+	while(*p) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+	if (pLen) {
+		*pLen = (u32)(p - (const u8*)name);
+	}
+	return hash;
 }
 
-/*static*/
-void CKLBPropertyBag::compact() {
-/*
-	//
-	// Do NOT compact PropertyBag array itself -> Pointer will change !
-	//
-
-	if (deletionFlag) {
-		deletionFlag = false;
-		_v* packProp		= properties;
-		u8*	packPropType	= propertyTypes;
-		char* packString	= strings;
-
-		for (u32 n=0; n < bagAlloc; n++) {
-			if (bags[n].m_free == false) {
-				CKLBPropertyBag* pBag = &bags[n];
-
-				//
-				// Move properties.
-				//
-				if (pBag->m_propertyValues != packProp) {
-					memcpy(packProp, pBag->m_propertyValues, sizeof(_v) * pBag->m_propertyCount);
-					memcpy(packPropType, pBag->m_propertyTypes, sizeof(u8) * pBag->m_propertyCount);
-					pBag->m_propertyValues	= packProp;
-					pBag->m_propertyTypes	= packPropType;
-				}
-
-				packProp		+= pBag->m_propertyCount;
-				packPropType	+= pBag->m_propertyCount;
-
-				//
-				// Move String name / value
-				//
-				for (u32 m=0; m < pBag->m_propertyCount; m++) {
-					const char* str = pBag->m_propertyValues[m].name;
-					u32 len = strlen(str) + 1;
-
-					if (str != packString) 
-					{
-						memcpy(packString, str, len);
-						pBag->m_propertyValues[m].name = packString;
-					}
-					packString += len;
-
-					if (pBag->m_propertyTypes[m] == STRING_TYPE) {
-						str = pBag->m_propertyValues[m].v.s;
-						len = strlen(str) + 1;
-						if (pBag->m_propertyValues[m].name != packString)
-						{
-							memcpy(packString, str, len);
-							pBag->m_propertyValues[m].v.s = packString;
-						}
-						packString += len;
-					}
-				}
-			}
+char* CKLBPropertyBag::allocString(u32 len) {
+	SBlock* pBlock = m_blocks;
+	if (!pBlock || ((pBlock->size - pBlock->used) < len)) {
+		// New block : big strings get their own block, never split.
+		u32 size = (len > (u32)STRING_BLOCK_SIZE) ? len : (u32)STRING_BLOCK_SIZE;
+		u8* raw = KLBNEWA(u8, sizeof(SBlock) + size);
+		if (!raw) {
+			return NULL;
 		}
-
-		// Compact string allocator.
-		stringAlloc = packString - strings;
-		// Compact prop allocator;
-		propAlloc	= packProp - properties;
+		pBlock = (SBlock*)raw;
+		pBlock->size	= size;
+		pBlock->used	= 0;
+		pBlock->next	= m_blocks;
+		m_blocks		= pBlock;
 	}
-	*/
+
+	char* res = ((char*)(pBlock + 1)) + pBlock->used;
+	pBlock->used += len;
+	return res;
 }
 
 void
 CKLBPropertyBag::appendProperty()
 {
-	int cnt = m_propertyCount + 1;
-    if(cnt <= m_propertyMax) { return; }
+	u32 cnt = m_propertyCount + 1;
+	if(cnt <= m_propertyMax) { return; }
 
-	cnt = m_propertyMax + PROPERTY_BLOCK_COUNT;
+	cnt = m_propertyMax ? (m_propertyMax * 2) : (u32)PROPERTY_BLOCK_COUNT;
+	if (cnt > MAX_PROPERTY_COUNT) {
+		cnt = MAX_PROPERTY_COUNT;
+	}
 	_v * tmpValues = KLBNEWA(_v, cnt);
 	u8 * tmpTypes  = KLBNEWA(u8, cnt);
 	if(m_propertyValues) {
@@ -221,59 +147,129 @@ CKLBPropertyBag::appendProperty()
 	m_propertyMax   = cnt;
 }
 
+void
+CKLBPropertyBag::rehash(u32 slotCount)
+{
+	KLBDELETEA(m_hashIndex);
+	m_hashIndex = KLBNEWA(u16, slotCount);
+	m_hashMask	= slotCount - 1;
+	for (u32 n = 0; n < slotCount; n++) {
+		m_hashIndex[n] = NULL_IDX;
+	}
+
+	for (u32 n = 0; n < m_propertyCount; n++) {
+		u32 slot = m_propertyValues[n].hash & m_hashMask;
+		while (m_hashIndex[slot] != NULL_IDX) {
+			slot = (slot + 1) & m_hashMask;
+		}
+		m_hashIndex[slot] = (u16)n;
+	}
+}
+
+s32
+CKLBPropertyBag::findSlot(const char* name, u32 hash)
+{
+	// Linear probing, table is never more than half full so an empty slot always exists.
+	u32 slot = hash & m_hashMask;
+	u16 idx;
+	while ((idx = m_hashIndex[slot]) != NULL_IDX) {
+		const _v& entry = m_propertyValues[idx];
+		if ((entry.hash == hash) && (strcmp(name, entry.name) == 0)) {
+			break;
+		}
+		slot = (slot + 1) & m_hashMask;
+	}
+	return slot;
+}
+
+s32
+CKLBPropertyBag::allocEntry(const char* name, u8 type)
+{
+	u32 len;
+	u32 hash = hashName(name, &len);
+
+	if (m_hashIndex) {
+		s32 slot = findSlot(name, hash);
+		u16 idx  = m_hashIndex[slot];
+		if (idx != NULL_IDX) {
+			// Overwrite existing property, name is already stored.
+			m_propertyTypes[idx] = type;
+			return idx;
+		}
+	}
+
+	if (m_propertyCount >= MAX_PROPERTY_COUNT) {
+		klb_assertAlways("Too many properties in bag (%s)", name);
+		return -1;
+	}
+
+	char* pName = allocString(len + 1);
+	if (!pName) {
+		return -1;
+	}
+	memcpy(pName, name, len + 1);
 
-void  CKLBPropertyBag::setPropertyInt(const char* name, s32 value) {
-	// klb_assert(propAlloc < MAX_PROP_BUFFER_COUNT, "No more space for properties");
 	appendProperty();
-	m_propertyValues[m_propertyCount].name = allocateName(name);
-	m_propertyValues[m_propertyCount].v.i  = value;
-	m_propertyTypes[m_propertyCount]       = INT_TYPE;
-	m_propertyCount++;
+	u32 idx = m_propertyCount++;
+	m_propertyValues[idx].name = pName;
+	m_propertyValues[idx].hash = hash;
+	m_propertyTypes [idx]      = type;
+
+	// Keep load factor <= 1/2
+	u32 slotCount = m_hashMask + 1;
+	if (!m_hashIndex || (m_propertyCount * 2 > slotCount)) {
+		slotCount = m_hashIndex ? (slotCount * 2) : (u32)HASH_MIN_SLOT;
+		while (m_propertyCount * 2 > slotCount) {
+			slotCount *= 2;
+		}
+		rehash(slotCount);
+	} else {
+		m_hashIndex[findSlot(pName, hash)] = (u16)idx;
+	}
+	return idx;
+}
+
+void  CKLBPropertyBag::setPropertyInt(const char* name, s32 value) {
+	s32 idx = allocEntry(name, INT_TYPE);
+	if (idx >= 0) {
+		m_propertyValues[idx].v.i = value;
+	}
 }
 
 void CKLBPropertyBag::setPropertyBool(const char* name, bool value) {
-	//klb_assert(propAlloc < MAX_PROP_BUFFER_COUNT, "No more space for properties");
-	appendProperty();
-	m_propertyValues[m_propertyCount].name = allocateName(name);
-	m_propertyValues[m_propertyCount].v.b  = value;
-	m_propertyTypes[m_propertyCount]       = BOOL_TYPE;
-	m_propertyCount++;
+	s32 idx = allocEntry(name, BOOL_TYPE);
+	if (idx >= 0) {
+		m_propertyValues[idx].v.b = value;
+	}
 }
 
 void CKLBPropertyBag::setPropertyFloat(const char* name, float value) {
-	//klb_assert(propAlloc < MAX_PROP_BUFFER_COUNT, "No more space for properties");
-	appendProperty();
-	m_propertyValues[m_propertyCount].name = allocateName(name);
-	m_propertyValues[m_propertyCount].v.f  = value;
-	m_propertyTypes[m_propertyCount]       = FLOAT_TYPE;
-	m_propertyCount++;
+	s32 idx = allocEntry(name, FLOAT_TYPE);
+	if (idx >= 0) {
+		m_propertyValues[idx].v.f = value;
+	}
 }
 
 void CKLBPropertyBag::setPropertyString(const char* name, const char* value) {
-	//klb_assert(propAlloc < MAX_PROP_BUFFER_COUNT, "No more space for properties");
-	appendProperty();
-
-	int namelen  = strlen(name) + 1;
-	int valuelen = strlen(value) + 1;
-
-	const char * vname = allocateName(name, valuelen);
-	char * vstring = (char *)vname + namelen;
-	strcpy(vstring, value);
+	u32 valuelen = strlen(value) + 1;
+	char * vstring = allocString(valuelen);
+	if (!vstring) {
+		return;
+	}
+	memcpy(vstring, value, valuelen);
 
-	m_propertyValues[m_propertyCount].name = vname;
-	m_propertyValues[m_propertyCount].v.s  = vstring;
-	m_propertyTypes[m_propertyCount]       = STRING_TYPE;
-	m_propertyCount++;
+	s32 idx = allocEntry(name, STRING_TYPE);
+	if (idx >= 0) {
+		m_propertyValues[idx].v.s = vstring;
+	}
 }
 
 s32 CKLBPropertyBag::getIndex(const char* name) {
-	for(u32 n = 0; n < m_propertyCount; n++) {
-		if (strcmp(name, m_propertyValues[n].name) == 0) {
-			return n;
-		}
+	if (!m_hashIndex) {
+		return -1;
 	}
-	
-	return -1;
+	u16 idx = m_hashIndex[findSlot(name, hashName(name, NULL))];
+	return (idx != NULL_IDX) ? idx : -1;
 }
 
 u32 CKLBPropertyBag::getFieldType(const char* name) {
@@ -311,12 +307,16 @@ bool CKLBPropertyBag::getPropertyBool(const char* name) {
 
 float CKLBPropertyBag::getPropertyFloat(const char* name) {
 	s32 idx = getIndex(name);
-	if ((idx != -1) && (m_propertyTypes[idx] == BOOL_TYPE)) {
-		return m_propertyValues[idx].v.f;
-	} else {
-		klb_assertAlways("Unknown property or non matching type %s", name);
-		return 0.0f;
+	if (idx != -1) {
+		if (m_propertyTypes[idx] == FLOAT_TYPE) {
+			return m_propertyValues[idx].v.f;
+		} else if (m_propertyTypes[idx] == INT_TYPE) {
+			return (float)m_propertyValues[idx].v.i;
+		}
 	}
+
+	klb_assertAlways("Unknown property or non matching type %s", name);
+	return 0.0f;
 }
 
 const char* CKLBPropertyBag::getPropertyString(const char* name) {
@@ -328,3 +328,108 @@ const char* CKLBPropertyBag::getPropertyString(const char* name) {
 		return NULL;
 	}
 }
+
+#ifdef INTERNAL_BENCH
+#include <stdio.h>
+#include "CompositeManagement.h"
+
+// Composite of BENCH_NODES child nodes, each with a "scrollbar" generic map of 'count' properties
+// (int and string values alternate). Returns the JSON size, 0 if the buffer is too small.
+#define BENCH_NODES	(16)
+static u32 benchCompositeSource(char* buf, u32 bufSize, u32 count) {
+	u32 len = sprintf(buf, "{\"sub\":[");
+	for (u32 node = 0; node < BENCH_NODES; node++) {
+		if (len + 64 > bufSize) { return 0; }
+		len += sprintf(&buf[len], "%s{\"scrollbar\":{", node ? "," : "");
+		for (u32 n = 0; n < count; n++) {
+			if (len + 64 > bufSize) { return 0; }
+			if (n & 1) {
+				len += sprintf(&buf[len], "%s\"prop%u\":\"value%u\"", n ? "," : "", n, n);
+			} else {
+				len += sprintf(&buf[len], "%s\"prop%u\":%u", n ? "," : "", n, n);
+			}
+		}
+		len += sprintf(&buf[len], "}}");
+	}
+	len += sprintf(&buf[len], "]}");
+	return len;
+}
+
+// Composites with 8 and 256 generic properties per node : parse (every property goes into a bag)
+// and instantiation (the bags are consumed and released), both per property.
+// Then bags of the same sizes alone : read every name back and probe as many unknown names.
+// With the hash index and the per bag arena all costs should stay flat when the bags grow.
+static bool benchPropertyBag(u32 loops) {
+	static const u32 sizes[2] = { 8, 256 };
+	const u32 bufSize = BENCH_NODES * 256 * 32 + 64;
+	char* json = KLBNEWA(char, bufSize);
+	if (!json) { return false; }
+
+	char names[256][16];
+	char misses[256][16];
+	for (u32 n = 0; n < 256; n++) {
+		sprintf(names[n],  "prop%u", n);
+		sprintf(misses[n], "none%u", n);
+	}
+
+	CKLBCompositeAssetPlugin plugin;
+	bool ok = true;
+	for (u32 s = 0; ok && (s < 2); s++) {
+		u32 count		= sizes[s];
+		u32 jsonSize	= benchCompositeSource(json, bufSize, count);
+		s64 timeLoad	= 0;
+		s64 timeCreate	= 0;
+		s64 timeGet		= 0;
+		s64 timeMiss	= 0;
+		ok = (jsonSize != 0);
+		for (u32 l = 0; ok && (l < loops); l++) {
+			s64 t0 = CKLBBenchmark::now();
+			CKLBCompositeAsset* pAsset = (CKLBCompositeAsset*)plugin.loadAsset((u8*)json, jsonSize);
+			s64 t1 = CKLBBenchmark::now();
+			CKLBNode* pNode = (pAsset && pAsset->hasPropertyBag()) ? pAsset->createSubTree((CKLBUITask*)NULL, 0) : NULL;
+			s64 t2 = CKLBBenchmark::now();
+			ok = (pNode != NULL);
+			if (pNode) { KLBDELETE(pNode); }
+			if (pAsset) { KLBDELETE(pAsset); }
+			timeLoad	+= t1 - t0;
+			timeCreate	+= t2 - t1;
+		}
+
+		for (u32 l = 0; ok && (l < loops); l++) {
+			CKLBPropertyBag* pBag = CKLBPropertyBag::getPropertyBag();
+			if (!pBag) { ok = false; break; }
+			for (u32 n = 0; n < count; n++) { pBag->setPropertyInt(names[n], n); }
+
+			s64 t0 = CKLBBenchmark::now();
+			u32 sum = 0;
+			for (u32 n = 0; n < count; n++) { sum += pBag->getPropertyInt(names[n]); }
+			s64 t1 = CKLBBenchmark::now();
+			u32 found = 0;
+			for (u32 n = 0; n < count; n++) { found += (pBag->getIndex(misses[n]) != -1) ? 1 : 0; }
+			s64 t2 = CKLBBenchmark::now();
+
+			CKLBPropertyBag::releasePropertyBag(pBag);
+			ok = (sum == count * (count - 1) / 2) && !found;
+			timeGet	+= t1 - t0;
+			timeMiss+= t2 - t1;
+		}
+
+		if (ok) {
+			char label[64];
+			sprintf(label, "composite load, %u props per node", count);
+			CKLBBenchmark::report(label, loops * count * BENCH_NODES, timeLoad);
+			sprintf(label, "composite instantiate, %u props per node", count);
+			CKLBBenchmark::report(label, loops * count * BENCH_NODES, timeCreate);
+			sprintf(label, "get, bag of %u", count);
+			CKLBBenchmark::report(label, loops * count, timeGet);
+			sprintf(label, "miss, bag of %u", count);
+			CKLBBenchmark::report(label, loops * count, timeMiss);
+		}
+	}
+
+	KLBDELETEA(json);
+	return ok;
+}
+
+static CKLBBenchmark gBenchPropertyBag("PROPBAG", benchPropertyBag);
+#endif
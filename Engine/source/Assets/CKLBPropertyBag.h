@@ -18,10 +18,19 @@
 
 #include "BaseType.h"
 
-#define MAX_PROP_BUFFER_COUNT	(2000)
-#define STRING_BUFFER_SIZE		(2000)
-#define MAX_PROPERTYBAG_COUNT	(100)
-
+/*!
+* \class CKLBPropertyBag
+* \brief Generic name / value storage used by composite "generic" fields.
+*
+* Each bag owns its own storage :
+* - property entries live in a growable array,
+* - names and string values are packed into a small block arena owned by the bag,
+* - lookups go through an open addressing hash index (name hash computed once at insertion).
+*
+* Bags do not share any global buffer, so there is no global compaction pass
+* and no hard limit on the number of bags or properties.
+* Setting an already existing name overwrites the previous value.
+*/
 class CKLBPropertyBag {
 public:
 	static CKLBPropertyBag*		getPropertyBag		();
@@ -42,12 +51,19 @@ public:
 			getPropertyString	(const char* name);
 	
 	s32		getIndex(const char* name);
+	inline
+	u32		getPropertyCount	() { return m_propertyCount; }
 private:
 	CKLBPropertyBag();
 	~CKLBPropertyBag();
 	
-	void appendProperty();
-	const char*	allocateName(const char* originalName, int addlen = 0);
+	static u32	hashName		(const char* name, u32* pLen);
+
+	s32			findSlot		(const char* name, u32 hash);
+	s32			allocEntry		(const char* name, u8 type);
+	void		appendProperty	();
+	void		rehash			(u32 slotCount);
+	char*		allocString		(u32 len);
 	
 	struct _v {
 		union v {
@@ -57,37 +73,36 @@ private:
 			bool			b;
 		} v;
 		const char* name;
+		u32			hash;
+	};
+
+	// Arena block : strings are never freed individually, only with the bag.
+	struct SBlock {
+		SBlock*		next;
+		u32			used;
+		u32			size;
+		// followed by 'size' bytes.
 	};
 	
 	_v*			m_propertyValues;
 	u8*			m_propertyTypes;
-	u8			m_propertyCount;
-	u8			m_propertyMax;		// Current buffer size by maximum number of properties.
-	bool		m_free;
+	u16*		m_hashIndex;		// Slot -> property index, NULL_IDX when empty.
+	SBlock*		m_blocks;
+	u32			m_propertyCount;
+	u32			m_propertyMax;		// Current buffer size by maximum number of properties.
+	u32			m_hashMask;			// Slot count - 1 (slot count is a power of 2).
 
 	CKLBPropertyBag		*	m_prev;
 	CKLBPropertyBag		*	m_next;
 
-
-
-	static void compact();
-/*
-	static CKLBPropertyBag 	bags			[MAX_PROPERTYBAG_COUNT];
-	static _v 				properties		[MAX_PROP_BUFFER_COUNT];
-	static u8				propertyTypes	[MAX_PROP_BUFFER_COUNT];
-	static char				strings			[STRING_BUFFER_SIZE];
-
-	static u32				propAlloc;
-	static u32				bagAlloc;
-	static u32				stringAlloc;
-	static bool				deletionFlag;
-	*/
-
 	static CKLBPropertyBag	*	ms_begin;
 	static CKLBPropertyBag	*	ms_end;
 
 	enum {
-		PROPERTY_BLOCK_COUNT = 10
+		PROPERTY_BLOCK_COUNT	= 16,
+		HASH_MIN_SLOT			= 32,
+		STRING_BLOCK_SIZE		= 512,
+		MAX_PROPERTY_COUNT		= 0xFFFE,	// NULL_IDX is reserved for empty slots.
 	};
 };
 
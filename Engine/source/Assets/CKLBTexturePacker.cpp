@@ -14,8 +14,8 @@
    limitations under the License.
 */
 #include "CKLBTexturePacker.h"
-#include "ArrayAllocator.h"
 #include "CKLBUtility.h"
+#include "CKLBBenchmark.h"
 
 //
 // Flag to decide if we update the texture for each sub surface individually
@@ -30,38 +30,17 @@ const bool g_useSWBuffer = true;
 // =====================================
 //	Private Data Structure.
 // =====================================
-struct PackNode {
-	PackNode(ArrayAllocator<PackNode>* pAlloc);
-	~PackNode();
-	
-	static void* operator new		(size_t size, ArrayAllocator<PackNode>* pAlloc); 
-	static void  operator delete	(void *p);
- 
-	PackNode*	clone();
-
-	ArrayAllocator<PackNode>*	allocCtx;
-	PackNode*	lft;
-	PackNode*	rgt;
-	u16 		x;
-	u16 		y;
-	u16 		w;
-	u16 		h;
-	bool		used;
+//
+// Skyline allocator (bottom-left) : the used area is described by its top
+// profile, a list of horizontal segments sorted by x covering the full width.
+// A new rectangle is placed where its bottom is the lowest.
+//
+struct SkyNode {
+	u16			x;
+	u16			y;
+	u16			w;
 };
 
-typedef	ArrayAllocator<PackNode>	AllocNode;
-
-/*static*/ void* PackNode::operator new		(size_t /*size*/, AllocNode* pAlloc)
-{
-	// Ignore size, we are fixed size type here.
-	return pAlloc->allocEntry();
-}
-
-/*static*/ void  PackNode::operator delete	(void *p)
-{
-	((PackNode*)p)->allocCtx->freeEntry((PackNode*)p);
-}
-
 class Packer {
 public:
 	Packer ();
@@ -73,10 +52,13 @@ public:
 protected:
 	u16 		usedWidth;
 	u16 		usedHeight;
-	PackNode*	root;
-	ArrayAllocator<PackNode>	allocator;
+	u16			width;
+	u16			height;
+	SkyNode*	nodes;
+	u32			nodeCount;
+	u32			nodeMax;
 
-	bool findCoordRec		(PackNode* node, u16 w, u16 h, u16& x, u16& y);
+	bool fitAt				(u32 idx, u16 w, u16 h, u16& y);
 };
 
 struct SPixel {
@@ -106,6 +88,11 @@ struct SSurface {
 // Maximum 2048 (12 bit on 16 bit index)
 #define SURFACE_MAX	(1000)
 
+// Dirty rectangles kept per texture before merging into the closest one.
+#define DIRTY_RECT_MAX		(16)
+// Two dirty rectangles are merged when their union wastes less than this (pixels).
+#define DIRTY_MERGE_SLACK	(32*32)
+
 // One instance per texture.
 class TexturePackerOnce {
 	friend class TexturePacker;
@@ -114,6 +101,7 @@ public:
 	void reset				();
 	void release			();
 	void dump				(bool detail);
+	void occupancy			(u32& allocSurface, u32& usedSurface);
 #ifdef DEBUG_TEXTURE_PACKER
 	void scan				(void* ctx);
 #endif
@@ -143,8 +131,18 @@ private:
 	u32				m_format;
 	u32				m_totalSurface;
 	u32				m_freeSurface;
-	u16				m_startYChange;
-	u16				m_endYChange;
+
+	// Texture area changed in software buffer, not uploaded yet.
+	struct DirtyRect {
+		u16			x0;
+		u16			y0;
+		u16			x1;
+		u16			y1;
+	};
+	DirtyRect		m_dirty[DIRTY_RECT_MAX];
+	u32				m_dirtyCount;
+	u32				m_uploadBytes;
+	u32				m_uploadCalls;
 
 	// Global
 	SSurface	m_surface[SURFACE_MAX];
@@ -154,67 +152,42 @@ private:
 	bool simpleAllocInternal(CKLBSprite* spr, u16 x, u16 y, u16 w, u16 h, s16& found);
 	void moveImage			(u16 id);
 	void refreshTexture		();
+	void addDirty			(u16 x0, u16 y0, u16 x1, u16 y1);
 };
 
 
-// =====================================
-//	PackNode
-// =====================================
-
-PackNode::PackNode(ArrayAllocator<PackNode>*	allocCtx)
-: lft		(NULL)
-, rgt		(NULL)
-, allocCtx	(allocCtx)
-, used		(false)
-{
-}
-
-PackNode::~PackNode() {
-	// Specific allocator, do NOT use KLBDELETE macro.
-	delete lft;
-	delete rgt;
-}
-
-PackNode* PackNode::clone() {
-	// Specific allocator, do NOT use KLBNEW macro.
-	PackNode* pNew = new(allocCtx) PackNode(allocCtx);
-	if (pNew) {
-		pNew->x = this->x;
-		pNew->y = this->y;
-		pNew->w = this->w;
-		pNew->h = this->h;
-	}
-	return pNew;
-}
-
 // =====================================
 //	Packer
 // =====================================
 
-Packer::Packer() {
-	if (allocator.init(SURFACE_MAX * 2)) {
-		root = new(&allocator) PackNode(&allocator);
-		setSize	(0, 0);
+Packer::Packer()
+: nodes		(NULL)
+, nodeCount	(0)
+, nodeMax	(0)
+{
+	// Each placement adds at most one segment.
+	nodes = KLBNEWA(SkyNode, SURFACE_MAX + 2);
+	if (nodes) {
+		nodeMax = SURFACE_MAX + 2;
 	}
+	setSize	(0, 0);
 }
 
 Packer::~Packer() {
-	// Do NOT use KLBDELETE for PackNode
-	delete root;
+	KLBDELETEA(nodes);
 }
 
 void Packer::setSize(u16 width, u16 height) {
-	root->x	= 0;
-	root->y	= 0;
-	root->w	= width;
-	root->h	= height;
-	
-	delete root->lft;
-	delete root->rgt;
-	
-	root->lft	= NULL;
-	root->rgt	= NULL;
-	
+	this->width		= width;
+	this->height	= height;
+
+	if (nodes) {
+		nodes[0].x	= 0;
+		nodes[0].y	= 0;
+		nodes[0].w	= width;
+		nodeCount	= 1;
+	}
+
 	usedWidth	= 0;
 	usedHeight	= 0;
 }
@@ -224,54 +197,97 @@ void Packer::getDimension(u16& refWidth, u16& refHeight) {
 	refHeight	= usedHeight;
 }
 
-bool Packer::findCoord	(u16 w, u16 h, u16& x, u16& y) {
-	if (findCoordRec(root, w, h, x, y)) {
-		if (usedWidth  < (x + w)) 	{ usedWidth  = x + w; }
-		if (usedHeight < (y + h))	{ usedHeight = y + h; }
-		return true;
-	} else {
+// Lowest y where a w x h rectangle can sit with its left side on segment idx.
+bool Packer::fitAt(u32 idx, u16 w, u16 h, u16& y) {
+	if ((u32)nodes[idx].x + w > width) {
 		return false;
 	}
-}
 
-bool Packer::findCoordRec(PackNode* node, u16 w, u16 h, u16& x, u16& y) {
-	if (node->lft) {
-		if (findCoordRec(node->lft,w,h,x,y)) {
-			return true;
-		} else {
-			return findCoordRec(node->rgt,w,h,x,y);
+	u32 top		= 0;
+	s32 remain	= w;
+	while (remain > 0) {
+		if (nodes[idx].y > top) {
+			top = nodes[idx].y;
 		}
-	} else {
-		// if already used or it's too big then return
-		if (node->used || (w > node->w) || (h > node->h)) {
+		if (top + h > height) {
 			return false;
 		}
-		
-		// if it fits perfectly then use this gap
-		if ((w == node->w) && (h == node->h)) {
-			node->used	= true;
-			x 			= node->x;
-			y 			= node->y;
-			return true;
+		remain -= nodes[idx].w;
+		idx++;
+	}
+	y = (u16)top;
+	return true;
+}
+
+bool Packer::findCoord	(u16 w, u16 h, u16& x, u16& y) {
+	if ((nodeCount == 0) || (nodeCount >= nodeMax)) {
+		return false;
+	}
+
+	// Bottom-left : lowest bottom, then narrowest segment.
+	u32 best		= 0xFFFFFFFF;
+	u32 bestBottom	= 0xFFFFFFFF;
+	u32 bestWidth	= 0xFFFFFFFF;
+	u16 bestY		= 0;
+	for (u32 n = 0; n < nodeCount; n++) {
+		u16 fitY;
+		if (fitAt(n, w, h, fitY)) {
+			u32 bottom = fitY + h;
+			if ((bottom < bestBottom) || ((bottom == bestBottom) && (nodes[n].w < bestWidth))) {
+				best		= n;
+				bestBottom	= bottom;
+				bestWidth	= nodes[n].w;
+				bestY		= fitY;
+			}
 		}
-		
-		// initialize the left and right leafs by clonning the current one
-		node->lft = node->clone();
-		node->rgt = node->clone();
-		
-		// checks if we partition in vertical or horizontal
-		if ((node->w - w) > (node->h - h)) {
-			node->lft->w = w;
-			node->rgt->x = node->x + w;
-			node->rgt->w = node->w - w;	
-		} else {
-			node->lft->h = h;
-			node->rgt->y = node->y + h;
-			node->rgt->h = node->h - h;							
+	}
+
+	if (best == 0xFFFFFFFF) {
+		return false;
+	}
+
+	x = nodes[best].x;
+	y = bestY;
+
+	// Insert new segment on top of the rectangle.
+	memmove(&nodes[best + 1], &nodes[best], (nodeCount - best) * sizeof(SkyNode));
+	nodeCount++;
+	nodes[best].x = x;
+	nodes[best].y = bestY + h;
+	nodes[best].w = w;
+
+	// Shrink or remove the segments now under the rectangle.
+	u32 n = best + 1;
+	while (n < nodeCount) {
+		u32 prevEnd = nodes[n - 1].x + nodes[n - 1].w;
+		if (nodes[n].x >= prevEnd) {
+			break;
+		}
+		u32 shrink = prevEnd - nodes[n].x;
+		if (nodes[n].w > shrink) {
+			nodes[n].x += shrink;
+			nodes[n].w -= shrink;
+			break;
 		}
+		memmove(&nodes[n], &nodes[n + 1], (nodeCount - n - 1) * sizeof(SkyNode));
+		nodeCount--;
+	}
 
-		return findCoordRec(node->lft, w, h, x, y);
+	// Merge neighbours at the same height.
+	n = 0;
+	while (n + 1 < nodeCount) {
+		if (nodes[n].y == nodes[n + 1].y) {
+			nodes[n].w += nodes[n + 1].w;
+			memmove(&nodes[n + 1], &nodes[n + 2], (nodeCount - n - 2) * sizeof(SkyNode));
+			nodeCount--;
+		} else {
+			n++;
+		}
 	}
+
+	if (usedWidth  < (x + w)) 	{ usedWidth  = x + w; }
+	if (usedHeight < (y + h))	{ usedHeight = y + h; }
+	return true;
 }
 
 
@@ -314,8 +330,9 @@ bool TexturePackerOnce::init(u16 width, u16 height, u16 mode) {
 		if (pTex) {
 			m_unit			= unit;
 			m_format		= format;
-			m_startYChange	= 0x4000;
-			m_endYChange	= 0;
+			m_dirtyCount	= 0;
+			m_uploadBytes	= 0;
+			m_uploadCalls	= 0;
 			m_texture		= pTex;
 			m_textureUsage	= pTex->createUsage();
 			m_surfaceCount	= 0;
@@ -366,15 +383,14 @@ void TexturePackerOnce::dump(bool detail) {
 	FILE* pFile = CPFInterface::getInstance().client().getShellOutput();
 	fprintf(pFile, "==== Surface Alloc %8lX Size W:%i, H:%i Byte/Pix: %i ====\n", reinterpret_cast<uintptr_t>(this), m_width, m_height, m_currFormat);
 	u32 totalSurface	= m_width * m_height;
-	u32 usedSurface		= 0;
-	u32 allocSurface	= 0;
+	u32 usedSurface;
+	u32 allocSurface;
+	occupancy(allocSurface, usedSurface);
 	for (int n = 0; n < m_surfaceCount; n++) {
 		if (m_surface[n].free) {
 			if (detail) { printf("! "); }
 		} else {
 			if (detail) { printf("  "); }
-			allocSurface += m_surface[n].alloc_w * m_surface[n].alloc_h; 
-			usedSurface  += m_surface[n].w * m_surface[n].h; 
 			if (detail) {
 				// writeSurface(&m_surface[n], n, this);
 			}
@@ -402,9 +418,21 @@ void TexturePackerOnce::dump(bool detail) {
 		);
 	}
 
+	fprintf(pFile, " Pending upload rectangles : %i\n", m_dirtyCount);
 	fprintf(pFile, "==== Surface Alloc End =====\n");
 }
 
+void TexturePackerOnce::occupancy(u32& allocSurface, u32& usedSurface) {
+	allocSurface	= 0;
+	usedSurface		= 0;
+	for (int n = 0; n < m_surfaceCount; n++) {
+		if (!m_surface[n].free) {
+			allocSurface += m_surface[n].alloc_w * m_surface[n].alloc_h; 
+			usedSurface  += m_surface[n].w * m_surface[n].h; 
+		}
+	}
+}
+
 #define INTERNAL_DUMP_TEXPACKER			/*dump(bool detail)*/;
 
 void TexturePacker::unloadSurface() {
@@ -742,9 +770,7 @@ void TexturePackerOnce::moveImage(u16 id) {
 		// Fill lower line
 		memset(pDst - m_currFormat, 0, wtp1 * m_currFormat);
 	
-		if (yt < m_startYChange)	{	m_startYChange = yt;	}
-		yt += pSurf->h + 2;
-		if (yt > m_endYChange)		{	m_endYChange   = yt;	}
+		addDirty(pSurf->x - 1, yt, pSurf->x + pSurf->w + 1, yt + pSurf->h + 2);
 	} else {
 		int xt = pSurf->x - 1;
 		int ht = pSurf->h + 1;
@@ -769,9 +795,68 @@ void TexturePackerOnce::moveImage(u16 id) {
 			pSurf->swBuffer,
 			m_currFormat * pSurf->w * pSurf->h
 		);
+
+		m_uploadCalls += 5;
+		m_uploadBytes += m_currFormat * ((wtp1 + htp1) * 2 + (pSurf->w * pSurf->h));
 	}
 
 }
+
+static inline u32 dirtyArea(u32 x0, u32 y0, u32 x1, u32 y1) {
+	return (x1 - x0) * (y1 - y0);
+}
+
+void TexturePackerOnce::addDirty(u16 x0, u16 y0, u16 x1, u16 y1) {
+	// Merge with any rectangle whose union does not waste more than the slack,
+	// repeat as the grown rectangle may now reach others.
+	bool merged;
+	do {
+		merged = false;
+		u32 area = dirtyArea(x0, y0, x1, y1);
+		for (u32 n = 0; n < m_dirtyCount; n++) {
+			DirtyRect& r = m_dirty[n];
+			u16 ux0 = r.x0 < x0 ? r.x0 : x0;
+			u16 uy0 = r.y0 < y0 ? r.y0 : y0;
+			u16 ux1 = r.x1 > x1 ? r.x1 : x1;
+			u16 uy1 = r.y1 > y1 ? r.y1 : y1;
+			u32 unionArea	= dirtyArea(ux0, uy0, ux1, uy1);
+			u32 sumArea		= area + dirtyArea(r.x0, r.y0, r.x1, r.y1);
+			if (unionArea <= sumArea + DIRTY_MERGE_SLACK) {
+				x0 = ux0; y0 = uy0; x1 = ux1; y1 = uy1;
+				m_dirty[n] = m_dirty[--m_dirtyCount];
+				merged = true;
+				break;
+			}
+		}
+	} while (merged);
+
+	if (m_dirtyCount == DIRTY_RECT_MAX) {
+		// List full : grow the rectangle that grows the least.
+		u32 bestIdx		= 0;
+		u32 bestGrow	= 0xFFFFFFFF;
+		for (u32 n = 0; n < m_dirtyCount; n++) {
+			DirtyRect& r = m_dirty[n];
+			u32 grow = dirtyArea(r.x0 < x0 ? r.x0 : x0, r.y0 < y0 ? r.y0 : y0,
+								 r.x1 > x1 ? r.x1 : x1, r.y1 > y1 ? r.y1 : y1)
+					 - dirtyArea(r.x0, r.y0, r.x1, r.y1);
+			if (grow < bestGrow) {
+				bestGrow	= grow;
+				bestIdx		= n;
+			}
+		}
+		DirtyRect& r = m_dirty[bestIdx];
+		if (x0 < r.x0) { r.x0 = x0; }
+		if (y0 < r.y0) { r.y0 = y0; }
+		if (x1 > r.x1) { r.x1 = x1; }
+		if (y1 > r.y1) { r.y1 = y1; }
+	} else {
+		DirtyRect& r = m_dirty[m_dirtyCount++];
+		r.x0 = x0;
+		r.y0 = y0;
+		r.x1 = x1;
+		r.y1 = y1;
+	}
+}
 /*
 #include "CKLBTextTempBuffer.h"
 
@@ -925,26 +1010,84 @@ void TexturePackerOnce::getSurfaceInfo(u16 surface, u32*& pixel, float& u0, floa
 }
 
 void TexturePackerOnce::refreshTexture() {
-	int height = m_endYChange - m_startYChange;
-	m_texture->updateTexture(
-		0,
-		m_startYChange,
-		m_texture->getWidth(),
-		height,
-		&m_swBuffer[m_startYChange * m_texture->getWidth() * m_currFormat],
-		m_texture->getWidth() * height * m_currFormat);
-
-	m_startYChange	= 0x4000;
-	m_endYChange	= 0;
+	u32 texWidth	= m_texture->getWidth();
+	u32 stride		= texWidth * m_currFormat;
+
+	for (u32 n = 0; n < m_dirtyCount; n++) {
+		DirtyRect& r = m_dirty[n];
+		u32 w = r.x1 - r.x0;
+		u32 h = r.y1 - r.y0;
+
+		if ((w * 4) >= (texWidth * 3)) {
+			// Nearly full width : upload the rows directly from the software buffer.
+			m_texture->updateTexture(
+				0,
+				r.y0,
+				texWidth,
+				h,
+				&m_swBuffer[r.y0 * stride],
+				stride * h);
+			m_uploadBytes += stride * h;
+		} else {
+			// Gather the sub rectangle (updateTexture expects packed rows).
+			u32 lineSize	= w * m_currFormat;
+			u8* pDst		= CKLBTextTempBuffer::reallocateBuffer(w, h, m_currFormat);
+			if (!pDst) {
+				klb_assertAlways("Allocation error");
+				continue;
+			}
+			const u8* pSrc	= &m_swBuffer[r.y0 * stride + r.x0 * m_currFormat];
+			for (u32 y = 0; y < h; y++) {
+				memcpy(&pDst[y * lineSize], pSrc, lineSize);
+				pSrc += stride;
+			}
+			m_texture->updateTexture(r.x0, r.y0, w, h, pDst, lineSize * h);
+			m_uploadBytes += lineSize * h;
+		}
+		m_uploadCalls++;
+	}
+
+	m_dirtyCount = 0;
 }
 
 void TexturePacker::refreshTextures() {
-	if (g_useSWBuffer == false) { return; }
+	u32 bytes = 0;
+	u32 calls = 0;
 
 	for (int n = 0; n < MAX_TEXTURES ; n++) {
 		TexturePackerOnce* pCurr	= m_allocatedPacker[n];
-		if (pCurr && (pCurr->m_startYChange < pCurr->m_endYChange)) {
-			pCurr->refreshTexture();
+		if (pCurr) {
+			if (g_useSWBuffer && pCurr->m_dirtyCount) {
+				pCurr->refreshTexture();
+			}
+			bytes += pCurr->m_uploadBytes;
+			calls += pCurr->m_uploadCalls;
+			pCurr->m_uploadBytes = 0;
+			pCurr->m_uploadCalls = 0;
+		}
+	}
+
+	m_frameUploadBytes = bytes;
+	m_frameUploadCalls = calls;
+}
+
+void TexturePacker::getStats(SPackerStats* pStats) {
+	pStats->textureCount	= 0;
+	pStats->totalPixels		= 0;
+	pStats->allocatedPixels	= 0;
+	pStats->usedPixels		= 0;
+	pStats->uploadCalls		= m_frameUploadCalls;
+	pStats->uploadBytes		= m_frameUploadBytes;
+
+	for (int n = 0; n < MAX_TEXTURES; n++) {
+		TexturePackerOnce* pCurr	= m_allocatedPacker[n];
+		if (pCurr) {
+			u32 allocSurface, usedSurface;
+			pCurr->occupancy(allocSurface, usedSurface);
+			pStats->textureCount++;
+			pStats->totalPixels		+= pCurr->m_width * pCurr->m_height;
+			pStats->allocatedPixels	+= allocSurface;
+			pStats->usedPixels		+= usedSurface;
 		}
 	}
 }
@@ -972,6 +1115,9 @@ bool TexturePacker::init(u16 width, u16 height, u16 defaultFormat) {
 	m_update	= NULL_IDX;
 	ignoreCount	= 0;
 
+	m_frameUploadBytes	= 0;
+	m_frameUploadCalls	= 0;
+
 	m_allocatedPacker[0] = KLBNEW(TexturePackerOnce);
 	if (m_allocatedPacker[0] && m_allocatedPacker[0]->init(width,height, m_currFormat)) {
 		m_lastUsedPacker[m_currFormat]	= m_allocatedPacker[0];
@@ -1002,6 +1148,9 @@ void TexturePacker::dump(bool detail) {
 			m_allocatedPacker[n]->dump(detail);
 		}
 	}
+
+	FILE* pFile = CPFInterface::getInstance().client().getShellOutput();
+	fprintf(pFile, "==== Last frame upload : %i call(s) %i byte(s) ====\n", m_frameUploadCalls, m_frameUploadBytes);
 }
 
 TexturePackerOnce* TexturePacker::allocateAllocator(u16 w, u16 h) {
@@ -1285,3 +1434,65 @@ CKLBLuaLibPackerControl::use8888Texture(lua_State * L)
 	lua.retBool(true);
 	return 1;
 }
+
+#ifdef INTERNAL_BENCH
+// Place up to SURFACE_MAX - 1 pseudo random rectangles of 8..135 pixels, marking them in pMap
+// (if not NULL). Returns false if a placement overlaps a previous one.
+static bool benchPlaceAll(Packer& packer, u16 size, u8* pMap, u32& placed, u32& usedPixels) {
+	packer.setSize(size, size);
+	u32 seed	= 12345;
+	placed		= 0;
+	usedPixels	= 0;
+	bool ok		= true;
+	for (u32 n = 0; n < SURFACE_MAX - 1; n++) {
+		seed = (seed * 1103515245) + 12345;
+		u16 w = 8 + ((seed >> 8) & 127);
+		u16 h = 8 + ((seed >> 16) & 127);
+		u16 x, y;
+		if (packer.findCoord(w, h, x, y)) {
+			placed++;
+			usedPixels += w * h;
+			if (pMap) {
+				for (u32 py = y; py < (u32)(y + h); py++) {
+					for (u32 px = x; px < (u32)(x + w); px++) {
+						ok = ok && (pMap[px + py * size] == 0);
+						pMap[px + py * size] = 1;
+					}
+				}
+			}
+		}
+	}
+	return ok;
+}
+
+// Skyline allocator alone (no texture) in a 2048x2048 atlas : check once that no two
+// placements overlap, then report the time to fill the atlas and its occupancy.
+static bool benchPacker(u32 loops) {
+	enum { SIZE = 2048 };
+	Packer packer;
+	u32 placed;
+	u32 usedPixels;
+
+	u8* pMap = KLBNEWA(u8, SIZE * SIZE);
+	if (!pMap) { return false; }
+	memset(pMap, 0, SIZE * SIZE);
+	bool ok = benchPlaceAll(packer, SIZE, pMap, placed, usedPixels);
+	KLBDELETEA(pMap);
+
+	s64 t0 = CKLBBenchmark::now();
+	for (u32 l = 0; l < loops; l++) {
+		benchPlaceAll(packer, SIZE, NULL, placed, usedPixels);
+	}
+	s64 time = CKLBBenchmark::now() - t0;
+
+	u16 usedW, usedH;
+	packer.getDimension(usedW, usedH);
+	u32 usedArea = usedW * usedH;
+	CKLBBenchmark::report("skyline placement", loops * (SURFACE_MAX - 1), time);
+	CPFInterface::getInstance().platform().logging("[BENCH] placed %i, occupancy %i%% of %ix%i\n",
+		placed, (u32)(((u64)usedPixels * 100) / (usedArea ? usedArea : 1)), usedW, usedH);
+	return ok;
+}
+
+static CKLBBenchmark gBenchPacker("PACKER", benchPacker);
+#endif
@@ -34,6 +34,15 @@ typedef void (*compact)(void* ctx, u16 surfaceID, u16 newSurfaceID);
 
 class CKLBLuaLibPackerControl;
 
+struct SPackerStats {
+	u32		textureCount;		// Allocated atlas textures
+	u32		totalPixels;		// Sum of atlas surfaces
+	u32		allocatedPixels;	// Pixels reserved by live surfaces
+	u32		usedPixels;			// Pixels requested by live surfaces
+	u32		uploadCalls;		// updateTexture calls during the last frame
+	u32		uploadBytes;		// Bytes sent during the last frame
+};
+
 class TexturePacker {
 	friend class TexturePackerOnce;
 	friend class CKLBLuaLibPackerControl;
@@ -52,6 +61,7 @@ public:
 	bool init				(u16 width,			u16 height, u16 format);
 	void release			();
 	void dump				(bool detail);
+	void getStats			(SPackerStats* pStats);
 	void refreshTextures	();
 	void unloadSurface		();
 	void reloadSurfaces		();
@@ -92,6 +102,9 @@ private:
 	TexturePackerOnce*	ignore				[MAX_TEXTURES];
 	u8					ignoreCount;
 
+	u32					m_frameUploadBytes;
+	u32					m_frameUploadCalls;
+
 	static
 	u8					s_currentTextureMode;
 };
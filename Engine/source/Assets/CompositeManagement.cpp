@@ -29,6 +29,8 @@
 #include "CKLBSplineNode.h"
 #include "CKLBUIGroup.h"
 #include "CKLBLuaLibSOUND.h"
+#include "CKLBLanguageDatabase.h"
+#include "CKLBBenchmark.h"
 
 // === Scroll Bar Parameters
 #define VAR_MIN						(0)
@@ -287,9 +289,25 @@ CKLBAbstractAsset*	CKLBCompositeAssetPlugin::loadAsset(u8* stream, u32 streamSiz
   
 //    g = yajl_gen_alloc(NULL);	// 2012.12.05  
 
+	// Same content already parsed : the new asset only shares the definition,
+	// instantiation clones from it without parsing again.
+	// The template list belongs to the main thread : loads from CKLBAsyncLoader neither use nor feed it.
+	bool bShare = !CKLBAssetManager::getInstance().isAsyncLoading();
+	u32 hash = CKLBCompositeAsset::hashContent(stream, streamSize);
+	CKLBCompositeAsset::TEMPLATE* pTemplate = bShare ? CKLBCompositeAsset::findTemplate(stream, streamSize, hash) : NULL;
+
 	CKLBCompositeAsset* pNewAsset = KLBNEW(CKLBCompositeAsset);
 
-	if (pNewAsset->init()) {
+	if (pNewAsset && pTemplate) {
+		if (pNewAsset->init()) {
+			pNewAsset->useTemplate(pTemplate);
+			return pNewAsset;
+		}
+		KLBDELETE(pNewAsset);
+		return null;
+	}
+
+	if (pNewAsset && pNewAsset->init()) {
 		/* ok.  open file.  let's read and parse */  
 		hand = yajl_alloc(&callbacks, NULL, pNewAsset);  
 		if (hand) {
@@ -308,6 +326,15 @@ CKLBAbstractAsset*	CKLBCompositeAssetPlugin::loadAsset(u8* stream, u32 streamSiz
 					// Force implementation mistake to make NULL ptr error. This variable should NOT be used.
 					pNewAsset->m_pCurrInnerDef = NULL;
 
+					// From the loading thread, CKLBAsyncLoader does it on the main thread.
+					if (bShare) {
+						pNewAsset->preloadLanguage();
+					}
+
+					if (bShare && !pNewAsset->m_bPropertyBag) {
+						pNewAsset->shareTemplate(stream, streamSize, hash);
+					}
+
 					return pNewAsset;
 				}
 			}
@@ -330,6 +357,140 @@ CKLBCompositeAssetPlugin::~CKLBCompositeAssetPlugin() {
 	// Do nothing.
 }
 
+// ------------------- Template cache ------------------
+
+// Unused definitions kept for later loads of the same content.
+#define MAX_IDLE_TEMPLATE	(16)
+
+/*static*/ CKLBCompositeAsset::TEMPLATE*	CKLBCompositeAsset::s_templateList	= NULL;
+/*static*/ u32							CKLBCompositeAsset::s_templateCount	= 0;
+
+/*static*/
+u32 CKLBCompositeAsset::hashContent(const u8* stream, u32 streamSize) {
+	// FNV-1a
+	u32 hash = 2166136261U;
+	for (u32 n = 0; n < streamSize; n++) {
+		hash = (hash ^ stream[n]) * 16777619U;
+	}
+	return hash;
+}
+
+/*static*/
+CKLBCompositeAsset::TEMPLATE* CKLBCompositeAsset::findTemplate(const u8* stream, u32 streamSize, u32 hash) {
+	TEMPLATE* pPrev = NULL;
+	TEMPLATE* pTemplate = s_templateList;
+	while (pTemplate) {
+		if ((pTemplate->hash == hash) && (pTemplate->contentSize == streamSize) 
+		&&  (memcmp(pTemplate->content, stream, streamSize) == 0)) {
+			// Move to front.
+			if (pPrev) {
+				pPrev->next		= pTemplate->next;
+				pTemplate->next	= s_templateList;
+				s_templateList	= pTemplate;
+			}
+			return pTemplate;
+		}
+		pPrev		= pTemplate;
+		pTemplate	= pTemplate->next;
+	}
+	return NULL;
+}
+
+void CKLBCompositeAsset::shareTemplate(const u8* stream, u32 streamSize, u32 hash) {
+	TEMPLATE* pTemplate = KLBNEW(TEMPLATE);
+	u8* content			= KLBNEWA(u8, streamSize);
+	if (!pTemplate || !content) {
+		// Asset keeps its own definition.
+		KLBDELETE(pTemplate);
+		KLBDELETEA(content);
+		return;
+	}
+
+	memcpy(content, stream, streamSize);
+	pTemplate->content		= content;
+	pTemplate->contentSize	= streamSize;
+	pTemplate->hash			= hash;
+	pTemplate->root			= m_root;
+	pTemplate->strings		= m_allocatedString;
+	pTemplate->width		= m_width;
+	pTemplate->height		= m_height;
+	pTemplate->refCount		= 1;
+	pTemplate->next			= s_templateList;
+	s_templateList			= pTemplate;
+	s_templateCount++;
+
+	// Definition now belongs to the template.
+	m_allocatedString		= NULL;
+	m_pTemplate				= pTemplate;
+
+	trimTemplates(MAX_IDLE_TEMPLATE);
+}
+
+void CKLBCompositeAsset::useTemplate(TEMPLATE* pTemplate) {
+	pTemplate->refCount++;
+	m_pTemplate	= pTemplate;
+	m_root		= pTemplate->root;
+	m_width		= pTemplate->width;
+	m_height	= pTemplate->height;
+}
+
+/*static*/
+void CKLBCompositeAsset::releaseTemplate(TEMPLATE* pTemplate) {
+	klb_assert(pTemplate->refCount, "Composite template released too many times");
+	pTemplate->refCount--;
+	trimTemplates(MAX_IDLE_TEMPLATE);
+}
+
+/*static*/
+void CKLBCompositeAsset::freeTemplate(TEMPLATE* pTemplate) {
+	STRINGENTRY* parse = pTemplate->strings;
+	while (parse) {
+		STRINGENTRY* parseNext = parse->next;
+		KLBDELETE(parse);
+		parse = parseNext;
+	}
+
+	KLBDELETE(pTemplate->root);
+	KLBDELETEA(pTemplate->content);
+	KLBDELETE(pTemplate);
+}
+
+/*static*/
+void CKLBCompositeAsset::trimTemplates(u32 maxCount) {
+	// Templates in use always stay : only the least recently used idle ones go.
+	while (s_templateCount > maxCount) {
+		TEMPLATE* pPrev		= NULL;
+		TEMPLATE* pVictim	= NULL;
+		TEMPLATE* pVictimPrev	= NULL;
+		TEMPLATE* pTemplate	= s_templateList;
+		while (pTemplate) {
+			if (pTemplate->refCount == 0) {
+				pVictim		= pTemplate;
+				pVictimPrev	= pPrev;
+			}
+			pPrev		= pTemplate;
+			pTemplate	= pTemplate->next;
+		}
+
+		if (!pVictim) {
+			break;
+		}
+
+		if (pVictimPrev) {
+			pVictimPrev->next	= pVictim->next;
+		} else {
+			s_templateList		= pVictim->next;
+		}
+		s_templateCount--;
+		freeTemplate(pVictim);
+	}
+}
+
+/*static*/
+void CKLBCompositeAsset::purgeTemplates() {
+	trimTemplates(0);
+}
+
 // ------------------- Asset ------------------
 
 /*static*/ int CKLBCompositeAsset::read_start_map	(void * ctx, unsigned int size)
@@ -370,7 +531,9 @@ CKLBCompositeAsset::CKLBCompositeAsset()
 ,m_width			(-1)
 ,m_height			(-1)
 ,mode				(STANDARD_PARSER_MODE)
+,m_bPropertyBag		(false)
 {
+	m_pTemplate		 = NULL;
 	m_parentStack[0] = NULL;
 	m_bLowRes = CPFInterface::getInstance().client().getPhysicalScreenHeight() < 480;
 }
@@ -393,6 +556,13 @@ CKLBCompositeAsset::~CKLBCompositeAsset() {
 		KLBDELETE(m_rootParent);
 	}
 
+	if (m_pTemplate) {
+		// Tree definition belongs to the template.
+		releaseTemplate(m_pTemplate);
+		m_pTemplate	= NULL;
+		m_root		= NULL;
+	}
+
 	if (m_root) {
 		KLBDELETE(m_root);
 	}
@@ -458,6 +628,30 @@ CKLBCompositeAsset::STRINGENTRY* CKLBCompositeAsset::registerString(const char*
 	return NULL;
 }
 
+void CKLBCompositeAsset::preloadLanguage() {
+	// All the localized ids of the definition in one batch,
+	// instead of one query per label when nodes are created.
+	const char* ids[64];
+	u32 count = 0;
+	CKLBLanguageDatabase& langDB = CKLBLanguageDatabase::getInstance();
+	STRINGENTRY* parse = m_allocatedString;
+	while (parse) {
+		const char* str = parse->string;
+		if (str && (str[0] == '#') && str[1]) {
+			ids[count++] = &str[1];
+			if (count == 64) {
+				langDB.preLoadKeys(ids, count);
+				count = 0;
+			}
+		}
+		parse = parse->next;
+	}
+
+	if (count) {
+		langDB.preLoadKeys(ids, count);
+	}
+}
+
 char*	CKLBCompositeAsset::allocateString(const unsigned char* string, u32 strLen, bool* err) {
 	*err = false;
 	if (strLen && string) {
@@ -1224,46 +1418,58 @@ static const int keyWordCount[9] = {
 	sizeof(keywordsOther) / sizeof(key_name_value),
 };
 
-static u32 bin_search(const key_name_value* searchArray, const unsigned char *key, u32 start, u32 finish)
-{
-	if (start >= finish) {
-		klb_assertAlways("Invalid Key");
-		return 0xFFFFFFFF;
-	} else {
-		u32 mid = (start+finish)/2;
-		int cmp = strcmp((const char*)key,searchArray[mid].name);
-		if (cmp == 0) {
-			return searchArray[mid].value;
-		} else if (cmp < 0) {
-			return bin_search(searchArray, key,start,mid);
-		} else {
-			return bin_search(searchArray, key,mid+1,finish);
-		}
+//
+// All keywords hashed once in a single open addressing table :
+// lookup is one hash of the key and usually one compare, no copy of the key needed.
+//
+#define KEYWORD_HASH_SIZE	(512)	// Power of 2, more than twice the keyword count.
+
+static const key_name_value*	gm_keywordHash[KEYWORD_HASH_SIZE];
+static bool						gm_keywordHashReady = false;
+
+static u32 keywordHash(const unsigned char* key, u32 keyLen) {
+	// FNV-1a
+	u32 hash = 2166136261U;
+	for (u32 n = 0; n < keyLen; n++) {
+		hash = (hash ^ key[n]) * 16777619U;
 	}
+	return hash;
 }
 
-static u32 Composite_keySearch(const char* buff, u32 stringLen) {
-	int num_keywords;
-	const key_name_value* keywords;
-	int keyLen = stringLen;
+static void buildKeywordHash() {
+	static const key_name_value* tables[9] = {
+		NULL, keywords1, keywords2, keywords3, keywords4, keywords5, keywords6, keywords7, keywordsOther
+	};
 
-	switch (keyLen) {
-	case 1:	keywords = keywords1;   break;
-	case 2:	keywords = keywords2;	break;
-	case 3:	keywords = keywords3;	break;
-	case 4:	keywords = keywords4;	break;
-	case 5:	keywords = keywords5;	break;
-	case 6:	keywords = keywords6;	break;
-	case 7:	keywords = keywords7;	break;
-	default: 
-		keywords = keywordsOther;	
-		keyLen = 8;
-		break;
+	for (u32 t = 1; t < 9; t++) {
+		for (int n = 0; n < keyWordCount[t]; n++) {
+			const key_name_value* pKey = &tables[t][n];
+			u32 slot = keywordHash((const unsigned char*)pKey->name, pKey->size) & (KEYWORD_HASH_SIZE - 1);
+			while (gm_keywordHash[slot]) {
+				slot = (slot + 1) & (KEYWORD_HASH_SIZE - 1);
+			}
+			gm_keywordHash[slot] = pKey;
+		}
+	}
+	gm_keywordHashReady = true;
+}
+
+static u32 Composite_keySearch(const unsigned char* key, u32 stringLen) {
+	if (!gm_keywordHashReady) {
+		buildKeywordHash();
 	}
 
-	num_keywords = keyWordCount[keyLen];
+	u32 slot = keywordHash(key, stringLen) & (KEYWORD_HASH_SIZE - 1);
+	const key_name_value* pKey;
+	while ((pKey = gm_keywordHash[slot]) != NULL) {
+		if (((u32)pKey->size == stringLen) && (memcmp(pKey->name, key, stringLen) == 0)) {
+			return pKey->value;
+		}
+		slot = (slot + 1) & (KEYWORD_HASH_SIZE - 1);
+	}
 
-	return bin_search(keywords,(const unsigned char*)buff,0,num_keywords);
+	klb_assertAlways("Invalid Key");
+	return 0xFFFFFFFF;
 }
 
 /*static*/
@@ -1293,13 +1499,7 @@ int CKLBCompositeAsset::readMapKey(const unsigned char * stringVal, size_t strin
 	}
 
 
-	// Tmp C string
-	char buff[100];
-	memcpy(buff,stringVal,stringLen);
-	buff[stringLen] = 0;
-
-	m_parserField = Composite_keySearch(buff, stringLen);
-	// printf("Keyword : %s (%i)", buff,m_parserField);
+	m_parserField = Composite_keySearch(stringVal, stringLen);
 
 	if (m_parserField == STATES_FIELD) {
 		m_bTreeMode = false;
@@ -1318,6 +1518,7 @@ int CKLBCompositeAsset::readStartMap(unsigned int /*size*/) {
 			m_pCurrInnerDef->propertyBag = CKLBPropertyBag::getPropertyBag();
 			if (m_pCurrInnerDef->propertyBag) {
 				mode = GENERIC_MODE;
+				m_bPropertyBag = true;
 			} else {
 				return 0;
 			}
@@ -2505,3 +2706,97 @@ bool CKLBCompositeAsset::createSubTreeRecursive(u16 groupID, CKLBUITask* pParent
 
 	return res;
 }
+
+#ifdef INTERNAL_BENCH
+// "BENCH COMPOSITE <loops> <asset.json>" : keyword lookup over every keyword (each must resolve to
+// its own value), then loads of the composite : full parse (idle templates purged before each load)
+// against a load sharing the template of a live asset, which must report the same size.
+// Idle templates are purged at the end : next loads of the application parse again.
+static bool benchComposite(u32 loops) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	static const key_name_value* tables[8] = {
+		keywords1, keywords2, keywords3, keywords4, keywords5, keywords6, keywords7, keywordsOther
+	};
+
+	bool ok			= true;
+	u32 lookups		= 0;
+	s64 t0 = CKLBBenchmark::now();
+	for (u32 l = 0; l < loops; l++) {
+		for (u32 t = 0; t < 8; t++) {
+			for (int n = 0; n < keyWordCount[t + 1]; n++) {
+				const key_name_value* pKey = &tables[t][n];
+				ok &= (Composite_keySearch((const unsigned char*)pKey->name, pKey->size) == (u32)pKey->value);
+				lookups++;
+			}
+		}
+	}
+	CKLBBenchmark::report("keyword lookup", lookups, CKLBBenchmark::now() - t0);
+	if (!ok) {
+		pltf.logging("[BENCH] COMPOSITE keyword resolved to a wrong value\n");
+		return false;
+	}
+
+	const char* asset = CKLBBenchmark::getArgument();
+	if (!asset) {
+		pltf.logging("[BENCH] COMPOSITE load needs a composite asset path\n");
+		return true;
+	}
+
+	IReadStream* pStream = pltf.openReadStream(asset, pltf.useEncryption());
+	if (!pStream || (pStream->getStatus() != IReadStream::NORMAL)) {
+		delete pStream;
+		return false;
+	}
+	u32 size	= pStream->getSize();
+	u8* buf		= KLBNEWA(u8, size);
+	if (buf) {
+		pStream->readBlock(buf, size);
+	}
+	delete pStream;
+	if (!buf) {
+		return false;
+	}
+
+	CKLBCompositeAssetPlugin plugin;
+	s64 timeParse	= 0;
+	s64 timeShared	= 0;
+	CKLBCompositeAsset* pRef = NULL;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		CKLBCompositeAsset::purgeTemplates();
+		s64 t1 = CKLBBenchmark::now();
+		CKLBCompositeAsset* pAsset = (CKLBCompositeAsset*)plugin.loadAsset(buf, size);
+		timeParse += CKLBBenchmark::now() - t1;
+		ok = (pAsset != NULL);
+		if (pAsset) {
+			KLBDELETE(pAsset);
+		}
+	}
+
+	if (ok) {
+		// Kept alive : its definition is shared by the next loads (unless it has a property bag).
+		pRef = (CKLBCompositeAsset*)plugin.loadAsset(buf, size);
+		ok = (pRef != NULL);
+	}
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t1 = CKLBBenchmark::now();
+		CKLBCompositeAsset* pAsset = (CKLBCompositeAsset*)plugin.loadAsset(buf, size);
+		timeShared += CKLBBenchmark::now() - t1;
+		ok = pAsset && (pAsset->get_width() == pRef->get_width()) && (pAsset->get_height() == pRef->get_height());
+		if (pAsset) {
+			KLBDELETE(pAsset);
+		}
+	}
+
+	CKLBBenchmark::report("composite parse", loops, timeParse);
+	CKLBBenchmark::report(pRef && pRef->hasPropertyBag() ? "composite load (bag, not shared)" : "composite load (shared)", loops, timeShared);
+
+	if (pRef) {
+		KLBDELETE(pRef);
+	}
+	CKLBCompositeAsset::purgeTemplates();
+	KLBDELETEA(buf);
+	return ok;
+}
+
+static CKLBBenchmark gBenchComposite("COMPOSITE", benchComposite);
+#endif
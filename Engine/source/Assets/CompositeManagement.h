@@ -57,6 +57,15 @@ public:
 	inline s16 get_width() const { return m_width; }
 	inline s16 get_height() const { return m_height; }
 
+	// Generic properties are consumed by the first createSubTree() : the asset can only be instantiated once.
+	inline bool hasPropertyBag() const { return m_bPropertyBag; }
+
+	// Batch load the localized strings of the definition. Main thread only (language database).
+	void		preloadLanguage();
+
+	// Free parsed definitions not used by any asset anymore.
+	static void			purgeTemplates();
+
 	enum FIELD_ENUM {
 		X_FIELD,
 		Y_FIELD,
@@ -200,6 +209,35 @@ private:
 
 	STRINGENTRY*	m_allocatedString;
 
+	//
+	// Parsed definition shared by all the assets loaded from the same content.
+	// Assets only own their instance state (node root, record, group).
+	//
+	struct TEMPLATE {
+		TEMPLATE*		next;
+		CKLBInnerDef*	root;
+		STRINGENTRY*	strings;
+		u8*				content;
+		u32				contentSize;
+		u32				hash;
+		u32				refCount;
+		s16				width;
+		s16				height;
+	};
+
+	TEMPLATE*		m_pTemplate;
+
+	static u32			hashContent		(const u8* stream, u32 streamSize);
+	static TEMPLATE*	findTemplate	(const u8* stream, u32 streamSize, u32 hash);
+	static void			releaseTemplate	(TEMPLATE* pTemplate);
+	static void			freeTemplate	(TEMPLATE* pTemplate);
+	static void			trimTemplates	(u32 maxCount);
+	void				useTemplate		(TEMPLATE* pTemplate);
+	void				shareTemplate	(const u8* stream, u32 streamSize, u32 hash);
+
+	static TEMPLATE*	s_templateList;	// Most recently used first.
+	static u32			s_templateCount;
+
 	u16			m_groupID;
 	//
 	// Parser Stuff.
@@ -229,6 +267,7 @@ private:
 	u8				mode;
 	bool			m_bTreeMode;
 	bool			m_bLowRes;
+	bool			m_bPropertyBag;	// Generic properties are consumed at instantiation : not shareable.
 
 	//
 	// Parser Call back.
@@ -20,6 +20,7 @@
 #include "CKLBUtility.h"
 #include "CKLBDrawTask.h"
 #include "KLBPlatformMetrics.h"
+#include "CKLBBenchmark.h"
 
 /*
  * Here is the header of the ETC1 decoder part taken out from the 
@@ -52,6 +53,21 @@ void processImage4444(u32 pixelCount, u32 lineWidth, u32 height, u8* buffer);
 void processImage5551(u32 pixelCount, u32 lineWidth, u32 height, u8* buffer);
 CKLBAbstractAsset* createTexture(u32 orgWidthI, u32 orgHeightI, const char* name);
 
+static bool textureResidency(void* ctx, CTexture* /*pTexture*/, bool reload) {
+	CKLBTextureAsset*	pAsset	= (CKLBTextureAsset*)ctx;
+	CKLBAssetManager&	mgr		= CKLBAssetManager::getInstance();
+	if (reload) {
+		// Plugin state is shared with the loading thread.
+		if (mgr.isAsyncLoading()) {
+			return false;
+		}
+		return mgr.reloadAsset(pAsset);
+	} else {
+		gTextureAllocHW -= pAsset->m_width * pAsset->m_height * pAsset->m_bytePerPix;
+		return true;
+	}
+}
+
 CKLBTextureAsset::CKLBTextureAsset()
 : CKLBAbstractAsset ()
 , m_indexBufferTotal(NULL)
@@ -84,7 +100,9 @@ CKLBTextureAsset::~CKLBTextureAsset()
 	CKLBOGLWrapper& pMgr = CKLBOGLWrapper::getInstance();
 
 	if (m_pTexture) {
-		gTextureAllocHW -= this->m_width * this->m_height * m_bytePerPix;
+		if (m_pTexture->isResident()) {
+			gTextureAllocHW -= this->m_width * this->m_height * m_bytePerPix;
+		}
 		if (m_pTextureUsage) {
 			m_pTexture->releaseUsage	(m_pTextureUsage);
 		}
@@ -102,11 +120,12 @@ CKLBTextureAsset::~CKLBTextureAsset()
 void
 CKLBTextureAsset::unloadRessource() {
 	if (m_pTexture) {
+		if (m_pTexture->isResident()) {
+			gTextureAllocHW -= this->m_width * this->m_height * m_bytePerPix;
+		}
 		m_pTexture->makeEmptyShell();
 	}
 
-	gTextureAllocHW -= this->m_width * this->m_height * m_bytePerPix;
-
 	// Release software texture.
 	if (m_softTexture) {
 		KLBDELETEA(m_softTexture);
@@ -1170,6 +1189,294 @@ processImage5551(u32 pixelCount, u32 lineWidth, u32 height, u8* buffer)
 #undef  SHIFTNEXT
 }
 
+// ---------------------------------------------------------------------------------------------
+//   Decoded texture cache.
+//
+//   Inflated, software decoded (ETC1) and downscaled pixels are stored GPU ready in a single
+//   container, next loads of the same content read them back instead of decoding.
+//   Layout : header + fixed entry table, then blobs aligned on TEXCACHE_ALIGN.
+//   Entries are pruned least recently used first when the size cap is reached.
+//   Each entry carries a checksum of its blob : a blob moved or partially written when the
+//   application stopped is detected on load and dropped.
+//   Loading may run on the asset thread, but never concurrently with a main thread load.
+// ---------------------------------------------------------------------------------------------
+
+#define TEXCACHE_FILE			"file://external/texture_decode.cache"
+#define TEXCACHE_MAGIC			CHUNK_TAG('K','T','X','C')
+#define TEXCACHE_VERSION		(2)
+#define TEXCACHE_MAX			(256)
+#define TEXCACHE_MAX_BYTES		(64*1024*1024)
+#define TEXCACHE_ALIGN			(16)
+#define TEXCACHE_DATA_START		((sizeof(STexCacheHeader) + TEXCACHE_ALIGN - 1) & ~(TEXCACHE_ALIGN - 1))
+
+struct STexCacheEntry {
+	u32		key;			// Hash of source stream and decode target. 0 : free entry.
+	u32		srcSize;
+	u32		offset;
+	u32		size;
+	u32		pixelFormat;
+	u16		width;
+	u16		height;
+	u32		lastUse;
+	u32		checksum;
+};
+
+struct STexCacheHeader {
+	u32				magic;
+	u32				version;
+	u32				dataEnd;
+	u32				useCounter;
+	STexCacheEntry	entries[TEXCACHE_MAX];
+};
+
+static STexCacheHeader	gm_texCache;
+static bool				gm_texCacheInit	= false;
+static bool				gm_texCacheFile	= false;	// Container exists with a valid header.
+
+static void* openTexCache(const char* mode) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const char* fullPath = pltf.getFullPath(TEXCACHE_FILE);
+	void* f = fullPath ? pltf.ifopen(fullPath, mode) : NULL;
+	delete[] fullPath;
+	return f;
+}
+
+static void initTexCache() {
+	gm_texCacheInit = true;
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	void* f = openTexCache("rb");
+	if (f) {
+		gm_texCacheFile = (pltf.ifread(&gm_texCache, sizeof(STexCacheHeader), 1, f) == 1)
+						&& (gm_texCache.magic	== TEXCACHE_MAGIC)
+						&& (gm_texCache.version	== TEXCACHE_VERSION);
+		pltf.ifclose(f);
+	}
+
+	if (!gm_texCacheFile) {
+		memset(&gm_texCache, 0, sizeof(STexCacheHeader));
+		gm_texCache.magic	= TEXCACHE_MAGIC;
+		gm_texCache.version	= TEXCACHE_VERSION;
+		gm_texCache.dataEnd	= TEXCACHE_DATA_START;
+	}
+}
+
+static u32 texCacheKey(const u8* src, u32 srcSize, CKLBTextureAsset* pAsset, u32 pixelFormat, bool lowRes) {
+	// FNV-1a on the source stream, then the parameters that change the decoded result.
+	u32 hash = 2166136261u;
+	const u8* end = src + srcSize;
+	while (src < end) {
+		hash = (hash ^ *src++) * 16777619;
+	}
+
+	u32 params[5];
+	params[0] = pAsset->m_width;
+	params[1] = pAsset->m_height;
+	params[2] = pAsset->m_type;
+	params[3] = pixelFormat;
+	params[4] = lowRes ? 1 : 0;
+	for (u32 n = 0; n < 5; n++) {
+		hash = (hash ^ params[n]) * 16777619;
+	}
+	return hash ? hash : 1;
+}
+
+static STexCacheEntry* findTexCache(u32 key, u32 srcSize, u32 pixelFormat) {
+	for (u32 n = 0; n < TEXCACHE_MAX; n++) {
+		STexCacheEntry* pEntry = &gm_texCache.entries[n];
+		if ((pEntry->key == key) && (pEntry->srcSize == srcSize) && (pEntry->pixelFormat == pixelFormat)) {
+			return pEntry;
+		}
+	}
+	return NULL;
+}
+
+static u32 texCacheChecksum(const u8* data, u32 size) {
+	// FNV-1a on little endian 32 bit words (any alignment), then the tail.
+	u32 hash = 2166136261u;
+	const u8* end = data + (size & ~3);
+	while (data < end) {
+		hash = (hash ^ (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24))) * 16777619;
+		data += 4;
+	}
+	for (u32 n = 0; n < (size & 3); n++) {
+		hash = (hash ^ data[n]) * 16777619;
+	}
+	return hash;
+}
+
+static void writeTexCacheHeader(void* f) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	pltf.ifseek(f, 0, SEEK_SET);
+	pltf.ifwrite(&gm_texCache, sizeof(STexCacheHeader), 1, f);
+}
+
+// Write back one entry and the use counter only : the rest of the header is unchanged.
+static void writeTexCacheEntry(void* f, STexCacheEntry* pEntry) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	pltf.ifseek(f, (u32)((u8*)&gm_texCache.useCounter - (u8*)&gm_texCache), SEEK_SET);
+	pltf.ifwrite(&gm_texCache.useCounter, sizeof(u32), 1, f);
+	pltf.ifseek(f, (u32)((u8*)pEntry - (u8*)&gm_texCache), SEEK_SET);
+	pltf.ifwrite(pEntry, sizeof(STexCacheEntry), 1, f);
+}
+
+// Return decoded pixels (KLBNEWA) and set the decoded size, or NULL.
+static u8* loadTexCache(u32 key, u32 srcSize, u32 pixelFormat, CKLBTextureAsset* pAsset) {
+	if (!gm_texCacheInit) {
+		initTexCache();
+	}
+
+	STexCacheEntry* pEntry = gm_texCacheFile ? findTexCache(key, srcSize, pixelFormat) : NULL;
+	if (!pEntry) {
+		return NULL;
+	}
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	u8* pixels = NULL;
+	void* f = openTexCache("r+b");
+	if (f) {
+		pixels = KLBNEWA(u8, pEntry->size);
+		if (pixels) {
+			if ((pltf.ifseek(f, pEntry->offset, SEEK_SET) != 0) || (pltf.ifread(pixels, pEntry->size, 1, f) != 1)
+			||  (texCacheChecksum(pixels, pEntry->size) != pEntry->checksum)) {
+				KLBDELETEA(pixels);
+				pixels = NULL;
+			}
+		}
+
+		if (pixels) {
+			pAsset->m_width		= pEntry->width;
+			pAsset->m_height	= pEntry->height;
+			pEntry->lastUse		= ++gm_texCache.useCounter;
+		} else {
+			pEntry->key			= 0;	// Unreadable or corrupted : forget it.
+		}
+		writeTexCacheEntry(f, pEntry);
+		pltf.ifclose(f);
+	}
+	return pixels;
+}
+
+// Move live blobs down to remove the holes left by pruned entries.
+// The header on disk is only rewritten afterwards : after a crash, entries still pointing
+// into a moved area fail their checksum on the next load.
+static bool compactTexCache(void* f) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	u32 pos		= TEXCACHE_DATA_START;
+	u32 from	= 0;
+	while (1) {
+		// Next blob in file order.
+		STexCacheEntry* pNext = NULL;
+		for (u32 n = 0; n < TEXCACHE_MAX; n++) {
+			STexCacheEntry* pEntry = &gm_texCache.entries[n];
+			if (pEntry->key && (pEntry->offset >= from) && ((!pNext) || (pEntry->offset < pNext->offset))) {
+				pNext = pEntry;
+			}
+		}
+
+		if (!pNext) {
+			break;
+		}
+
+		from = pNext->offset + 1;
+		if (pNext->offset != pos) {
+			u8* tmp = KLBNEWA(u8, pNext->size);
+			if (!tmp) {
+				return false;
+			}
+			bool ok = (pltf.ifseek(f, pNext->offset, SEEK_SET) == 0) && (pltf.ifread (tmp, pNext->size, 1, f) == 1)
+				   && (pltf.ifseek(f, pos,			 SEEK_SET) == 0) && (pltf.ifwrite(tmp, pNext->size, 1, f) == 1);
+			KLBDELETEA(tmp);
+			if (!ok) {
+				return false;
+			}
+			pNext->offset = pos;
+		}
+		pos += (pNext->size + TEXCACHE_ALIGN - 1) & ~(TEXCACHE_ALIGN - 1);
+	}
+	gm_texCache.dataEnd = pos;
+	return true;
+}
+
+static void storeTexCache(u32 key, u32 srcSize, u32 pixelFormat, CKLBTextureAsset* pAsset, const u8* pixels, u32 size) {
+	if (!gm_texCacheInit) {
+		initTexCache();
+	}
+
+	u32 alignedSize = (size + TEXCACHE_ALIGN - 1) & ~(TEXCACHE_ALIGN - 1);
+	if (alignedSize > (TEXCACHE_MAX_BYTES / 4)) {
+		return;
+	}
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	void* f = gm_texCacheFile ? openTexCache("r+b") : NULL;
+	if (!f) {
+		// Start a new container.
+		memset(gm_texCache.entries, 0, sizeof(gm_texCache.entries));
+		gm_texCache.dataEnd	= TEXCACHE_DATA_START;
+		f = openTexCache("w+b");
+		if (!f) {
+			return;
+		}
+		gm_texCacheFile = true;
+	}
+
+	//
+	// Prune least recently used entries until the blob and an entry fit.
+	//
+	STexCacheEntry* pFree;
+	bool pruned = false;
+	while (1) {
+		pFree = NULL;
+		STexCacheEntry* pOldest = NULL;
+		for (u32 n = 0; n < TEXCACHE_MAX; n++) {
+			STexCacheEntry* pEntry = &gm_texCache.entries[n];
+			if (pEntry->key == 0) {
+				if (!pFree) { pFree = pEntry; }
+			} else if ((!pOldest) || (pEntry->lastUse < pOldest->lastUse)) {
+				pOldest = pEntry;
+			}
+		}
+
+		u32 used = 0;
+		for (u32 n = 0; n < TEXCACHE_MAX; n++) {
+			if (gm_texCache.entries[n].key) {
+				used += (gm_texCache.entries[n].size + TEXCACHE_ALIGN - 1) & ~(TEXCACHE_ALIGN - 1);
+			}
+		}
+
+		if (pFree && ((used + alignedSize) <= TEXCACHE_MAX_BYTES)) {
+			break;
+		}
+		pOldest->key	= 0;
+		pruned			= true;
+	}
+
+	if (pruned || ((gm_texCache.dataEnd + alignedSize) > (TEXCACHE_DATA_START + TEXCACHE_MAX_BYTES))) {
+		if (!compactTexCache(f)) {
+			// Blob content can not be trusted anymore.
+			memset(gm_texCache.entries, 0, sizeof(gm_texCache.entries));
+			gm_texCache.dataEnd = TEXCACHE_DATA_START;
+		}
+	}
+
+	// Entry is published only once the blob is written.
+	if ((pltf.ifseek(f, gm_texCache.dataEnd, SEEK_SET) == 0) && (pltf.ifwrite(pixels, size, 1, f) == 1)) {
+		pFree->key			= key;
+		pFree->srcSize		= srcSize;
+		pFree->offset		= gm_texCache.dataEnd;
+		pFree->size			= size;
+		pFree->pixelFormat	= pixelFormat;
+		pFree->width		= pAsset->m_width;
+		pFree->height		= pAsset->m_height;
+		pFree->lastUse		= ++gm_texCache.useCounter;
+		pFree->checksum		= texCacheChecksum(pixels, size);
+		gm_texCache.dataEnd	+= alignedSize;
+	}
+	writeTexCacheHeader(f);
+	pltf.ifclose(f);
+}
+
 /*virtual*/
 CKLBAbstractAsset* 
 KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize) 
@@ -1321,6 +1628,13 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				break;
 			}
 
+			bool lowRes = (CPFInterface::getInstance().client().getPhysicalScreenHeight() < 480) || m_useQuarterTexture;
+
+			// Decoded pixels cache (0 : not decoded)
+			u32  cacheKey		= 0;
+			u32  cacheSrcSize	= 0;
+			bool fromCache		= false;
+
 			u32 opt = CKLBOGLWrapper::TEX_NONE;
 			u32 compressType = 0;
 			if (pNewAsset->m_type & (1<<3)) {
@@ -1330,9 +1644,15 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				if (compressType == 0) {
 					/* textureSize = zlib stream */
 					u32 outputSize = bytePerPix * pNewAsset->m_width * pNewAsset->m_height;
-					pNewAsset->m_bitmap				= KLBNEWA(u8, outputSize);
+					cacheSrcSize	= textureSize - 4;
+					cacheKey		= texCacheKey(stream, cacheSrcSize, pNewAsset, pixelFormat, lowRes);
+					pNewAsset->m_bitmap				= loadTexCache(cacheKey, cacheSrcSize, pixelFormat, pNewAsset);
+					fromCache		= (pNewAsset->m_bitmap != NULL);
+					if (!fromCache) {
+						pNewAsset->m_bitmap			= KLBNEWA(u8, outputSize);
+					}
 
-					if (pNewAsset->m_bitmap) {
+					if (pNewAsset->m_bitmap && (!fromCache)) {
 						u8* in = &stream[0];
 						// textureSize = compressed stream Size.
 						int ret;
@@ -1462,9 +1782,15 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 
 							opt &= ~CKLBOGLWrapper::TEX_OPT_COMPRESSED_BIT;
 							u32 outputSize = bytePerPix * pNewAsset->m_width * pNewAsset->m_height;
-							pNewAsset->m_bitmap				= KLBNEWA(u8, outputSize);
+							cacheSrcSize	= textureSize - 4;
+							cacheKey		= texCacheKey(stream, cacheSrcSize, pNewAsset, pixelFormat, lowRes);
+							pNewAsset->m_bitmap				= loadTexCache(cacheKey, cacheSrcSize, pixelFormat, pNewAsset);
+							fromCache		= (pNewAsset->m_bitmap != NULL);
+							if (!fromCache) {
+								pNewAsset->m_bitmap			= KLBNEWA(u8, outputSize);
+							}
 
-							if (pNewAsset->m_bitmap) {
+							if (pNewAsset->m_bitmap && (!fromCache)) {
 
 								/* From Khronos Specs
 									First block in mem  Second block in mem
@@ -1582,8 +1908,8 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				// Texture creation may fail, but asset is considered as loaded
 				//
 				MEASURE_THREAD_CPU_BEGIN(TASKTYPE_TEX_LOAD_LOWCONV);
-				bool lowRes = (CPFInterface::getInstance().client().getPhysicalScreenHeight() < 480) || m_useQuarterTexture;
-				if (lowRes && (compressType == 0)) {
+				// Cached pixels are already downscaled.
+				if (lowRes && (compressType == 0) && (!fromCache)) {
 					switch (pixelFormat) {
 					case GL_UNSIGNED_SHORT_5_6_5:
 						processImage565(
@@ -1621,11 +1947,16 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				}
 				MEASURE_THREAD_CPU_END(TASKTYPE_TEX_LOAD_LOWCONV);
 
+				if (cacheKey && (!fromCache)) {
+					storeTexCache(cacheKey, cacheSrcSize, pixelFormat, pNewAsset, (u8*)pNewAsset->m_bitmap,
+								  bytePerPix * pNewAsset->m_width * pNewAsset->m_height);
+				}
+
 				if (this->m_loadHardware) {
 					MEASURE_THREAD_CPU_BEGIN(TASKTYPE_TEX_LOAD_OGL);
 					if (CKLBAssetManager::getInstance().isAsyncLoading() == false) {
 						pNewAsset->m_bytePerPix	= bytePerPix;
-						pNewAsset->m_pTexture	= pMgr.createTexture(pNewAsset->m_width,
+						CTexture* pTexture		= pMgr.createTexture(pNewAsset->m_width,
 																	 pNewAsset->m_height,
 																	 pixelFormat,
 																	 channelCount,
@@ -1634,11 +1965,19 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 																	 (CKLBOGLWrapper::TEX_OPTION)opt,0,
 																	 (!m_pReloadAsset) ? NULL : pNewAsset->m_pTexture);
 						// Sync loading.
+						if (!m_pReloadAsset) {
+							pNewAsset->m_pTexture = pTexture;
+							if (pTexture && pNewAsset->m_fileSource) {
+								// Can be evicted and read again from its file.
+								pMgr.setTextureResidency(pTexture, textureResidency, pNewAsset);
+							}
+						}
+						// On reload failure, the texture stays an empty shell and is tried again when drawn.
 					} else {
 						// Async loading, but main thread need to perform the openGL call.
 						CKLBAssetManager::getInstance().setMainThreadTexture(pNewAsset, pixelFormat, channelCount, opt, textureSize);
 					}
-					if (pNewAsset->m_pTexture) {
+					if (pNewAsset->m_pTexture && pNewAsset->m_pTexture->isResident()) {
 						gTextureAllocHW += pNewAsset->m_width * pNewAsset->m_height * bytePerPix;
 					}
 					MEASURE_THREAD_CPU_END(TASKTYPE_TEX_LOAD_OGL);
@@ -1721,6 +2060,11 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				}
 
 				if (this->m_loadSoftware) {
+					if (pNewAsset->m_softTexture) {
+						// Reloading.
+						KLBDELETEA(pNewAsset->m_softTexture);
+						gTextureAllocSW -= pNewAsset->m_width * pNewAsset->m_height * 4;
+					}
 					pNewAsset->m_softTexture = createSoftTexture(
 						pNewAsset->m_width,
 						pNewAsset->m_height,
@@ -1735,7 +2079,10 @@ KLBTextureAssetPlugin::loadAsset(u8* stream, u32 streamSize)
 				}
 
 				if (pNewAsset->m_pTexture) {
-					pNewAsset->m_pTextureUsage = pNewAsset->m_pTexture->createUsage();				
+					// Reloaded texture keeps its usages.
+					if ((!m_pReloadAsset) || (!pNewAsset->m_pTextureUsage)) {
+						pNewAsset->m_pTextureUsage = pNewAsset->m_pTexture->createUsage();				
+					}
 					// pNewAsset->m_pTextureUsage->setSampling(
 				} else {
 					pNewAsset->m_pTextureUsage = NULL;
@@ -1993,7 +2340,9 @@ doScreenShot(const char* name, u32 srcx, u32 srcy, u32 width, u32 height, u32 ds
 		buffer = KLBNEWA(u8, bufferSize);
 		if (buffer) {
 			if (pMgr.copyScreenRGB888(srcx,srcy,width,height,buffer)) {
-				if (pNewAsset->m_pTexture->updateTexture(dstx,dsty,width,height,buffer,bufferSize)) {
+				// Errors are otherwise only polled once per frame : check this upload now.
+				if (pNewAsset->m_pTexture->updateTexture(dstx,dsty,width,height,buffer,bufferSize)
+				&&  (dglGetError() == GL_NO_ERROR)) {
 					KLBDELETEA(buffer);
 					return true;
 				}
@@ -2739,3 +3088,102 @@ namespace rg_etc1
    }
          
 } // namespace rg_etc1
+
+#ifdef INTERNAL_BENCH
+// Decoded texture cache : a 256x256 RGBA zlib texture stream (gradient and noise), timed through
+// the cache key, a full inflate (the miss path), the store, and the cache hit that replaces the inflate.
+// Checks that the hit returns the inflated pixels and size. The bench entry is dropped afterwards.
+static bool benchTexCache(u32 loops) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const u32 width		= 256;
+	const u32 height	= 256;
+	const u32 size		= width * height * 4;
+
+	uLongf	packedSize	= compressBound(size);
+	u8*		pixels		= KLBNEWA(u8, size);
+	u8*		decoded		= KLBNEWA(u8, size);
+	u8*		packed		= KLBNEWA(u8, packedSize);
+	bool	ok			= (pixels && decoded && packed);
+
+	u32 seed = 1;
+	for (u32 n = 0; ok && (n < size); n += 4) {
+		seed = (seed * 1103515245) + 12345;
+		u32 x = (n >> 2) % width;
+		u32 y = (n >> 2) / width;
+		pixels[n  ] = (u8)x;
+		pixels[n+1] = (u8)y;
+		pixels[n+2] = (u8)((x + y) >> 1);
+		pixels[n+3] = ((seed >> 16) & 7) ? 0xFF : (u8)(seed >> 8);
+	}
+	ok = ok && (compress2(packed, &packedSize, pixels, size, Z_DEFAULT_COMPRESSION) == Z_OK);
+
+	CKLBTextureAsset asset;
+	asset.m_width	= width;
+	asset.m_height	= height;
+	asset.m_type	= 0;
+
+	u32 key = 0;
+	if (ok) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; n < loops; n++) {
+			key = texCacheKey(packed, packedSize, &asset, GL_UNSIGNED_BYTE, false);
+		}
+		s64 t1 = CKLBBenchmark::now();
+		for (u32 n = 0; ok && (n < loops); n++) {
+			z_stream strm;
+			strm.zalloc		= Z_NULL;
+			strm.zfree		= Z_NULL;
+			strm.opaque		= Z_NULL;
+			strm.avail_in	= packedSize;
+			strm.next_in	= packed;
+			strm.avail_out	= size;
+			strm.next_out	= decoded;
+			ok = (inflateInit(&strm) == Z_OK);
+			if (ok) {
+				ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END);
+				inflateEnd(&strm);
+			}
+		}
+		s64 t2 = CKLBBenchmark::now();
+		CKLBBenchmark::report("cache key (FNV-1a)", loops, t1 - t0);
+		CKLBBenchmark::report("inflate 256x256x4", loops, t2 - t1);
+		ok = ok && (memcmp(decoded, pixels, size) == 0);
+	}
+
+	if (ok) {
+		s64 t0 = CKLBBenchmark::now();
+		storeTexCache(key, packedSize, GL_UNSIGNED_BYTE, &asset, decoded, size);
+		s64 t1 = CKLBBenchmark::now();
+		CKLBBenchmark::report("cache store", 1, t1 - t0);
+
+		for (u32 n = 0; ok && (n < loops); n++) {
+			asset.m_width	= 0;
+			asset.m_height	= 0;
+			u8* hit = loadTexCache(key, packedSize, GL_UNSIGNED_BYTE, &asset);
+			ok = hit && (asset.m_width == width) && (asset.m_height == height) && (memcmp(hit, pixels, size) == 0);
+			if (hit) { KLBDELETEA(hit); }
+		}
+		s64 t2 = CKLBBenchmark::now();
+		CKLBBenchmark::report("cache hit (read + checksum)", loops, t2 - t1);
+		if (!ok) {
+			pltf.logging("[BENCH] TEXCACHE hit does not match the decoded pixels (external storage writable ?)\n");
+		}
+
+		// Drop the bench entry.
+		STexCacheEntry* pEntry = findTexCache(key, packedSize, GL_UNSIGNED_BYTE);
+		void* f = pEntry ? openTexCache("r+b") : NULL;
+		if (f) {
+			pEntry->key = 0;
+			writeTexCacheEntry(f, pEntry);
+			pltf.ifclose(f);
+		}
+	}
+
+	if (pixels)		{ KLBDELETEA(pixels);	}
+	if (decoded)	{ KLBDELETEA(decoded);	}
+	if (packed)		{ KLBDELETEA(packed);	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchTexCache("TEXCACHE", benchTexCache);
+#endif
@@ -15,6 +15,8 @@
 */
 #include "CKLBAsyncFilecopy.h"
 #include "CKLBScriptEnv.h"
+#include "CKLBBenchmark.h"
+#include "CKLBWorkerPool.h"
 ;
 static CKLBTaskFactory<CKLBAsyncFilecopy> factory("UTIL_AsyncFilecopy", CLS_KLBASYNCFILECOPY);
 
@@ -26,15 +28,42 @@ static CKLBTaskFactory<CKLBAsyncFilecopy> factory("UTIL_AsyncFilecopy", CLS_KLBA
 #define ERROR_DSTFILEERR	(0x20)
 #define ERROR_NAMING		(0x30)
 
+#define DEFAULT_BLOCKSIZE	(1024 * 1024)
+#define MIN_BLOCKSIZE		(4 * 1024)
+#define MAX_BLOCKSIZE		(16 * 1024 * 1024)
+
+// Batch copy : workers besides the copy thread.
+#define BATCH_WORKERS		(3)
+
 CKLBAsyncFilecopy::CKLBAsyncFilecopy() 
 :CKLBLuaPropTask	()
 ,m_callback			(NULL)
 ,m_thread			(NULL)
 ,m_fileNameSrc		(NULL)
 ,m_fileNameDst		(NULL)
+,m_fileCount		(0)
+,m_filesDone		(0)
 ,m_done				(0)
+,m_doneSize			(0)
+,m_checkSize		(0)
 ,m_error			(NO_ERROR)
+,m_pDest			(NULL)
+,m_blockSize		(DEFAULT_BLOCKSIZE)
+,m_fullSize			(0)
+,m_mutex			(NULL)
+,m_evFree			(NULL)
+,m_evFilled			(NULL)
+,m_evDone			(NULL)
+,m_readDone			(false)
+,m_writeDone		(false)
+,m_writeError		(false)
+,m_abort			(false)
+,m_finished			(false)
 {
+	m_buffer[0]		= NULL;
+	m_buffer[1]		= NULL;
+	m_blockLen[0]	= 0;
+	m_blockLen[1]	= 0;
 	m_newScriptModel = true;
 }
 
@@ -51,8 +80,9 @@ enum {
 	ARG_FILENAMESRC = 1,
 	ARG_FILENAMEDST,
 	ARG_CALLBACK,		            // Function name for callback
+	ARG_BLOCKSIZE,					// Optional : copy block size in KB
 	ARG_REQUIRE		= ARG_CALLBACK,	
-	ARG_NUMS		= ARG_CALLBACK
+	ARG_NUMS		= ARG_BLOCKSIZE
 };
 
 u32
@@ -79,64 +109,203 @@ extractName(const char* fullpath) {
 	return fullpath;
 }
 
+bool
+CKLBAsyncFilecopy::writeBlock(const u8* buffer, u32 size)
+{
+	if (m_pDest->writeTmp((void*)buffer, size) != size) {
+		return false;
+	}
+	m_doneSize += size;
+	m_done = (u32)(((u64)m_doneSize * 100) / m_fullSize);
+	return true;
+}
+
+void
+CKLBAsyncFilecopy::setFlag(volatile bool& flag, void* evt)
+{
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	pfif.mutexLock(m_mutex);
+	flag = true;
+	pfif.mutexUnlock(m_mutex);
+	pfif.eventWakeup(evt);
+}
+
+bool
+CKLBAsyncFilecopy::waitFree(u32 slot)
+{
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	pfif.mutexLock(m_mutex);
+	while (m_blockLen[slot] && !m_abort) {
+		pfif.mutexUnlock(m_mutex);
+		pfif.eventSleep(m_evFree);
+		pfif.mutexLock(m_mutex);
+	}
+	bool res = !m_abort;
+	pfif.mutexUnlock(m_mutex);
+	return res;
+}
+
+u32
+CKLBAsyncFilecopy::waitFilled(u32 slot)
+{
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	pfif.mutexLock(m_mutex);
+	while (!m_blockLen[slot] && !m_readDone && !m_abort) {
+		pfif.mutexUnlock(m_mutex);
+		pfif.eventSleep(m_evFilled);
+		pfif.mutexLock(m_mutex);
+	}
+	u32 size = m_abort ? 0 : m_blockLen[slot];
+	pfif.mutexUnlock(m_mutex);
+	return size;
+}
+
+/*static*/
+s32
+CKLBAsyncFilecopy::ThreadWriter(void * /* hThread */, void * data)
+{
+	CKLBAsyncFilecopy* p	= (CKLBAsyncFilecopy*)data;
+	IPlatformRequest& pfif	= CPFInterface::getInstance().platform();
+
+	u32 slot = 0;
+	for (;;) {
+		u32 size = p->waitFilled(slot);
+		if (!size) { break; }	// Read done or abort.
+
+		bool writeOK = p->writeBlock(p->m_buffer[slot], size);
+
+		pfif.mutexLock(p->m_mutex);
+		p->m_blockLen[slot] = 0;
+		if (!writeOK) {
+			p->m_writeError = true;
+			p->m_abort		= true;
+		}
+		pfif.mutexUnlock(p->m_mutex);
+		pfif.eventWakeup(p->m_evFree);
+
+		if (!writeOK) { break; }
+		slot ^= 1;
+	}
+
+	p->setFlag(p->m_writeDone, p->m_evFree);
+	return 0;
+}
+
 /*static*/
 s32 
 CKLBAsyncFilecopy::ThreadLoader(void * /* hThread */, void * data)
 {
 	CKLBAsyncFilecopy* p			= (CKLBAsyncFilecopy*)data;
 
-	u8 block[4096];	// 4 KB Page
-	
 	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+
+	if (p->m_fileCount > 1) {
+		// Batch : files are small, copy several at once rather than overlap blocks.
+		if (p->m_error == 0) {
+			CKLBWorkerPool pool(BATCH_WORKERS);
+			pool.run(CopyJob, p, p->m_fileCount);
+		}
+		p->setFlag(p->m_finished, p->m_evDone);
+		return 0;
+	}
+
+	const char* fileNameSrc = p->m_fileNameSrc ? p->m_fileNameSrc[0] : NULL;
+	const char* fileNameDst = p->m_fileNameDst ? p->m_fileNameDst[0] : NULL;
 	
 	// Open Source
 	IReadStream* pSrc	= NULL;
-	if (p->m_fileNameSrc) {
-		pSrc = pfif.openReadStream(p->m_fileNameSrc, pfif.useEncryption());
+	if (fileNameSrc) {
+		pSrc = pfif.openReadStream(fileNameSrc, pfif.useEncryption());
 	}
 
 	// Create Tmp
 	ITmpFile* pDest		= NULL;
-	if (p->m_fileNameDst) {
+	if (fileNameDst) {
 		// Force deletion if file exist.
-		pfif.removeTmpFile(p->m_fileNameDst);
+		pfif.removeTmpFile(fileNameDst);
 		// Create new file.
-		pDest = pfif.openTmpFile(p->m_fileNameDst);
+		pDest = pfif.openTmpFile(fileNameDst);
 	}
 	
 	if (pSrc && (pSrc->getStatus() == IReadStream::NORMAL) && pDest && (p->m_error == 0)) {
 		// Success both ?
 		p->m_doneSize	= 0;
 		p->m_done		= 0;
+		p->m_pDest		= pDest;
 
-		u32 toCopy = pSrc->getSize();
-		u32 fullSize = toCopy;
-		
-		while (toCopy) {
-			u32 size;
+		u32 toCopy		= pSrc->getSize();
+		u32 blockSize	= (toCopy < p->m_blockSize) ? toCopy : p->m_blockSize;
+		p->m_fullSize	= toCopy;
 
-			if (toCopy >= 4096) {
-				size = 4096;
-				toCopy -= size;
-			} else {
-				size = toCopy;
-				toCopy = 0;
+		p->m_buffer[0]	= blockSize ? (u8*)malloc(blockSize) : NULL;
+
+		// Overlap reads and writes only when there is more than one block to move.
+		void* hWriter	= NULL;
+		if (p->m_buffer[0] && (toCopy > blockSize)) {
+			p->m_buffer[1] = (u8*)malloc(blockSize);
+			if (p->m_buffer[1]) {
+				hWriter = pfif.createThread(ThreadWriter, p);
 			}
-			
-			bool readOK		= pSrc->readBlock(block, size);
-			u32  writeSize	= pDest->writeTmp(block, size);
-			
-			if (readOK && (writeSize == size)) { 
-				p->m_doneSize += size;
-				p->m_done = (p->m_doneSize * 100) / fullSize;
-			} else {
-				toCopy = 0;
+		}
+
+		if (blockSize && !p->m_buffer[0]) {
+			toCopy = 0;
+			p->m_error |= ERROR_DURINGCOPY;
+		}
+
+		u32 slot = 0;
+		while (toCopy && !p->m_abort) {
+			u32 size = (toCopy < blockSize) ? toCopy : blockSize;
+
+			if (hWriter && !p->waitFree(slot)) {
+				break;
+			}
+
+			if (!pSrc->readBlock(p->m_buffer[slot], size)) {
+				p->m_error |= ERROR_DURINGCOPY;
+				break;
+			}
+			toCopy -= size;
+
+			if (hWriter) {
+				// Hand the block to the writer, read the next one in the other slot.
+				pfif.mutexLock(p->m_mutex);
+				p->m_blockLen[slot] = size;
+				pfif.mutexUnlock(p->m_mutex);
+				pfif.eventWakeup(p->m_evFilled);
+				slot ^= 1;
+			} else if (!p->writeBlock(p->m_buffer[0], size)) {
+				p->m_error |= ERROR_DURINGCOPY;
+				break;
+			}
+		}
+
+		if (hWriter) {
+			// Let the writer flush the pending blocks and wait for it.
+			p->setFlag(p->m_readDone, p->m_evFilled);
+			pfif.mutexLock(p->m_mutex);
+			while (!p->m_writeDone) {
+				pfif.mutexUnlock(p->m_mutex);
+				pfif.eventSleep(p->m_evFree);
+				pfif.mutexLock(p->m_mutex);
+			}
+			pfif.mutexUnlock(p->m_mutex);
+			pfif.deleteThread(hWriter);
+
+			if (p->m_writeError) {
 				p->m_error |= ERROR_DURINGCOPY;
 			}
 		}
 
-		if (p->m_error & ERROR_DURINGCOPY) {
-			pfif.removeTmpFile(p->m_fileNameDst);
+		free(p->m_buffer[0]);
+		free(p->m_buffer[1]);
+		p->m_buffer[0] = NULL;
+		p->m_buffer[1] = NULL;
+
+		if ((p->m_error & ERROR_DURINGCOPY) || p->m_abort) {
+			delete pDest;
+			pDest = NULL;
+			pfif.removeTmpFile(fileNameDst);
 		}
 	} else {
 		p->m_error |= ERROR_SETUP;	
@@ -153,16 +322,89 @@ CKLBAsyncFilecopy::ThreadLoader(void * /* hThread */, void * data)
 
 	if (pSrc)	{ delete pSrc;  }
 	if (pDest)	{ delete pDest; }
+	p->m_pDest = NULL;
 
+	// Last access to p : die() may release the task right after.
+	p->setFlag(p->m_finished, p->m_evDone);
 	return 0;
 }
 
+/*static*/
+void
+CKLBAsyncFilecopy::CopyJob(void * pCtx, u32 index)
+{
+	((CKLBAsyncFilecopy*)pCtx)->copyFile(index);
+}
+
+// One file of a batch, on a pool worker or the copy thread.
+void
+CKLBAsyncFilecopy::copyFile(u32 index)
+{
+	IPlatformRequest& pfif	= CPFInterface::getInstance().platform();
+	const char* fileNameDst	= m_fileNameDst[index];
+	u32 error				= NO_ERROR;
+	u32 toCopy				= 0;
+
+	IReadStream* pSrc		= m_abort ? NULL : pfif.openReadStream(m_fileNameSrc[index], pfif.useEncryption());
+	ITmpFile* pDest			= NULL;
+	if (pSrc && (pSrc->getStatus() == IReadStream::NORMAL)) {
+		pfif.removeTmpFile(fileNameDst);
+		pDest = pfif.openTmpFile(fileNameDst);
+	}
+
+	if (pDest) {
+		toCopy			= pSrc->getSize();
+		u32 blockSize	= (toCopy < m_blockSize) ? toCopy : m_blockSize;
+		u8* buffer		= blockSize ? (u8*)malloc(blockSize) : NULL;
+		if (blockSize && !buffer) {
+			error |= ERROR_DURINGCOPY;
+		}
+		while (buffer && toCopy && !m_abort) {
+			u32 size = (toCopy < blockSize) ? toCopy : blockSize;
+			if (!pSrc->readBlock(buffer, size) || (pDest->writeTmp(buffer, size) != size)) {
+				error |= ERROR_DURINGCOPY;
+				break;
+			}
+			toCopy -= size;
+
+			pfif.mutexLock(m_mutex);
+			m_doneSize += size;
+			pfif.mutexUnlock(m_mutex);
+		}
+		free(buffer);
+
+		if (toCopy) {
+			// Failed or aborted : no partial file left.
+			delete pDest;
+			pDest = NULL;
+			pfif.removeTmpFile(fileNameDst);
+		}
+	} else if (!m_abort) {
+		bool srcOk = pSrc && (pSrc->getStatus() == IReadStream::NORMAL);
+		error |= ERROR_SETUP | (srcOk ? ERROR_DSTFILEERR : ERROR_SRCFILEERR);
+	}
+
+	if (pSrc)	{ delete pSrc;  }
+	if (pDest)	{ delete pDest; }
+
+	pfif.mutexLock(m_mutex);
+	m_error |= error;
+	m_filesDone++;
+	m_done = (m_filesDone * 100) / m_fileCount;
+	pfif.mutexUnlock(m_mutex);
+}
+
+CKLBAsyncFilecopy*
+CKLBAsyncFilecopy::create(CKLBTask* pParentTask, const char* filesource, const char* filedest, const char* callback, u32 blockSize) {
+	return createBatch(pParentTask, &filesource, &filedest, 1, callback, blockSize);
+}
+
 CKLBAsyncFilecopy*
-CKLBAsyncFilecopy::create(CKLBTask* pParentTask, const char* filesource, const char* filedest, const char* callback) {
+CKLBAsyncFilecopy::createBatch(CKLBTask* pParentTask, const char** filesources, const char** filedests, u32 count, const char* callback, u32 blockSize) {
 	CKLBAsyncFilecopy* pTask = KLBNEW(CKLBAsyncFilecopy);
     if(!pTask) { return NULL; }
 
-	if(!pTask->init(pParentTask, filesource, filedest, callback)) {
+	if(!pTask->init(pParentTask, filesources, filedests, count, callback, blockSize)) {
 		KLBDELETE(pTask);
 		return NULL;
 	}
@@ -170,10 +412,16 @@ CKLBAsyncFilecopy::create(CKLBTask* pParentTask, const char* filesource, const c
 }
 
 bool
-CKLBAsyncFilecopy::init(CKLBTask* pTask, const char* filesource, const char* filedest, const char* callback) {
-	setStrC(m_callback,callback);
+CKLBAsyncFilecopy::init(CKLBTask* pTask, const char** filesources, const char** filedests, u32 count, const char* callback, u32 blockSize) {
+	if(!count) return false;
 
-	if(!m_callback) return false;
+	if(!setStrC(m_callback,callback)) return false;
+
+	if (blockSize) {
+		if (blockSize < MIN_BLOCKSIZE) { blockSize = MIN_BLOCKSIZE; }
+		if (blockSize > MAX_BLOCKSIZE) { blockSize = MAX_BLOCKSIZE; }
+		m_blockSize = blockSize;
+	}
 
 	// Properties definition
 	if(!setupPropertyList((const char**)CKLBAsyncFilecopy::ms_propItems,SizeOfArray(ms_propItems))) {
@@ -183,36 +431,57 @@ CKLBAsyncFilecopy::init(CKLBTask* pTask, const char* filesource, const char* fil
 	m_done	= 0;
 	m_error	= 0;
 
-	// Error setup :
-	// - Dest or src are null ?
-	const char* nameDst = NULL;
-	if (filedest) {
-		nameDst = extractName(filedest);
+	m_fileNameSrc = KLBNEWA(const char*, count);
+	m_fileNameDst = KLBNEWA(const char*, count);
+	if (!m_fileNameSrc || !m_fileNameDst) {
+		return false;
 	}
+	m_fileCount = count;
+
+	for (u32 n = 0; n < count; n++) {
+		const char* filesource	= filesources[n];
+		const char* filedest	= filedests[n];
+		m_fileNameSrc[n] = NULL;
+		m_fileNameDst[n] = NULL;
+
+		// Error setup :
+		// - Dest or src are null ?
+		const char* nameDst = NULL;
+		if (filedest) {
+			nameDst = extractName(filedest);
+		}
 
-	const char* nameSrc = NULL;
-	if (filesource) {
-		nameSrc = extractName(filesource);
-	}
+		const char* nameSrc = NULL;
+		if (filesource) {
+			nameSrc = extractName(filesource);
+		}
 
-	if (!nameDst) {
-		m_fileNameDst = NULL;
-		m_error		|= ERROR_SETUP | ERROR_NAMING | ERROR_DSTFILEERR;
-	} else if (!nameSrc) {
-		m_fileNameDst = NULL;
-		m_error		|= ERROR_SETUP | ERROR_NAMING | ERROR_SRCFILEERR;
-	} else {
-		if ((strcmp(nameSrc, nameDst) == 0) 
-			&& (strncmp(filesource, "file://install/" , 15) == 0)
-			&& (strncmp(filedest  , "file://external/", 16) == 0)) {
-			m_fileNameSrc = CKLBUtility::copyString(filesource);
-			m_fileNameDst = CKLBUtility::copyString(filedest);
+		if (!nameDst) {
+			m_error		|= ERROR_SETUP | ERROR_NAMING | ERROR_DSTFILEERR;
+		} else if (!nameSrc) {
+			m_error		|= ERROR_SETUP | ERROR_NAMING | ERROR_SRCFILEERR;
 		} else {
-			m_error |= ERROR_SETUP | ERROR_NAMING;
+			if ((strcmp(nameSrc, nameDst) == 0) 
+				&& (strncmp(filesource, "file://install/" , 15) == 0)
+				&& (strncmp(filedest  , "file://external/", 16) == 0)) {
+				m_fileNameSrc[n] = CKLBUtility::copyString(filesource);
+				m_fileNameDst[n] = CKLBUtility::copyString(filedest);
+			} else {
+				m_error |= ERROR_SETUP | ERROR_NAMING;
+			}
 		}
 	}
 	
-	m_thread = CPFInterface::getInstance().platform().createThread(ThreadLoader,this);
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	m_mutex		= pfif.allocMutex();
+	m_evFree	= pfif.allocEventLock();
+	m_evFilled	= pfif.allocEventLock();
+	m_evDone	= pfif.allocEventLock();
+	if (!m_mutex || !m_evFree || !m_evFilled || !m_evDone) {
+		return false;
+	}
+
+	m_thread = pfif.createThread(ThreadLoader,this);
 	if (!m_thread) {
 		return false;
 	}
@@ -228,18 +497,88 @@ CKLBAsyncFilecopy::initScript(CLuaState& lua)
 	if(argc < ARG_REQUIRE || argc > ARG_NUMS) return false;
 
 	const char * callback       = lua.getString(ARG_CALLBACK);
+	if(!callback) return false;
+
+	u32          blockSize      = 0;
+	if (argc >= ARG_BLOCKSIZE) {
+		// KB, clamped before scaling so that a large value can not wrap.
+		s32 blockKB = lua.getInt(ARG_BLOCKSIZE);
+		if (blockKB > (MAX_BLOCKSIZE / 1024)) { blockKB = MAX_BLOCKSIZE / 1024; }
+		blockSize = (blockKB > 0) ? (u32)blockKB * 1024 : 0;
+	}
+
+	if (lua.isTable(ARG_FILENAMESRC)) {
+		// Batch : arrays of source and destination names, same length.
+		u32 count = lua.tableLength(ARG_FILENAMESRC);
+		if (!count || !lua.isTable(ARG_FILENAMEDST) || (lua.tableLength(ARG_FILENAMEDST) != (int)count)) {
+			return false;
+		}
+		const char** names = KLBNEWA(const char*, count * 2);
+		if (!names) return false;
+		for (u32 n = 0; n < count; n++) {
+			// Strings stay referenced by the tables during init().
+			lua.tableRawGetIndex(n + 1, ARG_FILENAMESRC);
+			names[n]			= lua.isString(-1) ? lua.getString(-1) : NULL;
+			lua.pop(1);
+			lua.tableRawGetIndex(n + 1, ARG_FILENAMEDST);
+			names[count + n]	= lua.isString(-1) ? lua.getString(-1) : NULL;
+			lua.pop(1);
+		}
+		bool res = init(this, names, names + count, count, callback, blockSize);
+		KLBDELETEA(names);
+		return res;
+	}
+
 	const char * srcfilename    = lua.getString(ARG_FILENAMESRC);
 	const char * dstfilename    = lua.getString(ARG_FILENAMEDST);
 
-	return init(this, srcfilename, dstfilename, callback);
+	return init(this, &srcfilename, &dstfilename, 1, callback, blockSize);
+}
+
+void
+CKLBAsyncFilecopy::waitFinished()
+{
+	if (!m_thread) { return; }
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	pfif.mutexLock(m_mutex);
+	while (!m_finished) {
+		pfif.mutexUnlock(m_mutex);
+		pfif.eventSleep(m_evDone);
+		pfif.mutexLock(m_mutex);
+	}
+	pfif.mutexUnlock(m_mutex);
 }
 
 void
 CKLBAsyncFilecopy::die()
 {
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	if (m_thread) {
+		// Stop the copy after the current block and wait : the threads use this task.
+		setFlag(m_abort, m_evFree);
+		pfif.eventWakeup(m_evFilled);
+
+		waitFinished();
+		pfif.deleteThread(m_thread);
+		m_thread = NULL;
+	}
+	if (m_mutex)	{ pfif.freeMutex(m_mutex);		}
+	if (m_evFree)	{ pfif.freeEventLock(m_evFree);	}
+	if (m_evFilled)	{ pfif.freeEventLock(m_evFilled);	}
+	if (m_evDone)	{ pfif.freeEventLock(m_evDone);	}
+	m_mutex		= NULL;
+	m_evFree	= NULL;
+	m_evFilled	= NULL;
+	m_evDone	= NULL;
+
 	KLBDELETEA(m_callback);
+	for (u32 n = 0; n < m_fileCount; n++) {
+		KLBDELETEA(m_fileNameSrc[n]);
+		KLBDELETEA(m_fileNameDst[n]);
+	}
 	KLBDELETEA(m_fileNameSrc);
 	KLBDELETEA(m_fileNameDst);
+	m_fileCount = 0;
 }
 
 void
@@ -250,3 +589,182 @@ CKLBAsyncFilecopy::execute(u32 /*deltaT*/)
 		CKLBScriptEnv::getInstance().call_asyncFileCopy(m_callback,this,m_done,m_doneSize);
 	}
 }
+
+#ifdef INTERNAL_BENCH
+static bool sameFile(const char* pathA, const char* pathB) {
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	IReadStream* pA = pfif.openReadStream(pathA, pfif.useEncryption());
+	IReadStream* pB = pfif.openReadStream(pathB, pfif.useEncryption());
+	bool same = pA && pB && (pA->getStatus() == IReadStream::NORMAL) && (pB->getStatus() == IReadStream::NORMAL)
+		&& (pA->getSize() == pB->getSize());
+	u8 bufA[4096];
+	u8 bufB[4096];
+	for (s32 left = same ? pA->getSize() : 0; same && (left > 0); left -= sizeof(bufA)) {
+		u32 cnt = (left < (s32)sizeof(bufA)) ? left : sizeof(bufA);
+		same = pA->readBlock(bufA, cnt) && pB->readBlock(bufB, cnt) && (memcmp(bufA, bufB, cnt) == 0);
+	}
+	delete pA;
+	delete pB;
+	return same;
+}
+
+// Copies the file://install/ asset given as argument to file://external/ with 4 KB, 64 KB
+// and the default 1 MB blocks, through create() as native code does (no callback).
+// Checks the progress counters and that the copy matches the source, then removes it.
+// An existing external copy is left alone : the case does not run.
+static bool benchFileCopy(u32 loops) {
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	const char* asset = CKLBBenchmark::getArgument();
+	if (!asset || (strncmp(asset, "file://install/", 15) != 0)) {
+		pfif.logging("[BENCH] FILECOPY needs a file://install/ asset path\n");
+		return true;
+	}
+
+	char dst[256];
+	sprintf(dst, "file://external/%.200s", asset + 15);
+	IReadStream* pStream = pfif.openReadStream(dst, false);
+	bool exists = pStream && (pStream->getStatus() == IReadStream::NORMAL);
+	delete pStream;
+	pStream = pfif.openReadStream(asset, pfif.useEncryption());
+	s32 size = (pStream && (pStream->getStatus() == IReadStream::NORMAL)) ? pStream->getSize() : -1;
+	delete pStream;
+	if (exists || (size < 0)) {
+		pfif.logging("[BENCH] FILECOPY %s\n", exists ? "destination already exists" : "source not found");
+		return false;
+	}
+
+	static const u32 blockSizes[]	= { MIN_BLOCKSIZE, 64 * 1024, DEFAULT_BLOCKSIZE };
+	static const char* labels[]		= { "copy, 4 KB blocks", "copy, 64 KB blocks", "copy, 1 MB blocks" };
+	bool ok = true;
+	for (u32 b = 0; ok && (b < SizeOfArray(blockSizes)); b++) {
+		s64 time = 0;
+		for (u32 l = 0; ok && (l < loops); l++) {
+			s64 t0 = CKLBBenchmark::now();
+			CKLBAsyncFilecopy* p = CKLBAsyncFilecopy::create(NULL, asset, dst, NULL, blockSizes[b]);
+			if (!p) {
+				pfif.logging("[BENCH] FILECOPY create() failed\n");
+				return false;
+			}
+			p->waitFinished();
+			time += CKLBBenchmark::now() - t0;
+			ok = (p->getError() == NO_ERROR) && (p->getProcessCount() == (size ? 100 : 0)) && sameFile(asset, dst);
+			p->kill();
+			if (!ok) {
+				pfif.logging("[BENCH] FILECOPY %s failed or differs from the source\n", labels[b]);
+			}
+		}
+		CKLBBenchmark::report(labels[b], loops, time);
+	}
+	pfif.removeTmpFile(dst);
+	return ok;
+}
+
+// "BENCH FILECOPYTREE <loops> <list>" : the list file holds one file://install/ path per line,
+// for example the files of a data tree. Each loop copies the whole tree to file://external/
+// one create() after the other, then with a single createBatch(). Every copy must match its
+// source. Copies are real disk writes : keep the loop count small.
+// An existing external copy is left alone : the case does not run.
+static bool benchFileCopyTree(u32 loops) {
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	const char* list = CKLBBenchmark::getArgument();
+	if (!list) {
+		pfif.logging("[BENCH] FILECOPYTREE needs a list file of file://install/ paths\n");
+		return true;
+	}
+
+	IReadStream* pStream = pfif.openReadStream(list, false);
+	s32 size	= (pStream && (pStream->getStatus() == IReadStream::NORMAL)) ? pStream->getSize() : -1;
+	char* text	= (size > 0) ? KLBNEWA(char, size + 1) : NULL;
+	bool ok		= text && pStream->readBlock(text, size);
+	delete pStream;
+	if (!ok) {
+		KLBDELETEA(text);
+		pfif.logging("[BENCH] FILECOPYTREE can not read '%s'\n", list);
+		return false;
+	}
+	text[size] = 0;
+
+	// Lines cut in place, anything else than file://install/ is ignored.
+	enum { MAX_FILES = 4096 };
+	static const char*	srcs[MAX_FILES];
+	static const char*	dsts[MAX_FILES];
+	static char			dstNames[MAX_FILES][256];
+	u32 count	= 0;
+	char* parse	= text;
+	while (*parse && (count < MAX_FILES)) {
+		char* line = parse;
+		while (*parse && (*parse != '\n') && (*parse != '\r')) { parse++; }
+		if (*parse) { *parse++ = 0; }
+		if (!strncmp(line, "file://install/", 15) && (strlen(line + 15) < 200)) {
+			sprintf(dstNames[count], "file://external/%s", line + 15);
+			srcs[count] = line;
+			dsts[count] = dstNames[count];
+			count++;
+		}
+	}
+
+	for (u32 n = 0; ok && (n < count); n++) {
+		pStream = pfif.openReadStream(dsts[n], false);
+		ok = !pStream || (pStream->getStatus() != IReadStream::NORMAL);
+		delete pStream;
+		if (!ok) {
+			pfif.logging("[BENCH] FILECOPYTREE %s already exists\n", dsts[n]);
+		}
+	}
+	if (!ok || !count) {
+		KLBDELETEA(text);
+		if (!count) { pfif.logging("[BENCH] FILECOPYTREE no file://install/ path in '%s'\n", list); }
+		return false;
+	}
+
+	s64 timeSeq		= 0;
+	s64 timeBatch	= 0;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; ok && (n < count); n++) {
+			CKLBAsyncFilecopy* p = CKLBAsyncFilecopy::create(NULL, srcs[n], dsts[n], NULL);
+			ok = (p != NULL);
+			if (p) {
+				p->waitFinished();
+				ok = (p->getError() == NO_ERROR);
+				p->kill();
+			}
+		}
+		timeSeq += CKLBBenchmark::now() - t0;
+		for (u32 n = 0; ok && (n < count); n++) {
+			ok = sameFile(srcs[n], dsts[n]);
+			pfif.removeTmpFile(dsts[n]);
+		}
+		if (!ok) {
+			pfif.logging("[BENCH] FILECOPYTREE one by one failed or differs from the source\n");
+			break;
+		}
+
+		t0 = CKLBBenchmark::now();
+		CKLBAsyncFilecopy* p = CKLBAsyncFilecopy::createBatch(NULL, srcs, dsts, count, NULL);
+		ok = (p != NULL);
+		if (p) {
+			p->waitFinished();
+			ok = (p->getError() == NO_ERROR) && (p->getProcessCount() == 100);
+			p->kill();
+		}
+		timeBatch += CKLBBenchmark::now() - t0;
+		for (u32 n = 0; ok && (n < count); n++) {
+			ok = sameFile(srcs[n], dsts[n]);
+		}
+		for (u32 n = 0; n < count; n++) {
+			pfif.removeTmpFile(dsts[n]);
+		}
+		if (!ok) {
+			pfif.logging("[BENCH] FILECOPYTREE batch failed or differs from the source\n");
+		}
+	}
+	CKLBBenchmark::report("tree, one task per file", loops, timeSeq);
+	CKLBBenchmark::report("tree, one batch task", loops, timeBatch);
+	KLBDELETEA(text);
+	return ok;
+}
+
+static CKLBBenchmark gBenchFileCopy("FILECOPY", benchFileCopy);
+static CKLBBenchmark gBenchFileCopyTree("FILECOPYTREE", benchFileCopyTree);
+#endif
@@ -25,6 +25,10 @@
 * File copy may be a long operation to process.
 * In order to lighten the process cost for the game, it can be done
 * by another thread through a CKLBAsyncFilecopy object.
+* Files bigger than one block are copied by two threads : one reads the
+* next block while the other writes the previous one (double buffering).
+* A batch (many small files) is copied by a worker pool, one file per job,
+* and the progress is then the percentage of files done.
 * To load a resource in an asynchronous way, see CKLBAsyncLoader.
 */
 class CKLBAsyncFilecopy : public CKLBLuaPropTask
@@ -34,9 +38,11 @@ private:
 	CKLBAsyncFilecopy();
 	virtual ~CKLBAsyncFilecopy();
 
-	bool init(CKLBTask* pParentTask, const char* sourceFile, const char* destFile, const char* callback);
+	bool init(CKLBTask* pParentTask, const char** sourceFiles, const char** destFiles, u32 count, const char* callback, u32 blockSize);
 public:
-	static CKLBAsyncFilecopy* create(CKLBTask* pParentTask, const char* sourceFile, const char* destFile, const char* callback);
+	// callback may be NULL from native code.
+	static CKLBAsyncFilecopy* create		(CKLBTask* pParentTask, const char* sourceFile, const char* destFile, const char* callback, u32 blockSize = 0);
+	static CKLBAsyncFilecopy* createBatch	(CKLBTask* pParentTask, const char** sourceFiles, const char** destFiles, u32 count, const char* callback, u32 blockSize = 0);
 
 	bool		initScript		(CLuaState& lua);
 
@@ -48,16 +54,46 @@ public:
 	inline u32 getProcessCount	()		{ return m_done;	}
 	inline u32 getError			()		{ return m_error;	}
 
+	// Blocks until the copy thread is done (finished, failed or aborted).
+	void		waitFinished	();
+
 private:
 	static s32 ThreadLoader(void * hThread, void * data);
+	static s32 ThreadWriter(void * hThread, void * data);
+	static void CopyJob		(void * pCtx, u32 index);
+
+	void		copyFile		(u32 index);
+	bool		writeBlock		(const u8* buffer, u32 size);
+	bool		waitFree		(u32 slot);
+	u32			waitFilled		(u32 slot);
+	void		setFlag			(volatile bool& flag, void* evt);
+
 	const char *				m_callback;
-	const char *				m_fileNameSrc;
-	const char *				m_fileNameDst;
+	const char **				m_fileNameSrc;	// m_fileCount names, NULL if not valid
+	const char **				m_fileNameDst;
+	u32							m_fileCount;
+	u32							m_filesDone;
 	void*						m_thread;
 	u32							m_done;
 	u32							m_doneSize;
 	u32							m_checkSize;
 	u32							m_error;
+
+	// Copy pipeline, shared by the reader and writer threads.
+	ITmpFile*					m_pDest;
+	u8*							m_buffer[2];
+	volatile u32				m_blockLen[2];	// 0 : slot free for reading
+	u32							m_blockSize;
+	u32							m_fullSize;
+	void*						m_mutex;
+	void*						m_evFree;		// Writer -> reader : a slot was released / writer done
+	void*						m_evFilled;		// Reader -> writer : a slot was filled / read done
+	void*						m_evDone;		// Copy thread -> die() : finished
+	volatile bool				m_readDone;
+	volatile bool				m_writeDone;
+	volatile bool				m_writeError;
+	volatile bool				m_abort;
+	volatile bool				m_finished;
 	static	PROP_V2				ms_propItems[];
 };
 
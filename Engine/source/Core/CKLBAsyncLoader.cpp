@@ -15,6 +15,7 @@
 */
 #include "CKLBAsyncLoader.h"
 #include "CKLBScriptEnv.h"
+#include "CompositeManagement.h"
 ;
 static CKLBTaskFactory<CKLBAsyncLoader> factory("UTIL_AsyncLoader", CLS_KLBASYNCLOADER);
 
@@ -213,6 +214,10 @@ CKLBAsyncLoader::execute(u32 /*deltaT*/)
 				pList->added = true;
 				m_done++;
 				if (pList->asset) {
+					// Language database is not thread safe : skipped by the loading thread.
+					if (pList->asset->getAssetType() == ASSET_COMPOSITE) {
+						((CKLBCompositeAsset*)pList->asset)->preloadLanguage();
+					}
 					u16 handle = m_pDataSet->allocateHandle(pList->asset, NULL);
 					if (handle == 0) {
 						m_error++;				
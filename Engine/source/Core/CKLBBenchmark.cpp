@@ -0,0 +1,90 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "CKLBBenchmark.h"
+
+#ifdef INTERNAL_BENCH
+
+#include <string.h>
+#include "CPFInterface.h"
+
+CKLBBenchmark*	CKLBBenchmark::ms_begin		= NULL;
+const char*		CKLBBenchmark::ms_argument	= NULL;
+
+CKLBBenchmark::CKLBBenchmark(const char* name, BENCH_FUNC func)
+: m_name	(name)
+, m_func	(func)
+, m_next	(ms_begin)
+{
+	ms_begin = this;
+}
+
+/*static*/
+bool
+CKLBBenchmark::run(const char* name, u32 loops, const char* argument)
+{
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	if (!loops) { loops = DEFAULT_LOOPS; }
+	ms_argument = argument;
+
+	bool all	= (strcmp(name, "ALL") == 0);
+	bool found	= false;
+	bool result	= true;
+	for (CKLBBenchmark* pBench = ms_begin; pBench; pBench = pBench->m_next) {
+		if (all || (strcmp(name, pBench->m_name) == 0)) {
+			found = true;
+			pForm.logging("[BENCH] ---- %s (%i loops)\n", pBench->m_name, loops);
+			if (!pBench->m_func(loops)) {
+				pForm.logging("[BENCH] %s FAILED\n", pBench->m_name);
+				result = false;
+			}
+		}
+	}
+
+	ms_argument = NULL;
+
+	if (!found) {
+		pForm.logging("[BENCH] Unknown benchmark '%s'\n", name);
+		list();
+	}
+	return found && result;
+}
+
+/*static*/
+void
+CKLBBenchmark::list()
+{
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	for (CKLBBenchmark* pBench = ms_begin; pBench; pBench = pBench->m_next) {
+		pForm.logging("\t%s\n", pBench->m_name);
+	}
+}
+
+/*static*/
+s64
+CKLBBenchmark::now()
+{
+	return CPFInterface::getInstance().platform().nanotime();
+}
+
+/*static*/
+void
+CKLBBenchmark::report(const char* label, u32 count, s64 nanoTime)
+{
+	CPFInterface::getInstance().platform().logging("[BENCH] %-32s %8i x %10.3f uS (total %f mS)\n",
+		label, count, count ? (nanoTime / (double)count) / 1000.0 : 0.0, (nanoTime / 1000) / 1000.0f);
+}
+
+#endif // INTERNAL_BENCH
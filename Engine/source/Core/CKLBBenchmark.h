@@ -0,0 +1,63 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __CKLBBENCHMARK_H__
+#define __CKLBBENCHMARK_H__
+
+#include "BaseType.h"
+
+#ifdef DEBUG_PERFORMANCE
+	#define INTERNAL_BENCH
+#endif
+
+#ifdef INTERNAL_BENCH
+
+/*!
+* \class CKLBBenchmark
+* \brief Registry of micro benchmarks run from the debug shell ("BENCH <name|ALL> [loops] [argument]").
+*
+* A case is a static CKLBBenchmark instance declared next to the code it measures.
+* The case function times its own loops with now() (setup excluded), prints them with report(),
+* and returns false if a check failed or the case can not run in the current state.
+* Cases needing data (an asset path...) read it with getArgument().
+*/
+class CKLBBenchmark {
+public:
+	typedef bool (*BENCH_FUNC)(u32 loops);
+
+	CKLBBenchmark(const char* name, BENCH_FUNC func);
+
+	// name : case name or "ALL", loops : 0 uses DEFAULT_LOOPS, argument may be NULL.
+	static bool		run			(const char* name, u32 loops, const char* argument = NULL);
+	static void		list		();
+
+	static const char*
+					getArgument	()	{ return ms_argument; }
+	static s64		now			();
+	static void		report		(const char* label, u32 count, s64 nanoTime);
+private:
+	const char*		m_name;
+	BENCH_FUNC		m_func;
+	CKLBBenchmark*	m_next;
+
+	static CKLBBenchmark*	ms_begin;	// Zero initialized before any constructor runs.
+	static const char*		ms_argument;
+
+	enum { DEFAULT_LOOPS = 1000 };
+};
+
+#endif // INTERNAL_BENCH
+
+#endif // __CKLBBENCHMARK_H__
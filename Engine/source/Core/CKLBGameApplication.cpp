@@ -47,6 +47,7 @@
 #include "AudioAsset.h"
 #include "CKLBTexturePacker.h"
 #include "CKLBNetAPIKeyChain.h"
+#include "CKLBNetAPI.h"
 #include "CKLBFormGroup.h"
 #include "CKLBLanguageDatabase.h"
 #include "CompositeManagement.h"
@@ -401,6 +402,7 @@ CKLBGameApplication::finishGame()
 
 	NetworkManager::stopNetworkManager();
 	CKLBHTTPInterface::releaseHTTPLib();
+	CKLBNetAPI::purgeResponseCache();
 
 	// project local system finish.
 	localFinish();
@@ -424,6 +426,7 @@ CKLBGameApplication::finishGame()
 
 	// Free all singleton in OUR desired order.
 	// (final empty destruction of course done by CRT)
+	CKLBCompositeAsset::purgeTemplates();	// Holds asset references : before asset managers.
 	TexturePacker::getInstance().release(); // Release Texture BEFORE Rendering Mgr
 	CKLBRenderingManager::getInstance().release();
 	CKLBAssetManager::getInstance().release();
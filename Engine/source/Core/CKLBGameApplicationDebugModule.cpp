@@ -20,6 +20,7 @@
 #include "CKLBAsset.h"
 #include "CKLBDrawTask.h"
 #include "CKLBLuaLibSOUND.h"
+#include "CKLBBenchmark.h"
 
 static void parseBuffer(char* command, char** args, int* argc) {
 	char*	parse		= command;
@@ -78,6 +79,9 @@ bool CKLBGameApplication::executeCommand(const char* command) {
 			printf("\tLog execution time of next sysload command\n\n");
 			printf("DUMP SYSLOAD\n");
 			printf("\tDump the execution time for the sysload command logged.\n\n");
+			printf("BENCH [name|ALL] [loops] [argument]\n");
+			printf("\tRun the engine micro benchmarks, list them when no name is given.\n");
+			printf("\tSWF needs an asset path as argument.\n\n");
 			printf("HELP\n");
 			printf("\tThis help.\n\n");
 
@@ -177,6 +181,18 @@ bool CKLBGameApplication::executeCommand(const char* command) {
 				}
 			}
 		} else
+		if (strcmp("BENCH", commArgs[0]) == 0) {
+#ifdef INTERNAL_BENCH
+			if (argCount >= 2) {
+				CKLBBenchmark::run(commArgs[1], (argCount >= 3) ? atoi(commArgs[2]) : 0, (argCount >= 4) ? commArgs[3] : NULL);
+			} else {
+				CKLBBenchmark::list();
+			}
+#else
+			printf("Please recompile the engine with INTERNAL_BENCH defined. (CKLBUtility.h)\n");
+#endif
+			result = true;
+		} else
 		if (strcmp("LOG", commArgs[0]) == 0) {
 			if (argCount >= 2) {
 				if (strcmp("FRAME", commArgs[1]) == 0) {
@@ -0,0 +1,244 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "CKLBNameTable.h"
+#include "CKLBBenchmark.h"
+
+CKLBNameTable::CKLBNameTable(bool fold)
+:m_slots	(NULL)
+,m_slotMax	(0)
+,m_count	(0)
+,m_pool		(NULL)
+,m_poolSize	(0)
+,m_poolMax	(0)
+,m_fold		(fold)
+{
+}
+
+CKLBNameTable::~CKLBNameTable() {
+	free(m_slots);
+	free(m_pool);
+}
+
+void CKLBNameTable::clear() {
+	if (m_slots) {
+		memset(m_slots, 0, m_slotMax * sizeof(u32));
+	}
+	m_count		= 0;
+	m_poolSize	= 0;
+}
+
+u32 CKLBNameTable::hash(const char* name, u32 len, const char* suffix, u32 suffixLen) const {
+	u32 h = 2166136261U;
+	for (u32 part = 0; part < 2; part++) {
+		const char* p	= part ? suffix : name;
+		u32 l			= part ? suffixLen : len;
+		for (u32 n = 0; n < l; n++) {
+			u8 c = (u8)p[n];
+			if (m_fold) {
+				if ((c >= 'A') && (c <= 'Z'))	{ c += 'a' - 'A'; }
+				else if (c == '\\')				{ c = '/'; }
+			}
+			h = (h ^ c) * 16777619U;
+		}
+	}
+	return h;
+}
+
+bool CKLBNameTable::equal(const char* entry, const char* name, u32 len, const char* suffix, u32 suffixLen) const {
+	for (u32 part = 0; part < 2; part++) {
+		const char* p	= part ? suffix : name;
+		u32 l			= part ? suffixLen : len;
+		for (u32 n = 0; n < l; n++) {
+			u8 a = (u8)*entry++;
+			u8 b = (u8)p[n];
+			if (m_fold) {
+				if ((a >= 'A') && (a <= 'Z'))	{ a += 'a' - 'A'; }
+				else if (a == '\\')				{ a = '/'; }
+				if ((b >= 'A') && (b <= 'Z'))	{ b += 'a' - 'A'; }
+				else if (b == '\\')				{ b = '/'; }
+			}
+			if (a != b) { return false; }
+		}
+	}
+	return *entry == 0;
+}
+
+bool CKLBNameTable::grow() {
+	// Keeps the load factor under 1/2.
+	u32 newMax = m_slotMax ? m_slotMax * 2 : 256;
+	u32* newSlots = (u32*)calloc(newMax, sizeof(u32));
+	if (!newSlots) { return false; }
+
+	for (u32 n = 0; n < m_slotMax; n++) {
+		if (m_slots[n]) {
+			const char* name = m_pool + m_slots[n] - 1;
+			u32 idx = hash(name, strlen(name), NULL, 0) & (newMax - 1);
+			while (newSlots[idx]) { idx = (idx + 1) & (newMax - 1); }
+			newSlots[idx] = m_slots[n];
+		}
+	}
+	free(m_slots);
+	m_slots		= newSlots;
+	m_slotMax	= newMax;
+	return true;
+}
+
+u32 CKLBNameTable::find(const char* name, u32 len, const char* suffix, u32 suffixLen) const {
+	if (!m_slotMax) { return NOT_FOUND; }
+
+	u32 mask = m_slotMax - 1;
+	for (u32 idx = hash(name, len, suffix, suffixLen) & mask; m_slots[idx]; idx = (idx + 1) & mask) {
+		if (equal(m_pool + m_slots[idx] - 1, name, len, suffix, suffixLen)) {
+			return m_slots[idx] - 1;
+		}
+	}
+	return NOT_FOUND;
+}
+
+u32 CKLBNameTable::store(const char* name, u32 len) {
+	if (m_poolSize + len + 1 > m_poolMax) {
+		u32 newMax = m_poolMax ? m_poolMax * 2 : 64 * 1024;
+		while (newMax < m_poolSize + len + 1) { newMax *= 2; }
+		char* newPool = (char*)realloc(m_pool, newMax);
+		if (!newPool) { return NOT_FOUND; }
+		m_pool		= newPool;
+		m_poolMax	= newMax;
+	}
+	u32 offset = m_poolSize;
+	memcpy(m_pool + offset, name, len);
+	m_pool[offset + len] = 0;
+	m_poolSize += len + 1;
+	return offset;
+}
+
+u32 CKLBNameTable::insert(const char* name, u32 len, bool* pAdded) {
+	if (pAdded) { *pAdded = false; }
+
+	u32 offset = find(name, len);
+	if (offset != NOT_FOUND) {
+		return offset;
+	}
+
+	if (((m_count + 1) * 2 > m_slotMax) && !grow()) {
+		return NOT_FOUND;
+	}
+
+	offset = store(name, len);
+	if (offset == NOT_FOUND) {
+		return NOT_FOUND;
+	}
+
+	u32 mask	= m_slotMax - 1;
+	u32 idx		= hash(name, len, NULL, 0) & mask;
+	while (m_slots[idx]) { idx = (idx + 1) & mask; }
+	m_slots[idx] = offset + 1;
+	m_count++;
+	if (pAdded) { *pAdded = true; }
+	return offset;
+}
+
+#ifdef INTERNAL_BENCH
+#include <stdio.h>
+#include "CPFInterface.h"
+
+// 8192 asset like paths in a folded table : insert, lookup hits through an upper case / '\\' spelling,
+// name + suffix lookups and misses, against a linear strcmp walk over the same names.
+// Checks every hit returns the inserted offset, re-inserting adds nothing, misses and
+// an unfolded table reject the other spelling.
+static bool benchNameTable(u32 loops) {
+	enum { NAMES = 8192, WALKS = 256 };
+	static char names[NAMES][48];
+	static char variants[NAMES][48];
+	static u32	offsets[NAMES];
+	for (u32 n = 0; n < NAMES; n++) {
+		sprintf(names[n],		"image/ui/part%i/Button_%04i.png",		n & 15, n);
+		sprintf(variants[n],	"IMAGE\\UI\\PART%i\\button_%04i.PNG",	n & 15, n);
+	}
+
+	s64 timeInsert	= 0;
+	s64 timeHit		= 0;
+	s64 timeSuffix	= 0;
+	s64 timeMiss	= 0;
+	s64 timeWalk	= 0;
+	bool ok			= true;
+	u32 seed		= 1;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		CKLBNameTable table(true);
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; n < NAMES; n++) {
+			offsets[n] = table.insert(names[n], strlen(names[n]));
+		}
+		s64 t1 = CKLBBenchmark::now();
+		for (u32 n = 0; n < NAMES; n++) {
+			seed = (seed * 1103515245) + 12345;
+			u32 idx = (seed >> 8) % NAMES;
+			ok &= (table.find(variants[idx], strlen(variants[idx])) == offsets[idx]);
+		}
+		s64 t2 = CKLBBenchmark::now();
+		for (u32 n = 0; n < NAMES; n++) {
+			u32 len = strlen(names[n]) - 4;
+			ok &= (table.find(names[n], len, ".png", 4) == offsets[n]);
+		}
+		s64 t3 = CKLBBenchmark::now();
+		for (u32 n = 0; n < NAMES; n++) {
+			u32 len = strlen(names[n]) - 4;
+			ok &= (table.find(names[n], len, ".jpg", 4) == CKLBNameTable::NOT_FOUND);
+		}
+		s64 t4 = CKLBBenchmark::now();
+		for (u32 n = 0; n < WALKS; n++) {
+			seed = (seed * 1103515245) + 12345;
+			u32 idx = (seed >> 8) % NAMES;
+			u32 found = 0;
+			while ((found < NAMES) && strcmp(names[found], names[idx])) { found++; }
+			ok &= (found == idx);
+		}
+		s64 t5 = CKLBBenchmark::now();
+		timeInsert	+= t1 - t0;
+		timeHit		+= t2 - t1;
+		timeSuffix	+= t3 - t2;
+		timeMiss	+= t4 - t3;
+		timeWalk	+= t5 - t4;
+
+		for (u32 n = 0; ok && (n < NAMES); n++) {
+			bool added = true;
+			ok = (offsets[n] != CKLBNameTable::NOT_FOUND)
+				&& (strcmp(table.getName(offsets[n]), names[n]) == 0)
+				&& (table.insert(variants[n], strlen(variants[n]), &added) == offsets[n]) && !added;
+		}
+		ok = ok && (table.getCount() == NAMES);
+	}
+	CKLBBenchmark::report("insert", loops * NAMES, timeInsert);
+	CKLBBenchmark::report("find (folded spelling)", loops * NAMES, timeHit);
+	CKLBBenchmark::report("find name + suffix", loops * NAMES, timeSuffix);
+	CKLBBenchmark::report("find miss", loops * NAMES, timeMiss);
+	CKLBBenchmark::report("linear strcmp walk", loops * WALKS, timeWalk);
+
+	if (ok) {
+		CKLBNameTable exact(false);
+		u32 offset = exact.insert(names[0], strlen(names[0]));
+		ok = (exact.find(names[0], strlen(names[0])) == offset)
+			&& (exact.find(variants[0], strlen(variants[0])) == CKLBNameTable::NOT_FOUND);
+	}
+	if (!ok) {
+		CPFInterface::getInstance().platform().logging("[BENCH] NAMETABLE lookup returned a wrong offset\n");
+	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchNameTable("NAMETABLE", benchNameTable);
+#endif
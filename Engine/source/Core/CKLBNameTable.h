@@ -0,0 +1,65 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __CKLBNAMETABLE_H__
+#define __CKLBNAMETABLE_H__
+
+#include "BaseType.h"
+
+/*!
+* \class CKLBNameTable
+* \brief String pool with an open addressing hash index (FNV-1a).
+*
+* Names are copied once, zero terminated, and referenced by their offset in the pool.
+* insert() indexes a name, store() only copies it (not searchable).
+* With folding, lookups are case insensitive and '\\' matches '/' like the Windows file system.
+* Not thread safe.
+*/
+class CKLBNameTable {
+public:
+	enum { NOT_FOUND = 0xFFFFFFFF };
+
+	CKLBNameTable(bool fold);
+	~CKLBNameTable();
+
+	// Offset of name + suffix (suffix may be NULL), NOT_FOUND if absent.
+	u32			find		(const char* name, u32 len, const char* suffix = NULL, u32 suffixLen = 0) const;
+
+	// Offset of the name, added if new (*pAdded is set then). NOT_FOUND if out of memory.
+	u32			insert		(const char* name, u32 len, bool* pAdded = NULL);
+
+	// Copy into the pool without indexing. NOT_FOUND if out of memory.
+	u32			store		(const char* name, u32 len);
+
+	inline
+	const char*	getName		(u32 offset) const	{ return m_pool + offset; }
+	inline u32	getCount	() const			{ return m_count; }
+
+	void		clear		();
+private:
+	u32			hash		(const char* name, u32 len, const char* suffix, u32 suffixLen) const;
+	bool		equal		(const char* entry, const char* name, u32 len, const char* suffix, u32 suffixLen) const;
+	bool		grow		();
+
+	u32*		m_slots;		// Offset + 1 in m_pool, 0 : empty slot
+	u32			m_slotMax;		// Power of 2
+	u32			m_count;
+	char*		m_pool;
+	u32			m_poolSize;
+	u32			m_poolMax;
+	bool		m_fold;
+};
+
+#endif // __CKLBNAMETABLE_H__
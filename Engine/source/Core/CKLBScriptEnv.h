@@ -135,6 +135,8 @@ public:
 
 	// NetAPI
 	bool call_netAPI_callback		(const char* funcName, CKLBObjectScriptable* obj, int uniq, int msg, int status, CKLBJsonItem * pRoot);
+	// Same with raw JSON response : validJson is false (and no call done) if it can not be parsed.
+	bool call_netAPI_callback		(const char* funcName, CKLBObjectScriptable* obj, int uniq, int msg, int status, const char* json, u32 jsonLen, bool& validJson);
 	void call_netAPI_versionUp		(const char* funcName, CKLBObjectScriptable* obj, const char* clientVer, const char* serverVer);
 
 	void call_Mdl					(const char* callback, const char* filename, const char* url);
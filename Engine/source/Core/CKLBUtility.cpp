@@ -19,6 +19,7 @@
 #include "CKLBWebViewNode.h"
 #include "CompositeManagement.h"
 #include "CKLBScriptEnv.h"
+#include "CKLBBenchmark.h"
 #include <string.h>
 
 void
@@ -1000,12 +1001,12 @@ CKLBUtility::lua2json_rec(CLuaState& lua, JSON_BUF * jsonBuf)
 }
 
 // JSON文字列をLuaテーブルに変換し、Luaスタックに積む
-void
+bool
 CKLBUtility::json2lua(CLuaState& lua, const char * json, u32 json_size)
 {
-	CKLBJsonItem * pRoot = CKLBJsonItem::ReadJsonData(json, json_size);
-	jsonItem2lua(lua, pRoot);
-	KLBDELETE(pRoot);
+	CKLBJsonLuaBuilder builder(lua);
+	u32 size = (!json_size) ? strlen(json) : json_size;
+	return builder.feed(json, size) && builder.finish();
 }
 
 // CKLBJsonItemのツリーをLuaテーブルに変換し、Luaスタックに積む
@@ -1017,6 +1018,213 @@ CKLBUtility::jsonItem2lua(CLuaState& lua, CKLBJsonItem * pRoot)
 	}
 }
 
+// ------------------- Streaming JSON -> Lua ------------------
+
+// Table size hints are only given by binary JSON : do not trust them blindly.
+#define JSON_LUA_MAX_HINT	(65536)
+
+CKLBJsonLuaBuilder::CKLBJsonLuaBuilder(CLuaState& lua)
+: m_lua		(lua)
+, m_parser	(NULL)
+, m_levels	(NULL)
+, m_depth	(0)
+, m_maxDepth(0)
+, m_base	(lua.numArgs())
+, m_done	(false)
+{
+	static yajl_callbacks callbacks = { 
+		CKLBJsonLuaBuilder::read_null,  
+		CKLBJsonLuaBuilder::read_boolean,  
+		CKLBJsonLuaBuilder::read_int,  
+		CKLBJsonLuaBuilder::read_double,  
+		null,  
+		CKLBJsonLuaBuilder::read_string,  
+		CKLBJsonLuaBuilder::read_start_map,  
+		CKLBJsonLuaBuilder::read_map_key,  
+		CKLBJsonLuaBuilder::read_end_map,  
+		CKLBJsonLuaBuilder::read_start_array,  
+		CKLBJsonLuaBuilder::read_end_array
+	};
+
+	yajl_handle hand = yajl_alloc(&callbacks, NULL, this);
+	if (hand) {
+		yajl_config(hand, yajl_allow_comments, 1);
+	}
+	m_parser = hand;
+}
+
+CKLBJsonLuaBuilder::~CKLBJsonLuaBuilder()
+{
+	if (!m_done) {
+		// Incomplete or failed : remove partial tables.
+		abort();
+	}
+	if (m_parser) {
+		yajl_free((yajl_handle)m_parser);
+	}
+	KLBDELETEA(m_levels);
+}
+
+void
+CKLBJsonLuaBuilder::abort()
+{
+	m_lua.setTop(m_base);
+	m_depth = 0;
+}
+
+bool
+CKLBJsonLuaBuilder::feed(const char * json, u32 size)
+{
+	if (!m_parser || m_done) { return false; }
+
+	if (yajl_parse((yajl_handle)m_parser, (const unsigned char *)json, size) != yajl_status_ok) {
+		abort();
+		return false;
+	}
+	return true;
+}
+
+bool
+CKLBJsonLuaBuilder::finish()
+{
+	if (!m_parser || m_done) { return false; }
+
+	if ((yajl_complete_parse((yajl_handle)m_parser) != yajl_status_ok) 
+	||	(m_depth != 0) || (m_lua.numArgs() != m_base + 1)) {
+		abort();
+		return false;
+	}
+	m_done = true;
+	return true;
+}
+
+bool
+CKLBJsonLuaBuilder::openTable(bool isArray, unsigned int sizeHint)
+{
+	// Table + key of each level.
+	if (!m_lua.checkStack(3)) { return false; }
+
+	if (m_depth == m_maxDepth) {
+		u32 newMax = m_maxDepth ? m_maxDepth * 2 : 16;
+		LEVEL* pLevels = KLBNEWA(LEVEL, newMax);
+		if (!pLevels) { return false; }
+		if (m_levels) {
+			memcpy(pLevels, m_levels, m_depth * sizeof(LEVEL));
+			KLBDELETEA(m_levels);
+		}
+		m_levels	= pLevels;
+		m_maxDepth	= newMax;
+	}
+
+	// Text JSON gives no size (-1).
+	int hint = (sizeHint <= JSON_LUA_MAX_HINT) ? (int)sizeHint : 0;
+	m_lua.tableNew(isArray ? hint : 0, isArray ? 0 : hint);
+
+	LEVEL& level	= m_levels[m_depth++];
+	level.index		= 1;
+	level.isArray	= isArray;
+	return true;
+}
+
+bool
+CKLBJsonLuaBuilder::closeTable()
+{
+	if (!m_depth) { return false; }
+	m_depth--;
+	return setValue();
+}
+
+bool
+CKLBJsonLuaBuilder::setValue()
+{
+	if (!m_depth) {
+		// Root value : stays on the stack.
+		return true;
+	}
+
+	LEVEL& level = m_levels[m_depth - 1];
+	if (level.isArray) {
+		// [table][value]
+		m_lua.tableRawSetIndex(level.index++);
+	} else {
+		// [table][key][value]
+		m_lua.tableRawSet();
+	}
+	return true;
+}
+
+int
+CKLBJsonLuaBuilder::read_null(void * ctx)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retPointer(0);
+	return pBuilder->setValue();
+}
+
+int
+CKLBJsonLuaBuilder::read_boolean(void * ctx, int boolean)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retBoolean(boolean != 0);
+	return pBuilder->setValue();
+}
+
+int
+CKLBJsonLuaBuilder::read_int(void * ctx, long long integerVal)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retInt((int)integerVal);	// Same as CKLBJsonItem::getInt()
+	return pBuilder->setValue();
+}
+
+int
+CKLBJsonLuaBuilder::read_double(void * ctx, double doubleVal)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retDouble(doubleVal);
+	return pBuilder->setValue();
+}
+
+int
+CKLBJsonLuaBuilder::read_string(void * ctx, const unsigned char * stringVal, size_t stringLen, int /*cte_pool*/)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retString((const char *)stringVal, stringLen);
+	return pBuilder->setValue();
+}
+
+int
+CKLBJsonLuaBuilder::read_start_map(void * ctx, unsigned int size)
+{
+	return ((CKLBJsonLuaBuilder *)ctx)->openTable(false, size);
+}
+
+int
+CKLBJsonLuaBuilder::read_map_key(void * ctx, const unsigned char * stringVal, size_t stringLen, int /*cte_pool*/)
+{
+	CKLBJsonLuaBuilder * pBuilder = (CKLBJsonLuaBuilder *)ctx;
+	pBuilder->m_lua.retString((const char *)stringVal, stringLen);
+	return 1;
+}
+
+int
+CKLBJsonLuaBuilder::read_end_map(void * ctx)
+{
+	return ((CKLBJsonLuaBuilder *)ctx)->closeTable();
+}
+
+int
+CKLBJsonLuaBuilder::read_start_array(void * ctx, unsigned int size)
+{
+	return ((CKLBJsonLuaBuilder *)ctx)->openTable(true, size);
+}
+
+int
+CKLBJsonLuaBuilder::read_end_array(void * ctx)
+{
+	return ((CKLBJsonLuaBuilder *)ctx)->closeTable();
+}
+
 void
 CKLBUtility::json2lua_rec(CLuaState& lua, CKLBJsonItem * pItem)
 {
@@ -1024,25 +1232,27 @@ CKLBUtility::json2lua_rec(CLuaState& lua, CKLBJsonItem * pItem)
 	{
 	case CKLBJsonItem::J_MAP:	// 文字列indexの連想配列
 		{
-			lua.tableNew();
+			// Size is known from the tree : no rehash while filling.
+			lua.checkStack(4);
+			lua.tableNew(0, pItem->childCount());
 			CKLBJsonItem * child = pItem->child();
 			while(child) {
 				lua.retString(child->key());
 				json2lua_rec(lua, child);
-				lua.tableSet();
+				lua.tableRawSet();
 				child = child->next();
 			}
 		}
 		break;
 	case CKLBJsonItem::J_ARRAY:	// 数値indexの連想配列
 		{
-			lua.tableNew();
+			lua.checkStack(4);
+			lua.tableNew(pItem->childCount(), 0);
 			CKLBJsonItem * child = pItem->child();
 			int index = 1;
 			while(child) {
-				lua.retInt(index);
 				json2lua_rec(lua, child);
-				lua.tableSet();
+				lua.tableRawSetIndex(index);
 				child = child->next();
 				index++;
 			}
@@ -1132,3 +1342,101 @@ CKLBUtility::URLencode(char * retbuf, int maxlen, const char ** postForm)
 	*ptr = 0;
 	return basebuf;
 }
+
+#ifdef INTERNAL_BENCH
+#include "CKLBLuaEnv.h"
+
+// Same content, compared key by key (values at absolute stack positions a and b).
+static bool luaDeepEqual(CLuaState& lua, int a, int b) {
+	int type = lua.getType(a);
+	if (type != lua.getType(b)) { return false; }
+
+	switch (type) {
+	case LUA_TNUMBER:			return lua.getDouble(a) == lua.getDouble(b);
+	case LUA_TBOOLEAN:			return lua.getBool(a) == lua.getBool(b);
+	case LUA_TSTRING:			return strcmp(lua.getString(a), lua.getString(b)) == 0;
+	case LUA_TLIGHTUSERDATA:	return lua.getPointer(a) == lua.getPointer(b);
+	case LUA_TTABLE:
+		{
+			int countA = 0;
+			lua.retNil();
+			while (lua.tableNext(a)) {
+				// [key][valueA]
+				int top = lua.numArgs();
+				countA++;
+				lua.retValue(top - 1);
+				lua.tableGet(b);
+				bool same = luaDeepEqual(lua, top, top + 1);
+				lua.pop(2);
+				if (!same) {
+					lua.pop(1);
+					return false;
+				}
+			}
+
+			int countB = 0;
+			lua.retNil();
+			while (lua.tableNext(b)) {
+				countB++;
+				lua.pop(1);
+			}
+			return countA == countB;
+		}
+	default:
+		return false;
+	}
+}
+
+// JSON -> Lua on a 256 record document (maps, arrays, int, double, bool, null) : CKLBJsonItem tree
+// then jsonItem2lua, against the direct builder used by json2lua. Both tables must be equal,
+// and invalid JSON must fail with the Lua stack restored.
+static bool benchJson2Lua(u32 loops) {
+	const u32 records = 256;
+	char* json = KLBNEWA(char, records * 160 + 4);
+	if (!json) { return false; }
+
+	u32 size = 0;
+	json[size++] = '[';
+	for (u32 n = 0; n < records; n++) {
+		size += sprintf(&json[size], "%s{\"id\":%i,\"name\":\"item_%i\",\"score\":%i.5,\"ok\":%s,\"tags\":[1,2,%i],\"none\":null,\"sub\":{\"x\":%i,\"y\":\"s\"}}",
+						n ? "," : "", n, n, n, (n & 1) ? "true" : "false", n, n);
+	}
+	json[size++] = ']';
+	json[size]   = 0;
+
+	CLuaState& lua	= CKLBLuaEnv::getInstance().getState();
+	int base		= lua.numArgs();
+	bool ok			= true;
+
+	s64 t0 = CKLBBenchmark::now();
+	for (u32 l = 0; l < loops; l++) {
+		CKLBJsonItem* pRoot = CKLBJsonItem::ReadJsonData(json, size);
+		ok &= (pRoot != NULL);
+		CKLBUtility::jsonItem2lua(lua, pRoot);
+		KLBDELETE(pRoot);
+		lua.setTop(base);
+	}
+	s64 t1 = CKLBBenchmark::now();
+	for (u32 l = 0; l < loops; l++) {
+		ok &= CKLBUtility::json2lua(lua, json, size);
+		lua.setTop(base);
+	}
+	s64 t2 = CKLBBenchmark::now();
+	CKLBBenchmark::report("JSON tree + jsonItem2lua", loops, t1 - t0);
+	CKLBBenchmark::report("json2lua (direct)", loops, t2 - t1);
+
+	CKLBJsonItem* pRoot = CKLBJsonItem::ReadJsonData(json, size);
+	CKLBUtility::jsonItem2lua(lua, pRoot);
+	KLBDELETE(pRoot);
+	ok = ok && CKLBUtility::json2lua(lua, json, size) && (lua.numArgs() == base + 2) && luaDeepEqual(lua, base + 1, base + 2);
+	lua.setTop(base);
+
+	ok = ok && (!CKLBUtility::json2lua(lua, json, size / 2)) && (lua.numArgs() == base);
+	lua.setTop(base);
+
+	KLBDELETEA(json);
+	return ok;
+}
+
+static CKLBBenchmark gBenchJson2Lua("JSON2LUA", benchJson2Lua);
+#endif
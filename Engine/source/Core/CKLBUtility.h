@@ -115,7 +115,8 @@ public:
 	static const char * lua2BJson(CLuaState& lua, u32& streamSize, JSON_REPLACE * arrReplace = NULL);
 
 	// JSON文字列をLuaテーブルに変換し、Luaスタックに積む
-	static void json2lua(CLuaState& lua, const char * json, u32 json_size = 0);
+	// Return false (nothing pushed) if the JSON is invalid.
+	static bool json2lua(CLuaState& lua, const char * json, u32 json_size = 0);
 
 	// CKLBJsonItem のツリーをLuaテーブルに変換し、Luaスタックに積む
 	static void jsonItem2lua(CLuaState& lua, CKLBJsonItem * pRoot);
@@ -156,4 +157,52 @@ private:
 	static const char * escape	(const char * string);
 };
 
+/*!
+* \class CKLBJsonLuaBuilder
+* \brief Streaming JSON to Lua converter
+* 
+* Parses JSON text (chunk by chunk if needed) and builds the Lua tables
+* directly on the Lua stack, without intermediate CKLBJsonItem tree.
+* On success, finish() leaves the root value on top of the stack.
+* On failure, the stack is restored to its state before parsing.
+*/
+class CKLBJsonLuaBuilder
+{
+public:
+	CKLBJsonLuaBuilder(CLuaState& lua);
+	~CKLBJsonLuaBuilder();
+
+	bool	feed	(const char * json, u32 size);
+	bool	finish	();
+private:
+	struct LEVEL {
+		int		index;		// Next array index, 0 for map.
+		bool	isArray;
+	};
+
+	bool	openTable	(bool isArray, unsigned int sizeHint);
+	bool	closeTable	();
+	bool	setValue	();
+	void	abort		();
+
+	CLuaState&	m_lua;
+	void	*	m_parser;
+	LEVEL	*	m_levels;
+	u32			m_depth;
+	u32			m_maxDepth;
+	int			m_base;
+	bool		m_done;
+
+	static int read_null		(void * ctx);
+	static int read_boolean		(void * ctx, int boolean);
+	static int read_int			(void * ctx, long long integerVal);
+	static int read_double		(void * ctx, double doubleVal);
+	static int read_string		(void * ctx, const unsigned char * stringVal, size_t stringLen, int cte_pool);
+	static int read_start_map	(void * ctx, unsigned int size);  
+	static int read_map_key		(void * ctx, const unsigned char * stringVal, size_t stringLen, int cte_pool);
+	static int read_end_map		(void * ctx);
+	static int read_start_array	(void * ctx, unsigned int size);
+	static int read_end_array	(void * ctx);
+};
+
 #endif // CKLBUtility_h
@@ -0,0 +1,179 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "CKLBWorkerPool.h"
+#include "CPFInterface.h"
+
+CKLBWorkerPool::CKLBWorkerPool(u32 workerCount)
+:m_workers		(NULL)
+,m_workerCount	(workerCount)
+,m_mutex		(NULL)
+,m_evDone		(NULL)
+,m_pending		(0)
+,m_quit			(false)
+,m_ready		(false)
+,m_failed		(false)
+,m_pFunc		(NULL)
+,m_pCtx			(NULL)
+,m_jobCount		(0)
+,m_jobNext		(0)
+{
+}
+
+CKLBWorkerPool::~CKLBWorkerPool() {
+	release();
+}
+
+bool CKLBWorkerPool::start() {
+	if (m_ready || m_failed) {
+		return m_ready;
+	}
+	if (m_workerCount == 0) {
+		m_failed = true;
+		return false;
+	}
+
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	m_quit		= false;
+	m_pending	= 0;
+	m_workers	= KLBNEWA(SWorker, m_workerCount);
+	m_mutex		= m_workers	? pfif.allocMutex()		: NULL;
+	m_evDone	= m_mutex	? pfif.allocEventLock()	: NULL;
+	bool ok		= (m_evDone != NULL);
+	for (u32 n = 0; m_workers && (n < m_workerCount); n++) {
+		m_workers[n].pPool		= this;
+		m_workers[n].hThread	= NULL;
+		m_workers[n].evStart	= ok ? pfif.allocEventLock() : NULL;
+		ok = ok && m_workers[n].evStart;
+	}
+	for (u32 n = 0; ok && (n < m_workerCount); n++) {
+		m_workers[n].hThread = pfif.createThread(workerMain, &m_workers[n]);
+		ok = (m_workers[n].hThread != NULL);
+	}
+
+	m_ready = true;	// release() only stops what was created.
+	if (!ok) {
+		release();
+		m_failed = true;
+		return false;
+	}
+	return true;
+}
+
+void CKLBWorkerPool::release() {
+	if (!m_ready) {
+		return;
+	}
+
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+
+	u32 running = 0;
+	for (u32 n = 0; m_workers && (n < m_workerCount); n++) {
+		if (m_workers[n].hThread) { running++; }
+	}
+
+	if (running) {
+		m_pending	= running;
+		m_quit		= true;
+		for (u32 n = 0; n < m_workerCount; n++) {
+			if (m_workers[n].hThread) {
+				pfif.eventWakeup(m_workers[n].evStart);
+			}
+		}
+		waitPending();
+	}
+
+	for (u32 n = 0; m_workers && (n < m_workerCount); n++) {
+		if (m_workers[n].hThread)	{ pfif.deleteThread	(m_workers[n].hThread);	}
+		if (m_workers[n].evStart)	{ pfif.freeEventLock(m_workers[n].evStart);	}
+	}
+	if (m_evDone)	{ pfif.freeEventLock(m_evDone);	}
+	if (m_mutex)	{ pfif.freeMutex(m_mutex);		}
+	KLBDELETEA(m_workers);
+
+	m_workers	= NULL;
+	m_evDone	= NULL;
+	m_mutex		= NULL;
+	m_ready		= false;
+}
+
+void CKLBWorkerPool::run(JOB_FUNC pFunc, void* pCtx, u32 count) {
+	m_pFunc		= pFunc;
+	m_pCtx		= pCtx;
+	m_jobCount	= count;
+	m_jobNext	= 0;
+
+	if ((count > 1) && start()) {
+		IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+		m_pending = m_workerCount;
+		for (u32 n = 0; n < m_workerCount; n++) {
+			pfif.eventWakeup(m_workers[n].evStart);
+		}
+		runJobs();
+		waitPending();
+	} else {
+		for (u32 n = 0; n < count; n++) {
+			pFunc(pCtx, n);
+		}
+	}
+
+	m_pFunc		= NULL;
+	m_pCtx		= NULL;
+}
+
+void CKLBWorkerPool::runJobs() {
+	for (;;) {
+		MUTEX_LOCK(m_mutex);
+		u32 idx = m_jobNext++;
+		MUTEX_UNLOCK(m_mutex);
+		if (idx >= m_jobCount) {
+			break;
+		}
+		m_pFunc(m_pCtx, idx);
+	}
+}
+
+void CKLBWorkerPool::waitPending() {
+	// A wakeup left over from a previous run only costs one more check.
+	IPlatformRequest& pfif = CPFInterface::getInstance().platform();
+	for (;;) {
+		pfif.mutexLock(m_mutex);
+		u32 pending = m_pending;
+		pfif.mutexUnlock(m_mutex);
+		if (pending == 0) {
+			break;
+		}
+		pfif.eventSleep(m_evDone);
+	}
+}
+
+/*static*/ s32 CKLBWorkerPool::workerMain(void* /*hThread*/, void* data) {
+	SWorker* pWorker		= (SWorker*)data;
+	CKLBWorkerPool* pPool	= pWorker->pPool;
+	IPlatformRequest& pfif	= CPFInterface::getInstance().platform();
+	bool quit				= false;
+	while (!quit) {
+		pfif.eventSleep(pWorker->evStart);
+		quit = pPool->m_quit;
+		if (!quit) {
+			pPool->runJobs();
+		}
+		pfif.mutexLock(pPool->m_mutex);
+		pPool->m_pending--;
+		pfif.mutexUnlock(pPool->m_mutex);
+		pfif.eventWakeup(pPool->m_evDone);
+	}
+	return 0;
+}
@@ -0,0 +1,74 @@
+﻿/* 
+   Copyright 2013 KLab Inc.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __CKLBWORKERPOOL_H__
+#define __CKLBWORKERPOOL_H__
+
+#include "BaseType.h"
+
+/*!
+* \class CKLBWorkerPool
+* \brief Small fixed set of worker threads running indexed jobs.
+*
+* run() calls pFunc(pCtx, index) for every index in [0, count), spread over the
+* workers and the calling thread, and returns once every job is done.
+* Threads are created by the first run() ; if they can not be created, jobs
+* simply run on the calling thread.
+*
+* Workers sleep on their own event lock and report through a pending counter
+* guarded by the pool mutex, so a wakeup is never needed twice. The handshake
+* relies on event locks keeping a wakeup sent before the matching eventSleep()
+* (see IPlatformRequest::eventSleep).
+*/
+class CKLBWorkerPool {
+public:
+	typedef void (*JOB_FUNC)(void* pCtx, u32 index);
+
+	CKLBWorkerPool(u32 workerCount);
+	~CKLBWorkerPool();
+
+	void	run			(JOB_FUNC pFunc, void* pCtx, u32 count);
+	void	release		();
+
+	inline u32	getWorkerCount	() const	{ return m_workerCount;	}
+private:
+	struct SWorker {
+		CKLBWorkerPool*	pPool;
+		void*			hThread;
+		void*			evStart;
+	};
+
+	bool	start		();
+	void	runJobs		();
+	void	waitPending	();
+	static
+	s32		workerMain	(void* hThread, void* data);
+
+	SWorker*		m_workers;
+	u32				m_workerCount;
+	void*			m_mutex;
+	void*			m_evDone;
+	volatile u32	m_pending;
+	volatile bool	m_quit;
+	bool			m_ready;
+	bool			m_failed;
+
+	JOB_FUNC		m_pFunc;
+	void*			m_pCtx;
+	u32				m_jobCount;
+	u32				m_jobNext;
+};
+
+#endif
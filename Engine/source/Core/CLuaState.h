@@ -131,16 +131,24 @@ public:
     inline void retFloat	(float val)			{ lua_pushnumber(m_L, (lua_Number)val);		}
     inline void retDouble	(double val)		{ lua_pushnumber(m_L, (lua_Number)val);		}
     inline void retString	(const char * val)	{ lua_pushstring(m_L, val);					}
+    inline void retString	(const char * val, size_t len)	{ lua_pushlstring(m_L, val, len);	}
     inline void retPointer	(void * ptr)		{ lua_pushlightuserdata(m_L, ptr);			}
     inline void retGlobal	(const char * val)	{ lua_getglobal(m_L, val);					}
 
 	inline void retValue	(int pos)			{ lua_pushvalue(m_L, pos);					}
 
 	inline void tableNew	()					{ lua_newtable(m_L);						}
+	inline void tableNew	(int narr, int nrec){ lua_createtable(m_L, narr, nrec);			}
 	inline void tableSet	(int pos = -3)		{ lua_settable(m_L, pos);					}
+	inline void tableRawSet	(int pos = -3)		{ lua_rawset(m_L, pos);						}
+	inline void tableRawSetIndex(int index, int pos = -2)	{ lua_rawseti(m_L, pos, index);	}
+	inline void tableRawGetIndex(int index, int pos = -1)	{ lua_rawgeti(m_L, pos, index);	}
+	inline int  tableLength	(int pos = -1)		{ return (int)lua_rawlen(m_L, pos);			}
 	inline void tableGet	(int pos = -2)		{ lua_gettable(m_L, pos);					}
 	inline int  tableNext	(int pos = -2)		{ return lua_next(m_L, pos);				}
 	inline void pop			(int num)			{ lua_pop(m_L, num);						}
+	inline void setTop		(int top)			{ lua_settop(m_L, top);						}
+	inline bool checkStack	(int extra)			{ return lua_checkstack(m_L, extra) != 0;	}
 	inline void setGlobal	(const char * name) { lua_setglobal(m_L, name);					}
 	inline void getGlobal	(const char * name) { lua_getglobal(m_L, name);					}
 	inline int  getType		(int pos = -1)		{ return lua_type(m_L, pos);				}
@@ -17,3 +17,5 @@
 
 ITmpFile::ITmpFile() {}
 ITmpFile::~ITmpFile() {}
+
+void ITmpFile::reserve(size_t /*size*/) {}
@@ -18,6 +18,7 @@
 #include "CKLBDatabase.h"
 #include "CPFInterface.h"
 #include "encryptFile.h"
+#include "CKLBBenchmark.h"
 
 // Get a private global symbol owning all the file systems of SQLite.
 extern "C" {
@@ -32,6 +33,28 @@ int (*gOpenDefaultSQLite)	(sqlite3_vfs*, const char *zName, sqlite3_file*,int fl
 
 #define	getFileDecrypt(a)			(WrapperFileDecrypt*)(&(((unsigned char*)a)[gBaseSizeOsFile]))
 
+/**
+	Decrypted read-only copy of a whole DB file.
+	Shared by every read-only connection opened on the same full path.
+ */
+struct DB_IMAGE {
+	DB_IMAGE*			next;
+	char*				path;		// Full path as given to SQLite.
+	u8*					data;		// Decrypted content (malloc), without header.
+	u32					size;
+	u32					reserved;	// Bytes counted against the budget.
+	u32					refCount;	// Open SQLite files on the image.
+	void*				hThread;	// Background loader, NULL when synchronous.
+	volatile bool		loading;
+	bool				ready;
+	bool				pinned;		// Kept alive by preloadImage().
+};
+
+static DB_IMAGE*		gm_imageList	= NULL;
+static void*			gm_imageMutex	= NULL;
+static u32				gm_imageBytes	= 0;
+static u32				gm_imageBudget	= 32 * 1024 * 1024;
+
 struct WrapperFileDecrypt {
 	// Decrypt
 	// File ptr
@@ -41,8 +64,137 @@ struct WrapperFileDecrypt {
 	void*				m_file;
 	bool				m_no_op;
 	int					m_hasHeader;
+	DB_IMAGE*			m_image;	// Non NULL : read from memory image.
 };
 
+static void imageLock() {
+	if (gm_imageMutex) { CPFInterface::getInstance().platform().mutexLock(gm_imageMutex); }
+}
+
+static void imageUnlock() {
+	if (gm_imageMutex) { CPFInterface::getInstance().platform().mutexUnlock(gm_imageMutex); }
+}
+
+static DB_IMAGE* findImage(const char* fullPath) {
+	DB_IMAGE* pImage = gm_imageList;
+	while (pImage) {
+		if (strcmp(pImage->path, fullPath) == 0) {
+			return pImage;
+		}
+		pImage = pImage->next;
+	}
+	return NULL;
+}
+
+// Must be called with lock held, image must not be loading anymore.
+static void freeImage(DB_IMAGE* pImage) {
+	DB_IMAGE** ppLink = &gm_imageList;
+	while (*ppLink) {
+		if (*ppLink == pImage) {
+			*ppLink = pImage->next;
+			break;
+		}
+		ppLink = &(*ppLink)->next;
+	}
+	gm_imageBytes -= pImage->reserved;
+	if (pImage->data) {
+		free(pImage->data);
+	}
+	KLBDELETEA(pImage->path);
+	KLBDELETE(pImage);
+}
+
+// Must be called with lock held.
+static void tryFreeImage(DB_IMAGE* pImage) {
+	if (!pImage->pinned && !pImage->loading && !pImage->refCount && !pImage->hThread) {
+		freeImage(pImage);
+	}
+}
+
+// Release finished loader threads and unused images. Main thread only.
+static void reapImages() {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	imageLock();
+	DB_IMAGE* pImage = gm_imageList;
+	while (pImage) {
+		DB_IMAGE* pNext = pImage->next;
+		s32 status;
+		if (pImage->hThread && !pImage->loading && !pltf.watchThread(pImage->hThread, &status)) {
+			pltf.deleteThread(pImage->hThread);
+			pImage->hThread = NULL;
+		}
+		tryFreeImage(pImage);
+		pImage = pNext;
+	}
+	imageUnlock();
+}
+
+/**
+	Read and decrypt a complete DB file in one pass.
+	Same key stream as fEncryptRead : offset 0 is the first byte after the header.
+ */
+static u8* loadImage(const char* fullPath, u32* pSize) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	void* f = pltf.ifopen(fullPath, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	CDecryptBaseClass decrypt;
+	u8 header[16];
+	pltf.ifread(header,1,16,f);
+	decrypt.decryptSetup((const u8*)fullPath, header);
+
+	pltf.ifseek(f, 0, SEEK_END);
+	s32 size = pltf.iftell(f) - decrypt.m_header_size;
+	pltf.ifseek(f, decrypt.m_header_size, SEEK_SET);
+
+	u8* buff = (size > 0) ? (u8*)malloc(size) : NULL;
+	if (buff) {
+		u32 readSize = pltf.ifread(buff, 1, size, f);
+		if (readSize == (u32)size) {
+			decrypt.gotoOffset(0);
+			decrypt.decryptBlck(buff, size);
+			*pSize = size;
+		} else {
+			free(buff);
+			buff = NULL;
+		}
+	}
+	pltf.ifclose(f);
+	return buff;
+}
+
+static void loadImageInto(DB_IMAGE* pImage) {
+	u32 size = 0;
+	u8* data = loadImage(pImage->path, &size);
+
+	imageLock();
+	pImage->data	= data;
+	pImage->size	= size;
+	pImage->ready	= (data != NULL);
+	pImage->loading	= false;
+	imageUnlock();
+}
+
+static s32 imageLoaderThread(void* /*hThread*/, void* data) {
+	loadImageInto((DB_IMAGE*)data);
+	return 0;
+}
+
+// Return a ready image for the path with an extra reference, or NULL.
+static DB_IMAGE* acquireImage(const char* fullPath) {
+	imageLock();
+	DB_IMAGE* pImage = findImage(fullPath);
+	if (pImage && pImage->ready) {
+		pImage->refCount++;
+	} else {
+		pImage = NULL;
+	}
+	imageUnlock();
+	return pImage;
+}
+
 // === SQLite OS Methods ===
 int fEncryptOpen					(sqlite3_vfs*, const char *zName, sqlite3_file*, int flags, int *pOutFlags);
 
@@ -68,7 +220,14 @@ int fEncryptShmUnmap				(sqlite3_file*, int deleteFlag);
 int fEncryptClose					(sqlite3_file* file)
 {
 	WrapperFileDecrypt* fileDecrypt = getFileDecrypt(file);
-	if (!fileDecrypt->m_no_op) {
+	if (fileDecrypt->m_image) {
+		imageLock();
+		DB_IMAGE* pImage = fileDecrypt->m_image;
+		pImage->refCount--;
+		tryFreeImage(pImage);
+		imageUnlock();
+		fileDecrypt->m_image = NULL;
+	} else if (!fileDecrypt->m_no_op) {
 		CPFInterface::getInstance().platform().ifclose(fileDecrypt->m_file);
 	}
 
@@ -80,7 +239,20 @@ int fEncryptRead					(sqlite3_file* file, void* buff, int iAmt, sqlite3_int64 iO
 {
 	WrapperFileDecrypt* fileDecrypt = getFileDecrypt(file);
 
-	if (!fileDecrypt->m_no_op) {
+	if (fileDecrypt->m_image) {
+		const DB_IMAGE* pImage = fileDecrypt->m_image;
+		u32 readSize = 0;
+		if (iOfst < pImage->size) {
+			readSize = pImage->size - (u32)iOfst;
+			if (readSize > (u32)iAmt) { readSize = iAmt; }
+			memcpy(buff, &pImage->data[iOfst], readSize);
+		}
+
+		if (readSize < (u32)iAmt) {
+			memset(&((char*)buff)[readSize], 0, iAmt-readSize);
+			return SQLITE_IOERR_SHORT_READ;
+		}
+	} else if (!fileDecrypt->m_no_op) {
 		fileDecrypt->m_decrypt.gotoOffset((u32)iOfst);
 
 		IPlatformRequest& pltf = CPFInterface::getInstance().platform();
@@ -108,6 +280,11 @@ int fEncryptWrite					(sqlite3_file* file, const void* data, int iAmt, sqlite3_i
 {
 	WrapperFileDecrypt* fileDecrypt = getFileDecrypt(file);
 
+	if (fileDecrypt->m_image) {
+		// Memory images are read-only.
+		return SQLITE_READONLY;
+	}
+
 	if (!fileDecrypt->m_no_op) {
 		IPlatformRequest& pltf = CPFInterface::getInstance().platform();
 		int err = pltf.ifseek(fileDecrypt->m_file, (long)(iOfst + fileDecrypt->m_decrypt.m_header_size), SEEK_SET);
@@ -155,7 +332,9 @@ int fEncryptFileSize				(sqlite3_file* file, sqlite3_int64 *pSize)
 {
 	if (pSize) {
 		WrapperFileDecrypt* fileDecrypt = getFileDecrypt(file);
-		if (!fileDecrypt->m_no_op) {
+		if (fileDecrypt->m_image) {
+			*pSize = fileDecrypt->m_image->size;
+		} else if (!fileDecrypt->m_no_op) {
 			IPlatformRequest& pltf = CPFInterface::getInstance().platform();
 			int err = pltf.ifseek(fileDecrypt->m_file, 0, SEEK_END);
 			if (err == 0) {
@@ -373,6 +552,20 @@ int fEncryptOpen					(sqlite3_vfs* vfs, const char *zName, sqlite3_file* file, i
 	// Also call the original open.
 	// Decided to DO NOT call the gOpenDefaultSQLite(vfs, zName, file, flags, pOutFlags);
 	file->pMethods = &gSQLiteEncryptIO; // Patch here because table is patch in original Open.
+	fileDecrypt->m_no_op	= false;
+	fileDecrypt->m_image	= NULL;
+
+	// Read-only main DB already decrypted in memory : no file access at all.
+	if (isReadonly && (eType == SQLITE_OPEN_MAIN_DB)) {
+		DB_IMAGE* pImage = acquireImage(zName);
+		if (pImage) {
+			fileDecrypt->m_image	= pImage;
+			fileDecrypt->m_file		= NULL;
+			fileDecrypt->m_size		= pImage->size;
+			return SQLITE_OK;
+		}
+	}
+
 	// TODO enable decrypt : 
 	const char* openMode;
 	if (isReadonly) {
@@ -438,6 +631,8 @@ static bool initEncryptedVFS() {
 		// 2.2 Patch the fileSystem vfs->szOsFile, add our own structure. (need to keep original because we wrap open)
 		gBaseSizeOsFile		= (gVfsList->szOsFile + 7) & 0xFFFFFFF8;	// Align 8 byte.
 		gVfsList->szOsFile	= ((gBaseSizeOsFile + sizeof(WrapperFileDecrypt)) + 7) & 0xFFFFFFF8;
+
+		gm_imageMutex		= CPFInterface::getInstance().platform().allocMutex();
 		return true;
 	} else {
 		return false;
@@ -498,6 +693,133 @@ bool CKLBDatabase::init(const char* dbFile, int flags) {
 	}
 }
 
+/*static*/
+bool CKLBDatabase::preloadImage(const char* dbAsset, bool async) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	if (!pltf.useEncryption()) {
+		// Plain files are already served by the OS cache.
+		return false;
+	}
+	initEncryptedVFS();
+	reapImages();
+
+	const char* fullPath = pltf.getFullPath(dbAsset);
+	if (!fullPath) {
+		return false;
+	}
+
+	imageLock();
+	DB_IMAGE* pImage = findImage(fullPath);
+	if (pImage) {
+		pImage->pinned = true;
+		imageUnlock();
+		delete[] fullPath;
+		return true;
+	}
+	imageUnlock();
+
+	// Check the budget with the file size before spending anything.
+	u32 fileSize = 0;
+	void* f = pltf.ifopen(fullPath, "rb");
+	if (f) {
+		pltf.ifseek(f, 0, SEEK_END);
+		fileSize = pltf.iftell(f);
+		pltf.ifclose(f);
+	}
+
+	bool res = false;
+	if (fileSize && (gm_imageBytes + fileSize <= gm_imageBudget)) {
+		pImage = KLBNEW(DB_IMAGE);
+		u32 len = strlen(fullPath);
+		char* path = KLBNEWA(char, len + 1);
+		if (pImage && path) {
+			memcpy(path, fullPath, len + 1);
+			pImage->path		= path;
+			pImage->data		= NULL;
+			pImage->size		= 0;
+			pImage->reserved	= fileSize;
+			pImage->refCount	= 0;
+			pImage->hThread		= NULL;
+			pImage->loading		= true;
+			pImage->ready		= false;
+			pImage->pinned		= true;
+
+			imageLock();
+			pImage->next		= gm_imageList;
+			gm_imageList		= pImage;
+			gm_imageBytes		+= fileSize;
+			imageUnlock();
+
+			if (async) {
+				pImage->hThread = pltf.createThread(imageLoaderThread, pImage);
+			}
+			if (!pImage->hThread) {
+				loadImageInto(pImage);
+			}
+			res = true;
+		} else {
+			KLBDELETEA(path);
+			KLBDELETE(pImage);
+		}
+	}
+
+	delete[] fullPath;
+	return res;
+}
+
+/*static*/
+void CKLBDatabase::releaseImage(const char* dbAsset) {
+	const char* fullPath = CPFInterface::getInstance().platform().getFullPath(dbAsset);
+	if (fullPath) {
+		imageLock();
+		DB_IMAGE* pImage = findImage(fullPath);
+		if (pImage) {
+			// Freed once the last connection closes and loader is done.
+			pImage->pinned = false;
+		}
+		imageUnlock();
+		delete[] fullPath;
+	}
+	reapImages();
+}
+
+/*static*/
+void CKLBDatabase::releaseAllImages() {
+	imageLock();
+	DB_IMAGE* pImage = gm_imageList;
+	while (pImage) {
+		pImage->pinned = false;
+		pImage = pImage->next;
+	}
+	imageUnlock();
+	reapImages();
+}
+
+/*static*/
+bool CKLBDatabase::isImageReady(const char* dbAsset) {
+	const char* fullPath = CPFInterface::getInstance().platform().getFullPath(dbAsset);
+	bool res = false;
+	if (fullPath) {
+		res = hasImage(fullPath);
+		delete[] fullPath;
+	}
+	return res;
+}
+
+/*static*/
+bool CKLBDatabase::hasImage(const char* fullPath) {
+	imageLock();
+	DB_IMAGE* pImage = findImage(fullPath);
+	bool res = pImage && pImage->ready;
+	imageUnlock();
+	return res;
+}
+
+/*static*/
+void CKLBDatabase::setImageBudget(u32 bytes) {
+	gm_imageBudget = bytes;
+}
+
 void CKLBDatabase::_release() {
 	if (m_dataBase) {
 		sqlite3_close(m_dataBase);
@@ -570,3 +892,128 @@ CKLBDatabase::CKLBDatabase()
 CKLBDatabase::~CKLBDatabase() {
 	_release();
 }
+
+#ifdef INTERNAL_BENCH
+#include "CKLBLuaDB.h"
+#include "CKLBLuaEnv.h"
+
+// Full scan of the first table of db : leaves [ok][rows] on the Lua stack.
+static bool scanFirstTable(CLuaState& lua, CKLBLuaDB& db, char* sql, u32 sqlSize) {
+	int base = lua.numArgs();
+	db.query(&lua, "SELECT name FROM sqlite_master WHERE type = 'table' LIMIT 1;");
+	bool ok = lua.isTable(base + 2) && (lua.tableLength(base + 2) == 1);
+	if (ok) {
+		lua.tableRawGetIndex(1, base + 2);
+		lua.retString("name");
+		lua.tableGet();
+		ok = lua.isString(-1);
+		if (ok) {
+			snprintf(sql, sqlSize, "SELECT * FROM \"%s\";", lua.getString(-1));
+		}
+	}
+	lua.setTop(base);
+	return ok;
+}
+
+// Same cells (all text from DB_query) in the row tables at a and b.
+static bool sameScan(CLuaState& lua, int a, int b) {
+	int count = lua.tableLength(a);
+	if ((count != lua.tableLength(b)) || (count == 0)) { return count == lua.tableLength(b); }
+
+	bool ok = true;
+	lua.tableRawGetIndex(1, a);
+	int firstRow = lua.numArgs();
+	lua.retNil();
+	while (ok && lua.tableNext(firstRow)) {
+		// [firstRow][column][value]
+		int top = lua.numArgs();
+		for (int n = 1; ok && (n <= count); n++) {
+			lua.tableRawGetIndex(n, a);
+			lua.retValue(top - 1);	lua.tableGet(top + 1);
+			lua.tableRawGetIndex(n, b);
+			lua.retValue(top - 1);	lua.tableGet(top + 3);
+			ok = (lua.isNil(top + 2) && lua.isNil(top + 4))
+			  || (lua.isString(top + 2) && lua.isString(top + 4) && !strcmp(lua.getString(top + 2), lua.getString(top + 4)));
+			lua.setTop(top);
+		}
+		lua.pop(1);
+	}
+	lua.setTop(firstRow - 1);
+	return ok;
+}
+
+// "BENCH DBIMAGE <loops> <db asset>" : full scan of the first table of an encrypted read-only DB,
+// streamed from the file (decrypt per page read), then from the preloaded memory image.
+// Both scans must return the same cells. An image already preloaded by the application is kept.
+static bool benchDBImage(u32 loops) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const char* asset = CKLBBenchmark::getArgument();
+	if (!asset) {
+		pltf.logging("[BENCH] DBIMAGE needs a DB asset path\n");
+		return true;
+	}
+
+	CLuaState& lua	= CKLBLuaEnv::getInstance().getState();
+	int base		= lua.numArgs();
+	bool appImage	= CKLBDatabase::isImageReady(asset);
+	bool ok			= true;
+	char sql[256];
+
+	CKLBLuaDB* pFileDB = NULL;
+	if (!appImage) {
+		pFileDB = KLBNEW(CKLBLuaDB);
+		ok = pFileDB && pFileDB->open(asset, SQLITE_OPEN_READONLY) && scanFirstTable(lua, *pFileDB, sql, sizeof(sql));
+		if (ok) {
+			s64 t0 = CKLBBenchmark::now();
+			for (u32 l = 0; l < loops; l++) {
+				pFileDB->query(&lua, sql);
+				lua.setTop(base);
+			}
+			CKLBBenchmark::report("scan, file + decrypt", loops, CKLBBenchmark::now() - t0);
+
+			t0 = CKLBBenchmark::now();
+			ok = CKLBDatabase::preloadImage(asset, false);
+			CKLBBenchmark::report("preload image", 1, CKLBBenchmark::now() - t0);
+			if (!ok) {
+				pltf.logging("[BENCH] DBIMAGE no image (encryption disabled or over budget)\n");
+			}
+		}
+	} else {
+		pltf.logging("[BENCH] DBIMAGE image already preloaded : file scan skipped\n");
+	}
+
+	CKLBLuaDB* pImageDB = NULL;
+	if (ok) {
+		pImageDB = KLBNEW(CKLBLuaDB);
+		ok = pImageDB && pImageDB->open(asset, SQLITE_OPEN_READONLY) && scanFirstTable(lua, *pImageDB, sql, sizeof(sql));
+	}
+	if (ok) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 l = 0; l < loops; l++) {
+			pImageDB->query(&lua, sql);
+			lua.setTop(base);
+		}
+		CKLBBenchmark::report("scan, memory image", loops, CKLBBenchmark::now() - t0);
+
+		if (pFileDB) {
+			// [true][file rows][true][image rows]
+			pFileDB->query(&lua, sql);
+			pImageDB->query(&lua, sql);
+			ok = lua.isTable(base + 2) && lua.isTable(base + 4) && sameScan(lua, base + 2, base + 4);
+			if (!ok) {
+				pltf.logging("[BENCH] DBIMAGE image and file scans differ\n");
+			}
+			lua.setTop(base);
+		}
+	}
+
+	if (pImageDB)	{ KLBDELETE(pImageDB);	}
+	if (pFileDB)	{ KLBDELETE(pFileDB);	}
+	if (!appImage) {
+		CKLBDatabase::releaseImage(asset);
+	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchDBImage("DBIMAGE", benchDBImage);
+#endif
@@ -35,6 +35,18 @@ public:
 	}
 	static void release		()	{ getInstance()._release();	}
 
+	//
+	// Read-only memory images of encrypted DB files.
+	// The file is decrypted once (optionally on a worker thread) and every read-only
+	// connection on it then reads from memory. Over budget, connections keep using the file.
+	//
+	static bool	preloadImage	(const char* dbAsset, bool async);
+	static void	releaseImage	(const char* dbAsset);
+	static void	releaseAllImages();
+	static bool	isImageReady	(const char* dbAsset);
+	static bool	hasImage		(const char* fullPath);
+	static void	setImageBudget	(u32 bytes);
+
 	bool	init			(const char* dbFile, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
 
 	s32		lookup			(const char* table, const char* resultField, const char* className, const char* filterField, s32 filterValue);
@@ -15,11 +15,14 @@
 */
 #include "CKLBLanguageDatabase.h"
 #include "CKLBUtility.h"
+#include "CKLBBenchmark.h"
 
 bool CKLBLanguageDatabase::addString(const char* id, const char* string) {
 	const char* newstr = CKLBUtility::copyString(string);
 	if (newstr) {
 		m_dictionnary->add(id, newstr);
+		TABLE_ENTRY* pEntry = findEntry(id);
+		if (pEntry) { pEntry->overridden = 1; }
 		return true;
 	} else {
 		return false;
@@ -32,17 +35,103 @@ void CKLBLanguageDatabase::removeString(const char* id) {
 		m_dictionnary->remove(id);
 		KLBDELETEA(string);
 	}
+	// Back to the DB value.
+	TABLE_ENTRY* pEntry = findEntry(id);
+	if (pEntry) { pEntry->overridden = 0; }
 }
 
-const char* CKLBLanguageDatabase::loadStringFromDB(const char* id) {
-	if (m_db) {
-		// 1. SQL Load
-		// 2. Add to dictionnary : done in callback
-		// 3. Return loaded value.
+/*static*/
+u32 CKLBLanguageDatabase::hashKey(const char* key) {
+	// FNV-1a
+	u32 hash = 2166136261U;
+	while (*key) {
+		hash = (hash ^ (u8)(*key++)) * 16777619U;
+	}
+	return hash;
+}
+
+CKLBLanguageDatabase::TABLE_ENTRY* CKLBLanguageDatabase::findEntry(const char* key) {
+	if (m_tableEntries) {
+		u32 hash = hashKey(key);
+		u32 slot = hash & m_tableMask;
+		while (m_tableEntries[slot].key) {
+			TABLE_ENTRY* pEntry = &m_tableEntries[slot];
+			if ((pEntry->hash == hash) && (strcmp((const char*)&m_tableData[pEntry->key], key) == 0)) {
+				return pEntry;
+			}
+			slot = (slot + 1) & m_tableMask;
+		}
+	}
+	return NULL;
+}
+
+const char* CKLBLanguageDatabase::findLoaded(const char* id) {
+	TABLE_ENTRY* pEntry = findEntry(id);
+	if (pEntry && !pEntry->overridden) {
+		return (const char*)&m_tableData[pEntry->value];
+	}
+	return (const char*)m_dictionnary->find(id);
+}
+
+sqlite3_stmt* CKLBLanguageDatabase::prepare(sqlite3_stmt** pStmt, const char* SQLStatement) {
+	if (!*pStmt && m_db) {
+		if (sqlite3_prepare_v2(m_db, SQLStatement, -1, pStmt, NULL) != SQLITE_OK) {
+			klb_assertAlways("DB Error : %s", sqlite3_errmsg(m_db));
+			*pStmt = NULL;
+		}
+	}
+	return *pStmt;
+}
+
+bool CKLBLanguageDatabase::loadKey(const char* id) {
+	if (!m_stmtKey) {
 		char buffer[512];
-		sprintf(buffer, "SELECT %s,%s FROM %s WHERE %s='%s';", m_fieldKey, m_fieldValue, m_tableName, m_fieldKey, id);
+		sprintf(buffer, "SELECT %s FROM %s WHERE %s=?1;", m_fieldValue, m_tableName, m_fieldKey);
+		if (!prepare(&m_stmtKey, buffer)) {
+			return false;
+		}
+	}
+
+	sqlite3_stmt* stmt = m_stmtKey;
+
+	bool res = false;
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		const char* value = (const char*)sqlite3_column_text(stmt, 0);
+		if (value) {
+			res = addString(id, value);
+		}
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return res;
+}
 
-		if (runStatement(buffer)) {
+const char* CKLBLanguageDatabase::loadStringFromDB(const char* id) {
+	if (m_db && !m_tableComplete) {
+		// 1. SQL Load (prepared once, bound per id)
+		// 2. Add to dictionnary
+		// 3. Return loaded value.
+		if (loadKey(id)) {
+			if (m_recording) {
+				if (m_recordCount == m_recordMax) {
+					u32 newMax = m_recordMax ? m_recordMax * 2 : 64;
+					const char** newRecord = KLBNEWA(const char*, newMax);
+					if (!newRecord) {
+						return (const char*)m_dictionnary->find(id);
+					}
+					if (m_record) {
+						memcpy(newRecord, m_record, m_recordCount * sizeof(const char*));
+						KLBDELETEA(m_record);
+					}
+					m_record	= newRecord;
+					m_recordMax	= newMax;
+				}
+				const char* recordId = CKLBUtility::copyString(id);
+				if (recordId) {
+					m_record[m_recordCount++] = recordId;
+				}
+			}
 			return (const char*)m_dictionnary->find(id);
 		} else {
 			return NULL;
@@ -52,26 +141,227 @@ const char* CKLBLanguageDatabase::loadStringFromDB(const char* id) {
 	}
 }
 
+u32 CKLBLanguageDatabase::preLoadKeys(const char** ids, u32 count) {
+	if (!m_db) {
+		return 0;
+	}
+
+	// One read transaction : the shared lock is taken once for the whole batch.
+	bool trans = (sqlite3_exec(m_db, "BEGIN;", NULL, NULL, NULL) == SQLITE_OK);
+
+	u32 loaded = 0;
+	for (u32 n = 0; n < count; n++) {
+		const char* id = ids[n];
+		if (id && !findLoaded(id)) {
+			if (loadKey(id)) {
+				loaded++;
+			}
+		}
+	}
+
+	if (trans) {
+		sqlite3_exec(m_db, "COMMIT;", NULL, NULL, NULL);
+	}
+	return loaded;
+}
+
+void CKLBLanguageDatabase::recordMisses(bool enable) {
+	m_recording = enable;
+}
+
+void CKLBLanguageDatabase::clearRecords() {
+	for (u32 n = 0; n < m_recordCount; n++) {
+		KLBDELETEA(m_record[n]);
+	}
+	KLBDELETEA(m_record);
+	m_record		= NULL;
+	m_recordCount	= 0;
+	m_recordMax		= 0;
+}
+
 bool CKLBLanguageDatabase::preLoadGroup(const char* groupID) {
 	char buffer[512];
 
-	if (groupID && m_fieldGroup) {
+	if (!m_fieldGroup) {
+		return false;
+	}
+
+	if (groupID) {
 		// Load a Group.
-		sprintf(buffer, "SELECT %s,%s FROM %s WHERE %s='%s';", m_fieldKey, m_fieldValue, m_tableName, m_fieldGroup, groupID);
+		if (!m_stmtGroup) {
+			sprintf(buffer, "SELECT %s,%s FROM %s WHERE %s=?1;", m_fieldKey, m_fieldValue, m_tableName, m_fieldGroup);
+			if (!prepare(&m_stmtGroup, buffer)) {
+				return false;
+			}
+		}
+
+		sqlite3_stmt* stmt = m_stmtGroup;
+
+		bool res = true;
+		sqlite3_bind_text(stmt, 1, groupID, -1, SQLITE_STATIC);
+		int rc;
+		while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+			const char* key		= (const char*)sqlite3_column_text(stmt, 0);
+			const char* value	= (const char*)sqlite3_column_text(stmt, 1);
+			if (key && value && !addString(key, value)) {
+				res = false;
+				break;
+			}
+		}
+		if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+			klb_assertAlways("DB Error : %s", sqlite3_errmsg(m_db));
+			res = false;
+		}
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+		return res;
 	} else {
 		// Load complete table.
 		sprintf(buffer, "SELECT %s,%s FROM %s;", m_fieldKey, m_fieldValue, m_tableName);
+		return runStatement(buffer);
 	}
+}
 
-	if (m_fieldGroup && runStatement(buffer)) {
-		return true;
+bool CKLBLanguageDatabase::buildTable(const char* groupID) {
+	if (!m_db || (groupID && !m_fieldGroup)) {
+		return false;
+	}
+	freeTable();
+
+	char where[256];
+	if (groupID) {
+		sprintf(where, " WHERE %s=?1", m_fieldGroup);
 	} else {
+		where[0] = 0;
+	}
+
+	// 1. Size everything first : a single allocation for all the strings.
+	char buffer[768];
+	sprintf(buffer, "SELECT COUNT(*),TOTAL(LENGTH(CAST(%s AS BLOB))+LENGTH(CAST(%s AS BLOB))) FROM %s%s;",
+			m_fieldKey, m_fieldValue, m_tableName, where);
+
+	sqlite3_stmt* stmt = NULL;
+	if (sqlite3_prepare_v2(m_db, buffer, -1, &stmt, NULL) != SQLITE_OK) {
+		klb_assertAlways("DB Error : %s", sqlite3_errmsg(m_db));
+		return false;
+	}
+	if (groupID) { sqlite3_bind_text(stmt, 1, groupID, -1, SQLITE_STATIC); }
+
+	u32 count	= 0;
+	u32 total	= 0;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		count	= (u32)sqlite3_column_int(stmt, 0);
+		total	= (u32)sqlite3_column_double(stmt, 1);
+	}
+	sqlite3_finalize(stmt);
+
+	u32 slotCount = 16;
+	while (slotCount < count * 2) {
+		slotCount <<= 1;
+	}
+
+	// Offset 0 is reserved for empty slots.
+	u32 dataSize	= 1 + total + (count * 2);
+	m_tableData		= KLBNEWA(u8, dataSize);
+	m_tableEntries	= KLBNEWA(TABLE_ENTRY, slotCount);
+	if (!m_tableData || !m_tableEntries) {
+		freeTable();
 		return false;
 	}
+	memset(m_tableEntries, 0, slotCount * sizeof(TABLE_ENTRY));
+	m_tableMask		= slotCount - 1;
+	m_tableData[0]	= 0;
+
+	// 2. Copy all the records.
+	sprintf(buffer, "SELECT %s,%s FROM %s%s;", m_fieldKey, m_fieldValue, m_tableName, where);
+	if (sqlite3_prepare_v2(m_db, buffer, -1, &stmt, NULL) != SQLITE_OK) {
+		klb_assertAlways("DB Error : %s", sqlite3_errmsg(m_db));
+		freeTable();
+		return false;
+	}
+	if (groupID) { sqlite3_bind_text(stmt, 1, groupID, -1, SQLITE_STATIC); }
+
+	u32 pos = 1;
+	u32 rows = 0;
+	while ((rows < count) && (sqlite3_step(stmt) == SQLITE_ROW)) {
+		rows++;
+		const char* key		= (const char*)sqlite3_column_text(stmt, 0);
+		u32 keyLen			= sqlite3_column_bytes(stmt, 0);
+		const char* value	= (const char*)sqlite3_column_text(stmt, 1);
+		u32 valueLen		= sqlite3_column_bytes(stmt, 1);
+		if (!key || !value || (pos + keyLen + valueLen + 2 > dataSize)) {
+			continue;
+		}
+
+		u32 hash = hashKey(key);
+		u32 slot = hash & m_tableMask;
+		while (m_tableEntries[slot].key && ((m_tableEntries[slot].hash != hash) || strcmp((const char*)&m_tableData[m_tableEntries[slot].key], key))) {
+			slot = (slot + 1) & m_tableMask;
+		}
+
+		TABLE_ENTRY* pEntry = &m_tableEntries[slot];
+		if (!pEntry->key) {
+			memcpy(&m_tableData[pos], key, keyLen + 1);
+			pEntry->hash	= hash;
+			pEntry->key		= pos;
+			pos += keyLen + 1;
+		}
+		// Same key twice : last record wins like the dictionnary.
+		memcpy(&m_tableData[pos], value, valueLen + 1);
+		pEntry->value	= pos;
+		pos += valueLen + 1;
+
+		// Strings already set by addString() keep priority.
+		const char* current = (const char*)m_dictionnary->find(key);
+		pEntry->overridden = (current && strcmp(current, value)) ? 1 : 0;
+	}
+	sqlite3_finalize(stmt);
+
+	// A full snapshot answers misses too : no more per-id query.
+	m_tableComplete = (groupID == NULL);
+	return true;
+}
+
+void CKLBLanguageDatabase::freeTable() {
+	KLBDELETEA(m_tableData);
+	KLBDELETEA(m_tableEntries);
+	m_tableData		= NULL;
+	m_tableEntries	= NULL;
+	m_tableMask		= 0;
+	m_tableComplete	= false;
+}
+
+void CKLBLanguageDatabase::closeDB() {
+	if (m_stmtKey) {
+		sqlite3_finalize(m_stmtKey);
+		m_stmtKey = NULL;
+	}
+	if (m_stmtGroup) {
+		sqlite3_finalize(m_stmtGroup);
+		m_stmtGroup = NULL;
+	}
+	freeTable();
+
+	if (m_db) {
+		sqlite3_close(m_db);
+		m_db = NULL;
+	}
+
+	KLBDELETEA(m_tableName);
+	KLBDELETEA(m_fieldValue);
+	KLBDELETEA(m_fieldGroup);
+	KLBDELETEA(m_fieldKey);
+	m_tableName		= NULL;
+	m_fieldValue	= NULL;
+	m_fieldGroup	= NULL;
+	m_fieldKey		= NULL;
 }
 
 bool CKLBLanguageDatabase::setupDB(const char* dbFile, const char* tableName, const char* keyField, const char* valueField, const char* groupField)
 {
+	// Statements and table belong to the previous DB.
+	closeDB();
+
 	IPlatformRequest& platform = CPFInterface::getInstance().platform();
 	const char* fullPath = platform.getFullPath(dbFile);
 
@@ -80,7 +370,7 @@ bool CKLBLanguageDatabase::setupDB(const char* dbFile, const char* tableName, co
 	delete[] fullPath;
 
 	if (rc) {
-		_release();
+		closeDB();
 		return false;
 	}
 
@@ -95,7 +385,6 @@ bool CKLBLanguageDatabase::setupDB(const char* dbFile, const char* tableName, co
 	return (m_tableName!=NULL) && (m_fieldValue!=NULL) && (m_fieldKey!=NULL) && ((groupField!=NULL) ? (m_fieldGroup!=NULL) : true);
 }
 
-
 /**
  * Call back from SQLite for each record when loading language records.
  * -> Callback transfered to C++ callback.
@@ -137,7 +426,7 @@ const char*	CKLBLanguageDatabase::getString(const char* id) {
 	if (id) {
 		if (id[0] == '#') {
 			const char* old = id;
-			id = (const char*)m_dictionnary->find(&id[1]);
+			id = findLoaded(&id[1]);
 			if (!id) {
 				id = loadStringFromDB(&old[1]);
 				if (!id) {
@@ -158,6 +447,16 @@ CKLBLanguageDatabase::CKLBLanguageDatabase()
 , m_fieldGroup  (NULL)
 , m_fieldKey    (NULL) 
 , m_dictionnary (NULL)
+, m_stmtKey     (NULL)
+, m_stmtGroup   (NULL)
+, m_tableData   (NULL)
+, m_tableEntries(NULL)
+, m_tableMask   (0)
+, m_tableComplete(false)
+, m_recording   (false)
+, m_record      (NULL)
+, m_recordCount (0)
+, m_recordMax   (0)
 {
 	// Do nothing.
 }
@@ -187,14 +486,157 @@ void CKLBLanguageDatabase::_release() {
 		m_dictionnary->clear();
 	}
 
-	if (m_db) {
-		sqlite3_close(m_db);
-		m_db = NULL;
+	closeDB();
+	clearRecords();
+	KLBDELETE(m_dictionnary);
+	m_dictionnary = NULL;
+}
+
+#ifdef INTERNAL_BENCH
+#define BENCH_LANG_DB	"file://external/bench_langdb.db"
+
+static bool benchCheckString(CKLBLanguageDatabase& db, u32 idx) {
+	char id[32];
+	char expected[32];
+	sprintf(id,			"#bench_str_%04i", idx);
+	sprintf(expected,	"value %i", idx);
+	const char* value = db.getString(id);
+	return value && (strcmp(value, expected) == 0);
+}
+
+// Private instance : the application dictionary stays as it is.
+class CKLBBenchLanguageDB : public CKLBLanguageDatabase {
+public:
+	CKLBBenchLanguageDB		() : CKLBLanguageDatabase()	{}
+	~CKLBBenchLanguageDB	()							{ _release();	}
+	void	reset			()							{ _release();	}
+};
+
+// 4096 strings in 8 groups, in a scratch DB, read through a private instance (the application
+// dictionary is not touched) : ids fetched one by one on miss, preLoadKeys batch, preLoadGroup,
+// and lookups from the buildTable snapshot.
+// Checks every path returns the DB value, misses are recorded, addString overrides the snapshot
+// until removeString, and an unknown id is returned as is.
+static bool benchLanguageDB(u32 loops) {
+	enum { STRINGS = 4096, GROUPS = 8 };
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+
+	pltf.removeFileOrFolder(BENCH_LANG_DB);
+	const char* fullPath = pltf.getFullPath(BENCH_LANG_DB);
+	sqlite3* pDB = NULL;
+	bool ok = fullPath && (sqlite3_open_v2(fullPath, &pDB, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) == SQLITE_OK);
+	delete[] fullPath;
+	if (ok) {
+		sqlite3_stmt* stmt = NULL;
+		ok = (sqlite3_exec(pDB, "CREATE TABLE lang(key TEXT PRIMARY KEY, value TEXT, grp TEXT); BEGIN;", NULL, NULL, NULL) == SQLITE_OK)
+			&& (sqlite3_prepare_v2(pDB, "INSERT INTO lang VALUES(?1,?2,?3);", -1, &stmt, NULL) == SQLITE_OK);
+		for (u32 n = 0; ok && (n < STRINGS); n++) {
+			char key[32];
+			char value[32];
+			char group[16];
+			sprintf(key,	"bench_str_%04i", n);
+			sprintf(value,	"value %i", n);
+			sprintf(group,	"group%i", n % GROUPS);
+			sqlite3_bind_text(stmt, 1, key,		-1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 2, value,	-1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 3, group,	-1, SQLITE_TRANSIENT);
+			ok = (sqlite3_step(stmt) == SQLITE_DONE);
+			sqlite3_reset(stmt);
+		}
+		sqlite3_finalize(stmt);
+		ok = ok && (sqlite3_exec(pDB, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK);
+	}
+	if (pDB) {
+		sqlite3_close(pDB);
 	}
 
-	KLBDELETEA(m_tableName);
-	KLBDELETEA(m_fieldValue);
-	KLBDELETEA(m_fieldGroup);
-	KLBDELETEA(m_fieldKey);
-	KLBDELETE(m_dictionnary);
+	static char			keys[STRINGS][32];
+	static const char*	ids[STRINGS];
+	for (u32 n = 0; n < STRINGS; n++) {
+		sprintf(keys[n], "bench_str_%04i", n);
+		ids[n] = keys[n];
+	}
+
+	CKLBBenchLanguageDB* pLang = KLBNEW(CKLBBenchLanguageDB);
+	ok = ok && pLang;
+	s64 timeMiss	= 0;
+	s64 timeBatch	= 0;
+	s64 timeGroup	= 0;
+	s64 timeBuild	= 0;
+	s64 timeTable	= 0;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		// Per-id fetch, recorded.
+		ok = pLang->init() && pLang->setupDB(BENCH_LANG_DB, "lang", "key", "value", "grp");
+		pLang->recordMisses(true);
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; ok && (n < STRINGS); n++) {
+			ok = benchCheckString(*pLang, n);
+		}
+		timeMiss += CKLBBenchmark::now() - t0;
+		ok = ok && (pLang->getRecordCount() == STRINGS);
+		pLang->recordMisses(false);
+		pLang->reset();
+
+		// Batch : ids preloaded in one transaction, then resolved from memory.
+		ok = ok && pLang->init() && pLang->setupDB(BENCH_LANG_DB, "lang", "key", "value", "grp");
+		s64 t1 = CKLBBenchmark::now();
+		ok = ok && (pLang->preLoadKeys(ids, STRINGS) == STRINGS);
+		for (u32 n = 0; ok && (n < STRINGS); n++) {
+			ok = benchCheckString(*pLang, n);
+		}
+		timeBatch += CKLBBenchmark::now() - t1;
+		pLang->reset();
+
+		// Groups.
+		ok = ok && pLang->init() && pLang->setupDB(BENCH_LANG_DB, "lang", "key", "value", "grp");
+		s64 t2 = CKLBBenchmark::now();
+		for (u32 g = 0; ok && (g < GROUPS); g++) {
+			char group[16];
+			sprintf(group, "group%i", g);
+			ok = pLang->preLoadGroup(group);
+		}
+		timeGroup += CKLBBenchmark::now() - t2;
+		for (u32 n = 0; ok && (n < STRINGS); n++) {
+			ok = benchCheckString(*pLang, n);
+		}
+		pLang->reset();
+
+		// Snapshot table.
+		ok = ok && pLang->init() && pLang->setupDB(BENCH_LANG_DB, "lang", "key", "value", "grp");
+		s64 t3 = CKLBBenchmark::now();
+		ok = ok && pLang->buildTable(NULL);
+		s64 t4 = CKLBBenchmark::now();
+		for (u32 n = 0; ok && (n < STRINGS); n++) {
+			ok = benchCheckString(*pLang, n);
+		}
+		timeBuild += t4 - t3;
+		timeTable += CKLBBenchmark::now() - t4;
+
+		if (ok) {
+			const char* value;
+			pLang->addString("bench_str_0000", "override");
+			value	= pLang->getString("#bench_str_0000");
+			ok		= value && (strcmp(value, "override") == 0);
+			pLang->removeString("bench_str_0000");
+			ok		= ok && benchCheckString(*pLang, 0);
+			value	= pLang->getString("#bench_missing");
+			ok		= ok && value && (strcmp(value, "#bench_missing") == 0);
+		}
+		pLang->reset();
+	}
+	CKLBBenchmark::report("getString, fetched one by one", loops * STRINGS, timeMiss);
+	CKLBBenchmark::report("preLoadKeys + getString", loops * STRINGS, timeBatch);
+	CKLBBenchmark::report("preLoadGroup", loops * GROUPS, timeGroup);
+	CKLBBenchmark::report("buildTable", loops, timeBuild);
+	CKLBBenchmark::report("getString from table", loops * STRINGS, timeTable);
+	if (!ok) {
+		pltf.logging("[BENCH] LANGDB string mismatch\n");
+	}
+
+	KLBDELETE(pLang);
+	pltf.removeFileOrFolder(BENCH_LANG_DB);
+	return ok;
 }
+
+static CKLBBenchmark gBenchLanguageDB("LANGDB", benchLanguageDB);
+#endif
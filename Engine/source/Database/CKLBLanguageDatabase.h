@@ -42,7 +42,41 @@ public:
 
 	bool	preLoadGroup	(const char* groupID);
 
+	// Load many ids (without '#') with one prepared statement, return count loaded.
+	u32		preLoadKeys		(const char** ids, u32 count);
+
+	// Keep the ids that had to be fetched one by one, so the next run can preload them.
+	void	recordMisses	(bool enable);
+	u32		getRecordCount	() const		{ return m_recordCount; }
+	const char*	getRecord	(u32 idx) const	{ return (idx < m_recordCount) ? m_record[idx] : NULL; }
+	void	clearRecords	();
+
+	// Snapshot the table (or one group) into a single hashed block.
+	// Strings are then found without touching the trie or SQLite.
+	bool	buildTable		(const char* groupID);
+	void	freeTable		();
+
+protected:
+	// Singleton : derived only to get a private instance.
+	CKLBLanguageDatabase ();
+	~CKLBLanguageDatabase();
+	void _release();
+
 private:
+	struct TABLE_ENTRY {
+		u32			hash;
+		u32			key;		// Offsets in m_tableData, 0 = empty slot.
+		u32			value;
+		u32			overridden;	// addString() replaced the DB value.
+	};
+
+	static u32	hashKey				(const char* key);
+	TABLE_ENTRY* findEntry			(const char* key);
+	const char*	findLoaded			(const char* id);
+	bool		loadKey				(const char* id);
+	sqlite3_stmt* prepare			(sqlite3_stmt** pStmt, const char* SQLStatement);
+	void		closeDB				();
+
 	/* C like callback with object context for SQLite */
 	static
 	int			callbackFct			(void* ctx,int colNum,char** columnText,char** columnName);
@@ -59,10 +93,19 @@ private:
 	const char*		m_fieldGroup;
 	const char*		m_fieldKey;
 	Dictionnary*	m_dictionnary;
-	
-	CKLBLanguageDatabase ();
-	~CKLBLanguageDatabase();
-	void _release();
+
+	sqlite3_stmt*	m_stmtKey;
+	sqlite3_stmt*	m_stmtGroup;
+
+	u8*				m_tableData;
+	TABLE_ENTRY*	m_tableEntries;
+	u32				m_tableMask;
+	bool			m_tableComplete;
+
+	bool			m_recording;
+	const char**	m_record;
+	u32				m_recordCount;
+	u32				m_recordMax;
 	
 	static void callbackDictionnary(const void* this_, const void* ptrToDelete);
 };
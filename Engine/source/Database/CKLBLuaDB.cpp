@@ -16,6 +16,8 @@
 #include "CKLBLuaDB.h"
 #include "CPFInterface.h"
 #include "CKLBUtility.h"
+#include "CKLBDatabase.h"
+#include "CKLBBenchmark.h"
 
 CKLBLuaDB	*	CKLBLuaDB::ms_begin = NULL;
 CKLBLuaDB	*	CKLBLuaDB::ms_end	= NULL;
@@ -28,7 +30,9 @@ CKLBLuaDB::CKLBLuaDB()
 , m_idx	(0)
 , m_prev(NULL)
 , m_next(NULL)
+, m_stmtUse(0)
 {
+	memset(m_stmtCache, 0, sizeof(m_stmtCache));
 	add_link();
 }
 
@@ -39,7 +43,9 @@ CKLBLuaDB::CKLBLuaDB(const char * db_asset, int flags)
 , m_idx	(0)
 , m_prev(NULL)
 , m_next(NULL)
+, m_stmtUse(0)
 {
+	memset(m_stmtCache, 0, sizeof(m_stmtCache));
 	add_link();
 	open(db_asset, flags);
 }
@@ -112,7 +118,10 @@ CKLBLuaDB::open(const char * db_asset, int flags)
 		klb_assertAlways("DB Write Enabled on Read Only file system.");
 	}
 
-	if (!isReadOnly) {
+	// Preloaded memory image : stay read-only so the connection uses it.
+	bool useImage = fullpath && (flags & SQLITE_OPEN_READONLY) && CKLBDatabase::hasImage(fullpath);
+
+	if (!isReadOnly && !useImage) {
 		flags |= SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE;
 		flags &= ~SQLITE_OPEN_READONLY;
 	}
@@ -153,6 +162,8 @@ bool
 CKLBLuaDB::close()
 {
 	if (m_db) {
+		// Prepared statements would keep the DB busy.
+		finalizeAll();
 		sqlite3_close(m_db);
 		m_db = NULL;
 	}
@@ -209,6 +220,259 @@ CKLBLuaDB::query(const char* query)
 	return (const char**)m_pLua;
 }
 
+// ------------------- Prepared statements ------------------
+
+static u32 sqlHash(const char * sql)
+{
+	// FNV-1a
+	u32 hash = 2166136261U;
+	while (*sql) {
+		hash = (hash ^ (u8)*sql++) * 16777619U;
+	}
+	return hash;
+}
+
+sqlite3_stmt*
+CKLBLuaDB::prepare(const char * sql)
+{
+	u32 hash = sqlHash(sql);
+	STMT_ENTRY * pVictim = &m_stmtCache[0];
+	for (u32 n = 0; n < STMT_CACHE_SIZE; n++) {
+		STMT_ENTRY * pEntry = &m_stmtCache[n];
+		if (pEntry->stmt && (pEntry->hash == hash) && !strcmp(pEntry->sql, sql)) {
+			pEntry->lastUse = ++m_stmtUse;
+			return pEntry->stmt;
+		}
+		if (!pEntry->stmt) {
+			if (pVictim->stmt) { pVictim = pEntry; }
+		} else if (pVictim->stmt && (pEntry->lastUse < pVictim->lastUse)) {
+			pVictim = pEntry;
+		}
+	}
+
+	sqlite3_stmt * stmt = NULL;
+	if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		DEBUG_PRINT("[SQLite]%s", sqlite3_errmsg(m_db));
+		sqlite3_finalize(stmt);
+		return NULL;
+	}
+	if (!stmt) {
+		// Empty statement.
+		return NULL;
+	}
+
+	const char * sqlCopy = CKLBUtility::copyString(sql);
+	if (!sqlCopy) {
+		sqlite3_finalize(stmt);
+		return NULL;
+	}
+
+	if (pVictim->stmt) {
+		sqlite3_finalize(pVictim->stmt);
+		KLBDELETEA(pVictim->sql);
+	}
+	pVictim->sql		= sqlCopy;
+	pVictim->stmt		= stmt;
+	pVictim->hash		= hash;
+	pVictim->lastUse	= ++m_stmtUse;
+	return stmt;
+}
+
+void
+CKLBLuaDB::finalizeAll()
+{
+	for (u32 n = 0; n < STMT_CACHE_SIZE; n++) {
+		STMT_ENTRY * pEntry = &m_stmtCache[n];
+		if (pEntry->stmt) {
+			sqlite3_finalize(pEntry->stmt);
+			KLBDELETEA(pEntry->sql);
+			pEntry->stmt	= NULL;
+			pEntry->sql		= NULL;
+		}
+	}
+}
+
+bool
+CKLBLuaDB::bindParams(CLuaState& lua, sqlite3_stmt * stmt, int firstParam)
+{
+	int top = lua.numArgs();
+	int rc	= SQLITE_OK;
+	for (int pos = firstParam; (pos <= top) && (rc == SQLITE_OK); pos++) {
+		int idx = pos - firstParam + 1;
+		switch (lua.getType(pos)) {
+		case LUA_TNUMBER:
+			{
+				double d = lua.getDouble(pos);
+				sqlite3_int64 i = (sqlite3_int64)d;
+				rc = ((double)i == d) ? sqlite3_bind_int64(stmt, idx, i) : sqlite3_bind_double(stmt, idx, d);
+			}
+			break;
+		case LUA_TBOOLEAN:
+			rc = sqlite3_bind_int(stmt, idx, lua.getBool(pos) ? 1 : 0);
+			break;
+		case LUA_TSTRING:
+			// Lua string stays alive until the statement is reset.
+			rc = sqlite3_bind_text(stmt, idx, lua.getString(pos), -1, SQLITE_STATIC);
+			break;
+		default:
+			rc = sqlite3_bind_null(stmt, idx);
+			break;
+		}
+	}
+	return (rc == SQLITE_OK);
+}
+
+int
+CKLBLuaDB::stepRows(CLuaState& lua, sqlite3_stmt * stmt, int tablePos, bool reuseRows, int * rowCount)
+{
+	int colNum = sqlite3_column_count(stmt);
+	if (!lua.checkStack(colNum + 4)) {
+		return SQLITE_NOMEM;
+	}
+
+	// Column names pushed once : each cell key is a copy of the stack slot.
+	int nameBase = lua.numArgs();
+	for (int i = 0; i < colNum; i++) {
+		lua.retString(sqlite3_column_name(stmt, i));
+	}
+
+	int idx = 1;
+	int rc;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		bool reused = false;
+		if (reuseRows) {
+			lua.tableRawGetIndex(idx, tablePos);
+			reused = lua.isTable(-1);
+			if (!reused) { lua.pop(1); }
+		}
+		if (reused) {
+			// The row may come from another statement : no column of it may stay.
+			lua.retNil();
+			while (lua.tableNext(-2)) {
+				lua.pop(1);
+				lua.retValue(-1);
+				lua.retNil();
+				lua.tableRawSet(-4);
+			}
+		} else {
+			lua.tableNew(0, colNum);
+		}
+
+		for (int i = 0; i < colNum; i++) {
+			lua.retValue(nameBase + 1 + i);
+			switch (sqlite3_column_type(stmt, i)) {
+			case SQLITE_INTEGER:
+				{
+					sqlite3_int64 v = sqlite3_column_int64(stmt, i);
+					if (v == (s32)v)	{ lua.retInt((s32)v);		}
+					else				{ lua.retDouble((double)v);	}
+				}
+				break;
+			case SQLITE_FLOAT:
+				lua.retDouble(sqlite3_column_double(stmt, i));
+				break;
+			case SQLITE_NULL:
+				lua.retNil();	// Same as query() : no field.
+				break;
+			default:
+				{
+					// Text and blob : blob pointer first, then size.
+					const char * data = (const char *)sqlite3_column_blob(stmt, i);
+					lua.retString(data ? data : "", sqlite3_column_bytes(stmt, i));
+				}
+				break;
+			}
+			lua.tableRawSet();
+		}
+
+		if (reused) {
+			lua.pop(1);
+		} else {
+			lua.tableRawSetIndex(idx, tablePos);
+		}
+		idx++;
+	}
+
+	lua.pop(colNum);
+	*rowCount = idx - 1;
+
+	// Release read locks, parameters point to Lua strings.
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	return (rc == SQLITE_DONE) ? SQLITE_OK : rc;
+}
+
+int
+CKLBLuaDB::queryPrepared(CLuaState * plua, const char * sql, int firstParam)
+{
+	CLuaState& lua = *plua;
+	if(!m_db) {
+		lua.retBoolean(false);
+		return 1;
+	}
+
+	int rc = SQLITE_ERROR;
+	sqlite3_stmt * stmt = prepare(sql);
+	if (stmt) {
+		if (bindParams(lua, stmt, firstParam)) {
+			lua.retBoolean(true);
+			lua.tableNew();
+			int rows;
+			rc = stepRows(lua, stmt, lua.numArgs(), false, &rows);
+			if (rc == SQLITE_OK) {
+				return 2;
+			}
+			lua.pop(2);
+		} else {
+			rc = sqlite3_errcode(m_db);
+			sqlite3_clear_bindings(stmt);
+		}
+		DEBUG_PRINT("[SQLite]%s", sqlite3_errmsg(m_db));
+	}
+
+	lua.retBoolean(false);
+	lua.retInt(rc);
+	return 2;
+}
+
+int
+CKLBLuaDB::fetchRows(CLuaState * plua, const char * sql, int tablePos, int firstParam)
+{
+	CLuaState& lua = *plua;
+	if(!m_db || !lua.isTable(tablePos)) {
+		lua.retBoolean(false);
+		return 1;
+	}
+
+	int rc = SQLITE_ERROR;
+	sqlite3_stmt * stmt = prepare(sql);
+	if (stmt) {
+		if (bindParams(lua, stmt, firstParam)) {
+			int oldCount = lua.tableLength(tablePos);
+			int rows;
+			rc = stepRows(lua, stmt, tablePos, true, &rows);
+			if (rc == SQLITE_OK) {
+				// Drop rows left from a previous, longer result.
+				for (int n = rows + 1; n <= oldCount; n++) {
+					lua.retNil();
+					lua.tableRawSetIndex(n, tablePos);
+				}
+				lua.retInt(rows);
+				return 1;
+			}
+		} else {
+			rc = sqlite3_errcode(m_db);
+			sqlite3_clear_bindings(stmt);
+		}
+		DEBUG_PRINT("[SQLite]%s", sqlite3_errmsg(m_db));
+	}
+
+	lua.retBoolean(false);
+	lua.retInt(rc);
+	return 2;
+}
+
 int
 CKLBLuaDB::row_callback(void* ctx, int colNum, char** columnText, char** columnName)
 {
@@ -279,3 +543,108 @@ CKLBLuaDB::dumpAll()
 	}
 	return bResult;
 }
+
+#ifdef INTERNAL_BENCH
+#include "CKLBLuaEnv.h"
+
+#define BENCH_DB		"file://external/bench_dbquery.db"
+
+// Row n of the result tables at a and b has the same id and name (exec rows hold strings).
+static bool sameRows(CLuaState& lua, int a, int b) {
+	int count = lua.tableLength(a);
+	if (count != lua.tableLength(b)) { return false; }
+
+	bool ok = true;
+	for (int n = 1; ok && (n <= count); n++) {
+		lua.tableRawGetIndex(n, a);
+		lua.tableRawGetIndex(n, b);
+		int top = lua.numArgs();
+		lua.retString("id");	lua.tableGet(top - 1);
+		lua.retString("id");	lua.tableGet(top);
+		lua.retString("name");	lua.tableGet(top - 1);
+		lua.retString("name");	lua.tableGet(top);
+		ok = (lua.getDouble(top + 1) == lua.getDouble(top + 2)) && !strcmp(lua.getString(top + 3), lua.getString(top + 4));
+		lua.setTop(top - 2);
+	}
+	return ok;
+}
+
+// 1000 rows table in an external DB : the same 100 row SELECT through sqlite3_exec (DB_query),
+// the cached prepared statement with a bound parameter (DB_prepared) and fetchRows into a reused
+// table (DB_fetchRows). The three results must hold the same rows. The DB file is removed after.
+static bool benchDBQuery(u32 loops) {
+	CLuaState& lua	= CKLBLuaEnv::getInstance().getState();
+	int base		= lua.numArgs();
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+
+	pltf.removeFileOrFolder(BENCH_DB);
+	CKLBLuaDB* pDB = KLBNEW(CKLBLuaDB);
+	if (!pDB) { return false; }
+	bool ok = pDB->open(BENCH_DB);
+
+	if (ok) {
+		pDB->query(&lua, "CREATE TABLE t (id INTEGER PRIMARY KEY, name TEXT, score REAL);");
+		pDB->query(&lua, "BEGIN;");
+		char sql[128];
+		for (u32 n = 0; n < 1000; n++) {
+			sprintf(sql, "INSERT INTO t VALUES (%i, 'name_%i', %i.25);", n, n, n);
+			pDB->query(&lua, sql);
+		}
+		pDB->query(&lua, "COMMIT;");
+		lua.setTop(base);
+
+		s64 timeExec		= 0;
+		s64 timePrepared	= 0;
+		s64 timeFetch		= 0;
+		lua.tableNew();		// Rows reused by fetchRows.
+		int rowsPos = lua.numArgs();
+		for (u32 l = 0; ok && (l < loops); l++) {
+			u32 first = (l * 7) % 900;
+			sprintf(sql, "SELECT id, name, score FROM t WHERE id >= %i AND id < %i;", first, first + 100);
+
+			s64 t0 = CKLBBenchmark::now();
+			pDB->query(&lua, sql);
+			s64 t1 = CKLBBenchmark::now();
+			lua.retInt(first);
+			lua.retInt(first + 100);
+			pDB->queryPrepared(&lua, "SELECT id, name, score FROM t WHERE id >= ? AND id < ?;", rowsPos + 3);
+			lua.retInt(first);
+			lua.retInt(first + 100);
+			s64 t2 = CKLBBenchmark::now();
+			pDB->fetchRows(&lua, "SELECT id, name, score FROM t WHERE id >= ? AND id < ?;", rowsPos, rowsPos + 7);
+			s64 t3 = CKLBBenchmark::now();
+			timeExec		+= t1 - t0;
+			timePrepared	+= t2 - t1;
+			timeFetch		+= t3 - t2;
+
+			// [rows][true][exec rows][first][last][true][prepared rows][first][last][count]
+			ok = lua.isTable(rowsPos + 2) && lua.isTable(rowsPos + 6) && (lua.tableLength(rowsPos + 2) == 100)
+			  && sameRows(lua, rowsPos + 2, rowsPos + 6) && sameRows(lua, rowsPos + 2, rowsPos);
+			lua.setTop(rowsPos);
+		}
+
+		if (ok) {
+			// Narrower statement into the same rows : the previous columns must be gone.
+			pDB->fetchRows(&lua, "SELECT id FROM t WHERE id < 10;", rowsPos, rowsPos + 1);
+			lua.tableRawGetIndex(1, rowsPos);
+			lua.retString("name");
+			lua.tableGet(-2);
+			ok = (lua.getInt(rowsPos + 1) == 10) && lua.isNil(-1);
+			if (!ok) {
+				pltf.logging("[BENCH] DBQUERY reused row keeps a stale column\n");
+			}
+		}
+		lua.setTop(base);
+
+		CKLBBenchmark::report("DB_query (sqlite3_exec)", loops, timeExec);
+		CKLBBenchmark::report("DB_prepared (cached)", loops, timePrepared);
+		CKLBBenchmark::report("DB_fetchRows (reused rows)", loops, timeFetch);
+	}
+
+	KLBDELETE(pDB);
+	pltf.removeFileOrFolder(BENCH_DB);
+	return ok;
+}
+
+static CKLBBenchmark gBenchDBQuery("DBQUERY", benchDBQuery);
+#endif
@@ -45,6 +45,14 @@ public:
 	int query(CLuaState * lua, const char * sql);
 	const char** query(const char* query); // lua-free.
 
+	// Same as query() with a cached prepared statement : parameters ("?") are bound from
+	// the Lua stack starting at firstParam, columns keep their integer / real / blob types.
+	int queryPrepared(CLuaState * lua, const char * sql, int firstParam);
+
+	// Fill the Lua array at tablePos with the rows (row tables already there are cleared and reused),
+	// entries after the last row are cleared. Push the row count.
+	int fetchRows(CLuaState * lua, const char * sql, int tablePos, int firstParam);
+
 	// 現在生成されているCKLBLuaDB全てをクローズする
 	static void closeAll();
 
@@ -55,6 +63,20 @@ private:
 	void add_link();
 	void remove_link();
 
+	sqlite3_stmt*	prepare		(const char * sql);
+	void			finalizeAll	();
+	bool			bindParams	(CLuaState& lua, sqlite3_stmt * stmt, int firstParam);
+	int				stepRows	(CLuaState& lua, sqlite3_stmt * stmt, int tablePos, bool reuseRows, int * rowCount);
+
+	// Statements kept prepared, least recently used replaced.
+	enum { STMT_CACHE_SIZE = 32 };
+	struct STMT_ENTRY {
+		const char		*	sql;
+		sqlite3_stmt	*	stmt;
+		u32					hash;
+		u32					lastUse;
+	};
+
 	const char		*	m_name;
 	bool				m_pragmaJournal;
 
@@ -65,6 +87,9 @@ private:
 	CKLBLuaDB		*	m_prev;
 	CKLBLuaDB		*	m_next;
 
+	u32					m_stmtUse;
+	STMT_ENTRY			m_stmtCache[STMT_CACHE_SIZE];
+
 	static int row_callback			(void* ctx,int colNum,char** columnText,char** columnName);
 	static int row_callback_luaFree	(void* ctx,int colNum,char** columnText,char** columnName);
 
@@ -15,6 +15,7 @@
 */
 #include "CKLBHTTPInterface.h"
 #include "CKLBUtility.h"
+#include "CKLBJsonItem.h"
 #include <string.h>
 #include <ctype.h>
 #include <openssl/evp.h>
@@ -200,7 +201,18 @@ void CKLBHTTPInterface::download() {
 		// curl_easy_setopt(m_pCurl, CURLOPT_ACCEPT_ENCODING,	"gzip,deflate"); // I'm too lazy to decompress it later
 		CURLcode res = curl_easy_perform(m_pCurl);
 		if (res == CURLE_OK) {
-			curl_easy_getinfo (m_pCurl, CURLINFO_RESPONSE_CODE, &m_errorCode);
+			long status = 0;
+			curl_easy_getinfo (m_pCurl, CURLINFO_RESPONSE_CODE, &status);
+			// Parse here : the main thread only has to convert the finished tree.
+			// Done before the status is set, the main thread polls the status too.
+			if (m_parseJson) {
+				if ((status == 304) && m_notModified) {
+					m_pJson = CKLBJsonItem::ReadJsonData((const char*)m_notModified, m_notModifiedSize);
+				} else if (m_buffer && m_writeIndex) {
+					m_pJson = CKLBJsonItem::ReadJsonData((const char*)m_buffer, (u32)m_writeIndex);
+				}
+			}
+			m_errorCode = (int)status;
 			// WARNING : IN THAT ORDER, because of multithreading, flag set LAST, after everything else.
 			m_receivedData	= m_buffer;
 			m_receivedSize	= m_writeIndex;
@@ -303,6 +315,25 @@ size_t CKLBHTTPInterface::headerReceive_func( void *ptr, size_t size, size_t nme
 
 		}
 	}
+	if (strncmpi("ETag:", data, 5) == 0) {
+		u32 lineSize = totalSize - 5;
+		data += 5;
+		while ((lineSize != 0) && (*data == ' ')) {
+			data++;
+			lineSize--;
+		}
+		while ((lineSize != 0) && ((data[lineSize-1] == '\r') || (data[lineSize-1] == '\n') || (data[lineSize-1] == ' '))) {
+			lineSize--;
+		}
+
+		char* mem = (char*)CKLBUtility::copyMem(data, lineSize + 1);
+		if (mem) {
+			mem[lineSize] = 0;
+			KLBDELETEA(((CKLBHTTPInterface*)userdata)->m_pETag);
+			((CKLBHTTPInterface*)userdata)->m_pETag = mem;
+		}
+	}
+
 	if (!((CKLBHTTPInterface*)userdata)->m_stopThread) {
 		return totalSize;
 	} else {
@@ -319,12 +350,33 @@ bool CKLBHTTPInterface::hasHeader(const char* header, const char** value) {
 			*value = m_pServerVersion;
 		}
 		return (m_pServerVersion != NULL);
+	} else if (strcmp("ETag", header) == 0) {
+		if (value) {
+			*value = m_pETag;
+		}
+		return (m_pETag != NULL);
 	} else {
-		klb_assertAlways("Does not support other header for now than 'Server-Version'");
+		klb_assertAlways("Does not support other header for now than 'Server-Version' and 'ETag'");
 		return false;
 	}
 }
 
+CKLBJsonItem* CKLBHTTPInterface::detachJsonTree() {
+	CKLBJsonItem* pJson = m_pJson;
+	m_pJson = NULL;
+	return pJson;
+}
+
+bool CKLBHTTPInterface::setNotModifiedBody(const u8* body, u32 size) {
+	KLBDELETEA(m_notModified);
+	m_notModified		= KLBNEWA(u8, size);
+	m_notModifiedSize	= m_notModified ? size : 0;
+	if (m_notModified) {
+		memcpy(m_notModified, body, size);
+	}
+	return (m_notModified != NULL);
+}
+
 
 // static
 int CKLBHTTPInterface::progress_func(	void* ctx, 
@@ -552,6 +604,12 @@ void CKLBHTTPInterface::init() {
 	m_pCurl             = NULL;
 	m_postForm          = NULL;
 	m_pServerVersion    = NULL;
+	m_pETag             = NULL;
+	m_pJson             = NULL;
+	m_notModified       = NULL;
+	m_notModifiedSize   = 0;
+	m_parseJson         = false;
+	m_shareable         = false;
 	m_maintenance       = false;
 	m_threadStop        = 0;
 	m_stopThread        = false;
@@ -568,6 +626,9 @@ void CKLBHTTPInterface::clear() {
 	KLBDELETEA(m_headerEntry);
 	KLBDELETEA(m_headerEntryLen);
 	KLBDELETEA(m_pServerVersion);
+	KLBDELETEA(m_pETag);
+	KLBDELETE(m_pJson);
+	KLBDELETEA(m_notModified);
 
 	if (m_postForm) {
 		u32 i = 0;
@@ -585,6 +646,9 @@ void CKLBHTTPInterface::clear() {
 	m_headerEntry		= NULL;
 	m_headerEntryLen	= NULL;
 	m_pServerVersion	= NULL;
+	m_pETag				= NULL;
+	m_pJson				= NULL;
+	m_notModified		= NULL;
 
 	init();
 }
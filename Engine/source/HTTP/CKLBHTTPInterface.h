@@ -28,6 +28,7 @@
 
 #ifdef USE_NEW_CURL_WRAPPER
 class ConnectionEntry;
+class CKLBJsonItem;
 
 /*!
 * \class CKLBHTTPInterface
@@ -76,6 +77,20 @@ public:
 	inline bool isMaintenance() { return this->m_maintenance; }
 	inline bool isOutdated() { return this->m_versionup; }
 	bool hasHeader(const char* header, const char** value);
+
+	// Body is parsed as JSON by the connection thread when completed.
+	// The tree belongs to the connection unless detached.
+	inline void				setParseJson	(bool parse)	{ m_parseJson = parse;	}
+	inline CKLBJsonItem*	getJsonTree		()				{ return m_pJson;		}
+	CKLBJsonItem*			detachJsonTree	();
+	// Body sent with If-None-Match (copied) : parsed instead of the empty reply on 304.
+	bool					setNotModifiedBody(const u8* body, u32 size);
+
+	// Idempotent GET that other requests on the same URL may join (see NetworkManager).
+	inline void				setShareable	(bool share)	{ m_shareable = share;	}
+	inline bool				isShareable		()				{ return m_shareable;	}
+	inline bool				isPOST			()				{ return m_post;		}
+	inline const char*		getURL			()				{ return m_url;			}
 private:
 	void clear();
 	void init ();
@@ -101,6 +116,12 @@ private:
 	const char*	m_url;
 	void*		m_pCurl;
 	const char*	m_pServerVersion;
+	const char*	m_pETag;
+	CKLBJsonItem*	m_pJson;
+	u8*			m_notModified;
+	u32			m_notModifiedSize;
+	bool		m_parseJson;
+	bool		m_shareable;
 
 	ITmpFile*	m_pTmpFile;
 	s64			m_receivedSize;
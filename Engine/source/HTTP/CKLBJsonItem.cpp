@@ -19,8 +19,139 @@
 #include "../../libs/JSonParser/api/yajl_gen.h"
 
 #include "CPFInterface.h"
+#include "CKLBBenchmark.h"
 #include <string.h>
 
+// ------------------- Document arena ------------------
+//
+// Bump allocator : ReadJsonData makes one allocation per block instead of one
+// per item, key and string, and the whole tree is released in one go.
+//
+
+#define ARENA_MIN_BLOCK		(4 * 1024)
+#define ARENA_MAX_BLOCK		(512 * 1024)
+#define ARENA_KEY_BUCKETS	(512)		// Power of 2.
+
+struct ARENA_BLOCK {
+	ARENA_BLOCK	*	next;
+	u32				size;
+	u32				used;
+};
+
+struct KEY_ENTRY {
+	KEY_ENTRY	*	next;
+	u32				hash;
+	u32				len;
+	char		*	str;
+};
+
+struct CKLBJsonItem::ARENA {
+	ARENA_BLOCK	*	pBlock;
+	u32				nextSize;
+	KEY_ENTRY	**	keyBuckets;		// Interned keys : each key name stored once per document.
+};
+
+#define ARENA_HEADER	((sizeof(ARENA_BLOCK) + 7) & ~7)
+
+static void* arenaAlloc(CKLBJsonItem::ARENA * pArena, u32 size)
+{
+	size = (size + 7) & ~7;
+	ARENA_BLOCK * pBlock = pArena->pBlock;
+	if (!pBlock || (pBlock->used + size > pBlock->size)) {
+		u32 blockSize = pArena->nextSize;
+		if (size > blockSize) { blockSize = size; }
+		pBlock = (ARENA_BLOCK *)KLBMALLOC(ARENA_HEADER + blockSize);
+		if (!pBlock) { return NULL; }
+		pBlock->size	= blockSize;
+		pBlock->used	= 0;
+		pBlock->next	= pArena->pBlock;
+		pArena->pBlock	= pBlock;
+		if (pArena->nextSize < ARENA_MAX_BLOCK) { pArena->nextSize *= 2; }
+	}
+	void * p = ((u8 *)pBlock) + ARENA_HEADER + pBlock->used;
+	pBlock->used += size;
+	return p;
+}
+
+static CKLBJsonItem::ARENA * arenaCreate(u32 jsonSize)
+{
+	CKLBJsonItem::ARENA * pArena = KLBNEW(CKLBJsonItem::ARENA);
+	if (!pArena) { return NULL; }
+
+	// Items take about twice the text size.
+	u32 firstSize = jsonSize * 2;
+	if (firstSize < ARENA_MIN_BLOCK) { firstSize = ARENA_MIN_BLOCK; }
+	if (firstSize > ARENA_MAX_BLOCK) { firstSize = ARENA_MAX_BLOCK; }
+	pArena->pBlock		= NULL;
+	pArena->nextSize	= firstSize;
+	pArena->keyBuckets	= (KEY_ENTRY **)arenaAlloc(pArena, ARENA_KEY_BUCKETS * sizeof(KEY_ENTRY *));
+	if (!pArena->keyBuckets) {
+		KLBDELETE(pArena);
+		return NULL;
+	}
+	memset(pArena->keyBuckets, 0, ARENA_KEY_BUCKETS * sizeof(KEY_ENTRY *));
+	return pArena;
+}
+
+static void arenaRelease(CKLBJsonItem::ARENA * pArena)
+{
+	ARENA_BLOCK * pBlock = pArena->pBlock;
+	while (pBlock) {
+		ARENA_BLOCK * pNext = pBlock->next;
+		KLBFREE(pBlock);
+		pBlock = pNext;
+	}
+	KLBDELETE(pArena);
+}
+
+static char* arenaString(CKLBJsonItem::ARENA * pArena, const char * str, u32 len)
+{
+	char * buf = (char *)arenaAlloc(pArena, len + 1);
+	if (buf) {
+		memcpy(buf, str, len);
+		buf[len] = 0;
+	}
+	return buf;
+}
+
+static inline u32 keyHash(const char * str, u32 len)
+{
+	// FNV-1a
+	u32 hash = 2166136261U;
+	for (u32 n = 0; n < len; n++) {
+		hash = (hash ^ (u8)str[n]) * 16777619U;
+	}
+	return hash;
+}
+
+static const char* internKey(CKLBJsonItem::ARENA * pArena, const char * str, u32 len, u32 hash)
+{
+	KEY_ENTRY ** pBucket = &pArena->keyBuckets[hash & (ARENA_KEY_BUCKETS - 1)];
+	for (KEY_ENTRY * pEntry = *pBucket; pEntry; pEntry = pEntry->next) {
+		if ((pEntry->hash == hash) && (pEntry->len == len) && (memcmp(pEntry->str, str, len) == 0)) {
+			return pEntry->str;
+		}
+	}
+
+	KEY_ENTRY * pEntry = (KEY_ENTRY *)arenaAlloc(pArena, sizeof(KEY_ENTRY));
+	char * buf = arenaString(pArena, str, len);
+	if (!pEntry || !buf) { return NULL; }
+	pEntry->hash	= hash;
+	pEntry->len		= len;
+	pEntry->str		= buf;
+	pEntry->next	= *pBucket;
+	*pBucket		= pEntry;
+	return buf;
+}
+
+/*static*/
+void* CKLBJsonItem::operator new(size_t size, ARENA * pArena) throw()
+{
+	return arenaAlloc(pArena, size);
+}
+
+// ------------------- Item ------------------
+
 CKLBJsonItem::CKLBJsonItem(CKLBJsonItem * pParent)
 : m_pParent     (pParent)
 , m_child_begin (NULL)
@@ -28,6 +159,12 @@ CKLBJsonItem::CKLBJsonItem(CKLBJsonItem * pParent)
 , m_prev        (NULL)
 , m_next        (NULL)
 , m_key         (NULL)
+, m_pArena		(pParent ? pParent->m_pArena : NULL)
+, m_index		(NULL)
+, m_indexMask	(0)
+, m_childCount	(0)
+, m_keyHash		(0)
+, m_type		(J_NULL)
 {
 	if(m_pParent) {
 		m_prev = m_pParent->m_child_end;
@@ -37,12 +174,22 @@ CKLBJsonItem::CKLBJsonItem(CKLBJsonItem * pParent)
 			m_pParent->m_child_begin = this;
 		}
 		m_pParent->m_child_end = this;
+		m_pParent->m_childCount++;
+		m_pParent->m_index = NULL;	// Rebuilt on next search.
 	}
 	memset(&m_value, 0, sizeof(union VAR));
 }
 
 CKLBJsonItem::~CKLBJsonItem()
 {
+	if(m_pArena) {
+		// Items, keys and strings all live in the arena : the root frees it at once.
+		if(!m_pParent) {
+			arenaRelease(m_pArena);
+		}
+		return;
+	}
+
 	// 自身の子を削除する
 	CKLBJsonItem * pItem = m_child_begin;
 	CKLBJsonItem * pNext;
@@ -76,19 +223,76 @@ CKLBJsonItem::~CKLBJsonItem()
 bool
 CKLBJsonItem::setKey(const char * keyname)
 {
-	m_key = CKLBUtility::copyString(keyname);
+	u32 len   = strlen(keyname);
+	m_keyHash = keyHash(keyname, len);
+	if(m_pArena) {
+		m_key = internKey(m_pArena, keyname, len, m_keyHash);
+	} else {
+		m_key = CKLBUtility::copyString(keyname);
+	}
     if(!m_key) { return false; }
+	if(m_pParent) { m_pParent->m_index = NULL; }
+	return true;
+}
+
+bool
+CKLBJsonItem::buildIndex()
+{
+	u32 size = 16;
+	while(size < m_childCount * 2) { size <<= 1; }
+
+	CKLBJsonItem ** index = (CKLBJsonItem **)arenaAlloc(m_pArena, size * sizeof(CKLBJsonItem *));
+	if(!index) { return false; }
+	memset(index, 0, size * sizeof(CKLBJsonItem *));
+
+	// Insert in order : with linear probing the first of duplicated keys is found first.
+	for(CKLBJsonItem * pItem = m_child_begin; pItem; pItem = pItem->m_next) {
+		if(!pItem->m_key) { continue; }
+		u32 slot = pItem->m_keyHash & (size - 1);
+		while(index[slot]) { slot = (slot + 1) & (size - 1); }
+		index[slot] = pItem;
+	}
+	m_index		= index;
+	m_indexMask	= size - 1;
 	return true;
 }
 
 CKLBJsonItem *
 CKLBJsonItem::searchChild(const char * key)
 {
+	if(m_pArena && (m_childCount > INDEX_MIN_CHILD) && (m_index || buildIndex())) {
+		u32 hash = keyHash(key, strlen(key));
+		u32 slot = hash & m_indexMask;
+		CKLBJsonItem * pItem;
+		while((pItem = m_index[slot]) != NULL) {
+			if((pItem->m_keyHash == hash) && !strcmp(pItem->m_key, key)) { return pItem; }
+			slot = (slot + 1) & m_indexMask;
+		}
+		return NULL;
+	}
+
 	CKLBJsonItem * pItem = m_child_begin;
-    while(pItem && strcmp(pItem->m_key, key)) { pItem = pItem->m_next; }
+    while(pItem && (!pItem->m_key || strcmp(pItem->m_key, key))) { pItem = pItem->m_next; }
 	return pItem;
 }
 
+// Items of a parsed document : root on the heap (owner of the arena), others in the arena.
+/*static*/
+CKLBJsonItem *
+CKLBJsonItem::newItem(void * ctx)
+{
+	JSON_State * pState = (JSON_State *)ctx;
+
+	CKLBJsonItem * pItem;
+	if(pState->pParent) {
+		pItem = new(pState->pArena) CKLBJsonItem(pState->pParent);
+	} else {
+		pItem = KLBNEWC(CKLBJsonItem, (NULL));
+		if(pItem) { pItem->m_pArena = pState->pArena; }
+	}
+	if(pItem && !pState->pFirst) { pState->pFirst = pItem; }
+	return pItem;
+}
 
 CKLBJsonItem *
 CKLBJsonItem::ReadJsonData(const char * json_string, u32 json_size)
@@ -116,36 +320,47 @@ CKLBJsonItem::ReadJsonData(const char * json_string, u32 json_size)
 	
 //    g = yajl_gen_alloc(NULL);		// 2012.12.05  使用していなかったのでコメントアウト
 
-	JSON_State * pState = KLBNEW(JSON_State);
-	pState->pCurrent = NULL;
-	pState->pFirst   = NULL;
-	pState->pParent  = NULL;
+	u32 size = (!json_size) ? strlen(json_string) : json_size;
+
+	JSON_State state;
+	state.pCurrent = NULL;
+	state.pFirst   = NULL;
+	state.pParent  = NULL;
+	state.pArena   = arenaCreate(size);
+	if (!state.pArena) {
+		return NULL;
+	}
 
 	/* ok.  open file.  let's read and parse */  
-	hand = yajl_alloc(&callbacks, NULL, pState);
+	hand = yajl_alloc(&callbacks, NULL, &state);
 
 	if (hand) {
 		/* and let's allow comments by default */  
 		yajl_config(hand, yajl_allow_comments, 1);
 
-		u32 size = (!json_size) ? strlen(json_string) : json_size;
 		stat = yajl_parse(hand, (const unsigned char *)json_string, size);
 
-		CKLBJsonItem * pRoot = pState->pFirst;
-		KLBDELETE(pState);
-
 		if (stat == yajl_status_ok) {
 			stat = yajl_complete_parse(hand);
-			if (stat == yajl_status_ok) {
-				yajl_free(hand);
-				s64 time = CPFInterface::getInstance().platform().nanotime() - start;
-				DEBUG_PRINT("JSon -> Tree : %f ms",(float)(time / 1000000.0));
-				return pRoot;
-			}
 		}
-        if(pRoot) { KLBDELETE(pRoot); }     // 2012.12.12  NULLチェック追加
+		yajl_free(hand);
+	} else {
+		stat = yajl_status_error;
 	}
 
+	CKLBJsonItem * pRoot = state.pFirst;
+	if (!pRoot) {
+		// Arena not taken by a root item.
+		arenaRelease(state.pArena);
+	}
+
+	if (stat == yajl_status_ok) {
+		s64 time = CPFInterface::getInstance().platform().nanotime() - start;
+		DEBUG_PRINT("JSon -> Tree : %f ms",(float)(time / 1000000.0));
+		return pRoot;
+	}
+
+    if(pRoot) { KLBDELETE(pRoot); }     // 2012.12.12  NULLチェック追加
 	return NULL;
 }
 
@@ -159,7 +374,8 @@ CKLBJsonItem::read_null(void * ctx)
 	if(pState->pCurrent) {
 		pItem = pState->pCurrent;
 	} else {
-		pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+		pItem = newItem(pState);
+		if(!pItem) return 0;
 	}
 	pItem->m_type    = J_NULL;
 	pState->pCurrent = NULL;
@@ -175,7 +391,8 @@ CKLBJsonItem::read_boolean(void * ctx, int boolean)
 	if(pState->pCurrent) {
 		pItem = pState->pCurrent;
 	} else {
-		pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+		pItem = newItem(pState);
+		if(!pItem) return 0;
 	}
 	pItem->m_type    = J_BOOLEAN;
 	pItem->m_value.b = (boolean != 0) ? true : false;
@@ -192,7 +409,8 @@ CKLBJsonItem::read_int(void * ctx, long long integerVal)
 	if(pState->pCurrent) {
 		pItem = pState->pCurrent;
 	} else {
-		pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+		pItem = newItem(pState);
+		if(!pItem) return 0;
 	}
 	pItem->m_type    = J_INT;
 	pItem->m_value.i = integerVal;
@@ -209,7 +427,8 @@ CKLBJsonItem::read_double(void * ctx, double doubleVal)
 	if(pState->pCurrent) {
 		pItem = pState->pCurrent;
 	} else {
-		pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+		pItem = newItem(pState);
+		if(!pItem) return 0;
 	}
 	pItem->m_type    = J_DOUBLE;
 	pItem->m_value.d = doubleVal;
@@ -223,18 +442,17 @@ CKLBJsonItem::read_string(void * ctx, const unsigned char * stringVal, size_t st
 {
 	JSON_State * pState = (JSON_State *)ctx;
 
-	char * buf = KLBNEWA(char, stringLen + 1);
-	strncpy(buf, (const char *)stringVal, stringLen);
-	buf[stringLen] = 0;
-
 	CKLBJsonItem * pItem;
 	if(pState->pCurrent) {
 		pItem = pState->pCurrent;
-		pItem->m_type    = J_STRING;
-		pItem->m_value.s = buf;
 	} else {
-		pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+		pItem = newItem(pState);
+		if(!pItem) return 0;
 	}
+
+	char * buf = arenaString(pState->pArena, (const char *)stringVal, stringLen);
+	if(!buf) return 0;
+
 	pItem->m_type    = J_STRING;
 	pItem->m_value.s = buf;
 	pState->pCurrent = NULL;
@@ -247,9 +465,8 @@ CKLBJsonItem::read_start_map(void * ctx, unsigned int /*size*/)
 	JSON_State * pState = (JSON_State *)ctx;
 
 	if(!pState->pCurrent) {
-		CKLBJsonItem * pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
-		pState->pCurrent = pItem;
-		if(!pState->pFirst) pState->pFirst = pItem;
+		pState->pCurrent = newItem(pState);
+		if(!pState->pCurrent) return 0;
 	}
 	pState->pCurrent->m_type = J_MAP;
 
@@ -264,16 +481,15 @@ CKLBJsonItem::read_map_key(void * ctx, const unsigned char * stringVal, size_t s
 {
 	JSON_State * pState = (JSON_State *)ctx;
 
-	CKLBJsonItem * pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
+	CKLBJsonItem * pItem = newItem(pState);
+	if(!pItem) return 0;
 	pState->pCurrent = pItem;
-	if(!pState->pFirst) pState->pFirst = pItem;
 
-	char buf[256];
-	strncpy(buf, (const char *)stringVal, stringLen);
-	buf[stringLen] = 0;
-	pItem->setKey((const char *)buf);
+	// Same key names in every object of an array : stored once.
+	pItem->m_keyHash = keyHash((const char *)stringVal, stringLen);
+	pItem->m_key     = internKey(pState->pArena, (const char *)stringVal, stringLen, pItem->m_keyHash);
 
-	return 1;
+	return (pItem->m_key != NULL);
 }
 
 int
@@ -294,9 +510,8 @@ CKLBJsonItem::read_start_array(void * ctx, unsigned int /*size*/)
 	JSON_State * pState = (JSON_State *)ctx;
 
 	if(!pState->pCurrent) {
-		CKLBJsonItem * pItem = KLBNEWC(CKLBJsonItem, (pState->pParent));
-		pState->pCurrent = pItem;
-		if(!pState->pFirst) pState->pFirst = pItem;
+		pState->pCurrent = newItem(pState);
+		if(!pState->pCurrent) return 0;
 	}
 
 	pState->pCurrent->m_type = J_ARRAY;
@@ -318,3 +533,77 @@ CKLBJsonItem::read_end_array(void * ctx)
 
 	return 1;
 }
+
+#ifdef INTERNAL_BENCH
+#include <stdio.h>
+
+// Document of 2000 keys, a duplicated key and a 4096 element array : parse + free of the tree,
+// then searchChild on every key against a strcmp walk of the children as before the index.
+// Both must find the same item, duplicates resolve to the first one, unknown keys to NULL.
+static bool benchJsonTree(u32 loops) {
+	const u32 keys		= 2000;
+	const u32 elements	= 4096;
+	char* json = KLBNEWA(char, (keys * 20) + (elements * 6) + 64);
+	if (!json) { return false; }
+
+	u32 size = 0;
+	json[size++] = '{';
+	for (u32 n = 0; n < keys; n++) {
+		size += sprintf(&json[size], "\"key_%i\":%i,", n, n);
+	}
+	size += sprintf(&json[size], "\"dup\":1,\"dup\":2,\"arr\":[");
+	for (u32 n = 0; n < elements; n++) {
+		size += sprintf(&json[size], n ? ",%i" : "%i", n);
+	}
+	size += sprintf(&json[size], "]}");
+
+	bool ok = true;
+	s64 t0 = CKLBBenchmark::now();
+	for (u32 l = 0; l < loops; l++) {
+		CKLBJsonItem* pRoot = CKLBJsonItem::ReadJsonData(json, size);
+		ok &= (pRoot != NULL);
+		KLBDELETE(pRoot);
+	}
+	s64 t1 = CKLBBenchmark::now();
+	CKLBBenchmark::report("parse + free 2000 keys + 4096 ints", loops, t1 - t0);
+
+	CKLBJsonItem* pRoot = ok ? CKLBJsonItem::ReadJsonData(json, size) : NULL;
+	if (pRoot) {
+		char name[16];
+		s64 timeIndex	= 0;
+		s64 timeWalk	= 0;
+		for (u32 l = 0; ok && (l < loops); l++) {
+			u32 n = l % keys;
+			sprintf(name, "key_%i", n);
+
+			s64 t2 = CKLBBenchmark::now();
+			CKLBJsonItem* pFound = pRoot->searchChild(name);
+			s64 t3 = CKLBBenchmark::now();
+			CKLBJsonItem* pWalk = pRoot->child();
+			while (pWalk && strcmp(pWalk->key(), name)) {
+				pWalk = pWalk->next();
+			}
+			s64 t4 = CKLBBenchmark::now();
+			timeIndex	+= t3 - t2;
+			timeWalk	+= t4 - t3;
+
+			ok = pFound && (pFound == pWalk) && (pFound->getInt() == (int)n);
+		}
+		CKLBBenchmark::report("searchChild (indexed)", loops, timeIndex);
+		CKLBBenchmark::report("child walk with strcmp", loops, timeWalk);
+
+		CKLBJsonItem* pDup = pRoot->searchChild("dup");
+		CKLBJsonItem* pArr = pRoot->searchChild("arr");
+		ok = ok && pDup && (pDup->getInt() == 1) && (pRoot->searchChild("missing") == NULL)
+				&& pArr && (pArr->childCount() == elements);
+		KLBDELETE(pRoot);
+	} else {
+		ok = false;
+	}
+
+	KLBDELETEA(json);
+	return ok;
+}
+
+static CKLBBenchmark gBenchJsonTree("JSONTREE", benchJsonTree);
+#endif
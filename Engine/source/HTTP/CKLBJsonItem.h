@@ -23,14 +23,23 @@
 * \class CKLBJsonItem
 * \brief JSON Item Class
 * 
-* 
+* Trees returned by ReadJsonData keep all their items, keys and strings in one
+* arena owned by the root : only the root may be deleted, and it frees everything
+* at once.
 */
 class CKLBJsonItem
 {
 public:
+	struct ARENA;
+
 	CKLBJsonItem(CKLBJsonItem * pParent);
 	virtual ~CKLBJsonItem();
 
+	static void* operator new		(size_t size)					{ return ::operator new(size);	}
+	static void* operator new		(size_t size, ARENA * pArena) throw();
+	static void  operator delete	(void * p)						{ ::operator delete(p);			}
+	static void  operator delete	(void * /*p*/, ARENA * /*pArena*/)	{ /* Freed with the arena. */	}
+
 	// キー取得
 	inline const char * key() const { return m_key; }
 
@@ -57,6 +66,7 @@ public:
 	inline CKLBJsonItem * prev	() { return m_prev;			}
 	inline CKLBJsonItem * child	() { return m_child_begin;	}
 	inline CKLBJsonItem * parent() { return m_pParent;		}
+	inline u32 childCount() const  { return m_childCount;	}
 
 	inline bool getBool	() const { return m_value.b;		}
 	inline int  getInt	() const { return (int)getInt64();	}
@@ -94,6 +104,12 @@ public:
 	CKLBJsonItem * searchChild(const char * key);
 
 private:
+	// Objects with more children than this get a hash index on first search.
+	enum { INDEX_MIN_CHILD = 8 };
+
+	bool	buildIndex		();
+	static	CKLBJsonItem *	newItem(void * ctx);
+
 	CKLBJsonItem	*	m_pParent;	// 親アイテム
 
 	CKLBJsonItem	*	m_child_begin;	// 子アイテム
@@ -104,6 +120,12 @@ private:
 
 	const char		*	m_key;		// キー(名前)
 
+	ARENA			*	m_pArena;	// Document memory, NULL for items built by hand.
+	CKLBJsonItem	**	m_index;	// Child hash index (arena), built by searchChild.
+	u32					m_indexMask;
+	u32					m_childCount;
+	u32					m_keyHash;
+
 private:
 
 	union VAR {
@@ -119,6 +141,7 @@ private:
 		CKLBJsonItem	*	pParent;
 		CKLBJsonItem	*	pCurrent;
 		CKLBJsonItem	*	pFirst;
+		ARENA			*	pArena;
 	} JSON_State;
 
 	static int read_null		(void * ctx);
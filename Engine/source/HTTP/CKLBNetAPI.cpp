@@ -20,6 +20,7 @@
 #include "CPFInterface.h"
 #include "CKLBNetAPIKeyChain.h"
 #include "SIF_Win32.h"
+#include "CKLBBenchmark.h"
 #include <time.h>
 #include <ctype.h>
 
@@ -27,6 +28,124 @@
 
 static int fail_times = 0;
 
+//
+// Responses of idempotent GET requests, keyed by URL and validated with ETag.
+// A request sent with If-None-Match carries a copy of the stored body : on 304 the
+// connection thread parses that copy, so eviction meanwhile does not matter.
+//
+struct RESPONSE_CACHE {
+	RESPONSE_CACHE*	next;
+	const char*		url;
+	const char*		etag;
+	u8*				body;
+	u32				size;
+	u32				hash;
+};
+
+#define NETAPI_CACHE_MAX_BYTES	(2 * 1024 * 1024)
+
+static RESPONSE_CACHE*	gm_cacheList	= NULL;	// Most recently used first.
+static u32				gm_cacheBytes	= 0;
+
+static u32 cacheHash(const char* url)
+{
+	// FNV-1a
+	u32 hash = 2166136261U;
+	while (*url) {
+		hash = (hash ^ (u8)(*url++)) * 16777619U;
+	}
+	return hash;
+}
+
+static void cacheFree(RESPONSE_CACHE* pEntry)
+{
+	gm_cacheBytes -= pEntry->size;
+	KLBDELETEA(pEntry->url);
+	KLBDELETEA(pEntry->etag);
+	KLBDELETEA(pEntry->body);
+	KLBDELETE(pEntry);
+}
+
+static RESPONSE_CACHE* cacheFind(const char* url)
+{
+	u32 hash = cacheHash(url);
+	RESPONSE_CACHE* pPrev	= NULL;
+	RESPONSE_CACHE* pEntry	= gm_cacheList;
+	while (pEntry) {
+		if ((pEntry->hash == hash) && (strcmp(pEntry->url, url) == 0)) {
+			if (pPrev) {
+				pPrev->next		= pEntry->next;
+				pEntry->next	= gm_cacheList;
+				gm_cacheList	= pEntry;
+			}
+			return pEntry;
+		}
+		pPrev	= pEntry;
+		pEntry	= pEntry->next;
+	}
+	return NULL;
+}
+
+static void cacheRemove(const char* url)
+{
+	RESPONSE_CACHE* pEntry = cacheFind(url);
+	if (pEntry) {
+		// Found entry is now the head.
+		gm_cacheList = pEntry->next;
+		cacheFree(pEntry);
+	}
+}
+
+static void cacheStore(const char* url, const char* etag, const u8* body, u32 size)
+{
+	cacheRemove(url);
+	if (size > NETAPI_CACHE_MAX_BYTES / 4) {
+		return;
+	}
+
+	// Evict least recently used.
+	while (gm_cacheList && (gm_cacheBytes + size > NETAPI_CACHE_MAX_BYTES)) {
+		RESPONSE_CACHE** ppLast = &gm_cacheList;
+		while ((*ppLast)->next) {
+			ppLast = &(*ppLast)->next;
+		}
+		cacheFree(*ppLast);
+		*ppLast = NULL;
+	}
+
+	RESPONSE_CACHE* pEntry	= KLBNEW(RESPONSE_CACHE);
+	u8* copy				= KLBNEWA(u8, size);
+	const char* urlCopy		= CKLBUtility::copyString(url);
+	const char* etagCopy	= CKLBUtility::copyString(etag);
+	if (!pEntry || !copy || !urlCopy || !etagCopy) {
+		KLBDELETE(pEntry);
+		KLBDELETEA(copy);
+		KLBDELETEA(urlCopy);
+		KLBDELETEA(etagCopy);
+		return;
+	}
+
+	memcpy(copy, body, size);
+	pEntry->url		= urlCopy;
+	pEntry->etag	= etagCopy;
+	pEntry->body	= copy;
+	pEntry->size	= size;
+	pEntry->hash	= cacheHash(url);
+	pEntry->next	= gm_cacheList;
+	gm_cacheList	= pEntry;
+	gm_cacheBytes	+= size;
+}
+
+/*static*/
+void CKLBNetAPI::purgeResponseCache()
+{
+	while (gm_cacheList) {
+		RESPONSE_CACHE* pNext = gm_cacheList->next;
+		cacheFree(gm_cacheList);
+		gm_cacheList = pNext;
+	}
+}
+
 enum {
 	// Command Values
 	NETAPI_STARTUP,				// start new account
@@ -123,6 +242,13 @@ int get_statuscode(CKLBJsonItem* response)
 {
 	int status_code = 0;
 
+	// Response is the first member of the object : use the indexed lookup.
+	if(response && response->parent())
+	{
+		CKLBJsonItem* pItem = response->parent()->searchChild("status_code");
+		return pItem ? pItem->getInt() : 0;
+	}
+
 	while(status_code == 0 && response != NULL)
 	{
 		if(strcmp(response->key(), "status_code") == 0)
@@ -189,6 +315,7 @@ void CKLBNetAPI::startUp(int phase, int status_code)
 			NetworkManager::releaseConnection(m_http);
 			m_http = NetworkManager::createConnection();
 			m_http->reuse();
+			m_http->setParseJson(true);
 			m_http->setForm(form);
 			set_header(m_http, authorize);
 
@@ -221,6 +348,7 @@ void CKLBNetAPI::startUp(int phase, int status_code)
 			NetworkManager::releaseConnection(m_http);
 			m_http = NetworkManager::createConnection();
 			m_http->reuse();
+			m_http->setParseJson(true);
 			m_http->setForm(form);
 			set_header(m_http, authorize);
 
@@ -276,6 +404,7 @@ void CKLBNetAPI::login(int phase, int status_code)
 			NetworkManager::releaseConnection(m_http);
 			m_http = NetworkManager::createConnection();
 			m_http->reuse();
+			m_http->setParseJson(true);
 			m_http->setForm(form);
 			set_header(m_http, authorize);
 
@@ -332,6 +461,7 @@ void CKLBNetAPI::request_authkey(int timeout)
 	CKLBNetAPIKeyChain& kc = CKLBNetAPIKeyChain::getInstance();
 	CKLBHTTPInterface* http = NetworkManager::createConnection();
 	http->reuse();
+	http->setParseJson(true);
 
 	// Authorize string
 	{
@@ -397,10 +527,54 @@ CKLBNetAPI::execute(u32 deltaT)
 		// 
 		freeJSonResult();
 
-		if(bodyLen > 0) m_pRoot = getJsonTree((const char*)body, bodyLen);
+		// The connection thread parsed the body (or on 304 the copy sent with If-None-Match).
+		// Startup and login keep the tree for their next phase. Other trees stay with the
+		// connection, which may be shared : it is released after the callback.
+		CKLBJsonItem* pTree;
+		if((m_request_type == NETAPI_STARTUP) || (m_request_type == NETAPI_LOGIN)) {
+			pTree = m_pRoot = m_http->detachJsonTree();
+		} else {
+			pTree = m_http->getJsonTree();
+		}
+
+		if(state == 304)
+		{
+			if(pTree == NULL)
+			{
+				// Nothing to answer with (joined a shared request without the validated body) :
+				// same request again, unconditional and not shared.
+				char url[MAX_PATH];
+				sprintf(url, "%.*s", MAX_PATH - 1, m_http->getURL() ? m_http->getURL() : "");
+				cacheRemove(url);
+				NetworkManager::releaseConnection(m_http);
+				m_http = NetworkManager::createConnection();
+				if(m_http)
+				{
+					m_http->setParseJson(true);
+					m_http->httpGET(url, false);
+					m_timestart = 0;
+				}
+				else
+				{
+					lua_callback(NETAPIMSG_SERVER_ERROR, state, NULL, m_nonce);
+				}
+				return;
+			}
+
+			// Not modified : answered with the stored body.
+			m_nonce++;
+			fail_times = 0;
+
+			CKLBHTTPInterface* http = m_http;
+			m_http = NULL;
+			m_request_type = (-1);
+			lua_callback(NETAPIMSG_REQUEST_SUCCESS, 200, pTree, m_nonce - 1);
+			NetworkManager::releaseConnection(http);
+			return;
+		}
 
 		/* Upps, server sends invalid JSON */
-		if(m_pRoot == NULL)
+		if((bodyLen == 0) || (pTree == NULL))
 		{
 			NetworkManager::releaseConnection(m_http);
 			m_http = NULL;
@@ -443,19 +617,28 @@ CKLBNetAPI::execute(u32 deltaT)
 			}
 			fail_times = 0;
 
-			NetworkManager::releaseConnection(m_http);
+			// Only valid JSON is kept for 304 replies.
+			const char* etag;
+			if((state == 200) && !m_http->isPOST() && m_http->getURL() && m_http->hasHeader("ETag", &etag))
+			{
+				cacheStore(m_http->getURL(), etag, body, bodyLen);
+			}
+
+			// Tree belongs to the connection : release it after the callback.
+			CKLBHTTPInterface* http = m_http;
 			m_http = NULL;
 			m_request_type = (-1);
-			lua_callback(msg, state, m_pRoot, m_nonce - 1);
+			lua_callback(msg, state, pTree, m_nonce - 1);
+			NetworkManager::releaseConnection(http);
 
 			return;
 		}
 
-		NetworkManager::releaseConnection(m_http);
+		CKLBHTTPInterface* http = m_http;
 		m_http = NULL;
 		m_request_type = (-1);
-
-		lua_callback(msg, state, m_pRoot, m_nonce);
+		lua_callback(msg, state, pTree, m_nonce);
+		NetworkManager::releaseConnection(http);
 
 		return;
 	}
@@ -790,6 +973,7 @@ CKLBNetAPI::commandScript(CLuaState& lua)
 				m_http = NetworkManager::createConnection();
 
 				if (m_http) {
+					m_http->setParseJson(true);
 
 					lua.retValue(3);
 					send_json = CKLBUtility::lua2json(lua, send_json_size);
@@ -819,7 +1003,25 @@ CKLBNetAPI::commandScript(CLuaState& lua)
 						KLBDELETEA(json);
 						KLBDELETEA(authorize);
 					} else {
-						m_http->httpGET(api, false);
+						// Idempotent : join the same request if one is already in flight.
+						CKLBHTTPInterface* shared = NetworkManager::shareConnection(api);
+						if (shared) {
+							NetworkManager::releaseConnection(m_http);
+							m_http = shared;
+						} else {
+							// Validated body goes with the request, a 304 does not depend on the cache.
+							RESPONSE_CACHE* pCached = cacheFind(api);
+							if (pCached && m_http->setNotModifiedBody(pCached->body, pCached->size)) {
+								char ifNoneMatch[256];
+								const char* headers[2];
+								sprintf(ifNoneMatch, "If-None-Match: %.200s", pCached->etag);
+								headers[0] = ifNoneMatch;
+								headers[1] = NULL;
+								m_http->setHeader(headers);
+							}
+							m_http->setShareable(true);
+							m_http->httpGET(api, false);
+						}
 					}
 
 					m_timeout	= lua.getInt(5);
@@ -842,3 +1044,86 @@ CKLBNetAPI::lua_callback(int msg, int status, CKLBJsonItem * pRoot, int uniq)
 {
 	return CKLBScriptEnv::getInstance().call_netAPI_callback(m_callback, this, uniq, msg, status, pRoot);
 }
+
+#ifdef INTERNAL_BENCH
+// GET response cache, on an empty list (the application entries are set aside and restored) :
+// store of 64 URLs with 16 KB bodies, lookup hits in random order and misses.
+// Checks hit bodies, and the 2 MB cap under eviction pressure (least recently used go first).
+static bool benchNetCache(u32 loops) {
+	RESPONSE_CACHE*	savedList	= gm_cacheList;
+	u32				savedBytes	= gm_cacheBytes;
+	gm_cacheList	= NULL;
+	gm_cacheBytes	= 0;
+
+	const u32 urls		= 64;
+	const u32 bodySize	= 16 * 1024;
+	static char urlTable[urls][80];
+	static char missTable[urls][80];
+	for (u32 n = 0; n < urls; n++) {
+		sprintf(urlTable[n],	"https://api.example.com/v1/resource/%i?page=%i", n, n);
+		sprintf(missTable[n],	"https://api.example.com/v1/missing/%i?page=%i", n, n);
+	}
+
+	u8* body = KLBNEWA(u8, bodySize);
+	bool ok = (body != NULL);
+	if (ok) {
+		memset(body, 0x5A, bodySize);
+	}
+
+	s64 timeStore	= 0;
+	s64 timeHit		= 0;
+	s64 timeMiss	= 0;
+	u32 seed		= 1;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; n < urls; n++) {
+			body[0] = (u8)n;
+			cacheStore(urlTable[n], "\"etag\"", body, bodySize);
+		}
+		s64 t1 = CKLBBenchmark::now();
+		for (u32 n = 0; n < urls; n++) {
+			seed = (seed * 1103515245) + 12345;
+			u32 idx = (seed >> 8) % urls;
+			RESPONSE_CACHE* pEntry = cacheFind(urlTable[idx]);
+			ok &= pEntry && (pEntry->size == bodySize) && (pEntry->body[0] == (u8)idx);
+		}
+		s64 t2 = CKLBBenchmark::now();
+		for (u32 n = 0; n < urls; n++) {
+			ok &= (cacheFind(missTable[n]) == NULL);
+		}
+		s64 t3 = CKLBBenchmark::now();
+		timeStore	+= t1 - t0;
+		timeHit		+= t2 - t1;
+		timeMiss	+= t3 - t2;
+	}
+	CKLBBenchmark::report("store 16 KB body", loops * urls, timeStore);
+	CKLBBenchmark::report("lookup hit", loops * urls, timeHit);
+	CKLBBenchmark::report("lookup miss", loops * urls, timeMiss);
+
+	if (ok) {
+		// 4 times the cap : older entries go, the last stored stays and the total fits.
+		char url[80];
+		for (u32 n = 0; n < (NETAPI_CACHE_MAX_BYTES * 4) / bodySize; n++) {
+			sprintf(url, "https://api.example.com/v1/evict/%i", n);
+			body[0] = (u8)n;
+			cacheStore(url, "\"etag\"", body, bodySize);
+		}
+		RESPONSE_CACHE* pLast = cacheFind(url);
+		ok = (gm_cacheBytes <= NETAPI_CACHE_MAX_BYTES) && (cacheFind(urlTable[0]) == NULL)
+		  && pLast && (pLast->body[0] == body[0]);
+		if (!ok) {
+			CPFInterface::getInstance().platform().logging("[BENCH] NETCACHE eviction failed\n");
+		}
+	}
+
+	CKLBNetAPI::purgeResponseCache();
+	gm_cacheList	= savedList;
+	gm_cacheBytes	= savedBytes;
+	if (body) {
+		KLBDELETEA(body);
+	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchNetCache("NETCACHE", benchNetCache);
+#endif
@@ -72,6 +72,7 @@ public:
 	virtual u32 getClassID();
 	static CKLBNetAPI* create(	CKLBTask* pParentTask, 
 								const char * callback);
+	static void purgeResponseCache();
 	void set_header(CKLBHTTPInterface* http, const char* authorize_string);
 	void request_authkey(int timeout);
 	void startUp(int phase, int status_code);
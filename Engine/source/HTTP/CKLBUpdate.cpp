@@ -177,6 +177,12 @@ CKLBUpdate::CKLBUpdate()
 , m_dlSize      (0)
 , m_zipEntry    (0)
 , m_eStep       (S_INIT_DL)
+, m_extracting  (false)
+, m_extractFailed   (false)
+, m_evExtract   (NULL)
+, m_mutex       (NULL)
+, m_reportedEntry   (0)
+, m_thread      (NULL)
 , m_httpIF      (NULL)
 {
 	m_httpIF = NetworkManager::createConnection();
@@ -296,7 +302,7 @@ CKLBUpdate::execute(u32 deltaT)
 	case S_INIT_DL:		exec_init_download(deltaT); break;
 	case S_DOWNLOAD:	exec_download(deltaT);		break;
 	case S_INIT_UNZIP:	exec_init_unzip(deltaT);	break;
-	case S_UNZIP:		/* Now multithreaded */		break;
+	case S_UNZIP:		exec_unzip(deltaT);			break;
 	case S_COMPLETE:	exec_complete(deltaT);		break;
 	case S_FINISHED:	exec_finish(deltaT);		break;
 	}
@@ -312,18 +318,63 @@ CKLBUpdate::threadFunc(void* /*pThread*/, void* data)
 s32 
 CKLBUpdate::workThread() 
 {
-	while (m_eStep != S_COMPLETE) {
-		exec_unzip(0);
-	}
+	// Whole archive extracted by a worker pool, progress is reported by exec_unzip().
+	bool failed = !m_unzip->extractAll("file://external/");
+
+	// Signal then clear the flag in one locked section : once the flag reads false,
+	// the thread does not touch the task any more and die() may free it.
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	pForm.mutexLock(m_mutex);
+	m_extractFailed	= failed;
+	pForm.eventWakeup(m_evExtract);
+	m_extracting	= false;
+	pForm.mutexUnlock(m_mutex);
 	return 1;
 }
 
+bool
+CKLBUpdate::isExtracting()
+{
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	pForm.mutexLock(m_mutex);
+	bool extracting = m_extracting;
+	pForm.mutexUnlock(m_mutex);
+	return extracting;
+}
+
+// Always waits for the thread to be done with the task before releasing it.
+void
+CKLBUpdate::waitThread()
+{
+	if (!m_thread) { return; }
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	pForm.mutexLock(m_mutex);
+	while (m_extracting) {
+		pForm.mutexUnlock(m_mutex);
+		pForm.eventSleep(m_evExtract);
+		pForm.mutexLock(m_mutex);
+	}
+	pForm.mutexUnlock(m_mutex);
+	pForm.deleteThread(m_thread);
+	m_thread = NULL;
+}
+
 void
 CKLBUpdate::die()
 {
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
 	if (m_thread) {
-		CPFInterface::getInstance().platform().deleteThread(m_thread);
-		m_thread = NULL;
+		// Stops after the entries being inflated, the thread uses m_unzip.
+		if (m_unzip) { m_unzip->abortExtract(); }
+		waitThread();
+	}
+	if (m_evExtract) {
+		pForm.freeEventLock(m_evExtract);
+		m_evExtract = NULL;
+	}
+	if (m_mutex) {
+		pForm.freeMutex(m_mutex);
+		m_mutex = NULL;
 	}
 
 	KLBDELETEA(m_zipURL);
@@ -422,56 +473,77 @@ CKLBUpdate::exec_init_unzip(u32 /*deltaT*/)
 		return;
 	}
 
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
 	m_zipEntry   = m_unzip->numEntry();	// あらかじめエントリ数を取得しておく
-	m_extracting = false;
+	m_extracting = true;
+	m_extractFailed = false;
+	m_reportedEntry = 0;
+
+	// New event for each extraction : no wakeup left over from the previous one.
+	if (m_evExtract) {
+		pForm.freeEventLock(m_evExtract);
+	}
+	m_evExtract = pForm.allocEventLock();
+	if (!m_mutex) {
+		m_mutex = pForm.allocMutex();
+	}
+	if (m_evExtract && m_mutex) {
+		m_thread = pForm.createThread(threadFunc,this);
+	}
+	if (!m_thread) {
+		// Keep the zip and the lock file, retry like an invalid zip file.
+		m_extracting = false;
+		KLBDELETE(m_unzip);
+		m_unzip = NULL;
+		TaskbarProgress::SetValue(100, 100);
+		TaskbarProgress::ProgressRed();
+		CKLBScriptEnv::getInstance().call_eventUpdateError(m_callbackError, this);
+		DEBUG_PRINT("[update] can not start the extraction thread");
+		return;
+	}
 	m_eStep      = S_UNZIP;
 
 	TaskbarProgress::ProgressGreen();
 	TaskbarProgress::SetValue(0, m_zipEntry);
-
-	m_thread = CPFInterface::getInstance().platform().createThread(threadFunc,this);
 }
 
 void
 CKLBUpdate::exec_unzip(u32 /*deltaT*/)
 {
-	bool bResult = true;
-	if(m_extracting) {
-		if(m_unzip->isFinishExtract()) {
-			// 戻り値が true であれば読み込みが終わっている
-			m_extracting = false;
-			bResult = m_unzip->gotoNextFile();	// 次のファイルへ
-
-			// 現在展開済みのファイル数を得る
-			int finished = m_unzip->getFinishedEntry();
-			CKLBScriptEnv::getInstance().call_eventUpdateZIP(m_callbackZIP, this, finished, m_zipEntry);
-
-			if(!bResult) {
-				// 展開終了
-				KLBDELETE(m_unzip);
-				m_unzip = NULL;
-				// テンポラリzip削除
-				CPFInterface::getInstance().platform().removeTmpFile(m_tmpPath);
-				m_eStep = S_COMPLETE;
-			}
-		}
+	// Read the flag first : once it is false, the count is final.
+	bool extracting	= isExtracting();
+
+	// 現在展開済みのファイル数を得る
+	int finished	= m_unzip->getFinishedEntry();
+	if (finished != m_reportedEntry) {
+		m_reportedEntry = finished;
+		CKLBScriptEnv::getInstance().call_eventUpdateZIP(m_callbackZIP, this, finished, m_zipEntry);
 	}
-	// 次のファイルがあり、なおかつ展開処理が終了していれば次のファイルの読み込みを開始する
-	if(bResult && !m_extracting) {
-		if(m_unzip->readCurrentFileInfo()) {
-			m_unzip->extractCurrentFile("file://external/");
-			m_extracting = true;
+
+	if (!extracting) {
+		// 展開終了
+		waitThread();
+		KLBDELETE(m_unzip);
+		m_unzip = NULL;
+		if (m_extractFailed) {
+			// Keep the zip and the lock file : extraction starts again from the first entry.
+			TaskbarProgress::SetValue(100, 100);
+			TaskbarProgress::ProgressRed();
+			CKLBScriptEnv::getInstance().call_eventUpdateError(m_callbackError, this);
+			DEBUG_PRINT("[update] zip extraction failed. retry.");
+			m_eStep = S_INIT_UNZIP;
+			return;
 		}
+		// テンポラリzip削除
+		CPFInterface::getInstance().platform().removeTmpFile(m_tmpPath);
+		m_eStep = S_COMPLETE;
 	}
 }
 
 void
 CKLBUpdate::exec_complete(u32 /*deltaT*/) 
 {
-	if (m_thread) {
-		CPFInterface::getInstance().platform().deleteThread(m_thread);
-		m_thread = NULL;
-	}
+	waitThread();
 	// Delete Update State file.
 	m_eStep = S_FINISHED;
 	CPFInterface::getInstance().platform().removeTmpFile(gUpdateFile);
@@ -88,6 +88,8 @@ protected:
 	bool saveUpdate			();
 
 		   s32					workThread			();
+		   bool					isExtracting		();
+		   void					waitThread			();
 	static s32					threadFunc			(void* pThread, void* data);
 
 protected:
@@ -117,7 +119,13 @@ protected:
 
 	volatile
 	STEP					m_eStep;		// 進行ステップ
+	volatile
 	bool					m_extracting;	// 展開中
+	volatile
+	bool					m_extractFailed;
+	void*					m_evExtract;	// Signaled by the thread when extraction is over, one per extraction
+	void*					m_mutex;		// Guards m_extracting / m_extractFailed and the signal
+	int						m_reportedEntry;
 
 	s64						m_dlSize;	// ダウンロード終了サイズ
 	int						m_zipEntry;	// zip内のエントリ数
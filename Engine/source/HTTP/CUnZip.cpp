@@ -15,6 +15,7 @@
 */
 #include "CPFInterface.h"
 #include "CUnZip.h"
+#include "CKLBBenchmark.h"
 #include <string.h>
 #ifdef _WIN32
 #include <Windows.h>
@@ -28,16 +29,41 @@
 
 CUnZip::CUnZip()
 : m_hUnzip  (0)
-, m_bReady  (false)
+, m_wrfile  (NULL)
 , m_finished_entry  (0) 
+, m_bReady  (false)
+, m_zipPath		(NULL)
+, m_extractRoot	(NULL)
+, m_files		(NULL)
+, m_fileCount	(0)
+, m_fileMax		(0)
+, m_nextFile	(0)
+, m_names		(false)
+, m_mutex		(NULL)
+, m_evDone		(NULL)
+, m_activeWorkers(0)
+, m_abort		(false)
+, m_extractError(false)
 {
 }
 
 CUnZip::CUnZip(const char * zip_path)
 : m_hUnzip      (0)
-, m_bReady      (false)
-, m_finished_entry  (0)
 , m_wrfile      (NULL)
+, m_finished_entry  (0)
+, m_bReady      (false)
+, m_zipPath		(NULL)
+, m_extractRoot	(NULL)
+, m_files		(NULL)
+, m_fileCount	(0)
+, m_fileMax		(0)
+, m_nextFile	(0)
+, m_names		(false)
+, m_mutex		(NULL)
+, m_evDone		(NULL)
+, m_activeWorkers(0)
+, m_abort		(false)
+, m_extractError(false)
 {
 	Open(zip_path);
     memset(m_currentPath, 0, sizeof(m_currentPath));
@@ -46,12 +72,17 @@ CUnZip::CUnZip(const char * zip_path)
 CUnZip::~CUnZip()
 {
 	if(m_hUnzip) unzClose(m_hUnzip);
+	freeExtractList();
+	delete [] m_zipPath;
 }
 
 bool
 CUnZip::Open(const char * zip_path)
 {
 	m_bReady = false;
+	delete [] m_zipPath;
+	m_zipPath = new char [ strlen(zip_path) + 1 ];
+	strcpy(m_zipPath, zip_path);
 	m_hUnzip = unzOpen(zip_path);
 	if (!m_hUnzip){
 		for(int x = 0; x < 3 && m_hUnzip == NULL; x++)
@@ -104,6 +135,16 @@ CUnZip::make_directory(const char * dir_name)
 #endif
 }
 
+bool
+CUnZip::isKnownDirectory(const char * path, u32 len)
+{
+	// Returns true if the directory was already created / checked, otherwise records it.
+	// Out of memory : not recorded, checked again next time.
+	bool added;
+	u32 offset = m_names.insert(path, len, &added);
+	return (offset != CKLBNameTable::NOT_FOUND) && !added;
+}
+
 bool
 CUnZip::CreateDirectoryReflex(const char * assetPath)
 {
@@ -112,6 +153,10 @@ CUnZip::CreateDirectoryReflex(const char * assetPath)
 	for (const char * p = strPath; *p; p++) {
 		if (*p == '/') {
 			int len = p - strPath + 1;
+			// Each directory is checked only once per archive.
+			if (isKnownDirectory(strPath, len)) {
+				continue;
+			}
 			strncpy(strSubPath, strPath, len);
 			strSubPath[len] = 0;
 			if (!IsFileExist(strSubPath)) {
@@ -280,13 +325,328 @@ CUnZip::gotoNextFile()
 bool
 CUnZip::unCompress(const char * extract_root)
 {
-    if(!m_bReady) { return false; }
-	do {
-		if(!readCurrentFileInfo()) {
-			return false;
-		}
-		extractCurrentFile(extract_root);
-	} while (gotoNextFile());
+	return extractAll(extract_root);
+}
+
+void
+CUnZip::freeExtractList()
+{
+	free(m_files);
+	m_files		= NULL;
+	m_fileCount	= 0;
+	m_fileMax	= 0;
+	m_nextFile	= 0;
+}
 
+bool
+CUnZip::queueFile(const char * name, u32 size)
+{
+	if (m_fileCount == m_fileMax) {
+		u32 newMax = m_fileMax ? m_fileMax * 2 : 256;
+		FILE_ENTRY* newFiles = (FILE_ENTRY*)realloc(m_files, newMax * sizeof(FILE_ENTRY));
+		if (!newFiles) { return false; }
+		m_files		= newFiles;
+		m_fileMax	= newMax;
+	}
+
+	FILE_ENTRY& entry = m_files[m_fileCount];
+	if (unzGetFilePos(m_hUnzip, &entry.pos) != UNZ_OK) {
+		return false;
+	}
+	entry.name	= m_names.store(name, strlen(name));
+	if (entry.name == CKLBNameTable::NOT_FOUND) {
+		return false;
+	}
+	entry.size	= size;
+	m_fileCount++;
 	return true;
 }
+
+void
+CUnZip::extractFiles(unzFile hUnzip)
+{
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	unsigned char* buffer	= (unsigned char*)malloc(EXTRACT_BUF_SIZE);
+	char* targetPath		= new char [ strlen(m_extractRoot) + sizeof(m_currentPath) + 1 ];
+
+	while (buffer && targetPath && !m_abort) {
+		pForm.mutexLock(m_mutex);
+		u32 idx = m_nextFile;
+		if (idx < m_fileCount) { m_nextFile++; }
+		pForm.mutexUnlock(m_mutex);
+		if (idx >= m_fileCount) { break; }
+
+		FILE_ENTRY& entry = m_files[idx];
+		strcpy(targetPath, m_extractRoot);
+		strcat(targetPath, m_names.getName(entry.name));
+
+		size_t written = 0;
+		if ((unzGoToFilePos(hUnzip, &entry.pos) == UNZ_OK) && (unzOpenCurrentFile(hUnzip) == UNZ_OK)) {
+			ITmpFile* file = pForm.openTmpFile(targetPath);
+			if (file) {
+				file->reserve(entry.size);
+				int sizeRead;
+				while ((sizeRead = unzReadCurrentFile(hUnzip, buffer, EXTRACT_BUF_SIZE)) > 0) {
+					written += file->writeTmp(buffer, sizeRead);
+				}
+				delete file;
+			}
+			unzCloseCurrentFile(hUnzip);
+		}
+
+		// 展開後処理の呼び出し
+		pForm.mutexLock(m_mutex);
+		if (written != entry.size) { m_extractError = true; }
+		m_finished_entry++;
+		afterExtract(targetPath, false, written);
+		pForm.mutexUnlock(m_mutex);
+	}
+
+	delete [] targetPath;
+	free(buffer);
+}
+
+s32
+CUnZip::ThreadExtractWorker(void * /* hThread */, void * data)
+{
+	CUnZip* pUnZip = (CUnZip*)data;
+
+	// Each worker reads the archive through its own handle.
+	unzFile hUnzip = unzOpen(pUnZip->m_zipPath);
+	if (hUnzip) {
+		pUnZip->extractFiles(hUnzip);
+		unzClose(hUnzip);
+	}
+
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	pForm.mutexLock(pUnZip->m_mutex);
+	pUnZip->m_activeWorkers--;
+	pForm.mutexUnlock(pUnZip->m_mutex);
+	pForm.eventWakeup(pUnZip->m_evDone);
+	return 0;
+}
+
+bool
+CUnZip::extractAll(const char * extract_root)
+{
+	if(!m_bReady) { return false; }
+
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	m_extractRoot	= extract_root;
+	m_extractError	= false;
+	m_abort			= false;
+	freeExtractList();
+
+	// Read the central directory once : directories and empty files are done right away
+	// (one lookup per directory), the other files are queued for the workers.
+	char * targetPath = new char [ strlen(extract_root) + sizeof(m_currentPath) + 1 ];
+	int res = unzGoToFirstFile(m_hUnzip);
+	while ((res == UNZ_OK) && !m_abort) {
+		if (!readCurrentFileInfo() || !m_lenPath) {
+			m_extractError = true;
+			break;
+		}
+		strcpy(targetPath, extract_root);
+		strcat(targetPath, m_currentPath);
+		CreateDirectoryReflex(targetPath);	// 指定されたディレクトリが無ければ作る
+
+		if (m_currentPath[m_lenPath - 1] == '/') {
+			m_finished_entry++;
+			afterExtract(targetPath, true, 0);
+		} else if (!m_fileInfo.uncompressed_size) {
+			ITmpFile* file = pForm.openTmpFile(targetPath);
+			if (file) {
+				delete file;
+			} else {
+				m_extractError = true;
+			}
+			m_finished_entry++;
+			afterExtract(targetPath, false, 0);
+		} else if (!queueFile(m_currentPath, m_fileInfo.uncompressed_size)) {
+			m_extractError = true;
+			break;
+		}
+		res = unzGoToNextFile(m_hUnzip);
+	}
+	delete [] targetPath;
+
+	if (m_fileCount && !m_abort) {
+		m_mutex		= pForm.allocMutex();
+		m_evDone	= pForm.allocEventLock();
+
+		void* hWorkers[EXTRACT_WORKERS - 1];
+		u32 workerCount = 0;
+		if (m_mutex && m_evDone) {
+			u32 wanted = (m_fileCount < EXTRACT_WORKERS) ? m_fileCount - 1 : EXTRACT_WORKERS - 1;
+			m_activeWorkers = wanted;
+			for (; workerCount < wanted; workerCount++) {
+				hWorkers[workerCount] = pForm.createThread(ThreadExtractWorker, this);
+				if (!hWorkers[workerCount]) { break; }
+			}
+			pForm.mutexLock(m_mutex);
+			m_activeWorkers -= wanted - workerCount;
+			pForm.mutexUnlock(m_mutex);
+		}
+
+		if (m_mutex) {
+			// The calling thread is a worker too.
+			extractFiles(m_hUnzip);
+
+			pForm.mutexLock(m_mutex);
+			while (m_activeWorkers) {
+				pForm.mutexUnlock(m_mutex);
+				pForm.eventSleep(m_evDone);
+				pForm.mutexLock(m_mutex);
+			}
+			pForm.mutexUnlock(m_mutex);
+		} else {
+			m_extractError = true;
+		}
+
+		for (u32 n = 0; n < workerCount; n++) {
+			pForm.deleteThread(hWorkers[n]);
+		}
+		if (m_evDone)	{ pForm.freeEventLock(m_evDone);	m_evDone = NULL; }
+		if (m_mutex)	{ pForm.freeMutex(m_mutex);			m_mutex  = NULL; }
+	}
+	freeExtractList();
+
+	return !m_extractError && !m_abort;
+}
+
+#ifdef INTERNAL_BENCH
+#define BENCH_POOL_DIR	"file://external/bench_unzip_pool"
+#define BENCH_SEQ_DIR	"file://external/bench_unzip_seq"
+#define BENCH_POOL_ROOT	BENCH_POOL_DIR "/"
+#define BENCH_SEQ_ROOT	BENCH_SEQ_DIR "/"
+
+// Records the files extracted below the root.
+class CBenchUnZip : public CUnZip {
+public:
+	CBenchUnZip(const char* zipPath, const char* root)
+	: CUnZip	(zipPath)
+	, m_names	(false)
+	, m_root	(root)
+	, m_files	(NULL)
+	, m_count	(0)
+	, m_max		(0)
+	, m_bytes	(0)
+	, m_ok		(true)
+	{}
+	virtual ~CBenchUnZip() { free(m_files); }
+
+	CKLBNameTable	m_names;
+	const char*		m_root;
+	u32*			m_files;		// Offsets in m_names
+	u32				m_count;
+	u32				m_max;
+	u32				m_bytes;
+	bool			m_ok;
+protected:
+	bool afterExtract(const char * extract_path, bool isDirectory, size_t size) {
+		// The entry loop reports a directory a second time from isFinishExtract(), without path.
+		if (isDirectory || !extract_path) { return true; }
+		const char* name = extract_path + strlen(m_root);
+		if (m_count == m_max) {
+			u32 newMax = m_max ? m_max * 2 : 256;
+			u32* newFiles = (u32*)realloc(m_files, newMax * sizeof(u32));
+			if (!newFiles) { m_ok = false; return true; }
+			m_files	= newFiles;
+			m_max	= newMax;
+		}
+		m_files[m_count] = m_names.insert(name, strlen(name));
+		m_ok &= (m_files[m_count] != CKLBNameTable::NOT_FOUND);
+		m_count++;
+		m_bytes += size;
+		return true;
+	}
+};
+
+static bool sameExtractedFile(const char* root, const char* otherRoot, const char* name) {
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	char path[1024];
+	char otherPath[1024];
+	sprintf(path,		"%s%.900s", root,		name);
+	sprintf(otherPath,	"%s%.900s", otherRoot,	name);
+	IReadStream* pA = pForm.openReadStream(path, false);
+	IReadStream* pB = pForm.openReadStream(otherPath, false);
+	bool same = pA && pB && (pA->getStatus() == IReadStream::NORMAL) && (pB->getStatus() == IReadStream::NORMAL)
+		&& (pA->getSize() == pB->getSize());
+	u8 bufA[4096];
+	u8 bufB[4096];
+	for (s32 left = same ? pA->getSize() : 0; same && (left > 0); left -= sizeof(bufA)) {
+		u32 cnt = (left < (s32)sizeof(bufA)) ? left : sizeof(bufA);
+		same = pA->readBlock(bufA, cnt) && pB->readBlock(bufB, cnt) && (memcmp(bufA, bufB, cnt) == 0);
+	}
+	delete pA;
+	delete pB;
+	return same;
+}
+
+// Extracts the zip given as argument (asset path) with extractAll (worker pool) and with the
+// former one entry at a time loop (extractCurrentFile / isFinishExtract / gotoNextFile),
+// into two scratch folders under file://external/, removed afterwards.
+// Checks extractAll reports every entry, and both extract the same files with the same content.
+static bool benchUnZip(u32 loops) {
+	IPlatformRequest& pForm = CPFInterface::getInstance().platform();
+	const char* asset = CKLBBenchmark::getArgument();
+	if (!asset) {
+		pForm.logging("[BENCH] UNZIP needs a zip asset path\n");
+		return true;
+	}
+	const char* zipPath = pForm.getFullPath(asset);
+	if (!zipPath) { return false; }
+
+	s64 timePool	= 0;
+	s64 timeSeq		= 0;
+	bool ok			= true;
+	for (u32 l = 0; ok && (l < loops); l++) {
+		pForm.removeFileOrFolder(BENCH_POOL_DIR);
+		pForm.removeFileOrFolder(BENCH_SEQ_DIR);
+
+		CBenchUnZip pool(zipPath, BENCH_POOL_ROOT);
+		CBenchUnZip seq (zipPath, BENCH_SEQ_ROOT);
+		if (!pool.getStatus() || !seq.getStatus()) {
+			pForm.logging("[BENCH] UNZIP can not open %s\n", asset);
+			ok = false;
+			break;
+		}
+
+		s64 t0 = CKLBBenchmark::now();
+		ok = pool.extractAll(BENCH_POOL_ROOT);
+		s64 t1 = CKLBBenchmark::now();
+		bool seqOk = true;
+		if (seq.numEntry()) {
+			do {
+				// A started entry is always waited for : its thread uses seq.
+				seqOk = seq.readCurrentFileInfo() && seq.extractCurrentFile(BENCH_SEQ_ROOT);
+				while (seqOk && !seq.isFinishExtract()) {}
+			} while (seqOk && seq.gotoNextFile());
+		}
+		s64 t2 = CKLBBenchmark::now();
+		ok = ok && seqOk;
+		timePool	+= t1 - t0;
+		timeSeq		+= t2 - t1;
+
+		ok = ok && pool.m_ok && seq.m_ok && ((u32)pool.getFinishedEntry() == pool.numEntry())
+			&& (pool.m_count == seq.m_count) && (pool.m_bytes == seq.m_bytes);
+		for (u32 n = 0; ok && (n < seq.m_count); n++) {
+			const char* name = seq.m_names.getName(seq.m_files[n]);
+			ok = (pool.m_names.find(name, strlen(name)) != CKLBNameTable::NOT_FOUND)
+				&& sameExtractedFile(BENCH_POOL_ROOT, BENCH_SEQ_ROOT, name);
+		}
+		if (!ok) {
+			pForm.logging("[BENCH] UNZIP worker pool and entry loop extractions differ\n");
+		}
+	}
+	CKLBBenchmark::report("extractAll (worker pool)", loops, timePool);
+	CKLBBenchmark::report("one entry at a time", loops, timeSeq);
+
+	pForm.removeFileOrFolder(BENCH_POOL_DIR);
+	pForm.removeFileOrFolder(BENCH_SEQ_DIR);
+	delete [] zipPath;
+	return ok;
+}
+
+static CKLBBenchmark gBenchUnZip("UNZIP", benchUnZip);
+#endif
@@ -25,6 +25,7 @@
 
 #include "BaseType.h"
 #include "ITmpFile.h"
+#include "CKLBNameTable.h"
 
 /*!
 * \class CUnZip
@@ -55,6 +56,12 @@ public:
 	// 展開処理
 	bool unCompress(const char * extract_root);
 
+	// Extract every entry : the central directory is read once, directories and empty files
+	// are created on the calling thread, the other files are inflated by a pool of workers.
+	// getFinishedEntry() can be polled from another thread meanwhile.
+	bool extractAll	(const char * extract_root);
+	inline void abortExtract() { m_abort = true; }
+
 protected:
 	// ファイル個別の展開が終了したときに、そのファイルのパス名と展開サイズを引数として呼び出される。
 	virtual bool afterExtract(const char * extract_path, bool isDirectory, size_t size);
@@ -67,6 +74,18 @@ private:
 	s32		ThreadExtract			(void * hThread, void * data);
 
 	static s32 ThreadExtractEntry	(void * hThread, void * data);
+	static s32 ThreadExtractWorker	(void * hThread, void * data);
+
+	struct FILE_ENTRY {
+		unz_file_pos	pos;
+		u32				name;		// Offset in m_names pool
+		u32				size;		// Uncompressed size
+	};
+
+	bool	queueFile				(const char * name, u32 size);
+	void	extractFiles			(unzFile hUnzip);
+	bool	isKnownDirectory		(const char * path, u32 len);
+	void	freeExtractList			();
 
 
 	unzFile			m_hUnzip;
@@ -82,12 +101,28 @@ private:
 	bool			m_extractFinish;
 	void		*	m_hThread;
 
-	int				m_finished_entry;
+	volatile int	m_finished_entry;
 
 	bool			m_bReady;
 
+	// extractAll() state
+	char		*	m_zipPath;
+	const char	*	m_extractRoot;
+	FILE_ENTRY	*	m_files;
+	u32				m_fileCount;
+	u32				m_fileMax;
+	u32				m_nextFile;
+	CKLBNameTable	m_names;		// Created directories (indexed) and queued file names
+	void		*	m_mutex;
+	void		*	m_evDone;
+	u32				m_activeWorkers;
+	volatile bool	m_abort;
+	bool			m_extractError;
+
 	enum {
-		BUF_SIZE = 8192
+		BUF_SIZE			= 8192,
+		EXTRACT_BUF_SIZE	= 64 * 1024,
+		EXTRACT_WORKERS		= 4		// Including the calling thread
 	};
 };
 
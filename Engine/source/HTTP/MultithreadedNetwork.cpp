@@ -19,8 +19,9 @@ NetworkManager NetworkManager::s_manager;
 
 ConnectionEntry::ConnectionEntry() 
 {
-	m_pNext = NULL;
-	m_kill	= false;	
+	m_pNext		= NULL;
+	m_refCount	= 1;
+	m_kill		= false;	
 }
 
 ConnectionEntry::~ConnectionEntry() 
@@ -113,6 +114,11 @@ NetworkManager::releaseConnection(CKLBHTTPInterface* connection)
 	ConnectionEntry* pPrev	= NULL;
 	while (pEntry) {
 		if ((&pEntry->m_oConnection) == connection) {
+			// Still used by another request.
+			if (--pEntry->m_refCount != 0) {
+				break;
+			}
+
 			// Between lock.
 			if (pPrev) {
 				pPrev->m_pNext		= pEntry->m_pNext;				
@@ -139,6 +145,33 @@ NetworkManager::releaseConnection(CKLBHTTPInterface* connection)
 	WAKE_THREAD(s_manager.m_eventLock);
 }
 
+/**
+	Join an identical idempotent request still in flight.
+	Each owner releases the connection once : the last one kills it.
+ */
+/*static*/
+CKLBHTTPInterface*
+NetworkManager::shareConnection(const char* url)
+{
+	if (!url) { return NULL; }
+
+	CKLBHTTPInterface* res = NULL;
+	LOCK(s_manager.m_lock);
+	ConnectionEntry* pEntry = s_manager.m_entries;
+	while (pEntry) {
+		CKLBHTTPInterface& con = pEntry->m_oConnection;
+		if (con.isShareable() && (con.m_threadStop == 0) && con.getURL() && (strcmp(con.getURL(), url) == 0)) {
+			pEntry->m_refCount++;
+			gTotal++;
+			res = &con;
+			break;
+		}
+		pEntry = pEntry->m_pNext;
+	}
+	UNLOCK(s_manager.m_lock);
+	return res;
+}
+
 /*static*/ 
 s32 
 NetworkManager::threadFunc(void* /*pThread*/, void* data) 
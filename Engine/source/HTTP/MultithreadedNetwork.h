@@ -41,6 +41,7 @@ public:
 	~ConnectionEntry();
 	ConnectionEntry*	m_pNext;
 	CKLBHTTPInterface	m_oConnection;
+	u32					m_refCount;		// Owners sharing the connection.
 	bool				m_kill;
 };
 
@@ -56,6 +57,7 @@ public:
 	static void 				stopNetworkManager	();
 	static CKLBHTTPInterface*	createConnection	();
 	static void					releaseConnection	(CKLBHTTPInterface* connection);
+	static CKLBHTTPInterface*	shareConnection		(const char* url);
 private:
 		   s32					workThread			();
 	static s32					threadFunc			(void* pThread, void* data);
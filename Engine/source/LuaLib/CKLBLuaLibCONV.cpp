@@ -102,7 +102,9 @@ CKLBLuaLibCONV::json2lua(lua_State * L)
 {
 	CLuaState lua(L);
 	const char * json = lua.getString(1);
-	CKLBUtility::json2lua(lua, json, strlen(json));
+	if (!CKLBUtility::json2lua(lua, json, strlen(json))) {
+		lua.retNil();
+	}
 	return 1;
 }
 
@@ -134,7 +136,9 @@ CKLBLuaLibCONV::jsonfile2lua(lua_State * L)
 	buf[size] = 0;
 	const char * json = (const char *)buf;
 
-	CKLBUtility::json2lua(lua, json, size);
+	if (!CKLBUtility::json2lua(lua, json, size)) {
+		lua.retNil();
+	}
 	KLBDELETEA(buf);
 
 	return 1;
@@ -14,6 +14,7 @@
    limitations under the License.
 */
 #include "CKLBLuaLibDB.h"
+#include "CKLBDatabase.h"
 
 static CKLBLuaLibDB libdef(0);
 
@@ -24,6 +25,7 @@ CKLBLuaLibDB::~CKLBLuaLibDB()
 {
 	// クローズされていないDBがあればすべてクローズ
 	CKLBLuaDB::closeAll();
+	CKLBDatabase::releaseAllImages();
 }
 
 // LuaLib全破棄時に、クローズされていないDBはすべてクローズ
@@ -31,6 +33,7 @@ void
 CKLBLuaLibDB::destroyResources()
 {
 	CKLBLuaDB::closeAll();
+	CKLBDatabase::releaseAllImages();
 }
 
 // 現在生成されているDBオブジェクトをダンプする
@@ -49,7 +52,12 @@ CKLBLuaLibDB::addLibrary()
 	addFunction("DB_open",  CKLBLuaLibDB::dbopen);
 	addFunction("DB_close", CKLBLuaLibDB::dbclose);
 	addFunction("DB_query", CKLBLuaLibDB::dbquery);
+	addFunction("DB_prepared", CKLBLuaLibDB::dbprepared);
+	addFunction("DB_fetchRows", CKLBLuaLibDB::dbfetchRows);
 	addFunction("DB_closeAll", CKLBLuaLibDB::dbcloseAll);
+	addFunction("DB_preload", CKLBLuaLibDB::dbpreload);
+	addFunction("DB_unload", CKLBLuaLibDB::dbunload);
+	addFunction("DB_isPreloaded", CKLBLuaLibDB::dbisPreloaded);
 }
 
 int
@@ -129,6 +137,89 @@ CKLBLuaLibDB::dbquery(lua_State * L)
 	return pDB->query(&lua, sql);	// 失敗のときはエラーコード(int)が、成功のときはテーブルが積まれる。
 }
 
+// DB_prepared(db, sql, param...) : same results as DB_query, statement cached and parameters bound.
+int
+CKLBLuaLibDB::dbprepared(lua_State * L)
+{
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	if(argc < 2) {
+		lua.retNil();
+		return 1;
+	}
+	if(lua.isNil(1)) {	// ポインタとして積まれたものがnilだった
+		lua.retNil();
+		return 1;
+	}
+	CKLBLuaDB * pDB = (CKLBLuaDB *)lua.getPointer(1);
+	const char * sql = lua.getString(2);
+
+	return pDB->queryPrepared(&lua, sql, 3);
+}
+
+// DB_fetchRows(db, rows, sql, param...) : fill rows array, return row count (false, code on error).
+int
+CKLBLuaLibDB::dbfetchRows(lua_State * L)
+{
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	if(argc < 3) {
+		lua.retNil();
+		return 1;
+	}
+	if(lua.isNil(1)) {	// ポインタとして積まれたものがnilだった
+		lua.retNil();
+		return 1;
+	}
+	CKLBLuaDB * pDB = (CKLBLuaDB *)lua.getPointer(1);
+	const char * sql = lua.getString(3);
+
+	return pDB->fetchRows(&lua, sql, 2, 4);
+}
+
+// DB_preload(asset [, async]) : decrypt the DB in memory for read-only DB_open.
+// Returns false when over budget or not encrypted (file access is used instead).
+int
+CKLBLuaLibDB::dbpreload(lua_State * L)
+{
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	if(argc < 1 || 2 < argc) {
+		lua.retBoolean(false);
+		return 1;
+	}
+	const char * db_asset = lua.getString(1);
+	bool b_async = (argc >= 2) ? lua.getBool(2) : false;
+	lua.retBoolean(CKLBDatabase::preloadImage(db_asset, b_async));
+	return 1;
+}
+
+// DB_unload(asset) : memory is freed when the last connection using it is closed.
+int
+CKLBLuaLibDB::dbunload(lua_State * L)
+{
+	CLuaState lua(L);
+	if(lua.numArgs() != 1) {
+		lua.retNil();
+		return 1;
+	}
+	CKLBDatabase::releaseImage(lua.getString(1));
+	lua.retNil();
+	return 1;
+}
+
+int
+CKLBLuaLibDB::dbisPreloaded(lua_State * L)
+{
+	CLuaState lua(L);
+	if(lua.numArgs() != 1) {
+		lua.retBoolean(false);
+		return 1;
+	}
+	lua.retBoolean(CKLBDatabase::isImageReady(lua.getString(1)));
+	return 1;
+}
+
 CKLBLuaDB* CKLBLuaLibDB::dbopen(const char* db_asset, bool b_write, bool b_create)
 {
 	int flags = (b_write) ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY;
@@ -42,6 +42,11 @@ private:
 	static int dbclose		(lua_State * L);
 	static int dbcloseAll	(lua_State * L);
 	static int dbquery		(lua_State * L);
+	static int dbprepared	(lua_State * L);
+	static int dbfetchRows	(lua_State * L);
+	static int dbpreload	(lua_State * L);
+	static int dbunload		(lua_State * L);
+	static int dbisPreloaded(lua_State * L);
 };
 
 
@@ -44,6 +44,7 @@ CKLBLuaLibGL::addLibrary()
 	addFunction("GL_Unloadtexture",			CKLBLuaLibGL::luaGLUnloadTexture		);
 	addFunction("GL_Reloadtexture",			CKLBLuaLibGL::luaGLReloadTexture		);
 	addFunction("GL_DoScreenShot",			CKLBLuaLibGL::luaGLDoScreenShot			);
+	addFunction("GL_SetTextureBudget",		CKLBLuaLibGL::luaGLSetTextureBudget		);
 }
 
 /*static*/
@@ -177,6 +178,27 @@ int CKLBLuaLibGL::luaSetGuardBand(lua_State * L) {
 	return 1;
 }
 
+int CKLBLuaLibGL::luaGLSetTextureBudget(lua_State * L) {
+	CLuaState lua(L);
+
+	int argc = lua.numArgs();
+	if(argc != 1) {
+		lua.retBoolean(false);
+		return 1;
+	}
+
+	int budget = lua.getInt(1);
+	if (budget < 0) {
+		lua.retBoolean(false);
+		return 1;
+	}
+
+	// 0 : no budget, textures are never evicted.
+	CKLBOGLWrapper::getInstance().setTextureBudget((u32)budget);
+	lua.retBoolean(true);
+	return 1;
+}
+
 /*static*/
 bool
 CKLBLuaLibGL::GLCreateScreenAsset(const char* name)
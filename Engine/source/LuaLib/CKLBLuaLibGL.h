@@ -43,6 +43,7 @@ private:
 	static int luaGLSetQuarter			(lua_State * L);
 	static int luaGLReloadTexture		(lua_State * L);
 	static int luaGLUnloadTexture		(lua_State * L);
+	static int luaGLSetTextureBudget	(lua_State * L);
 
 	
 		
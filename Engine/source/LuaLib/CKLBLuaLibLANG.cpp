@@ -32,6 +32,11 @@ void CKLBLuaLibLANG::addLibrary()
 	addFunction("LANG_removeString",	CKLBLuaLibLANG::luaRemoveString);
 	addFunction("LANG_useDB",			CKLBLuaLibLANG::luaUseDB);
 	addFunction("LANG_loadGroup",		CKLBLuaLibLANG::luaLoadGroup);
+	addFunction("LANG_preloadKeys",		CKLBLuaLibLANG::luaPreloadKeys);
+	addFunction("LANG_recordMisses",	CKLBLuaLibLANG::luaRecordMisses);
+	addFunction("LANG_getMisses",		CKLBLuaLibLANG::luaGetMisses);
+	addFunction("LANG_buildTable",		CKLBLuaLibLANG::luaBuildTable);
+	addFunction("LANG_freeTable",		CKLBLuaLibLANG::luaFreeTable);
 }
 
 int
@@ -80,6 +85,83 @@ CKLBLuaLibLANG::luaLoadGroup(lua_State * L) {
 	return 1;
 }
 
+// LANG_preloadKeys({ id, ... }) : ids without '#', return number of strings loaded.
+int
+CKLBLuaLibLANG::luaPreloadKeys(lua_State * L) {
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	if(argc != 1 || !lua.isTable(1)) {
+		lua.retInt(0);
+		return 1;
+	}
+
+	// Strings stay referenced by the table during the call.
+	const char* ids[64];
+	u32 count	= 0;
+	u32 loaded	= 0;
+	int len = lua.tableLength(1);
+	for (int n = 1; n <= len; n++) {
+		lua.tableRawGetIndex(n, 1);
+		if (lua.isString(-1)) {
+			ids[count++] = lua.getString(-1);
+		}
+		lua.pop(1);
+		if (count == 64 || (n == len && count)) {
+			loaded += CKLBLanguageDatabase::getInstance().preLoadKeys(ids, count);
+			count = 0;
+		}
+	}
+
+	lua.retInt(loaded);
+	return 1;
+}
+
+int
+CKLBLuaLibLANG::luaRecordMisses(lua_State * L) {
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	if(argc != 1) {
+		lua.retBool(false);
+		return 1;
+	}
+	CKLBLanguageDatabase::getInstance().recordMisses(lua.getBool(1));
+	lua.retBool(true);
+	return 1;
+}
+
+// LANG_getMisses() : ids fetched one by one since last call, for LANG_preloadKeys next time.
+int
+CKLBLuaLibLANG::luaGetMisses(lua_State * L) {
+	CLuaState lua(L);
+	CKLBLanguageDatabase& ldb = CKLBLanguageDatabase::getInstance();
+	u32 count = ldb.getRecordCount();
+	lua.tableNew(count, 0);
+	for (u32 n = 0; n < count; n++) {
+		lua.retString(ldb.getRecord(n));
+		lua.tableRawSetIndex(n + 1);
+	}
+	ldb.clearRecords();
+	return 1;
+}
+
+// LANG_buildTable([groupID]) : hashed snapshot of the table, or of one group.
+int
+CKLBLuaLibLANG::luaBuildTable(lua_State * L) {
+	CLuaState lua(L);
+	int argc = lua.numArgs();
+	const char* groupID = (argc >= 1 && !lua.isNil(1)) ? lua.getString(1) : NULL;
+	lua.retBool(CKLBLanguageDatabase::getInstance().buildTable(groupID));
+	return 1;
+}
+
+int
+CKLBLuaLibLANG::luaFreeTable(lua_State * L) {
+	CLuaState lua(L);
+	CKLBLanguageDatabase::getInstance().freeTable();
+	lua.retBool(true);
+	return 1;
+}
+
 int
 CKLBLuaLibLANG::luaAddString(lua_State * L)
 {
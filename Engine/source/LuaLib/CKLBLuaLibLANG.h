@@ -61,6 +61,11 @@ private:
 	static int luaRemoveString	(lua_State * L);
 	static int luaUseDB			(lua_State * L);
 	static int luaLoadGroup		(lua_State * L);
+	static int luaPreloadKeys	(lua_State * L);
+	static int luaRecordMisses	(lua_State * L);
+	static int luaGetMisses		(lua_State * L);
+	static int luaBuildTable	(lua_State * L);
+	static int luaFreeTable		(lua_State * L);
 };
 
 #endif // CKLBLiaLibUI_h
@@ -136,12 +136,10 @@ void	CBuffer::commitVBO() {
 		#pragma message ("Warning : feature not supported with standard OpenGL for now")
 	#else
 		klb_assertc(VBOModified == true, "VBO is not modified but commitVBO is executed.");
-		dglBindBuffer	(GL_ARRAY_BUFFER, this->vboID);
-		GLintptr	offset	= this->VBOModifyStart * strideVBO * sizeof(float);
-		GLsizeiptr	size	= (VBOModifyEnd - VBOModifyStart) * strideVBO * sizeof(float);
-		void*		data	= &(((float*)vboLocalCopy)[offset >> 2]);
+		u32			start	= this->VBOModifyStart * strideVBO * sizeof(float);
+		u32			end		= this->VBOModifyEnd   * strideVBO * sizeof(float);
 
-		dglBufferSubData	(GL_ARRAY_BUFFER, offset, size, data);
+		this->vboID = CKLBOGLWrapper::getInstance().commitStream(stream, GL_ARRAY_BUFFER, start, end, vboLocalCopy);
 	#endif
 
 	this->VBOModified	= false;
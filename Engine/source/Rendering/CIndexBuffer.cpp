@@ -83,12 +83,10 @@ void CIndexBuffer::commitVBO() {
 		#pragma message ("Warning : feature not supported with standard OpenGL for now")
 	#else
 		klb_assertc(VBOModified == true, "VBO is not modified but commitVBO is executed.");
-		dglBindBuffer	(GL_ELEMENT_ARRAY_BUFFER, this->vboID);
-		GLintptr	offset	= this->VBOModifyStart * sizeof(short);
-		GLsizeiptr	size	= (VBOModifyEnd - VBOModifyStart) * sizeof(short);
-		void*		data	= &(((short*)ptrBuffer)[offset >> 1]);
+		u32			start	= this->VBOModifyStart * sizeof(short);
+		u32			end		= this->VBOModifyEnd   * sizeof(short);
 
-		dglBufferSubData	(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+		this->vboID = CKLBOGLWrapper::getInstance().commitStream(stream, GL_ELEMENT_ARRAY_BUFFER, start, end, ptrBuffer);
 	#endif
 
 	this->VBOModified	= false;
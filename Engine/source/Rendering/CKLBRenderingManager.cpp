@@ -639,8 +639,8 @@ u32 CKLBRenderingManager::createShaderDefinition(const char* shaderCode) {
 	CShader*			pixelShader		= pOGLMgr.createShader(shaderCode, CKLBOGLWrapper::PIXEL_SHADER, paramsShader);
 	CShaderSet*			shaderSet		= NULL;
 	if (pixelShader) {
-		// Map the shader together.
-		shaderSet	= pOGLMgr.createShaderSet(m_pVShader, pixelShader);
+		// Map the shader together : linked later when the program is cached, fails now on broken source.
+		shaderSet	= pOGLMgr.createShaderSet(m_pVShader, pixelShader, true);
 		if (shaderSet) {
 			for (int n=0; n < SHADER_DEF_MAX; n++) {
 				if (!m_shaderDef[n].m_definition) {
@@ -655,6 +655,7 @@ u32 CKLBRenderingManager::createShaderDefinition(const char* shaderCode) {
 		}
 		pOGLMgr.releaseShader(pixelShader);
 	}
+	KLBDELETEA(pParam);
 #else
 	klb_assertAlways("OpenGL 1.1 Profile does not support shader APIs");
 #endif
@@ -963,6 +964,11 @@ void CKLBRenderingManager::dumpMetrics() {
 	fprintf(pFile,"Total internal copy: %i\n", m_memCopySize);
 	fprintf(pFile,"Total DrawCall     : %i\n", m_drawCall);
 	fprintf(pFile,"Time %lli uSec\n", m_drawTime / 1000);
+
+	STextureResidencyStats res;
+	CKLBOGLWrapper::getInstance().getTextureResidencyStats(&res);
+	fprintf(pFile,"Texture resident   : %u bytes (%u textures, budget %u)\n", res.residentBytes, res.residentCount, res.budgetBytes);
+	fprintf(pFile,"Texture evict/load : %u / %u (%u failed), stall %u uSec\n", res.evictions, res.reloads, res.reloadFailures, res.reloadStallUS);
 	fprintf(pFile,"==== Rendering Metrics End ===\n\n");
 #else
 	fprintf(pFile,"==== Not Available (Compile option DEBUG_PERFORMANCE not set\n\n");
@@ -1513,6 +1519,10 @@ void CKLBRenderingManager::draw() {
 						indexVCount  = 0; // Reset index counter.
 						pLastTexture		= pSpr->m_pTexture;
 						pLastTextureMask	= pSpr->m_pMaskTexture;
+
+						// Stamp usage, upload again if evicted.
+						if (pLastTexture)		{ pOGLMgr.touchTexture(pLastTexture);		}
+						if (pLastTextureMask)	{ pOGLMgr.touchTexture(pLastTextureMask);	}
 					}
 
 					if (pCommand->m_commandType & RENDERCOMMAND_3D) {
@@ -1908,7 +1918,7 @@ void CKLBSprite::applyNode(CKLBNode* pNode, float stx, float sty) {
 		int    vCount = this->m_uiVertexCount;
 
 	#ifdef DEBUG_PERFORMANCE
-		CKLBNode::s_vertexRecomputeCount += vCount;
+		NODE_PERF_COUNT(CKLBNode::s_vertexRecomputeCount, vCount);
 	#endif
 	
 		// We are ok here because we garantee to modify coordinate only when matrix changes.
@@ -2386,7 +2396,7 @@ void CKLBSprite::setColor(const float* vec4) {
 #endif
 
 	#ifdef DEBUG_PERFORMANCE
-	CKLBNode::s_colorRecomputeCount  += 1;
+	NODE_PERF_COUNT(CKLBNode::s_colorRecomputeCount, 1);
 	#endif
 
 	// Color changed ?
@@ -2405,7 +2415,7 @@ void CKLBSprite::setColor(const float* vec4) {
 void CKLBDynSprite::setColor(const float* vec4) {
 
 	#ifdef DEBUG_PERFORMANCE
-	CKLBNode::s_colorRecomputeCount  += this->m_uiVertexCount;
+	NODE_PERF_COUNT(CKLBNode::s_colorRecomputeCount, this->m_uiVertexCount);
 	#endif
 
 	for (u32 n=0; n<this->m_uiVertexCount; n++) {
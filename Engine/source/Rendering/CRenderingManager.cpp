@@ -15,12 +15,26 @@
 */
 #include "RenderingFramework.h"
 #include "mem.h"
+#include "CKLBBenchmark.h"
 
 static int _x_getVertexSize() {
 	return 5;
 }
 
 CKLBOGLWrapper::CKLBOGLWrapper():
+	m_pLRUHead			(NULL),
+	m_pLRUTail			(NULL),
+	m_textureBudget		(0),
+	m_residentBytes		(0),
+	m_residentCount		(0),
+	m_evictions			(0),
+	m_reloads			(0),
+	m_reloadFailures	(0),
+	m_reloadStallUS		(0),
+	m_uploadBytes		(0),
+	m_uploadCalls		(0),
+	m_lastUploadBytes	(0),
+	m_lastUploadCalls	(0),
 	frame				(0),
 
 	m_pTextureList		(NULL),
@@ -36,8 +50,7 @@ CKLBOGLWrapper::CKLBOGLWrapper():
 	_glTexSubImage3DOES	(NULL),
 	enableColor			(UNDEFINED_BOOL),
 	enableTexture		(UNDEFINED_BOOL),
-	lastElementArrayBuffer	((GLuint)-1),
-	arrayBufferID			((GLuint)-1)
+	lastElementArrayBuffer	((GLuint)-1)
 {
 	//char shaderPatchArray[1000];
 
@@ -94,6 +107,7 @@ bool CKLBOGLWrapper::init(float displayMatrix[16]) {
 	memcpy32(displayMatrix2D, displayMatrix, 16*sizeof(float));
 
 	// Current GL state must be uninitialized.
+	dglStateReset();
 
 #ifndef OPENGL2
 	dglMatrixMode(GL_MODELVIEW);
@@ -444,6 +458,9 @@ void		CKLBOGLWrapper::releaseTexture	(CTexture* texture) {
 		// Remove Sub Textures. (SECOND)
 		texture->releaseSubTextures();
 
+		unlinkLRU		(texture);
+		dropResidency	(texture);
+
 		//
 		// Remove master texture itself from the list.
 		//
@@ -546,6 +563,7 @@ CBuffer*	CKLBOGLWrapper::createVertexBuffer		(s32 vertexCount, const SVertexEntr
 				}
 
 				if (!err) {
+					initStream(pNewBuffer->stream, pNewBuffer->vboID, vertexCount * sizeVBOVertex * sizeof(float));
 					pNewBuffer->dynCount		= cntDynVertex;
 					pNewBuffer->vboCount		= cntVBOVertex;
 					pNewBuffer->ptrBuffer		= ptrBuff;
@@ -645,6 +663,7 @@ CIndexBuffer* CKLBOGLWrapper::createIndexBuffer(s32 indexCount, bool asVBO, void
 		}
 
 		if (err == false) {
+			initStream(pNewBuffer->stream, pNewBuffer->vboID, indexCount * sizeof(GLushort));
 			pNewBuffer->ptrBuffer		= (short*)ptrBuff;
 			pNewBuffer->VBOModified		= asVBO;
 			pNewBuffer->VBOModifying	= false;
@@ -672,10 +691,9 @@ CIndexBuffer* CKLBOGLWrapper::createIndexBuffer(s32 indexCount, bool asVBO, void
 }
 
 void CKLBOGLWrapper::_glBindBuffer(GLuint id) {
-	if (id != arrayBufferID) {
-		arrayBufferID = id;
-		dglBindBuffer(GL_ARRAY_BUFFER, id);
-	}
+	// Redundant binds are dropped by the GL state shadow, which also sees
+	// the binds done directly by CBuffer.
+	dglBindBuffer(GL_ARRAY_BUFFER, id);
 }
 
 void CKLBOGLWrapper::releaseIndexBuffer(CIndexBuffer* pBuffer) {
@@ -692,7 +710,7 @@ void CKLBOGLWrapper::releaseIndexBuffer(CIndexBuffer* pBuffer) {
 		prev->pNext = p->pNext;
 	}
 
-	dglDeleteBuffers(1, &pBuffer->vboID);
+	releaseStream(pBuffer->stream);
 
 	if (!p->fromOutside) {
 		KLBDELETE(p->ptrBuffer);
@@ -714,7 +732,7 @@ void CKLBOGLWrapper::releaseVertexBuffer(CBuffer* pBuffer) {
 		prev->pNext = p->pNext;
 	}
 
-	dglDeleteBuffers(1, &pBuffer->vboID);
+	releaseStream(pBuffer->stream);
 
 	KLBDELETE(p->structure);
 
@@ -730,7 +748,283 @@ void CKLBOGLWrapper::releaseVertexBuffer(CBuffer* pBuffer) {
 }
 
 void CKLBOGLWrapper::endFrame() {
+	evictTextures();
+
 	frame++;
+	dglFrameEnd();
+
+#ifdef OPENGL2
+	linkPendingShaderSet();
+#endif
+
+	m_lastUploadBytes	= m_uploadBytes;
+	m_lastUploadCalls	= m_uploadCalls;
+	m_uploadBytes		= 0;
+	m_uploadCalls		= 0;
+}
+
+void CKLBOGLWrapper::initStream(SVBOStream& stream, GLuint vboID, u32 byteSize) {
+	for (u32 n = 0; n < VBO_STREAM_SLOTS; n++) {
+		stream.slotID	[n] = 0;
+		stream.pendStart[n] = byteSize;
+		stream.pendEnd	[n] = 0;
+	}
+	stream.slotID[0]	= vboID;
+	stream.byteSize		= byteSize;
+	stream.lastFrame	= -2;
+	stream.streak		= 0;
+	stream.slot			= 0;
+	stream.streaming	= false;
+}
+
+void CKLBOGLWrapper::releaseStream(SVBOStream& stream) {
+	for (u32 n = 0; n < VBO_STREAM_SLOTS; n++) {
+		if (stream.slotID[n]) {
+			dglDeleteBuffers(1, &stream.slotID[n]);
+			stream.slotID[n] = 0;
+		}
+	}
+	stream.streaming = false;
+}
+
+GLuint CKLBOGLWrapper::commitStream(SVBOStream& stream, GLenum target, u32 start, u32 end, const void* localCopy) {
+	bool newFrame = (stream.lastFrame != frame);
+	if (newFrame) {
+		if (stream.lastFrame == frame - 1) {
+			if (stream.streak < 0xFF) { stream.streak++; }
+		} else {
+			stream.streak = 0;
+		}
+		stream.lastFrame = frame;
+
+		if ((!stream.streaming) && (stream.streak >= VBO_STREAM_PROMOTE)) {
+			// Dynamic every frame : create the other slots, they must receive the full content.
+			dglGenBuffers(VBO_STREAM_SLOTS - 1, &stream.slotID[1]);
+			bool ok = true;
+			for (u32 n = 1; n < VBO_STREAM_SLOTS; n++) {
+				if (stream.slotID[n]) {
+					dglBindBuffer(target, stream.slotID[n]);
+					dglBufferData(target, stream.byteSize, NULL, GL_DYNAMIC_DRAW);
+					stream.pendStart[n]	= 0;
+					stream.pendEnd	[n]	= stream.byteSize;
+				} else {
+					ok = false;
+				}
+			}
+
+			if (ok) {
+				stream.streaming = true;
+			} else {
+				// Stay static.
+				for (u32 n = 1; n < VBO_STREAM_SLOTS; n++) {
+					if (stream.slotID[n]) {
+						dglDeleteBuffers(1, &stream.slotID[n]);
+						stream.slotID[n] = 0;
+					}
+				}
+			}
+		}
+
+		if (stream.streaming) {
+			stream.slot = (stream.slot + 1) % VBO_STREAM_SLOTS;
+		}
+	}
+
+	// Every slot misses the new range.
+	u32 slotCount = stream.streaming ? VBO_STREAM_SLOTS : 1;
+	for (u32 n = 0; n < slotCount; n++) {
+		if (start < stream.pendStart[n]) { stream.pendStart[n] = start; }
+		if (end   > stream.pendEnd	[n]) { stream.pendEnd	[n] = end;   }
+	}
+
+	u32		slot	= stream.slot;
+	GLuint	vboID	= stream.slotID[slot];
+	u32		from	= stream.pendStart[slot];
+	u32		to		= stream.pendEnd[slot];
+
+	if (from < to) {
+		dglBindBuffer(target, vboID);
+		if (stream.streaming && ((to - from) * 4 >= stream.byteSize * 3)) {
+			// Nearly everything changes : respecify (orphan) the whole storage.
+			dglBufferData(target, stream.byteSize, localCopy, GL_DYNAMIC_DRAW);
+			m_uploadBytes += stream.byteSize;
+		} else {
+			dglBufferSubData(target, from, to - from, &((const u8*)localCopy)[from]);
+			m_uploadBytes += to - from;
+		}
+		m_uploadCalls++;
+	}
+
+	stream.pendStart[slot]	= stream.byteSize;
+	stream.pendEnd	[slot]	= 0;
+	return vboID;
+}
+
+static u32 textureByteSize(s32 width, s32 height, GLenum pixelFormat, CKLBOGLWrapper::TEX_CHANNEL channelCount, s32 dataLength, u32 option) {
+	u32 size;
+	if (option & CKLBOGLWrapper::TEX_OPT_COMPRESSED_BIT) {
+		size = dataLength;
+	} else {
+		u32 pixelSize;
+		if (pixelFormat == GL_UNSIGNED_BYTE) {
+			// LUMINANCE is 0.
+			pixelSize = (channelCount == CKLBOGLWrapper::LUMINANCE) ? 1 : channelCount;
+		} else {
+			// 565, 5551, 4444
+			pixelSize = 2;
+		}
+		size = width * height * pixelSize;
+	}
+
+	if (option & CKLBOGLWrapper::TEX_OPT_MIPMAP_BIT) {
+		size += size / 3;
+	}
+
+	if (option & CKLBOGLWrapper::TEX_OPT_DOUBLEBUFFERED_BIT) {
+		size *= 2;
+	}
+	return size;
+}
+
+void CKLBOGLWrapper::setTextureResidency(CTexture* pTexture, cbTextureResidency callback, void* ctx) {
+	unlinkLRU(pTexture);
+	pTexture->residencyCB	= NULL;
+	pTexture->residencyCtx	= NULL;
+
+	// Double buffered textures are updated at runtime : content can not be rebuilt.
+	if (callback && (!pTexture->isDoubleBuffered)) {
+		pTexture->residencyCB	= callback;
+		pTexture->residencyCtx	= ctx;
+		pTexture->lastUsedFrame	= frame;
+
+		pTexture->pLRUPrev		= NULL;
+		pTexture->pLRUNext		= m_pLRUHead;
+		if (m_pLRUHead) {
+			m_pLRUHead->pLRUPrev = pTexture;
+		} else {
+			m_pLRUTail = pTexture;
+		}
+		m_pLRUHead = pTexture;
+	}
+}
+
+bool CKLBOGLWrapper::pinTexture(CTexture* pTexture) {
+	if (pTexture->residencyCB) {
+		stampTexture(pTexture);
+		if (!pTexture->resident) {
+			return false;
+		}
+		setTextureResidency(pTexture, NULL, NULL);
+	}
+	return true;
+}
+
+void CKLBOGLWrapper::unlinkLRU(CTexture* pTexture) {
+	if (pTexture->residencyCB) {
+		if (pTexture->pLRUPrev) {
+			pTexture->pLRUPrev->pLRUNext = pTexture->pLRUNext;
+		} else {
+			m_pLRUHead = pTexture->pLRUNext;
+		}
+
+		if (pTexture->pLRUNext) {
+			pTexture->pLRUNext->pLRUPrev = pTexture->pLRUPrev;
+		} else {
+			m_pLRUTail = pTexture->pLRUPrev;
+		}
+
+		pTexture->pLRUPrev = NULL;
+		pTexture->pLRUNext = NULL;
+	}
+}
+
+void CKLBOGLWrapper::dropResidency(CTexture* pTexture) {
+	if (pTexture->resident) {
+		pTexture->resident = false;
+		m_residentBytes -= pTexture->byteSize;
+		m_residentCount--;
+	}
+}
+
+void CKLBOGLWrapper::stampTexture(CTexture* pTexture) {
+	pTexture->lastUsedFrame = frame;
+
+	if (pTexture->residencyCB) {
+		// Move to the most recently used end.
+		if (pTexture != m_pLRUHead) {
+			pTexture->pLRUPrev->pLRUNext = pTexture->pLRUNext;
+			if (pTexture->pLRUNext) {
+				pTexture->pLRUNext->pLRUPrev = pTexture->pLRUPrev;
+			} else {
+				m_pLRUTail = pTexture->pLRUPrev;
+			}
+
+			pTexture->pLRUPrev		= NULL;
+			pTexture->pLRUNext		= m_pLRUHead;
+			m_pLRUHead->pLRUPrev	= pTexture;
+			m_pLRUHead				= pTexture;
+		}
+
+		if (!pTexture->resident) {
+			IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+			s64 start = pltf.nanotime();
+
+			// Failure : drawn without content, tried again next frame.
+			if (pTexture->residencyCB(pTexture->residencyCtx, pTexture, true) && pTexture->resident) {
+				m_reloads++;
+			} else {
+				m_reloadFailures++;
+			}
+			m_reloadStallUS += (u32)((pltf.nanotime() - start) / 1000);
+
+			// Upload changed the texture binding.
+			for (u32 n = 0; n < 4; n++) {
+				samplerUnit[n].texture = 0;
+			}
+		}
+	}
+}
+
+void CKLBOGLWrapper::evictTextures() {
+	if (m_textureBudget == 0) {
+		return;
+	}
+
+	bool evicted = false;
+	CTexture* pTexture = m_pLRUTail;
+	while (pTexture && (m_residentBytes > m_textureBudget)) {
+		// List is ordered by last use : all the others were used this frame.
+		if (pTexture->lastUsedFrame == frame) {
+			break;
+		}
+
+		CTexture* pPrev = pTexture->pLRUPrev;
+		if (pTexture->resident) {
+			if (pTexture->residencyCB(pTexture->residencyCtx, pTexture, false)) {
+				pTexture->makeEmptyShell();
+				m_evictions++;
+				evicted = true;
+			}
+		}
+		pTexture = pPrev;
+	}
+
+	if (evicted) {
+		// Texture names can be recycled by GL.
+		for (u32 n = 0; n < 4; n++) {
+			samplerUnit[n].texture = 0;
+		}
+	}
+}
+
+void CKLBOGLWrapper::getTextureResidencyStats(STextureResidencyStats* pStats) {
+	pStats->budgetBytes		= m_textureBudget;
+	pStats->residentBytes	= m_residentBytes;
+	pStats->residentCount	= m_residentCount;
+	pStats->evictions		= m_evictions;
+	pStats->reloads			= m_reloads;
+	pStats->reloadFailures	= m_reloadFailures;
+	pStats->reloadStallUS	= m_reloadStallUS;
 }
 
 bool CKLBOGLWrapper::support3DTexture() {
@@ -775,17 +1069,24 @@ CTexture*	CKLBOGLWrapper::createTexture	(	s32 width,
 			pTexture->height			= height;
 			pTexture->UPerPixel			= (float)(1.0 / width);
 			pTexture->VPerPixel			= (float)(1.0 / height);
-			pTexture->usageCount		= 0;
 			pTexture->pMaster			= pTexture;
-			pTexture->pParent			= null;
-			pTexture->pChild			= null;
-			pTexture->pBrother			= null;
 			pTexture->pMgr				= this;
 
 			pTexture->activeTexture 	= pTexture->texture;
 
-			pTexture->usageList.init(pTexture);
-			pTexture->usageList.pMgr	= this;
+			if (reload) {
+				// Same texture instance : usages and sub textures stay valid,
+				// but the new texture object needs its sampling setup.
+				pTexture->resetSampling();
+			} else {
+				pTexture->usageCount		= 0;
+				pTexture->pParent			= null;
+				pTexture->pChild			= null;
+				pTexture->pBrother			= null;
+
+				pTexture->usageList.init(pTexture);
+				pTexture->usageList.pMgr	= this;
+			}
 
 			pTexture->format			= pixelFormat;
 
@@ -883,6 +1184,13 @@ CTexture*	CKLBOGLWrapper::createTexture	(	s32 width,
 				pTexture->pNext = m_pTextureList;
 				m_pTextureList = pTexture;
 			}
+
+			dropResidency(pTexture);
+			pTexture->byteSize		= textureByteSize(width, height, pixelFormat, channelCount, dataLength, option);
+			pTexture->lastUsedFrame	= frame;
+			pTexture->resident		= true;
+			m_residentBytes			+= pTexture->byteSize;
+			m_residentCount++;
 		} else {
 			goto error1;
 		}
@@ -894,6 +1202,14 @@ error1:
 	if (pTexture->textureDoubleBuff != 0) {
 									dglDeleteTextures(1, &pTexture->textureDoubleBuff); }
 
+	if (reload) {
+		// Still referenced by its owner : stay as an empty shell.
+		pTexture->texture			= 0;
+		pTexture->textureDoubleBuff	= 0;
+		dropResidency(pTexture);
+		return NULL;
+	}
+
 	KLBDELETE(pTexture);
 	pTexture = null;
 	return pTexture;
@@ -1456,6 +1772,8 @@ void CKLBOGLWrapper::resetSampler(s32 sampler) {
 }
 
 void CKLBOGLWrapper::assignSampler(CTextureUsage* pTextureInstance, s32 sampler) {
+	touchTexture(pTextureInstance);
+
 	GLuint textureID = pTextureInstance->pTexture->pMaster->activeTexture;
 	// Main draw loop setup outside.
 	// dglActiveTexture(GL_TEXTURE0 + sampler);
@@ -1476,3 +1794,239 @@ void CKLBOGLWrapper::assignSampler(CTextureUsage* pTextureInstance, s32 sampler)
 	}
 }
 
+
+#ifdef INTERNAL_BENCH
+#include "CPFInterface.h"
+
+// Streaming VBO : a 64 KB vertex buffer gets a random range (up to an eighth, every 64th frame all of it)
+// rewritten per simulated frame, committed through commitStream and through a single buffer with
+// glBufferSubData as before. Only the submission is timed, nothing is drawn so no stall is measured.
+// A CPU mirror of every slot checks that the slot returned for drawing always matches the local copy.
+bool benchVBOStream(u32 loops) {
+	CKLBOGLWrapper& mgr = CKLBOGLWrapper::getInstance();
+	const u32 size = 64 * 1024;
+
+	u8* localCopy	= KLBNEWA(u8, size);
+	u8* mirror		= KLBNEWA(u8, size * VBO_STREAM_SLOTS);
+	if (!localCopy || !mirror) {
+		if (localCopy)	{ KLBDELETEA(localCopy);	}
+		if (mirror)		{ KLBDELETEA(mirror);		}
+		return false;
+	}
+	memset(localCopy,	0, size);
+	memset(mirror,		0, size * VBO_STREAM_SLOTS);
+
+	GLuint ids[2];
+	dglGenBuffers(2, ids);
+	for (u32 n = 0; n < 2; n++) {
+		dglBindBuffer(GL_ARRAY_BUFFER, ids[n]);
+		dglBufferData(GL_ARRAY_BUFFER, size, localCopy, GL_DYNAMIC_DRAW);
+	}
+	SVBOStream stream;
+	mgr.initStream(stream, ids[0], size);
+
+	s32 savedFrame			= mgr.frame;
+	u32 savedBytes			= mgr.m_uploadBytes;
+	u32 savedCalls			= mgr.m_uploadCalls;
+	mgr.m_uploadBytes		= 0;
+	mgr.m_uploadCalls		= 0;
+
+	bool ok			= true;
+	u32 seed		= 1;
+	u32 naiveBytes	= 0;
+	s64 streamTime	= 0;
+	s64 naiveTime	= 0;
+	for (u32 n = 0; n < loops; n++) {
+		mgr.frame++;
+
+		seed = (seed * 1103515245) + 12345;
+		u32 start	= ((seed >> 8) % size) & ~3;
+		u32 end		= start + (((seed >> 4) % (size / 8)) & ~3) + 4;
+		if (end > size)			{ end = size;		}
+		if ((n & 63) == 63)		{ start = 0; end = size; }
+		memset(&localCopy[start], n, end - start);
+
+		// What each slot misses before the commit, new slots miss everything.
+		u32 pendStart	[VBO_STREAM_SLOTS];
+		u32 pendEnd		[VBO_STREAM_SLOTS];
+		bool wasStreaming = stream.streaming;
+		for (u32 s = 0; s < VBO_STREAM_SLOTS; s++) {
+			pendStart[s]	= stream.pendStart[s];
+			pendEnd[s]		= stream.pendEnd[s];
+		}
+
+		s64 t0 = CKLBBenchmark::now();
+		mgr.commitStream(stream, GL_ARRAY_BUFFER, start, end, localCopy);
+		s64 t1 = CKLBBenchmark::now();
+		dglBindBuffer	(GL_ARRAY_BUFFER, ids[1]);
+		dglBufferSubData(GL_ARRAY_BUFFER, start, end - start, &localCopy[start]);
+		s64 t2 = CKLBBenchmark::now();
+		streamTime	+= t1 - t0;
+		naiveTime	+= t2 - t1;
+		naiveBytes	+= end - start;
+
+		u32 slot = stream.slot;
+		if (stream.streaming && !wasStreaming && (slot != 0)) {
+			pendStart[slot]	= 0;
+			pendEnd[slot]	= size;
+		}
+		u32 from	= (pendStart[slot] < start) ? pendStart[slot] : start;
+		u32 to		= (pendEnd[slot] > end) ? pendEnd[slot] : end;
+		u8* pSlot	= &mirror[slot * size];
+		memcpy(&pSlot[from], &localCopy[from], to - from);
+		if (memcmp(pSlot, localCopy, size) != 0) {
+			CPFInterface::getInstance().platform().logging("[BENCH] VBOSTREAM slot %i is stale at frame %i\n", slot, n);
+			ok = false;
+			break;
+		}
+	}
+	u32 streamBytes = mgr.m_uploadBytes;
+	u32 streamCalls = mgr.m_uploadCalls;
+
+	if (ok && (loops > VBO_STREAM_PROMOTE) && !stream.streaming) {
+		CPFInterface::getInstance().platform().logging("[BENCH] VBOSTREAM buffer was not promoted to streaming\n");
+		ok = false;
+	}
+
+	mgr.releaseStream(stream);
+	dglDeleteBuffers(1, &ids[1]);
+	mgr.frame			= savedFrame;
+	mgr.m_uploadBytes	= savedBytes;
+	mgr.m_uploadCalls	= savedCalls;
+	KLBDELETEA(localCopy);
+	KLBDELETEA(mirror);
+
+	CKLBBenchmark::report("commitStream", loops, streamTime);
+	CKLBBenchmark::report("single buffer glBufferSubData", loops, naiveTime);
+	CPFInterface::getInstance().platform().logging("[BENCH] uploaded %i KB in %i calls (single buffer %i KB)\n",
+		streamBytes / 1024, streamCalls, naiveBytes / 1024);
+	return ok;
+}
+
+static CKLBBenchmark gBenchVBOStream("VBOSTREAM", benchVBOStream);
+
+// Reload re-uploads the pixels given as context, as an asset reload would from its file.
+static bool benchResidencyCB(void* ctx, CTexture* pTexture, bool reload) {
+	if (reload) {
+		return CKLBOGLWrapper::getInstance().createTexture(64, 64, GL_RGBA, CKLBOGLWrapper::RGBA, ctx, 0, CKLBOGLWrapper::TEX_NONE, 0, pTexture) != NULL;
+	}
+	return true;
+}
+
+// Texture residency : 32 textures of 64x64 RGBA (16 KB) under a budget of 8, a sliding working set
+// of 6 textures stamped per simulated frame, then end of frame eviction. The application textures
+// are set aside (LRU list and resident counters) and restored, with the budget and statistics.
+// Checks drawn textures are resident, the resident bytes match the textures, the budget holds
+// unless every resident texture was drawn this frame, and no evicted texture was used more
+// recently than a resident one not drawn this frame.
+bool benchTextureResidency(u32 loops) {
+	enum { TEXTURES = 32, WORKING_SET = 6, BUDGET_COUNT = 8, TEX_BYTES = 64 * 64 * 4 };
+	CKLBOGLWrapper& mgr = CKLBOGLWrapper::getInstance();
+
+	CTexture*	savedHead		= mgr.m_pLRUHead;
+	CTexture*	savedTail		= mgr.m_pLRUTail;
+	u32			savedBytes		= mgr.m_residentBytes;
+	u32			savedCount		= mgr.m_residentCount;
+	u32			savedBudget		= mgr.m_textureBudget;
+	u32			savedEvictions	= mgr.m_evictions;
+	u32			savedReloads	= mgr.m_reloads;
+	u32			savedFailures	= mgr.m_reloadFailures;
+	u32			savedStall		= mgr.m_reloadStallUS;
+	s32			savedFrame		= mgr.frame;
+	mgr.m_pLRUHead		= NULL;
+	mgr.m_pLRUTail		= NULL;
+	mgr.m_residentBytes	= 0;
+	mgr.m_residentCount	= 0;
+	mgr.m_evictions		= 0;
+	mgr.m_reloads		= 0;
+	mgr.m_reloadFailures= 0;
+
+	u8* pixels = KLBNEWA(u8, TEXTURES * TEX_BYTES);
+	CTexture* textures[TEXTURES];
+	s32 usedFrame[TEXTURES];
+	bool ok = (pixels != NULL);
+	for (u32 n = 0; n < TEXTURES; n++) {
+		textures[n] = NULL;
+		if (ok) {
+			memset(&pixels[n * TEX_BYTES], n * 8, TEX_BYTES);
+			textures[n] = mgr.createTexture(64, 64, GL_RGBA, CKLBOGLWrapper::RGBA, &pixels[n * TEX_BYTES]);
+			ok = (textures[n] != NULL);
+			if (ok) {
+				mgr.setTextureResidency(textures[n], benchResidencyCB, &pixels[n * TEX_BYTES]);
+				usedFrame[n] = mgr.frame;
+			}
+		}
+	}
+	u32 texBytes		= mgr.m_residentBytes / TEXTURES;	// GPU size as accounted by createTexture.
+	mgr.m_textureBudget	= ok ? texBytes * BUDGET_COUNT : 0;
+	mgr.frame++;	// Creation frame is over : all textures can be evicted.
+
+	u32 expectedReloads = 0;
+	s64 time = 0;
+	for (u32 f = 0; ok && (f < loops); f++) {
+		s64 t0 = CKLBBenchmark::now();
+		for (u32 n = 0; n < WORKING_SET; n++) {
+			u32 idx = ((f * 3) + n) % TEXTURES;
+			if (!textures[idx]->isResident()) {
+				expectedReloads++;
+			}
+			mgr.stampTexture(textures[idx]);
+			usedFrame[idx] = mgr.frame;
+			ok &= textures[idx]->isResident();
+		}
+		mgr.evictTextures();
+		time += CKLBBenchmark::now() - t0;
+
+		u32 residentBytes	= 0;
+		bool allDrawn		= true;
+		s32 newestEvicted	= -0x7FFFFFFF;
+		s32 oldestKept		= 0x7FFFFFFF;
+		for (u32 n = 0; n < TEXTURES; n++) {
+			if (textures[n]->isResident()) {
+				residentBytes += texBytes;
+				if (usedFrame[n] != mgr.frame) {
+					allDrawn	= false;
+					oldestKept	= (usedFrame[n] < oldestKept) ? usedFrame[n] : oldestKept;
+				}
+			} else {
+				newestEvicted = (usedFrame[n] > newestEvicted) ? usedFrame[n] : newestEvicted;
+			}
+		}
+		ok = ok && (residentBytes == mgr.m_residentBytes)
+			&& ((mgr.m_residentBytes <= mgr.m_textureBudget) || allDrawn)
+			&& (newestEvicted <= oldestKept);
+		mgr.frame++;
+	}
+	ok = ok && (mgr.m_reloads == expectedReloads) && (mgr.m_reloadFailures == 0);
+	CKLBBenchmark::report("frame (6 stamps + eviction)", loops, time);
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	pltf.logging("[BENCH] TEXRESIDENCY %i evictions, %i reloads, %i us reload stall\n",
+		mgr.m_evictions, mgr.m_reloads, mgr.m_reloadStallUS - savedStall);
+	if (!ok) {
+		pltf.logging("[BENCH] TEXRESIDENCY residency or LRU order mismatch\n");
+	}
+
+	for (u32 n = 0; n < TEXTURES; n++) {
+		if (textures[n]) {
+			mgr.releaseTexture(textures[n]);
+		}
+	}
+	if (pixels) {
+		KLBDELETEA(pixels);
+	}
+	mgr.m_pLRUHead			= savedHead;
+	mgr.m_pLRUTail			= savedTail;
+	mgr.m_residentBytes		= savedBytes;
+	mgr.m_residentCount		= savedCount;
+	mgr.m_textureBudget		= savedBudget;
+	mgr.m_evictions			= savedEvictions;
+	mgr.m_reloads			= savedReloads;
+	mgr.m_reloadFailures	= savedFailures;
+	mgr.m_reloadStallUS		= savedStall;
+	mgr.frame				= savedFrame;
+	return ok;
+}
+
+static CKLBBenchmark gBenchTextureResidency("TEXRESIDENCY", benchTextureResidency);
+#endif
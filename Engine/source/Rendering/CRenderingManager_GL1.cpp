@@ -97,7 +97,7 @@ CShader*	CKLBOGLWrapper::createShader		(const char* /*source*/, SHADER_TYPE /*ty
 }
 
 // Rendering Shader.
-CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pPixelShader) {
+CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pPixelShader, bool /*deferLink*/) {
 	CShaderSet* pNewShaderSet = KLBNEW(CShaderSet);
 	if (pNewShaderSet) {
 		s32 size = pVertexShader->countUniform + pPixelShader->countUniform;
@@ -130,6 +130,14 @@ CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pP
 	return null;
 }
 
+void CKLBOGLWrapper::getShaderCacheStats(SShaderCacheStats* pStats) {
+	// No shader in 1.x profile.
+	pStats->cacheHits	= 0;
+	pStats->cacheMisses	= 0;
+	pStats->buildTimeUS	= 0;
+	pStats->savedTimeUS	= 0;
+}
+
 void CKLBOGLWrapper::releaseShader(CShader* pShader) {
 	CShader* p = this->shaderList;
 	CShader* prev = null;
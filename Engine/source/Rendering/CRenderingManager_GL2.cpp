@@ -14,6 +14,7 @@
    limitations under the License.
 */
 #include "RenderingFramework.h"
+#include "CKLBBenchmark.h"
 
 #ifdef OPENGL2
 
@@ -95,87 +96,310 @@ CShader*	CKLBOGLWrapper::createShader(SRenderState::RENDER_MODE mode, SHADER_TYP
 	return createShader(src, type, listParam);
 }
 
+// -----------------------------------------------------------------------------
+//  Program binary cache (GL_OES_get_program_binary).
+//
+//  Linked programs are stored in the external data directory, keyed by the
+//  shader sources and attribute bindings. The whole file is invalidated when the
+//  driver strings change. Any failure falls back to compile and link.
+// -----------------------------------------------------------------------------
+#ifdef GL_OES_get_program_binary
+#define SHADER_BINARY_CACHE
+#endif
+
+#define SHADER_CACHE_FILE		"file://external/shader_program.cache"
+#define SHADER_CACHE_MAGIC		(0x4350534B)	// 'KSPC'
+#define SHADER_CACHE_VERSION	(1)
+#define SHADER_CACHE_MAX		(64)
+#define SHADER_BINARY_MAX_SIZE	(1024*1024)
+
+static u32 hashShaderString(u32 hash, const char* str) {
+	// FNV-1a
+	if (str) {
+		while (*str) {
+			hash = (hash ^ (u8)(*str++)) * 16777619;
+		}
+	}
+	return (hash ^ 0xFF) * 16777619;	// Separator, "ab"+"c" != "a"+"bc"
+}
+
+#ifdef SHADER_BINARY_CACHE
+
+struct SProgramBinary {
+	u32		key;
+	u32		format;
+	u32		length;
+	u32		buildTimeUS;	// Compile + link time this binary replaces.
+	u8*		data;
+};
+
+static bool							gm_cacheInit		= false;
+static bool							gm_cacheSupported	= false;
+static bool							gm_cacheFileValid	= false;	// File header matches current driver.
+static u32							gm_driverHash		= 0;
+static u32							gm_cacheCount		= 0;
+static SProgramBinary				gm_cache[SHADER_CACHE_MAX];
+static PFNGLGETPROGRAMBINARYOESPROC	gm_glGetProgramBinary	= NULL;
+static PFNGLPROGRAMBINARYOESPROC	gm_glProgramBinary		= NULL;
+
+static void loadProgramCache() {
+	gm_cacheInit = true;
+
+	const char* ext = (const char*)dglGetString(GL_EXTENSIONS);
+	if (!ext || !strstr(ext, "GL_OES_get_program_binary")) {
+		return;
+	}
+
+	GLint formats = 0;
+	dglGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+	if (formats <= 0) {
+		return;
+	}
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	gm_glGetProgramBinary	= (PFNGLGETPROGRAMBINARYOESPROC)pltf.getGLExtension("glGetProgramBinaryOES");
+	gm_glProgramBinary		= (PFNGLPROGRAMBINARYOESPROC)	pltf.getGLExtension("glProgramBinaryOES");
+	if (!gm_glGetProgramBinary || !gm_glProgramBinary) {
+		return;
+	}
+
+	gm_cacheSupported	= true;
+	u32 hash			= 2166136261u;
+	hash				= hashShaderString(hash, (const char*)dglGetString(GL_VENDOR));
+	hash				= hashShaderString(hash, (const char*)dglGetString(GL_RENDERER));
+	gm_driverHash		= hashShaderString(hash, (const char*)dglGetString(GL_VERSION));
+
+	const char* fullPath = pltf.getFullPath(SHADER_CACHE_FILE);
+	void* f = fullPath ? pltf.ifopen(fullPath, "rb") : NULL;
+	delete[] fullPath;
+
+	if (f) {
+		u32 header[3];
+		if ((pltf.ifread(header, sizeof(u32), 3, f) == 3)
+			&& (header[0] == SHADER_CACHE_MAGIC)
+			&& (header[1] == SHADER_CACHE_VERSION)
+			&& (header[2] == gm_driverHash)) {
+			gm_cacheFileValid = true;
+
+			u32 entry[4];
+			while ((gm_cacheCount < SHADER_CACHE_MAX) && (pltf.ifread(entry, sizeof(u32), 4, f) == 4)) {
+				if (entry[2] > SHADER_BINARY_MAX_SIZE) {
+					gm_cacheFileValid = false;
+					break;
+				}
+
+				u8* data = KLBNEWA(u8, entry[2]);
+				if (!data) {
+					break;
+				}
+				if (pltf.ifread(data, 1, entry[2], f) != entry[2]) {
+					// Truncated : rewrite the file on next store.
+					KLBDELETEA(data);
+					gm_cacheFileValid = false;
+					break;
+				}
+
+				SProgramBinary& bin = gm_cache[gm_cacheCount++];
+				bin.key			= entry[0];
+				bin.format		= entry[1];
+				bin.length		= entry[2];
+				bin.buildTimeUS	= entry[3];
+				bin.data		= data;
+			}
+		}
+		pltf.ifclose(f);
+	}
+}
+
+static void writeProgramEntry(IPlatformRequest& pltf, void* f, SProgramBinary& bin) {
+	u32 entry[4];
+	entry[0] = bin.key;
+	entry[1] = bin.format;
+	entry[2] = bin.length;
+	entry[3] = bin.buildTimeUS;
+	pltf.ifwrite(entry, sizeof(u32), 4, f);
+	pltf.ifwrite(bin.data, 1, bin.length, f);
+}
+
+static void storeProgramBinary(u32 key, GLuint progID, u32 buildTimeUS) {
+	if (!gm_cacheSupported || (gm_cacheCount >= SHADER_CACHE_MAX)) {
+		return;
+	}
+
+	GLint length = 0;
+	dglGetProgramiv(progID, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+	if ((length <= 0) || (length > SHADER_BINARY_MAX_SIZE)) {
+		return;
+	}
+
+	u8* data = KLBNEWA(u8, length);
+	if (!data) {
+		return;
+	}
+
+	GLsizei	written = 0;
+	GLenum	format	= 0;
+	gm_glGetProgramBinary(progID, length, &written, &format, data);
+	if (written <= 0) {
+		KLBDELETEA(data);
+		return;
+	}
+
+	SProgramBinary& bin = gm_cache[gm_cacheCount++];
+	bin.key			= key;
+	bin.format		= format;
+	bin.length		= written;
+	bin.buildTimeUS	= buildTimeUS;
+	bin.data		= data;
+
+	// Append, or rewrite everything when the file is missing / stale.
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	const char* fullPath = pltf.getFullPath(SHADER_CACHE_FILE);
+	void* f = fullPath ? pltf.ifopen(fullPath, gm_cacheFileValid ? "ab" : "wb") : NULL;
+	delete[] fullPath;
+
+	if (f) {
+		if (gm_cacheFileValid) {
+			writeProgramEntry(pltf, f, bin);
+		} else {
+			u32 header[3];
+			header[0] = SHADER_CACHE_MAGIC;
+			header[1] = SHADER_CACHE_VERSION;
+			header[2] = gm_driverHash;
+			pltf.ifwrite(header, sizeof(u32), 3, f);
+			for (u32 n = 0; n < gm_cacheCount; n++) {
+				writeProgramEntry(pltf, f, gm_cache[n]);
+			}
+			gm_cacheFileValid = true;
+		}
+		pltf.ifclose(f);
+	}
+}
+
+// Return the cache entry loaded into progID, NULL on miss or if the driver rejects it.
+static SProgramBinary* loadProgramBinary(u32 key, GLuint progID) {
+	for (u32 n = 0; n < gm_cacheCount; n++) {
+		SProgramBinary& bin = gm_cache[n];
+		if (bin.key == key) {
+			gm_glProgramBinary(progID, bin.format, bin.data, bin.length);
+
+			GLint success = 0;
+			dglGetProgramiv(progID, GL_LINK_STATUS, &success);
+			if (success) {
+				return &bin;
+			}
+
+			// Rejected by the driver : drop it, the file is rewritten on next store.
+			KLBDELETEA(bin.data);
+			gm_cache[n] = gm_cache[--gm_cacheCount];
+			gm_cacheFileValid = false;
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+static bool hasProgramBinary(u32 key) {
+	if (!gm_cacheInit) {
+		loadProgramCache();
+	}
+	for (u32 n = 0; n < gm_cacheCount; n++) {
+		if (gm_cache[n].key == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
+
+static SShaderCacheStats	gm_shaderStats = { 0, 0, 0, 0 };
+
+void CKLBOGLWrapper::getShaderCacheStats(SShaderCacheStats* pStats) {
+	*pStats = gm_shaderStats;
+}
+
 // Shaders.
 CShader*	CKLBOGLWrapper::createShader		(const char* source, SHADER_TYPE type, const SParam* listParam) {
+	if (!source) {
+		return NULL;
+	}
+
 	CShader* pNewShader = KLBNEW(CShader);
 	if (pNewShader) {
-		GLuint shaderID = dglCreateShader(type == VERTEX_SHADER ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
-		if (shaderID != 0) {
-			GLint compiled;
-
-			dglShaderSource(shaderID, 1, &source, null);
-			// Compile the shader
-			dglCompileShader(shaderID);
-			// Check the compile status
-			dglGetShaderiv(shaderID, GL_COMPILE_STATUS, &compiled);
+		// Compiled on demand (createShaderSet / linkShaderSet) : not needed when the program comes from the cache.
+		u32 len				= strlen(source);
+		pNewShader->source	= KLBNEWA(char, len + 1);
+		if (pNewShader->source) {
+			memcpy(pNewShader->source, source, len + 1);
+			pNewShader->shaderObj	= 0;
+			pNewShader->shaderType	= (type == VERTEX_SHADER) ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+			pNewShader->sourceHash	= hashShaderString(2166136261u, source);
 
-			if (compiled) {
-				//
-				// Parse the list of parameters
-				//
-				const SParam* parser = listParam;
-				
-				bool type;
-				
-				if (parser) {
-					s32 uniCount = 0;
-					s32 verCount = 0;
-					while (parser->dType != END_LIST) {
-						if (parser->isUniform) {
-							uniCount++;
-						} else {
-							verCount++;
-						}
-						if (parser->dType & TEXTURE) {
-							pNewShader->enableTexture = true;
-						}
-						if (parser->dType & COLOR) {
-							pNewShader->enableColor = true;
-						}
-						parser++;
+			//
+			// Parse the list of parameters
+			//
+			const SParam* parser = listParam;
+			
+			bool type;
+			
+			if (parser) {
+				s32 uniCount = 0;
+				s32 verCount = 0;
+				while (parser->dType != END_LIST) {
+					if (parser->isUniform) {
+						uniCount++;
+					} else {
+						verCount++;
+					}
+					if (parser->dType & TEXTURE) {
+						pNewShader->enableTexture = true;
+					}
+					if (parser->dType & COLOR) {
+						pNewShader->enableColor = true;
 					}
+					parser++;
+				}
 
-					pNewShader->countUniform		= uniCount;
-					pNewShader->countStreamInfo		= verCount;
+				pNewShader->countUniform		= uniCount;
+				pNewShader->countStreamInfo		= verCount;
 
-					pNewShader->arrayParam			= KLBNEWA(CShader::SInternalParam,uniCount + verCount);
+				pNewShader->arrayParam			= KLBNEWA(CShader::SInternalParam,uniCount + verCount);
 
-					if (pNewShader->arrayParam) {
-						CShader::SInternalParam* pUniParam = pNewShader->arrayParam;
-						CShader::SInternalParam* pVerParam = &pNewShader->arrayParam[uniCount];
-						parser = listParam;
+				if (pNewShader->arrayParam) {
+					CShader::SInternalParam* pUniParam = pNewShader->arrayParam;
+					CShader::SInternalParam* pVerParam = &pNewShader->arrayParam[uniCount];
+					parser = listParam;
 
-						while (parser->dType != END_LIST) {
-							if (parser->isUniform) {
-								pUniParam->param = *parser++;
-								pUniParam++;
-							} else {
-								pVerParam->param = *parser++;
-								pVerParam++;
-							}
+					while (parser->dType != END_LIST) {
+						if (parser->isUniform) {
+							pUniParam->param = *parser++;
+							pUniParam++;
+						} else {
+							pVerParam->param = *parser++;
+							pVerParam++;
 						}
-
 					}
-				
-					type							= true;
-				} else {
-					pNewShader->countUniform		= 0;
-					pNewShader->countStreamInfo		= 0;
-					pNewShader->arrayParam			= null;
-					type							= false;
+
 				}
+			
+				type							= true;
+			} else {
+				pNewShader->countUniform		= 0;
+				pNewShader->countStreamInfo		= 0;
+				pNewShader->arrayParam			= null;
+				type							= false;
+			}
 
 
-				if ((pNewShader->arrayParam && type) || (!type)) {
-					pNewShader->refCount	= 0;
-					pNewShader->shaderObj	= shaderID;
-					pNewShader->pNext		= this->shaderList;
-					this->shaderList		= pNewShader; 
+			if ((pNewShader->arrayParam && type) || (!type)) {
+				pNewShader->refCount	= 0;
+				pNewShader->pNext		= this->shaderList;
+				this->shaderList		= pNewShader; 
 
-					return pNewShader;
-				}
+				return pNewShader;
 			}
-			dglDeleteShader(shaderID);
+			KLBDELETEA(pNewShader->source);
 		}
 			
 		KLBDELETE(pNewShader);
@@ -184,8 +408,133 @@ CShader*	CKLBOGLWrapper::createShader		(const char* source, SHADER_TYPE type, co
 	return pNewShader;
 }
 
+bool CKLBOGLWrapper::compileShader(CShader* pShader) {
+	if (pShader->shaderObj) {
+		return true;
+	}
+
+	GLuint shaderID = dglCreateShader(pShader->shaderType);
+	if (shaderID != 0) {
+		GLint compiled = 0;
+		const char* src = pShader->source;
+
+		dglShaderSource(shaderID, 1, &src, null);
+		// Compile the shader
+		dglCompileShader(shaderID);
+		// Check the compile status
+		dglGetShaderiv(shaderID, GL_COMPILE_STATUS, &compiled);
+
+		if (compiled) {
+			pShader->shaderObj = shaderID;
+			return true;
+		}
+		dglDeleteShader(shaderID);
+	}
+	klb_assertAlways("Shader compilation failed");
+	return false;
+}
+
+bool CKLBOGLWrapper::linkShaderSet(CShaderSet* pSet) {
+	pSet->linkPending = false;
+
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	s64 start = pltf.nanotime();
+
+	CShader* pVertexShader	= pSet->vertexShader;
+	CShader* pPixelShader	= pSet->pixelShader;
+
+	GLuint progID = dglCreateProgram();
+	if (!progID) {
+		return false;
+	}
+
+	//
+	// Iterate through vertex shader attribute 
+	//
+	s32 iterator = 0;
+	CShader::SInternalParam* pParam = &pVertexShader->arrayParam[pVertexShader->countUniform];
+	while (iterator < pVertexShader->countStreamInfo) {
+		dglBindAttribLocation(progID, iterator, pParam->param.name);	// Actually only associated with vertex.
+		iterator++;
+		pParam++;				
+	}
+
+	GLint success = 0;
+#ifdef SHADER_BINARY_CACHE
+	if (!gm_cacheInit) {
+		loadProgramCache();
+	}
+
+	SProgramBinary* pBinary = loadProgramBinary(pSet->cacheKey, progID);
+	if (pBinary) {
+		success = 1;
+		u32 loadTimeUS = (u32)((pltf.nanotime() - start) / 1000);
+		gm_shaderStats.cacheHits++;
+		gm_shaderStats.buildTimeUS += loadTimeUS;
+		if (pBinary->buildTimeUS > loadTimeUS) {
+			gm_shaderStats.savedTimeUS += pBinary->buildTimeUS - loadTimeUS;
+		}
+	} else
+#endif
+	{
+		if (compileShader(pVertexShader) && compileShader(pPixelShader)) {
+			// Attach
+			dglAttachShader(progID, pVertexShader->shaderObj);
+			dglAttachShader(progID, pPixelShader->shaderObj);
+
+			dglLinkProgram(progID);
+			dglGetProgramiv(progID, GL_LINK_STATUS, &success);
+		}
+
+		if (success) {
+			u32 buildTimeUS = (u32)((pltf.nanotime() - start) / 1000);
+			gm_shaderStats.cacheMisses++;
+			gm_shaderStats.buildTimeUS += buildTimeUS;
+#ifdef SHADER_BINARY_CACHE
+			storeProgramBinary(pSet->cacheKey, progID, buildTimeUS);
+#endif
+		}
+	}
+
+	if (success)
+	{
+		s32 uniformIndex = 0;
+		for (s32 n=0; n < 2; n++) {
+			CShader* pShader;
+			if (n==0) { pShader = pVertexShader; } else { pShader = pPixelShader; }
+	
+			CShader::SInternalParam* pParam = pShader->arrayParam;
+			iterator = 0;
+			while (iterator < pShader->countUniform) {
+				// Becomes UniformID
+				pSet->locationArray[uniformIndex++] = dglGetUniformLocation(progID, pParam->param.name);
+				iterator++;
+				pParam++;
+			}
+		}
+
+		pSet->programObj = progID;
+		return true;
+	}
+
+	dglDeleteProgram(progID);
+	return false;
+}
+
+void CKLBOGLWrapper::linkPendingShaderSet() {
+	// One program per call, spread over frames.
+	CShaderSet* pSet = this->shaderSetList;
+	while (pSet) {
+		if (pSet->linkPending) {
+			linkShaderSet(pSet);
+			return;
+		}
+		pSet = pSet->pNext;
+	}
+}
+
 // Rendering Shader.
-CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pPixelShader) {
+CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pPixelShader, bool deferLink) {
 	CShaderSet* pNewShaderSet = KLBNEW(CShaderSet);
 	if (pNewShaderSet) {
 		s32 size = pVertexShader->countUniform + pPixelShader->countUniform;
@@ -196,63 +545,42 @@ CShaderSet*	CKLBOGLWrapper::createShaderSet	(CShader* pVertexShader, CShader* pP
 		}
 
 		if ((pNewShaderSet->locationArray) || (size == 0)) {
-			GLuint progID = dglCreateProgram();
-			if (progID) {
-				// Attach
-				dglAttachShader(progID, pVertexShader->shaderObj);
-				dglAttachShader(progID, pPixelShader->shaderObj);
-			
-				pNewShaderSet->pInstances	= null;
-				pNewShaderSet->pMgr			= this;
-
-				//
-				// Iterate through vertex shader attribute 
-				//
-				s32 iterator = 0;
-				CShader::SInternalParam* pParam = &pVertexShader->arrayParam[pVertexShader->countUniform];
-				while (iterator < pVertexShader->countStreamInfo) {
-					dglBindAttribLocation(progID, iterator, pParam->param.name);	// Actually only associated with vertex.
-					iterator++;
-					pParam++;				
-				}
-
-				dglLinkProgram(progID);
-
-				GLint success = 0;
-				dglGetProgramiv(progID, GL_LINK_STATUS, &success);
-				if (success)
-				{
-					s32 uniformIndex = 0;
-					for (s32 n=0; n < 2; n++) {
-						CShader* pShader;
-						if (n==0) { pShader = pVertexShader; } else { pShader = pPixelShader; }
-				
-						CShader::SInternalParam* pParam = pShader->arrayParam;
-						iterator = 0;
-						while (iterator < pShader->countUniform) {
-							// Becomes UniformID
-							pNewShaderSet->locationArray[uniformIndex++] = dglGetUniformLocation(progID, pParam->param.name);
-							iterator++;
-							pParam++;
-						}
-					}
-
-					pNewShaderSet->programObj	= progID;
-					pNewShaderSet->pNext		= this->shaderSetList;
-					this->shaderSetList			= pNewShaderSet;
-
-					pVertexShader->refCount++;
-					pPixelShader->refCount++;
+			pNewShaderSet->pInstances	= null;
+			pNewShaderSet->pMgr			= this;
+			pNewShaderSet->programObj	= 0;
+			pNewShaderSet->pixelShader	= pPixelShader;
+			pNewShaderSet->vertexShader	= pVertexShader;
+
+			// Cache key : both sources and the attribute bindings.
+			u32 key = pVertexShader->sourceHash ^ (pPixelShader->sourceHash * 31);
+			CShader::SInternalParam* pParam = &pVertexShader->arrayParam[pVertexShader->countUniform];
+			for (s32 n = 0; n < pVertexShader->countStreamInfo; n++) {
+				key = hashShaderString(key, pParam[n].param.name);
+			}
+			pNewShaderSet->cacheKey		= key;
+
+			// Deferred sets are linked from endFrame() or on first draw.
+			// Only a program known to the binary cache is deferred : new sources are
+			// built now so that a broken shader is reported to the caller.
+#ifdef SHADER_BINARY_CACHE
+			if (deferLink && !hasProgramBinary(key)) {
+				deferLink = false;
+			}
+#else
+			deferLink = false;
+#endif
+			pNewShaderSet->linkPending	= deferLink;
+			if (deferLink || linkShaderSet(pNewShaderSet)) {
+				pNewShaderSet->pNext		= this->shaderSetList;
+				this->shaderSetList			= pNewShaderSet;
 
-					pNewShaderSet->pixelShader	= pPixelShader;
-					pNewShaderSet->vertexShader	= pVertexShader;
+				pVertexShader->refCount++;
+				pPixelShader->refCount++;
 
-					pNewShaderSet->enableTexture	= pPixelShader->enableTexture | pVertexShader->enableTexture;
-					pNewShaderSet->enableColor		= pPixelShader->enableColor   | pVertexShader->enableColor;
+				pNewShaderSet->enableTexture	= pPixelShader->enableTexture | pVertexShader->enableTexture;
+				pNewShaderSet->enableColor		= pPixelShader->enableColor   | pVertexShader->enableColor;
 
-					return pNewShaderSet;
-				}
-				dglDeleteProgram(progID);
+				return pNewShaderSet;
 			}
 
 			if (pNewShaderSet->locationArray) {
@@ -284,7 +612,13 @@ void CKLBOGLWrapper::releaseShader(CShader* pShader) {
 	//
 	// Delete shader from GL
 	//
-	dglDeleteShader(pShader->shaderObj);
+	if (pShader->shaderObj) {
+		dglDeleteShader(pShader->shaderObj);
+	}
+
+	if (pShader->source) {
+		KLBDELETEA(pShader->source);
+	}
 
 	// Free param
 	if (pShader->arrayParam) {
@@ -315,7 +649,9 @@ void CKLBOGLWrapper::releaseShaderSet(CShaderSet* pFullShader) {
 	pFullShader->releaseAllInstances();
 	// Release open GL associated program.
 
-	dglDeleteProgram(pFullShader->programObj);
+	if (pFullShader->programObj) {
+		dglDeleteProgram(pFullShader->programObj);
+	}
 
 	if (pFullShader->locationArray) {
 		KLBDELETE(pFullShader->locationArray);
@@ -361,6 +697,15 @@ void CKLBOGLWrapper::draw(
 		pIndexBuffer->commitVBO();
 	}
 	
+	CShaderSet* pSet = instance->m_pShaderSet;
+	if (pSet->linkPending) {
+		// Deferred program needed now.
+		linkShaderSet(pSet);
+	}
+	if (!pSet->programObj) {
+		return;
+	}
+
 	if (m_lastShaderInstance != instance) {
 		// Same Shader with different param is also a possibility.
 		if (!m_lastShaderInstance || (m_lastShaderInstance->m_pShaderSet != instance->m_pShaderSet)) {
@@ -569,5 +914,113 @@ void CKLBOGLWrapper::draw(
 	}
 }
 
+#ifdef INTERNAL_BENCH
+// Builds a program from the sources given, NULL binary : compile + link, else load the binary.
+static GLuint benchBuildProgram(const char* vsSrc, const char* psSrc, GLenum format, const void* binary, GLsizei length) {
+	static const char* attribs[] = { "pos_attr", "uv_attr", "col_attr" };
+	GLuint progID = dglCreateProgram();
+	if (!progID) {
+		return 0;
+	}
+	for (u32 n = 0; n < 3; n++) {
+		dglBindAttribLocation(progID, n, attribs[n]);
+	}
+
+	GLint success = 0;
+	if (binary) {
+#ifdef SHADER_BINARY_CACHE
+		gm_glProgramBinary(progID, format, binary, length);
+		dglGetProgramiv(progID, GL_LINK_STATUS, &success);
+#endif
+	} else {
+		GLuint shaders[2];
+		const char* sources[2] = { vsSrc, psSrc };
+		GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		for (u32 n = 0; n < 2; n++) {
+			GLint compiled = 0;
+			shaders[n] = dglCreateShader(types[n]);
+			dglShaderSource(shaders[n], 1, &sources[n], null);
+			dglCompileShader(shaders[n]);
+			dglGetShaderiv(shaders[n], GL_COMPILE_STATUS, &compiled);
+			if (compiled) {
+				dglAttachShader(progID, shaders[n]);
+			}
+		}
+		dglLinkProgram(progID);
+		dglGetProgramiv(progID, GL_LINK_STATUS, &success);
+		dglDeleteShader(shaders[0]);
+		dglDeleteShader(shaders[1]);
+	}
+	if (!success) {
+		dglDeleteProgram(progID);
+		return 0;
+	}
+	return progID;
+}
+
+// Textured + colored sprite program : compile + link against loading its program binary
+// (miss and hit paths of the cache), without touching the cache entries or file.
+// Checks the binary links and exposes the same uniform locations as the compiled program.
+static bool benchShaderCache(u32 loops) {
+	IPlatformRequest& pltf = CPFInterface::getInstance().platform();
+	s64 timeBuild	= 0;
+	s64 timeLoad	= 0;
+	u32 loaded		= 0;
+	bool ok			= true;
+#ifdef SHADER_BINARY_CACHE
+	if (!gm_cacheInit) {
+		loadProgramCache();
+	}
+#endif
+	for (u32 l = 0; ok && (l < loops); l++) {
+		s64 t0 = CKLBBenchmark::now();
+		GLuint built = benchBuildProgram(sh_vertColTexture, sh_fragColTexture, 0, NULL, 0);
+		timeBuild += CKLBBenchmark::now() - t0;
+		ok = (built != 0);
+
+#ifdef SHADER_BINARY_CACHE
+		if (ok && gm_cacheSupported) {
+			GLint length = 0;
+			dglGetProgramiv(built, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+			u8* data = (length > 0) ? KLBNEWA(u8, length) : NULL;
+			GLsizei	written	= 0;
+			GLenum	format	= 0;
+			if (data) {
+				gm_glGetProgramBinary(built, length, &written, &format, data);
+			}
+			if (written > 0) {
+				s64 t1 = CKLBBenchmark::now();
+				GLuint fromBinary = benchBuildProgram(NULL, NULL, format, data, written);
+				timeLoad += CKLBBenchmark::now() - t1;
+				loaded++;
+				ok = (fromBinary != 0)
+					&& (dglGetUniformLocation(fromBinary, "Projection")	== dglGetUniformLocation(built, "Projection"))
+					&& (dglGetUniformLocation(fromBinary, "texture")	== dglGetUniformLocation(built, "texture"));
+				if (fromBinary) {
+					dglDeleteProgram(fromBinary);
+				}
+			}
+			KLBDELETEA(data);
+		}
+#endif
+		if (built) {
+			dglDeleteProgram(built);
+		}
+	}
+	CKLBBenchmark::report("compile + link", loops, timeBuild);
+	if (loaded) {
+		CKLBBenchmark::report("load program binary", loaded, timeLoad);
+	} else {
+		pltf.logging("[BENCH] SHADERCACHE program binaries are not supported by this driver\n");
+	}
+	if (!ok) {
+		pltf.logging("[BENCH] SHADERCACHE program build or binary load failed\n");
+	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchShaderCache("SHADERCACHE", benchShaderCache);
+#endif
+
 #endif
 
@@ -17,6 +17,9 @@
 #include "mem.h"
 
 CShader::CShader():
+	source(NULL),
+	sourceHash(0),
+	shaderType(0),
 	enableTexture(false),
 	enableColor(false)
 {
@@ -27,7 +30,10 @@ CShader::~CShader() {
 	// Do nothing.
 }
 
-CShaderSet::CShaderSet() {
+CShaderSet::CShaderSet():
+	cacheKey(0),
+	linkPending(false)
+{
 	// Do nothing.
 }
 
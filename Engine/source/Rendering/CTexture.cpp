@@ -17,8 +17,15 @@
 
 // nothing.
 
-CTexture::CTexture() {
-	// Do nothing.
+CTexture::CTexture()
+:residencyCB	(NULL)
+,residencyCtx	(NULL)
+,pLRUPrev		(NULL)
+,pLRUNext		(NULL)
+,byteSize		(0)
+,lastUsedFrame	(-1)
+,resident		(false)
+{
 }
 
 CTexture::~CTexture() {
@@ -93,7 +93,23 @@ void CTextureBase::releaseSubTextures() {
 	}
 }
 
+void CTextureBase::resetSampling() {
+	// Texture objects were recreated : sampling parameters must be sent again.
+	CTextureUsage* pUsage = &this->usageList;
+	while (pUsage) {
+		pUsage->samplingSetupDone = false;
+		pUsage = pUsage->pNext;
+	}
+
+	CTextureBase* pBase = this->pChild;
+	while (pBase) {
+		pBase->resetSampling();
+		pBase = pBase->pBrother;
+	}
+}
+
 void CTexture::makeEmptyShell() {
+	pMgr->dropResidency(this);
 	if (texture) {
 		dglDeleteTextures(1, &texture);
 		texture = 0;
@@ -143,6 +159,10 @@ void	CTextureBase::releaseSubTexture(CSubTexture* /*pSubTex*/) {
 }
 
 void CTextureBase::updateTextureFromFrame(u32 mipLevel, s32 dstX, s32 dstY, s32 srcX, s32 srcY, s32 srcW, s32 srcH) {
+	if (!pMgr->pinTexture(pMaster)) {
+		return;
+	}
+
 	dglBindTexture(GL_TEXTURE_2D,pMaster->getWorkingTexture());
 
 	dstX += this->x;
@@ -155,6 +175,18 @@ bool	CTextureBase::updateTexture(s32 x, s32 y, s32 width, s32 height, void* data
 	x = this->x + x;
 	y = this->y + y;
 
+	// GL errors are not read back per call : reject what the driver would refuse.
+	if ((!data) || (width <= 0) || (height <= 0) || (x < 0) || (y < 0)
+	||  ((x + width) > pMaster->width) || ((y + height) > pMaster->height)) {
+		klb_assertAlways("Invalid texture update");
+		return false;
+	}
+
+	// Patched content is lost on eviction.
+	if (!pMgr->pinTexture(pMaster)) {
+		return false;
+	}
+
 	dglBindTexture(GL_TEXTURE_2D,pMaster->getWorkingTexture());
 
 	dglPixelStorei(GL_PACK_ALIGNMENT,	1);
@@ -175,12 +207,14 @@ bool	CTextureBase::updateTexture(s32 x, s32 y, s32 width, s32 height, void* data
 				data);
 	}
 
+#ifdef GL_CHECK_EACH_CALL
 	if (dglGetError()) {
 		klb_assertAlways("Invalid texture update");
 		return false;
-	} else {
-		return true;
 	}
+#endif
+	// Otherwise errors are polled once per frame (dglFrameEnd).
+	return true;
 }
 
 void CTextureBase::convertPixelToRenderUV(s32 x, s32 y, UVCOMPUTE_MODE sampling, float* u, float* v) {
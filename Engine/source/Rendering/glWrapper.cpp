@@ -13,9 +13,13 @@
    See the License for the specific language governing permissions and
    limitations under the License.
 */
+// Implements the state shadow : keep the dgl* entry points unredirected here.
+#define GL_STATE_SHADOW_IMPL
 #include "glWrapper.h"
 #include "assert_klb.h"
+#include "CKLBBenchmark.h"
 #include <stdio.h>
+#include <string.h>
 
 // static bool gl_log = false;
 
@@ -472,3 +476,541 @@ void dglViewport  (GLint x, GLint y, GLsizei width, GLsizei height) 							{ glV
 #endif
 
 #endif
+
+// ---------------------------------------------------------------------------------------
+//
+//  State shadowing
+//
+// ---------------------------------------------------------------------------------------
+#ifdef USE_STATE_SHADOW
+
+#define SHADOW_UNKNOWN		(0xFFFFFFFF)
+#define SHADOW_TEX_UNITS	(8)
+#define SHADOW_ATTRIBS		(16)
+
+// Every field is SHADOW_UNKNOWN until the first call sets it.
+struct SGLShadow {
+	GLuint	activeUnit;
+	GLuint	texture2D		[SHADOW_TEX_UNITS];
+	GLuint	arrayBuffer;
+	GLuint	elementBuffer;
+	GLuint	blendSrc;
+	GLuint	blendDst;
+	GLuint	packAlign;
+	GLuint	unpackAlign;
+	GLuint	blend;
+	GLuint	scissor;
+	GLuint	depthTest;
+	GLuint	stencilTest;
+	GLuint	cullFace;
+#ifndef OPENGL2
+	GLuint	alphaTest;
+	GLuint	texEnable		[SHADOW_TEX_UNITS];
+	GLuint	clientUnit;
+	GLuint	texCoordArray	[SHADOW_TEX_UNITS];
+	GLuint	vertexArray;
+	GLuint	colorArray;
+	GLuint	normalArray;
+#else
+	GLuint	program;
+	GLuint	attribArray		[SHADOW_ATTRIBS];
+#endif
+
+	SGLShadow() { reset(); }
+	void reset() { memset(this, 0xFF, sizeof(SGLShadow)); }
+};
+
+static SGLShadow	gm_shadow;
+static unsigned int	gm_elided			= 0;
+static unsigned int	gm_forwarded		= 0;
+static unsigned int	gm_lastElided		= 0;
+static unsigned int	gm_lastForwarded	= 0;
+
+// Returns true if the driver must be called.
+static inline bool shadowSet(GLuint& slot, GLuint value) {
+	if (slot == value) {
+		gm_elided++;
+		return false;
+	}
+	slot = value;
+	gm_forwarded++;
+	return true;
+}
+
+static GLuint* capSlot(SGLShadow& s, GLenum cap) {
+	switch (cap) {
+	case GL_BLEND:			return &s.blend;
+	case GL_SCISSOR_TEST:	return &s.scissor;
+	case GL_DEPTH_TEST:		return &s.depthTest;
+	case GL_STENCIL_TEST:	return &s.stencilTest;
+	case GL_CULL_FACE:		return &s.cullFace;
+#ifndef OPENGL2
+	case GL_ALPHA_TEST:		return &s.alphaTest;
+	case GL_TEXTURE_2D:		// Per texture unit.
+		return (s.activeUnit < SHADOW_TEX_UNITS) ? &s.texEnable[s.activeUnit] : NULL;
+#endif
+	default:				return NULL;
+	}
+}
+
+#ifdef INTERNAL_BENCH
+// Null GL backend : while set, the calls the shadow lets through go to this recorder
+// instead of the driver (see benchGLShadow).
+enum NULLGL_CALL {
+	NULLGL_ACTIVE_TEXTURE,
+	NULLGL_BIND_TEXTURE,
+	NULLGL_DELETE_TEXTURE,
+	NULLGL_BIND_BUFFER,
+	NULLGL_DELETE_BUFFER,
+	NULLGL_ENABLE,
+	NULLGL_DISABLE,
+	NULLGL_BLEND_FUNC,
+	NULLGL_PIXEL_STORE,
+	NULLGL_CLIENT_ACTIVE_TEXTURE,
+	NULLGL_ENABLE_CLIENT_STATE,
+	NULLGL_DISABLE_CLIENT_STATE,
+	NULLGL_USE_PROGRAM,
+	NULLGL_ENABLE_ATTRIB,
+	NULLGL_DISABLE_ATTRIB
+};
+
+static void (*gm_nullGL)(NULLGL_CALL call, GLuint a, GLuint b) = NULL;
+
+#define SHADOW_FORWARD(call, a, b, glCall)	if (gm_nullGL) { gm_nullGL(call, a, b); } else { glCall; }
+#else
+#define SHADOW_FORWARD(call, a, b, glCall)	glCall
+#endif
+
+void dglStateReset() {
+	gm_shadow.reset();
+}
+
+void dglFrameEnd() {
+#ifndef GL_CHECK_EACH_CALL
+	// Single poll per frame, drain the other pending flags.
+	GLenum err = glGetError();
+	if (err != GL_NO_ERROR) {
+		for (int n = 0; (n < 8) && (glGetError() != GL_NO_ERROR); n++) {}
+		klb_assertAlways("OpenGL error 0x%04X during frame", err);
+	}
+#endif
+	gm_lastElided		= gm_elided;
+	gm_lastForwarded	= gm_forwarded;
+	gm_elided			= 0;
+	gm_forwarded		= 0;
+}
+
+unsigned int dglGetElidedCalls() {
+	return gm_lastElided;
+}
+
+unsigned int dglGetForwardedCalls() {
+	return gm_lastForwarded;
+}
+
+void sglActiveTexture(GLenum texture) {
+	if (shadowSet(gm_shadow.activeUnit, texture - GL_TEXTURE0)) {
+		SHADOW_FORWARD(NULLGL_ACTIVE_TEXTURE, texture, 0, dglActiveTexture(texture));
+	}
+}
+
+void sglBindTexture(GLenum target, GLuint texture) {
+	if ((target == GL_TEXTURE_2D) && (gm_shadow.activeUnit < SHADOW_TEX_UNITS)) {
+		if (!shadowSet(gm_shadow.texture2D[gm_shadow.activeUnit], texture)) {
+			return;
+		}
+	}
+	SHADOW_FORWARD(NULLGL_BIND_TEXTURE, target, texture, dglBindTexture(target, texture));
+}
+
+void sglDeleteTextures(GLsizei n, const GLuint* textures) {
+	// A deleted texture is unbound from every unit (binding reverts to 0).
+	for (GLsizei i = 0; i < n; i++) {
+		for (int u = 0; u < SHADOW_TEX_UNITS; u++) {
+			if (gm_shadow.texture2D[u] == textures[i]) {
+				gm_shadow.texture2D[u] = 0;
+			}
+		}
+	}
+#ifdef INTERNAL_BENCH
+	if (gm_nullGL) {
+		for (GLsizei i = 0; i < n; i++) { gm_nullGL(NULLGL_DELETE_TEXTURE, textures[i], 0); }
+		return;
+	}
+#endif
+	dglDeleteTextures(n, textures);
+}
+
+void sglBindBuffer(GLenum target, GLuint buffer) {
+	GLuint* pSlot;
+	switch (target) {
+	case GL_ARRAY_BUFFER:			pSlot = &gm_shadow.arrayBuffer;		break;
+	case GL_ELEMENT_ARRAY_BUFFER:	pSlot = &gm_shadow.elementBuffer;	break;
+	default:						pSlot = NULL;						break;
+	}
+	if ((pSlot == NULL) || shadowSet(*pSlot, buffer)) {
+		SHADOW_FORWARD(NULLGL_BIND_BUFFER, target, buffer, dglBindBuffer(target, buffer));
+	}
+}
+
+void sglDeleteBuffers(GLsizei n, const GLuint* buffers) {
+	for (GLsizei i = 0; i < n; i++) {
+		if (gm_shadow.arrayBuffer   == buffers[i]) { gm_shadow.arrayBuffer   = 0; }
+		if (gm_shadow.elementBuffer == buffers[i]) { gm_shadow.elementBuffer = 0; }
+	}
+#ifdef INTERNAL_BENCH
+	if (gm_nullGL) {
+		for (GLsizei i = 0; i < n; i++) { gm_nullGL(NULLGL_DELETE_BUFFER, buffers[i], 0); }
+		return;
+	}
+#endif
+	dglDeleteBuffers(n, buffers);
+}
+
+void sglEnable(GLenum cap) {
+	GLuint* pSlot = capSlot(gm_shadow, cap);
+	if ((pSlot == NULL) || shadowSet(*pSlot, 1)) {
+		SHADOW_FORWARD(NULLGL_ENABLE, cap, 0, dglEnable(cap));
+	}
+}
+
+void sglDisable(GLenum cap) {
+	GLuint* pSlot = capSlot(gm_shadow, cap);
+	if ((pSlot == NULL) || shadowSet(*pSlot, 0)) {
+		SHADOW_FORWARD(NULLGL_DISABLE, cap, 0, dglDisable(cap));
+	}
+}
+
+void sglBlendFunc(GLenum sfactor, GLenum dfactor) {
+	if ((gm_shadow.blendSrc == sfactor) && (gm_shadow.blendDst == dfactor)) {
+		gm_elided++;
+		return;
+	}
+	gm_shadow.blendSrc = sfactor;
+	gm_shadow.blendDst = dfactor;
+	gm_forwarded++;
+	SHADOW_FORWARD(NULLGL_BLEND_FUNC, sfactor, dfactor, dglBlendFunc(sfactor, dfactor));
+}
+
+void sglPixelStorei(GLenum pname, GLint param) {
+	GLuint* pSlot;
+	switch (pname) {
+	case GL_PACK_ALIGNMENT:		pSlot = &gm_shadow.packAlign;	break;
+	case GL_UNPACK_ALIGNMENT:	pSlot = &gm_shadow.unpackAlign;	break;
+	default:					pSlot = NULL;					break;
+	}
+	if ((pSlot == NULL) || shadowSet(*pSlot, (GLuint)param)) {
+		SHADOW_FORWARD(NULLGL_PIXEL_STORE, pname, (GLuint)param, dglPixelStorei(pname, param));
+	}
+}
+
+#ifndef OPENGL2
+
+void sglClientActiveTexture(GLenum texture) {
+	if (shadowSet(gm_shadow.clientUnit, texture - GL_TEXTURE0)) {
+		SHADOW_FORWARD(NULLGL_CLIENT_ACTIVE_TEXTURE, texture, 0, dglClientActiveTexture(texture));
+	}
+}
+
+static GLuint* clientSlot(SGLShadow& s, GLenum array) {
+	switch (array) {
+	case GL_VERTEX_ARRAY:			return &s.vertexArray;
+	case GL_COLOR_ARRAY:			return &s.colorArray;
+	case GL_NORMAL_ARRAY:			return &s.normalArray;
+	case GL_TEXTURE_COORD_ARRAY:	// Per client texture unit.
+		return (s.clientUnit < SHADOW_TEX_UNITS) ? &s.texCoordArray[s.clientUnit] : NULL;
+	default:						return NULL;
+	}
+}
+
+void sglEnableClientState(GLenum array) {
+	GLuint* pSlot = clientSlot(gm_shadow, array);
+	if ((pSlot == NULL) || shadowSet(*pSlot, 1)) {
+		SHADOW_FORWARD(NULLGL_ENABLE_CLIENT_STATE, array, 0, dglEnableClientState(array));
+	}
+}
+
+void sglDisableClientState(GLenum array) {
+	GLuint* pSlot = clientSlot(gm_shadow, array);
+	if ((pSlot == NULL) || shadowSet(*pSlot, 0)) {
+		SHADOW_FORWARD(NULLGL_DISABLE_CLIENT_STATE, array, 0, dglDisableClientState(array));
+	}
+}
+
+#else
+
+void sglUseProgram(GLuint program) {
+	if (shadowSet(gm_shadow.program, program)) {
+		SHADOW_FORWARD(NULLGL_USE_PROGRAM, program, 0, dglUseProgram(program));
+	}
+}
+
+void sglEnableVertexAttribArray(GLuint index) {
+	if ((index >= SHADOW_ATTRIBS) || shadowSet(gm_shadow.attribArray[index], 1)) {
+		SHADOW_FORWARD(NULLGL_ENABLE_ATTRIB, index, 0, dglEnableVertexAttribArray(index));
+	}
+}
+
+void sglDisableVertexAttribArray(GLuint index) {
+	if ((index >= SHADOW_ATTRIBS) || shadowSet(gm_shadow.attribArray[index], 0)) {
+		SHADOW_FORWARD(NULLGL_DISABLE_ATTRIB, index, 0, dglDisableVertexAttribArray(index));
+	}
+}
+
+#endif
+
+#ifdef INTERNAL_BENCH
+#include "CPFInterface.h"
+
+// Expected driver state, written from the GL rules without the shadow's types or slot helpers.
+// Enable flags are kept per capability enum ; GL_TEXTURE_2D and client arrays per unit.
+#define NULLGL_UNITS	8
+#define NULLGL_ATTRIBS	16
+
+static const GLenum gm_nullCaps[] = {
+	GL_BLEND, GL_SCISSOR_TEST, GL_DEPTH_TEST, GL_STENCIL_TEST, GL_CULL_FACE,
+#ifndef OPENGL2
+	GL_ALPHA_TEST,
+#endif
+};
+#define NULLGL_CAPS	(sizeof(gm_nullCaps) / sizeof(GLenum))
+
+struct SNullGLState {
+	GLuint	activeUnit;
+	GLuint	texture		[NULLGL_UNITS];
+	GLuint	buffer		[2];			// array, element
+	GLuint	cap			[NULLGL_CAPS];
+	GLuint	blendSrc;
+	GLuint	blendDst;
+	GLuint	packAlign;
+	GLuint	unpackAlign;
+#ifndef OPENGL2
+	GLuint	texEnable	[NULLGL_UNITS];
+	GLuint	clientUnit;
+	GLuint	texCoord	[NULLGL_UNITS];
+	GLuint	vertex;
+	GLuint	color;
+	GLuint	normal;
+#else
+	GLuint	program;
+	GLuint	attrib		[NULLGL_ATTRIBS];
+#endif
+
+	// GL initial state.
+	void init() {
+		memset(this, 0, sizeof(SNullGLState));
+		blendSrc	= GL_ONE;
+		blendDst	= GL_ZERO;
+		packAlign	= 4;
+		unpackAlign	= 4;
+	}
+
+	void apply(NULLGL_CALL call, GLuint a, GLuint b) {
+		GLuint on = 0;
+		switch (call) {
+		case NULLGL_ACTIVE_TEXTURE:
+			activeUnit = a - GL_TEXTURE0;
+			break;
+		case NULLGL_BIND_TEXTURE:
+			if (a == GL_TEXTURE_2D) { texture[activeUnit] = b; }
+			break;
+		case NULLGL_DELETE_TEXTURE:
+			// A deleted texture is unbound from every unit it was bound to.
+			for (int u = 0; u < NULLGL_UNITS; u++) {
+				if (texture[u] == a) { texture[u] = 0; }
+			}
+			break;
+		case NULLGL_BIND_BUFFER:
+			if (a == GL_ARRAY_BUFFER)			{ buffer[0] = b; }
+			if (a == GL_ELEMENT_ARRAY_BUFFER)	{ buffer[1] = b; }
+			break;
+		case NULLGL_DELETE_BUFFER:
+			if (buffer[0] == a) { buffer[0] = 0; }
+			if (buffer[1] == a) { buffer[1] = 0; }
+			break;
+		case NULLGL_ENABLE:
+			on = 1;
+			// fall through
+		case NULLGL_DISABLE:
+#ifndef OPENGL2
+			if (a == GL_TEXTURE_2D) { texEnable[activeUnit] = on; break; }
+#endif
+			for (u32 n = 0; n < NULLGL_CAPS; n++) {
+				if (gm_nullCaps[n] == a) { cap[n] = on; }
+			}
+			break;
+		case NULLGL_BLEND_FUNC:
+			blendSrc = a;
+			blendDst = b;
+			break;
+		case NULLGL_PIXEL_STORE:
+			if (a == GL_PACK_ALIGNMENT)		{ packAlign   = b; }
+			if (a == GL_UNPACK_ALIGNMENT)	{ unpackAlign = b; }
+			break;
+#ifndef OPENGL2
+		case NULLGL_CLIENT_ACTIVE_TEXTURE:
+			clientUnit = a - GL_TEXTURE0;
+			break;
+		case NULLGL_ENABLE_CLIENT_STATE:
+			on = 1;
+			// fall through
+		case NULLGL_DISABLE_CLIENT_STATE:
+			if (a == GL_TEXTURE_COORD_ARRAY)	{ texCoord[clientUnit] = on; }
+			if (a == GL_VERTEX_ARRAY)			{ vertex = on; }
+			if (a == GL_COLOR_ARRAY)			{ color  = on; }
+			if (a == GL_NORMAL_ARRAY)			{ normal = on; }
+			break;
+#else
+		case NULLGL_USE_PROGRAM:
+			program = a;
+			break;
+		case NULLGL_ENABLE_ATTRIB:
+			on = 1;
+			// fall through
+		case NULLGL_DISABLE_ATTRIB:
+			attrib[a] = on;
+			break;
+#endif
+		default:
+			break;
+		}
+	}
+};
+
+// Driver side of the null backend : the calls that went through the shadow, applied to the same model.
+static SNullGLState	gm_nullDriver;
+static u32			gm_nullCalls;
+
+static void nullGLRecord(NULLGL_CALL call, GLuint a, GLuint b) {
+	gm_nullDriver.apply(call, a, b);
+	gm_nullCalls++;
+}
+
+// Same call through the shadow.
+static void nullGLShadowCall(NULLGL_CALL call, GLuint a, GLuint b) {
+	switch (call) {
+	case NULLGL_ACTIVE_TEXTURE:			sglActiveTexture(a);						break;
+	case NULLGL_BIND_TEXTURE:			sglBindTexture(a, b);						break;
+	case NULLGL_DELETE_TEXTURE:			sglDeleteTextures(1, &a);					break;
+	case NULLGL_BIND_BUFFER:			sglBindBuffer(a, b);						break;
+	case NULLGL_DELETE_BUFFER:			sglDeleteBuffers(1, &a);					break;
+	case NULLGL_ENABLE:					sglEnable(a);								break;
+	case NULLGL_DISABLE:				sglDisable(a);								break;
+	case NULLGL_BLEND_FUNC:				sglBlendFunc(a, b);							break;
+	case NULLGL_PIXEL_STORE:			sglPixelStorei(a, (GLint)b);				break;
+#ifndef OPENGL2
+	case NULLGL_CLIENT_ACTIVE_TEXTURE:	sglClientActiveTexture(a);					break;
+	case NULLGL_ENABLE_CLIENT_STATE:	sglEnableClientState(a);					break;
+	case NULLGL_DISABLE_CLIENT_STATE:	sglDisableClientState(a);					break;
+#else
+	case NULLGL_USE_PROGRAM:			sglUseProgram(a);							break;
+	case NULLGL_ENABLE_ATTRIB:			sglEnableVertexAttribArray(a);				break;
+	case NULLGL_DISABLE_ATTRIB:			sglDisableVertexAttribArray(a);				break;
+#endif
+	default:																		break;
+	}
+}
+
+// Pseudo random state call over a few values so that most of the stream is redundant, as in a frame.
+static NULLGL_CALL nullGLRandom(u32& seed, GLuint& a, GLuint& b) {
+	static const GLenum caps[] = {
+		GL_BLEND, GL_SCISSOR_TEST, GL_DEPTH_TEST, GL_STENCIL_TEST, GL_CULL_FACE,
+#ifndef OPENGL2
+		GL_ALPHA_TEST, GL_TEXTURE_2D,
+#endif
+	};
+	seed = (seed * 1103515245) + 12345;
+	u32 r = seed >> 8;
+	u32 v = r >> 4;
+	b = 0;
+	switch (r & 15) {
+	case 0:				a = GL_TEXTURE0 + (v % 3);													return NULLGL_ACTIVE_TEXTURE;
+	case 1: case 2:
+	case 3:				a = GL_TEXTURE_2D; b = 1 + (v % 4);											return NULLGL_BIND_TEXTURE;
+	case 4:				a = 1 + (v % 4);															return NULLGL_DELETE_TEXTURE;
+	case 5: case 6:		a = (v & 1) ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER; b = (v >> 1) % 3;	return NULLGL_BIND_BUFFER;
+	case 7:				a = 1 + (v % 2);															return NULLGL_DELETE_BUFFER;
+	case 8: case 9:		a = caps[v % (sizeof(caps) / sizeof(GLenum))];								return NULLGL_ENABLE;
+	case 10: case 11:	a = caps[v % (sizeof(caps) / sizeof(GLenum))];								return NULLGL_DISABLE;
+	case 12:
+		a = (v & 1) ? GL_SRC_ALPHA : GL_ONE;
+		b = GL_ONE_MINUS_SRC_ALPHA;
+		return NULLGL_BLEND_FUNC;
+	case 13:
+		a = (v & 1) ? GL_PACK_ALIGNMENT : GL_UNPACK_ALIGNMENT;
+		b = (v & 2) ? 4 : 1;
+		return NULLGL_PIXEL_STORE;
+#ifndef OPENGL2
+	case 14:			a = GL_TEXTURE0 + (v % 2);													return NULLGL_CLIENT_ACTIVE_TEXTURE;
+	default:
+		a = (v & 2) ? GL_TEXTURE_COORD_ARRAY : ((v & 4) ? GL_COLOR_ARRAY : GL_VERTEX_ARRAY);
+		return (v & 1) ? NULLGL_ENABLE_CLIENT_STATE : NULLGL_DISABLE_CLIENT_STATE;
+#else
+	case 14:			a = v % 3;																	return NULLGL_USE_PROGRAM;
+	default:
+		a = (v >> 1) % 4;
+		return (v & 1) ? NULLGL_ENABLE_ATTRIB : NULLGL_DISABLE_ATTRIB;
+#endif
+	}
+}
+
+// Null GL equivalence check : a pseudo random call stream goes through the shadow with the recorder
+// as driver, and straight into an expected model that shares no code with the shadow. Both driver states must match after every call.
+// Then times the shadowed stream alone. The real driver is never called, the shadow is restored.
+static bool benchGLShadow(u32 loops) {
+	bool ok = true;
+	u32 count = loops * 64;
+
+	SGLShadow		saved		= gm_shadow;
+	unsigned int	elided		= gm_elided;
+	unsigned int	forwarded	= gm_forwarded;
+
+	// Both driver models start from the GL initial state, the shadow from unknown.
+	SNullGLState reference;
+	reference.init();
+	gm_nullDriver.init();
+	gm_shadow.reset();
+	gm_nullCalls	= 0;
+	gm_nullGL		= nullGLRecord;
+
+	u32 seed	= 1;
+	u32 checked	= 0;
+	while (checked < count) {
+		GLuint a, b;
+		NULLGL_CALL call = nullGLRandom(seed, a, b);
+		reference.apply(call, a, b);
+		nullGLShadowCall(call, a, b);
+		checked++;
+		if (memcmp(&reference, &gm_nullDriver, sizeof(SNullGLState)) != 0) {
+			CPFInterface::getInstance().platform().logging("[BENCH] GLSHADOW driver state differs after call %i (type %i)\n", checked, call);
+			ok = false;
+			break;
+		}
+	}
+	u32 reached = gm_nullCalls;
+
+	gm_shadow.reset();
+	seed = 1;
+	s64 t0 = CKLBBenchmark::now();
+	for (u32 n = 0; n < count; n++) {
+		GLuint a, b;
+		NULLGL_CALL call = nullGLRandom(seed, a, b);
+		nullGLShadowCall(call, a, b);
+	}
+	s64 time = CKLBBenchmark::now() - t0;
+
+	CKLBBenchmark::report("shadowed call (incl. stream)", count, time);
+	CPFInterface::getInstance().platform().logging("[BENCH] %i calls, %i reached the null driver (%i%% elided)\n",
+		checked, reached, (checked - reached) * 100 / checked);
+
+	gm_nullGL		= NULL;
+	gm_shadow		= saved;
+	gm_elided		= elided;
+	gm_forwarded	= forwarded;
+	return ok;
+}
+
+static CKLBBenchmark gBenchGLShadow("GLSHADOW", benchGLShadow);
+#endif
+
+#endif
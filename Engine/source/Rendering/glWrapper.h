@@ -663,4 +663,87 @@
 #endif
 
 
+// ---------------------------------------------------------------------------------------
+//
+//  State shadowing (1.x & 2.0)
+//
+//  Binds, enables, blend function, pixel store and program changes are compared with a
+//  shadow copy of the GL state : a call that would not change anything is dropped before
+//  reaching the driver. Code calling the raw gl* API for those states must call
+//  dglStateReset() afterward (context creation does it).
+//
+//  glGetError() is a synchronization point on most drivers. Without the debug wrapper
+//  errors are only polled once per frame by dglFrameEnd() ; with the debug wrapper each
+//  call is checked (GL_CHECK_EACH_CALL).
+//
+// ---------------------------------------------------------------------------------------
+#define USE_STATE_SHADOW
+
+#ifdef USE_DEBUG_WRAPPER
+	#define GL_CHECK_EACH_CALL
+#endif
+
+void			dglStateReset			();
+void			dglFrameEnd				();
+unsigned int	dglGetElidedCalls		();		// Dropped during the last frame.
+unsigned int	dglGetForwardedCalls	();		// Shadowed calls sent during the last frame.
+
+#ifdef USE_STATE_SHADOW
+	void sglActiveTexture (GLenum texture);
+	void sglBindTexture (GLenum target, GLuint texture);
+	void sglDeleteTextures (GLsizei n, const GLuint* textures);
+	void sglBindBuffer (GLenum target, GLuint buffer);
+	void sglDeleteBuffers (GLsizei n, const GLuint* buffers);
+	void sglEnable (GLenum cap);
+	void sglDisable (GLenum cap);
+	void sglBlendFunc (GLenum sfactor, GLenum dfactor);
+	void sglPixelStorei (GLenum pname, GLint param);
+	#ifndef OPENGL2
+	void sglClientActiveTexture (GLenum texture);
+	void sglEnableClientState (GLenum array);
+	void sglDisableClientState (GLenum array);
+	#else
+	void sglUseProgram (GLuint program);
+	void sglEnableVertexAttribArray (GLuint index);
+	void sglDisableVertexAttribArray (GLuint index);
+	#endif
+
+	// glWrapper.cpp implements the shadow on top of the dgl* entry points.
+	#ifndef GL_STATE_SHADOW_IMPL
+		#undef dglActiveTexture
+		#undef dglBindTexture
+		#undef dglDeleteTextures
+		#undef dglBindBuffer
+		#undef dglDeleteBuffers
+		#undef dglEnable
+		#undef dglDisable
+		#undef dglBlendFunc
+		#undef dglPixelStorei
+		#define dglActiveTexture			sglActiveTexture
+		#define dglBindTexture				sglBindTexture
+		#define dglDeleteTextures			sglDeleteTextures
+		#define dglBindBuffer				sglBindBuffer
+		#define dglDeleteBuffers			sglDeleteBuffers
+		#define dglEnable					sglEnable
+		#define dglDisable					sglDisable
+		#define dglBlendFunc				sglBlendFunc
+		#define dglPixelStorei				sglPixelStorei
+		#ifndef OPENGL2
+		#undef dglClientActiveTexture
+		#undef dglEnableClientState
+		#undef dglDisableClientState
+		#define dglClientActiveTexture		sglClientActiveTexture
+		#define dglEnableClientState		sglEnableClientState
+		#define dglDisableClientState		sglDisableClientState
+		#else
+		#undef dglUseProgram
+		#undef dglEnableVertexAttribArray
+		#undef dglDisableVertexAttribArray
+		#define dglUseProgram				sglUseProgram
+		#define dglEnableVertexAttribArray	sglEnableVertexAttribArray
+		#define dglDisableVertexAttribArray	sglDisableVertexAttribArray
+		#endif
+	#endif
+#endif
+
 #endif
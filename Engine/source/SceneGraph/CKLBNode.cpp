@@ -59,6 +59,8 @@ CKLBNode::CKLBNode():
 	m_pColorMatrix		(NULL),
 	m_pAnimationNext	(NULL),
 	m_pAnimationPrev	(NULL),
+	m_pDeferNext		(NULL),
+	m_dirtyIndex		(0),
 	m_pRender			(NULL),
 	m_renderSlot		(NULL),
 	m_layer				(0),
@@ -77,6 +79,7 @@ CKLBNode::CKLBNode():
 {
 	m_pColorMatrix	= &m_colorMatrix;
 	m_pRender		= &m_renderSlot;
+	m_deferStatus	= 0;
 }
 
 /*virtual*/
@@ -140,7 +143,7 @@ CKLBNode* CKLBNode::clone(CKLBNode* newItem, CKLBNode* parent, CKLBNode* brother
 		newItem->m_renderCount		= m_renderCount;
 
 		newItem->m_groupID			= m_groupID;
-		newItem->m_status			= m_status | INVISIBLE_UPPER;
+		newItem->m_status			= (m_status & ~(DIRTY_LISTED | DIRTY_ROOT)) | INVISIBLE_UPPER;	// Dirty list entry is not cloned.
 
 		if (parent == NULL) {
 			newItem->m_status |= ANY_CHANGE | MARKED;
@@ -181,6 +184,10 @@ CKLBNode::~CKLBNode() {
 		m_status &= ~ANIMATED;
 	}
 
+	if (m_status & DIRTY_LISTED) {
+		CKLBSystem::removeFromDirty(this);
+	}
+
 	// Clean list BEFORE, avoid recursion.
 	m_pChild = NULL; setVisible(false);
 
@@ -753,6 +760,10 @@ void CKLBNode::rejectSub() {
 }*/
 
 void CKLBNode::recompute() {
+	recomputeNode(NULL);
+}
+
+void CKLBNode::recomputeNode(SRecomputeJob* pJob) {
 	if (isVisible()) {
 		if (m_parent) {
 			m_status |= m_parent->m_status & ANY_CHANGE; // If parent changed -> force myself to change.
@@ -799,7 +810,12 @@ void CKLBNode::recompute() {
 		}
 
 		if (m_status & ANY_CHANGE) {
-			recomputeCustom();
+			if (pJob) {
+				// Worker thread : custom code runs later on the main thread.
+				CKLBSystem::deferCustom(pJob, this);
+			} else {
+				recomputeCustom();
+			}
 		}
 
 		//
@@ -809,7 +825,7 @@ void CKLBNode::recompute() {
 			CKLBNode* pChild = m_pChild;
 
 			while (pChild) {
-				pChild->recompute();
+				pChild->recomputeNode(pJob);
 				pChild = pChild->m_pBrother;
 			}
 		}
@@ -839,7 +855,7 @@ void CKLBNode::updateMatrices() {
 				// Load Matrix from local matrix.
 				//
 #ifdef DEBUG_PERFORMANCE
-				s_matrixRecomputeCount++;
+				NODE_PERF_COUNT(s_matrixRecomputeCount, 1);
 #endif
 
 				#define M2(a)		(pCurMat->m_matrix[a])
@@ -949,6 +965,10 @@ void CKLBNode::updateMatrices() {
 }
 
 void CKLBNode::markUpTree() {
+	if ((m_status & DIRTY_LISTED) == 0) {
+		CKLBSystem::addToDirty(this);
+	}
+
 	CKLBNode* pParent = this->m_parent;
 	while (pParent) {
 		if (pParent->m_status & MARKED) {
@@ -91,13 +91,38 @@
 
 class CKLBNode;
 class CKLBUITask;
+struct SRecomputeJob;
+
+// Worker threads used to recompute independent dirty sub trees (0 : main thread only).
+#define NODE_RECOMPUTE_WORKERS		(3)
+// Minimum number of independent dirty sub trees before the workers are used.
+#define NODE_RECOMPUTE_PARALLEL_MIN	(4)
+
+#ifdef DEBUG_PERFORMANCE
+// Statistic counters are incremented from the recompute workers too.
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NODE_PERF_COUNT(counter, value)	_InterlockedExchangeAdd((volatile long*)&(counter), (long)(value))
+#else
+#define NODE_PERF_COUNT(counter, value)	__sync_fetch_and_add(&(counter), (u32)(value))
+#endif
+#endif
 
 /*!
 * \class CKLBSystem
 * \brief Node System Class
 * 
-* CKLBSystem provides static methods to manage the Animation Node List.
+* CKLBSystem provides static methods to manage the Animation Node List
+* and the Dirty Node List.
 * It allows to separate the Node System from the rest of the Game Engine.
+*
+* Every node calling markUpTree() is registered in the Dirty Node List.
+* performRecompute() extracts the top most dirty nodes of the list and only
+* recomputes their sub trees, so the cost per frame depends on the number of
+* modified nodes and not on the size of the tree.
+* When there are enough independent sub trees, they are recomputed by a small
+* worker pool. recomputeCustom() calls are deferred and performed afterward
+* on the main thread, in the order the sub trees were registered.
 */
 class CKLBSystem {
 public:
@@ -105,6 +130,17 @@ public:
 	static void			addToAnimation			(CKLBNode* pNode);
 	static CKLBNode*	getAnimationNodeList	();
 	static void			performAnimationUpdate	(u32 milliSecDelta);
+
+	static void			addToDirty				(CKLBNode* pNode);
+	static void			removeFromDirty			(CKLBNode* pNode);
+	static void			performRecompute		();
+	static void			releaseRecompute		();
+
+	static void			deferCustom				(SRecomputeJob* pJob, CKLBNode* pNode);
+private:
+	static u32			collectDirtyRoots		(u32 count);
+	static void			processDirtyRoots		(u32 rootCount);
+	static void			recomputeJob			(void* pCtx, u32 index);
 };
 
 //
@@ -226,6 +262,11 @@ public:
 
 	void		recompute			();
 
+	void		recomputeNode		(SRecomputeJob* pJob);
+
+	// Called once the node matrices and render commands are up to date.
+	// When the sub tree is recomputed by a worker, the call is deferred until
+	// the whole sub tree is done : implementations must only use the node own state.
 	virtual		
 	void		recomputeCustom		()	{ /* Do nothing default*/ }
 
@@ -398,6 +439,7 @@ public:
 	bool	setRenderSlotCount	(u32 slot);
 
 #ifdef DEBUG_PERFORMANCE
+	// Also updated by the recompute workers : use NODE_PERF_COUNT().
 	static u32	s_vertexRecomputeCount;
 	static u32	s_matrixRecomputeCount;
 	static u32  s_colorRecomputeCount;
@@ -415,8 +457,8 @@ protected:
 		RENDER_CHANGE	= 0x0008,
 		ANY_CHANGE		= MATRIX_CHANGE | CMATRIX_CHANGE | CUSTOM_CHANGE | RENDER_CHANGE,	// Force all recomputation
 		MARKED			= 0x0010,
-		// 0x0020		: Free
-		// 0x0040		: Free
+		DIRTY_LISTED	= 0x0020,	// Registered in the dirty node list.
+		DIRTY_ROOT		= 0x0040,	// Temporary tag used while extracting dirty sub trees.
 
 		//
 		// State Flags
@@ -492,6 +534,9 @@ protected:	CKLBNode*			m_parent;
 protected:	CKLBNode*			m_pAnimationNext;
 protected:	CKLBNode*			m_pAnimationPrev;
 
+protected:	CKLBNode*			m_pDeferNext;	// Deferred recomputeCustom() list when recomputed by a worker.
+protected:	u32					m_dirtyIndex;	// Index inside the dirty node list when DIRTY_LISTED.
+
 public:		SColorVector*		m_pColorMatrix;
 protected:	CKLBRenderCommand**	m_pRender;
 protected:	CKLBRenderCommand*	m_renderSlot;
@@ -510,6 +555,7 @@ public:		u16					m_movieID;
 public:		u16					m_updateFrame;
 private:	u16					m_nameLength;
 
+protected:	u16					m_deferStatus;
 protected:	bool				m_isAnimated;
 protected:	bool				m_deleteRender;
 protected:	bool				m_bInternalNode;
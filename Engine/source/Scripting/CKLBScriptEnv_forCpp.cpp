@@ -725,6 +725,16 @@ bool CKLBScriptEnv::call_netAPI_callback(const char* funcName, CKLBObjectScripta
 	return callbackIIIP_retB(objectHandle,uniq,msg,status,pRoot);
 }
 
+bool CKLBScriptEnv::call_netAPI_callback(const char* funcName, CKLBObjectScriptable* obj, s32 uniq, s32 msg, s32 status, const char* json, u32 jsonLen, bool& validJson) {
+	// Native side works on the tree.
+	CKLBJsonItem * pRoot = CKLBJsonItem::ReadJsonData(json, jsonLen);
+	validJson = (pRoot != NULL);
+	if (!pRoot) { return false; }
+	bool res = call_netAPI_callback(funcName, obj, uniq, msg, status, pRoot);
+	KLBDELETE(pRoot);
+	return res;
+}
+
 void CKLBScriptEnv::call_netAPI_versionUp		(const char* funcName, CKLBObjectScriptable* obj, const char* clientVer, const char* serverVer) {
 	m_call++;
 	u32 objectHandle = obj->getScriptHandle();
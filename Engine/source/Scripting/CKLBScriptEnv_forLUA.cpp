@@ -412,6 +412,26 @@ bool CKLBScriptEnv::call_netAPI_callback(const char* funcName, CKLBObjectScripta
 	return lua.call(4, funcName);
 }
 
+bool CKLBScriptEnv::call_netAPI_callback(const char* funcName, CKLBObjectScriptable* /*obj*/, int uniq, int msg, int status, const char* json, u32 jsonLen, bool& validJson) {
+	validJson = true;
+	if(!funcName) return false;
+
+	CLuaState& lua = CKLBLuaEnv::getInstance().getState();
+	int top = lua.numArgs();
+	lua.getGlobal(funcName);
+	lua.retInt(uniq);
+	lua.retInt(msg);
+	lua.retInt(status);
+
+	// Tables are built directly on the stack, no CKLBJsonItem tree.
+	if(!CKLBUtility::json2lua(lua, json, jsonLen)) {
+		lua.setTop(top);
+		validJson = false;
+		return false;
+	}
+	return lua.call(4, funcName);
+}
+
 void CKLBScriptEnv::call_netAPI_versionUp		(const char* funcName, CKLBObjectScriptable* obj, const char* clientVer, const char* serverVer) {
 	if (!funcName) { return; }
 	CLuaState& lua = CKLBLuaEnv::getInstance().getState();
@@ -150,6 +150,7 @@ CKLBDrawResource::freeResource()
 	if (m_gpRootNode) {
 		KLBDELETE(m_gpRootNode); m_gpRootNode = NULL;
 	}
+	CKLBSystem::releaseRecompute();
 }
 
 void
@@ -79,7 +79,7 @@ public:
 	}
 
 	inline void recompute() {
-		m_gpRootNode->recompute();
+		CKLBSystem::performRecompute();
 	}
 
 	inline void draw() {
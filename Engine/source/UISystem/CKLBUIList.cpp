@@ -25,8 +25,12 @@
 
 #include "CKLBUIScrollBar.h"
 #include "IMgrEntry.h"
+#include "CKLBBenchmark.h"
 ;
 
+// dynamic モードの先読みマージン (クリップサイズに対する割合 : 1/N)
+#define LIST_DYNAMIC_MARGIN_RATE	(2)
+
 // Command Values
 enum {
 	UI_LIST_ITEM_ADD,		// アイテムを下端に追加
@@ -253,6 +257,11 @@ CKLBUIList::CKLBUIList()
 , m_layoutTableLayout   (NULL)
 , m_curveLength         (0)
 , m_layoutInterlaceSize (0)
+, m_tplBegin            (NULL)
+, m_itemTable           (NULL)
+, m_itemTableMax        (0)
+, m_dynBegin            (0)
+, m_dynEnd              (0)
 , m_dragCallback        (NULL)
 , m_limitCallback       (NULL)
 , m_dynamicCallback     (NULL)
@@ -1650,6 +1659,13 @@ CKLBUIList::dieUI()
 		delete_item(pItem, false);
 		pItem = next;
 	}
+	m_lstBegin = m_lstEnd = NULL;
+
+	// テンプレートはアイテム破棄時に解放済み
+	klb_assert(!m_tplBegin, "List templates still referenced");
+	KLBDELETEA(m_itemTable);
+	m_itemTable    = NULL;
+	m_itemTableMax = 0;
 
 	// スクロールコントロールノードの破棄
 	KLBDELETE(m_pCtrlNode);
@@ -1670,7 +1686,8 @@ bool
 CKLBUIList::load_itemform(CKLBUIList::LISTITEM * pItem, const char * json, u32 jsonLength, CKLBCompositeAsset * pOrgAsset, IDataSource * pSource)
 {
 	// 既に form がロードされている場合は何もしない
-	if(pItem->form && pItem->handle) return true;
+	// (テンプレート共有時は handle を持たないため form のみで判定する)
+	if(pItem->form) return true;
 
 	u32 handle = 0;
 
@@ -1735,6 +1752,7 @@ CKLBUIList::load_itemform(CKLBUIList::LISTITEM * pItem, const char * json, u32 j
 	// その node と handle を抱えたLISTITEMを作る
 	pItem->form   = pNode;
 	pItem->handle = handle;
+	if(pItem->tpl) { pItem->tpl->loadCount++; }
 
 	CKLBTouchEventUIMgr::getInstance().registForm(&pItem->ctrl);
 
@@ -1785,9 +1803,112 @@ CKLBUIList::unload_itemform(CKLBUIList::LISTITEM * pItem, bool kill_child)
 	pItem->form   = NULL;
 	pItem->handle = 0;
 
+	// 共有されていないテンプレートは、ツリーが無くなったら解析結果も手放す。
+	TEMPLATE * pTpl = pItem->tpl;
+	if(pTpl) {
+		pTpl->loadCount--;
+		if(!pTpl->loadCount && pTpl->refCount <= 1 && pTpl->pAsset) {
+			CKLBDataHandler::releaseHandle(pTpl->handle);
+			pTpl->pAsset = NULL;
+			pTpl->handle = 0;
+		}
+	}
+
 	return true;
 }
 
+bool
+CKLBUIList::load_dynamic(CKLBUIList::LISTITEM * pItem)
+{
+	if(pItem->form) return true;
+
+	TEMPLATE * pTpl = pItem->tpl;
+	if(!pTpl) {
+		return load_itemform(pItem, pItem->jsonp, pItem->jsonlen);
+	}
+
+	// 汎用プロパティは最初のツリー生成で消費されるため、そのようなフォームは共有せずアイテムごとに解析する。
+	if(!pTpl->bShared) {
+		return load_itemform(pItem, pTpl->json, pTpl->jsonlen);
+	}
+
+	// フォームの解析はテンプレートごとに一度だけ行い、以降は解析済みアセットからツリーを生成する。
+	if(!pTpl->pAsset) {
+		u32 handle = 0;
+		CKLBAssetManager& pAssetManager = CKLBAssetManager::getInstance();
+		CKLBCompositeAsset * pAsset = (CKLBCompositeAsset *)CKLBUtility::readAsset((u8 *)pTpl->json, pTpl->jsonlen, &handle, pAssetManager.getPlugin('P'));
+		if(!pAsset) {
+			return false;
+		}
+		if(pAsset->hasPropertyBag()) {
+			// この解析結果はこのアイテム専用とし、handle もアイテムが持つ。
+			pTpl->bShared = false;
+			bool bResult = load_itemform(pItem, NULL, 0, pAsset);
+			if(bResult && pItem->form) {
+				pItem->handle = handle;
+			} else {
+				CKLBDataHandler::releaseHandle(handle);
+			}
+			return bResult;
+		}
+		pTpl->pAsset = pAsset;
+		pTpl->handle = handle;
+	}
+	return load_itemform(pItem, NULL, 0, pTpl->pAsset);
+}
+
+CKLBUIList::TEMPLATE *
+CKLBUIList::acquire_template(const char * json, u32 jsonLen)
+{
+	// FNV-1a
+	u32 hash = 2166136261u;
+	for(u32 i = 0; i < jsonLen; i++) {
+		hash = (hash ^ (u8)json[i]) * 16777619u;
+	}
+
+	TEMPLATE * pTpl;
+	for(pTpl = m_tplBegin; pTpl; pTpl = pTpl->next) {
+		if(pTpl->hash == hash && pTpl->jsonlen == jsonLen && !memcmp(pTpl->json, json, jsonLen)) {
+			pTpl->refCount++;
+			return pTpl;
+		}
+	}
+
+	pTpl = KLBNEW(TEMPLATE);
+	if(!pTpl) { return NULL; }
+	pTpl->json = CKLBUtility::copyMem(json, jsonLen);
+	if(!pTpl->json) {
+		KLBDELETE(pTpl);
+		return NULL;
+	}
+	pTpl->jsonlen   = jsonLen;
+	pTpl->hash      = hash;
+	pTpl->refCount  = 1;
+	pTpl->loadCount = 0;
+	pTpl->handle    = 0;
+	pTpl->pAsset    = NULL;
+	pTpl->bShared   = true;
+	pTpl->next      = m_tplBegin;
+	m_tplBegin      = pTpl;
+	return pTpl;
+}
+
+void
+CKLBUIList::release_template(TEMPLATE * pTpl)
+{
+	if(--pTpl->refCount) return;
+
+	TEMPLATE ** ppLink = &m_tplBegin;
+	while(*ppLink != pTpl) { ppLink = &(*ppLink)->next; }
+	*ppLink = pTpl->next;
+
+	if(pTpl->pAsset) {
+		CKLBDataHandler::releaseHandle(pTpl->handle);
+	}
+	KLBDELETEA(pTpl->json);
+	KLBDELETE(pTpl);
+}
+
 CKLBUIList::LISTITEM *
 CKLBUIList::create_item(const char * json, u32 size, int id, CKLBCompositeAsset * pOrgAsset, IDataSource * pSource)
 {
@@ -1814,7 +1935,9 @@ CKLBUIList::create_item(const char * json, u32 size, int id, CKLBCompositeAsset
 		break;
 	case LIST_ITEM_DYNAMIC:
 		{
-			pItem->jsonp    = CKLBUtility::copyMem(json, size);
+			// 同一フォームのアイテムはJSONと解析結果を共有する
+			pItem->tpl      = (json) ? acquire_template(json, size) : NULL;
+			pItem->jsonp    = (pItem->tpl) ? pItem->tpl->json : CKLBUtility::copyMem(json, size);
 			pItem->jsonlen  = size;
 			pItem->handle   = 0;
 			pItem->form     = NULL;
@@ -1835,7 +1958,11 @@ CKLBUIList::delete_item(LISTITEM * pItem, bool kill_child)
 	unload_itemform(pItem, kill_child);
 
 	// JSONがあれば破棄する
-	KLBDELETEA(pItem->jsonp);
+	if(pItem->tpl) {
+		release_template(pItem->tpl);
+	} else {
+		KLBDELETEA(pItem->jsonp);
+	}
 
 	KLBDELETE(pItem);	// インスタンス本体を破棄
 }
@@ -1865,6 +1992,11 @@ CKLBUIList::getItemByID(int id)
 CKLBUIList::LISTITEM *
 CKLBUIList::getItemByIndex(int index)
 {
+	// 配置確定済みであれば index 表を引く
+	if(!m_itemUpdate && m_itemTable) {
+		return (index >= 0 && index < m_itemCnt) ? m_itemTable[index] : NULL;
+	}
+
 	LISTITEM * pItem;
 	int idx = 0;
 	for(pItem = m_lstBegin; pItem; pItem = pItem->next) {
@@ -2142,6 +2274,8 @@ CKLBUIList::itemRealloc()
 		}
 
 		m_listLength = pos + ((m_bLoop) ? 0 : m_marginBottom);	// 終端値
+
+		updateIndex();
 	}
 
 	// ループ可能な最小クリップサイズの計算。
@@ -2241,7 +2375,7 @@ CKLBUIList::itemRealloc()
 		if(m_layoutTable) {
 			setSplinePosition();
 		} else {
-			setStraightPosition();
+			setStraightPosition(itemUpdate);
 		}
 		// 設定されたリストの最大長を利用して、スクロールバーの最大値を設定する。
 		int maxPos = m_listLength - m_clipSize;
@@ -2261,8 +2395,50 @@ CKLBUIList::itemRealloc()
 	}
 }
 
+// index 表を作り直し、各アイテムの index を振りなおす
 void
-CKLBUIList::setStraightPosition()
+CKLBUIList::updateIndex()
+{
+	if(m_itemCnt > m_itemTableMax) {
+		int newMax = (m_itemTableMax) ? m_itemTableMax : 64;
+		while(newMax < m_itemCnt) { newMax *= 2; }
+		LISTITEM ** pNewTable = KLBNEWA(LISTITEM *, newMax);
+		KLBDELETEA(m_itemTable);
+		m_itemTable    = pNewTable;
+		m_itemTableMax = (pNewTable) ? newMax : 0;
+	}
+
+	int item_index = 0;
+	for(LISTITEM * pItem = m_lstBegin; pItem; pItem = pItem->next) {
+		pItem->index = item_index;
+		if(m_itemTable) { m_itemTable[item_index] = pItem; }
+		item_index++;
+	}
+
+	// 配置が変わったため、dynamic モードのツリー化範囲は次回全件判定する
+	m_dynBegin = m_dynEnd = 0;
+}
+
+int
+CKLBUIList::find_index_by_pos(int pos)
+{
+	// アイテムは pos 順に並んでいる (ループ時を除く)
+	int lo = 0;
+	int hi = m_itemCnt;
+	while(lo < hi) {
+		int mid = (lo + hi) >> 1;
+		LISTITEM * pItem = m_itemTable[mid];
+		if(pItem->pos + pItem->step > pos) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return lo;
+}
+
+void
+CKLBUIList::setStraightPosition(bool relayout)
 {
 	LISTITEM * pItem;
 
@@ -2288,26 +2464,58 @@ CKLBUIList::setStraightPosition()
 		break;
 	case LIST_ITEM_DYNAMIC:
 		{
-			int item_index = 0;
-			for(pItem = m_lstBegin; pItem; pItem = pItem->next) {
-				// index を再設定する
-				pItem->index = item_index;
-				item_index++;
+			// クリップ領域とその前後のマージン内にあるアイテムのみツリー化する
+			int margin = m_clipSize / LIST_DYNAMIC_MARGIN_RATE;
+			int top    = -m_scrollPos - margin;
+			int bottom = -m_scrollPos + m_clipSize + margin;
+
+			if(m_bLoop || !m_itemTable) {
+				// ループ時は pos が並ばないため、全アイテムを判定する
+				for(pItem = m_lstBegin; pItem; pItem = pItem->next) {
+					if((pItem->pos + pItem->step) > top && pItem->pos < bottom) {
+						// アイテムがクリップ領域内にある
+						if(load_dynamic(pItem)) {
+							x = (m_vertical)  ? 0 : pItem->pos;
+							y = (!m_vertical) ? 0 : pItem->pos;
+							pItem->form->setTranslate((float)x, (float)y);
+							pItem->form->setVisible(true);
+						}
+					} else if(pItem->form) {
+						// アイテムはクリップ領域外にある
+						unload_itemform(pItem);
+					}
+				}
+				m_dynBegin = m_dynEnd = 0;
+			} else {
+				int begin = find_index_by_pos(top);
+				int end   = begin;
+				while(end < m_itemCnt && m_itemTable[end]->pos < bottom) { end++; }
 
-				// このアイテムが画面内に入っていれば、アイテムツリーを生成
-				// 入っていなければアイテムツリーを破棄
-				int pos = pItem->pos + m_scrollPos;
-				if((pos + pItem->step) > 0 && pos < m_clipSize) {
-					// アイテムがクリップ領域内にある
-					load_itemform(pItem, pItem->jsonp, pItem->jsonlen);
-					x = (m_vertical)  ? 0 : pItem->pos;
-					y = (!m_vertical) ? 0 : pItem->pos;
-					pItem->form->setTranslate((float)x, (float)y);
-					pItem->form->setVisible(true);
+				if(relayout) {
+					// 配置が変わった: 範囲外のツリーをすべて破棄する
+					for(pItem = m_lstBegin; pItem; pItem = pItem->next) {
+						if(pItem->form && (pItem->index < begin || pItem->index >= end)) {
+							unload_itemform(pItem);
+						}
+					}
 				} else {
-					// アイテムはクリップ領域外にある
-					unload_itemform(pItem);
+					// スクロールのみ: 前回の範囲から外れたアイテムだけを破棄する
+					for(int i = m_dynBegin; i < m_dynEnd; i++) {
+						if(i < begin || i >= end) { unload_itemform(m_itemTable[i]); }
+					}
 				}
+
+				for(int i = begin; i < end; i++) {
+					pItem = m_itemTable[i];
+					if(load_dynamic(pItem)) {
+						x = (m_vertical)  ? 0 : pItem->pos;
+						y = (!m_vertical) ? 0 : pItem->pos;
+						pItem->form->setTranslate((float)x, (float)y);
+						pItem->form->setVisible(true);
+					}
+				}
+				m_dynBegin = begin;
+				m_dynEnd   = end;
 			}
 		}
 		break;
@@ -2368,7 +2576,7 @@ CKLBUIList::setSplinePosition()
 			CKLBNode* pNode = NULL;
 			// アイテムがクリップ領域内にある
 			if(isDynamic) {
-				if(load_itemform(pItem, pItem->jsonp, pItem->jsonlen)) {
+				if(load_dynamic(pItem)) {
 					pNode = pItem->form;
 				}
 			} else {
@@ -2641,3 +2849,101 @@ CKLBUIList::defaultScroll(void * pData, PAD_ITEM::TYPE type, int dragX, int drag
 		break;
 	}
 }
+
+#ifdef INTERNAL_BENCH
+// Removes every item through the script API, then lets the task release them.
+static void benchListClear(CKLBUIList* pList) {
+	while(pList->getItems()) {
+		pList->cmdItemRemove(0);
+	}
+	pList->execute(0);
+}
+
+// Two UI_List tasks created like the script does, 2048 items of mixed heights using 4 item forms.
+// Dynamic mode : add the items (forms are shared, nothing is built), first layout, then scroll to
+// pseudo random items (window moves, out of window items are released). Normal mode : the same
+// items, each form parsed and built when added. Every scroll must land on the item position.
+static bool benchListWindow(u32 loops) {
+	enum { ITEMS = 2048, QUERIES = 256, FORMS = 4, CLIP = 960 };
+	static const char* forms[FORMS] = {
+		"{ \"name\" : \"row_a\" }",
+		"{ \"name\" : \"row_b\" }",
+		"{ \"name\" : \"header\" }",
+		"{ \"name\" : \"footer\" }"
+	};
+
+	CKLBUIList* pDyn	= CKLBUIList::create(NULL, NULL, 0, 1000, 0.0f, 0.0f, 640.0f, (float)CLIP, 48, true);
+	CKLBUIList* pNormal	= CKLBUIList::create(NULL, NULL, 0, 1000, 0.0f, 0.0f, 640.0f, (float)CLIP, 48, true);
+	bool ok = pDyn && pNormal && pDyn->setItemMode(CKLBUIList::LIST_ITEM_DYNAMIC);
+
+	static int itemPos[ITEMS];
+	int length = 0;
+	for(int i = 0; i < ITEMS; i++) {
+		itemPos[i]	= length;
+		length		+= 40 + (i % 7) * 8;
+	}
+
+	s64 timeAdd		= 0;
+	s64 timeLayout	= 0;
+	s64 timeScroll	= 0;
+	s64 timeAddNormal	= 0;
+	s64 timeLayoutNormal= 0;
+	u32 seed		= 1;
+	for(u32 l = 0; ok && l < loops; l++) {
+		s64 t0 = CKLBBenchmark::now();
+		for(int i = 0; ok && i < ITEMS; i++) {
+			ok = pDyn->cmdItemAdd(forms[i % FORMS], 40 + (i % 7) * 8, i);
+		}
+		s64 t1 = CKLBBenchmark::now();
+		pDyn->cmdSetInitial(0);
+		s64 t2 = CKLBBenchmark::now();
+		ok = ok && (pDyn->getItems() == ITEMS);
+
+		static int targets[QUERIES];
+		for(int q = 0; q < QUERIES; q++) {
+			seed = (seed * 1103515245) + 12345;
+			targets[q] = (seed >> 8) % ITEMS;
+		}
+		s64 t3 = CKLBBenchmark::now();
+		for(int q = 0; ok && q < QUERIES; q++) {
+			pDyn->cmdSetItemPos(LIST_VIEW_TOP, targets[q], 0);
+			int expected = itemPos[targets[q]];
+			if(expected > length - CLIP) { expected = length - CLIP; }
+			ok = (pDyn->cmdGetPosition() == expected);
+		}
+		s64 t4 = CKLBBenchmark::now();
+		benchListClear(pDyn);
+
+		s64 t5 = CKLBBenchmark::now();
+		for(int i = 0; ok && i < ITEMS; i++) {
+			ok = pNormal->cmdItemAdd(forms[i % FORMS], 40 + (i % 7) * 8, i);
+		}
+		s64 t6 = CKLBBenchmark::now();
+		pNormal->cmdSetInitial(0);
+		s64 t7 = CKLBBenchmark::now();
+		ok = ok && (pNormal->getItems() == ITEMS);
+		benchListClear(pNormal);
+
+		timeAdd			+= t1 - t0;
+		timeLayout		+= t2 - t1;
+		timeScroll		+= t4 - t3;
+		timeAddNormal	+= t6 - t5;
+		timeLayoutNormal+= t7 - t6;
+	}
+	CKLBBenchmark::report("dynamic : add item", loops * ITEMS, timeAdd);
+	CKLBBenchmark::report("dynamic : first layout", loops, timeLayout);
+	CKLBBenchmark::report("dynamic : scroll to item", loops * QUERIES, timeScroll);
+	CKLBBenchmark::report("normal : add item", loops * ITEMS, timeAddNormal);
+	CKLBBenchmark::report("normal : first layout", loops, timeLayoutNormal);
+	if(!ok) {
+		CPFInterface::getInstance().platform().logging("[BENCH] UILIST item count or scroll position mismatch\n");
+	}
+
+	// Released by the task manager.
+	if(pDyn)	{ benchListClear(pDyn);		pDyn->kill();		}
+	if(pNormal)	{ benchListClear(pNormal);	pNormal->kill();	}
+	return ok;
+}
+
+static CKLBBenchmark gBenchListWindow("UILIST", benchListWindow);
+#endif
@@ -321,6 +321,20 @@ private:
 
 	const char			*	m_pGroupName;
 
+	// dynamic モードで使用するアイテム生成フォーム。
+	// 同一JSONのアイテムはこれを共有し、二つ以上のアイテムが参照している間は解析済みアセットを保持する。
+	struct TEMPLATE {
+		TEMPLATE			*	next;
+		const char			*	json;		// アイテム生成フォームのJSON
+		u32						jsonlen;
+		u32						hash;
+		u32						refCount;	// このテンプレートを参照するアイテム数
+		u32						loadCount;	// ツリー化されているアイテム数
+		u32						handle;		// 解析済みアセットのハンドル
+		CKLBCompositeAsset	*	pAsset;		// 解析済みアセット (未解析ならNULL)
+		bool					bShared;	// false : 汎用プロパティを持つため、アイテムごとに解析する
+	};
+
 	struct LISTITEM {
 
 		LISTITEM		*	prev;	// 前の項目
@@ -330,6 +344,7 @@ private:
 
 		const char		*	jsonp;	// dynamic モードで使用。アイテム生成フォームのJSON
 		u32					jsonlen;
+		TEMPLATE		*	tpl;	// dynamic モードで使用。jsonp の共有元
 
 		CKLBNode		*	form;	// 項目フォームのノード
 		u32					handle;	// フォームアセットのハンドル
@@ -350,6 +365,7 @@ private:
             , enable(false)
             , jsonp (NULL)
             , jsonlen   (0)
+            , tpl   (NULL)
             , form  (NULL)
             , handle(0)
             , ctrl  ()
@@ -367,6 +383,13 @@ private:
 	LISTITEM		*	m_killBegin;
 	LISTITEM		*	m_killEnd;
 
+	TEMPLATE		*	m_tplBegin;			// dynamic モードのテンプレート一覧
+
+	LISTITEM		**	m_itemTable;		// index -> アイテム (m_itemUpdate が false の間のみ有効)
+	int					m_itemTableMax;
+	int					m_dynBegin;			// dynamic モードでツリー化されている index 範囲 [begin, end)
+	int					m_dynEnd;
+
 	int					m_itemCnt;			// 登録アイテム数
 	int					m_scrollPos;		// スクロール位置
 	bool				m_enableEvents;
@@ -428,6 +451,13 @@ private:
 
 	bool        load_itemform   (LISTITEM * pItem, const char * json, u32 jsonLen, CKLBCompositeAsset * pOrgAsset = NULL, IDataSource * pSource = NULL);
 	bool        unload_itemform (LISTITEM * pItem, bool kill_child = true);
+
+	bool        load_dynamic    (LISTITEM * pItem);
+	TEMPLATE *  acquire_template(const char * json, u32 jsonLen);
+	void        release_template(TEMPLATE * pTpl);
+
+	// 末端 (pos + step) が指定位置より後ろにある最初のアイテムの index (二分探索)
+	int         find_index_by_pos(int pos);
 	
 	inline void set_item_id (LISTITEM * pItem, int id = -1) { pItem->id = id; }
 
@@ -458,7 +488,7 @@ private:
 	void itemRealloc();
 
 	// 直線型リストの表示位置再設定
-	void setStraightPosition();
+	void setStraightPosition(bool relayout);
 
 	// スプライン型リストの表示位置再設定
 	void setSplinePosition();
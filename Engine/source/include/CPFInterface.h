@@ -631,6 +631,7 @@ public:
 	virtual void	mutexLock		(void* mutex) = 0;
 	virtual void	mutexUnlock		(void* mutex) = 0;
 
+	// Auto-reset event : a wakeup sent while nobody sleeps is kept for the next eventSleep().
 	virtual void*	allocEventLock	() = 0;
 	virtual void	freeEventLock	(void* lock) = 0;
 	virtual void	eventSleep		(void* lock) = 0;
@@ -118,6 +118,27 @@ public:
 // Able to use loader directly from code.
 s32 TGALoad( const char *fileName, char **buffer, s32 *width, s32 *height, bool load, bool swapXY);
 
+//
+// VBO upload state.
+// A buffer committed on consecutive frames is promoted to streaming : it then rotates
+// between VBO_STREAM_SLOTS buffer names, one per frame, so an upload never rewrites
+// storage still used by a frame in flight (GLES 1.x / 2.0 have no fence).
+// Buffers committed once stay on their single static buffer.
+//
+#define VBO_STREAM_SLOTS	(3)
+#define VBO_STREAM_PROMOTE	(2)		// Consecutive committed frames before streaming.
+
+struct SVBOStream {
+	GLuint			slotID		[VBO_STREAM_SLOTS];	// slotID[0] is the original buffer.
+	u32				pendStart	[VBO_STREAM_SLOTS];	// Byte range not uploaded yet into each slot.
+	u32				pendEnd		[VBO_STREAM_SLOTS];
+	u32				byteSize;
+	s32				lastFrame;
+	u8				streak;
+	u8				slot;
+	bool			streaming;
+};
+
 // Shader : "name" + type (Uniform/vertex + Format) + vertexLocationID
 class CIndexBuffer {
 	friend class CKLBOGLWrapper;
@@ -132,7 +153,8 @@ private:
 	short*			ptrBuffer;		// Dynamic buffer.
 	bool			fromOutside;
 
-	GLuint			vboID;
+	GLuint			vboID;			// Current slot of stream.
+	SVBOStream		stream;
 
 	u16				offsetDraw;
 	short			VBOModifyStart;
@@ -159,7 +181,8 @@ private:
 	CBuffer*		pNext;
 	float*			ptrBuffer;		// Dynamic buffer.
 	float*			vboLocalCopy;	// Dynamic local buffer.
-	GLuint			vboID;
+	GLuint			vboID;			// Current slot of stream.
+	SVBOStream		stream;
 
 	SVertexEntry*	structure;
 	short			VBOModifyStart;
@@ -187,6 +210,13 @@ private:
 //
 // #############################################################################
 
+struct SShaderCacheStats {
+	u32				cacheHits;			// Programs loaded as binary.
+	u32				cacheMisses;		// Programs compiled and linked.
+	u32				buildTimeUS;		// Time spent creating programs.
+	u32				savedTimeUS;		// Compile + link time avoided by the cache.
+};
+
 class CShader {
 	friend class CKLBOGLWrapper;
 	friend class CShaderInstance;
@@ -201,6 +231,9 @@ private:
 
 	CShader*		pNext;
 	SInternalParam*	arrayParam;			// One Array, shared in two.
+	char*			source;				// Kept until compiled (GL2 compiles on demand).
+	u32				sourceHash;
+	GLenum			shaderType;
 	GLuint			shaderObj;
 	u8				countUniform;
 	u8				countStreamInfo;
@@ -273,7 +306,9 @@ private:
 	CShaderSet*			pNext;
 	CKLBOGLWrapper*		pMgr;
 	s32*				locationArray;
-	GLuint				programObj;
+	GLuint				programObj;			// 0 until linked.
+	u32					cacheKey;			// Program binary cache key.
+	bool				linkPending;
 
 	bool				enableTexture;
 	bool				enableColor;
@@ -387,6 +422,20 @@ private:
 	~CTextureUsage();
 };
 
+// Texture residency : called with reload == false when the GPU copy is dropped,
+// and with reload == true to upload it again. Return false if the source is not available.
+typedef bool (*cbTextureResidency)(void* ctx, CTexture* pTexture, bool reload);
+
+struct STextureResidencyStats {
+	u32				budgetBytes;		// 0 : no budget, nothing is evicted.
+	u32				residentBytes;		// GPU memory used by all textures.
+	u32				residentCount;
+	u32				evictions;
+	u32				reloads;
+	u32				reloadFailures;
+	u32				reloadStallUS;		// Time spent re-uploading evicted textures.
+};
+
 class CTextureBase {
 	friend class CKLBOGLWrapper;
 	friend class CTextureUsage;
@@ -444,6 +493,7 @@ private:
 
 	void 			releaseUsage		();
 	void			releaseSubTextures	();
+	void			resetSampling		();
 };
 
 class CTexture : public CTextureBase {
@@ -454,6 +504,7 @@ class CTexture : public CTextureBase {
 	friend class CFrame;
 public:
 	void			makeEmptyShell			();
+	bool			isResident				()	{ return resident; }
 	GLuint			activeTexture;	
 private:
 	GLuint			getWorkingTexture() {
@@ -474,6 +525,15 @@ private:
 	bool			is3D;
 	s32				frame;
 
+	// Residency (see CKLBOGLWrapper::setTextureResidency)
+	cbTextureResidency	residencyCB;
+	void*			residencyCtx;
+	CTexture*		pLRUPrev;
+	CTexture*		pLRUNext;
+	u32				byteSize;
+	s32				lastUsedFrame;
+	bool			resident;
+
 	// Open GL side
 	GLenum			format;
 	GLint			channels;
@@ -683,6 +743,9 @@ private:
 
 class CKLBOGLWrapper {
 	friend class CTextureUsage;
+	friend class CTexture;
+	friend bool benchVBOStream(u32 loops);	// INTERNAL_BENCH case, simulates frames.
+	friend bool benchTextureResidency(u32 loops);	// INTERNAL_BENCH case, simulates frames.
 public:
 	inline
 	static CKLBOGLWrapper& getInstance() {
@@ -724,6 +787,11 @@ public:
 	s32				getFrame()			{ return frame; }
 	void			endFrame();
 
+	// Upload [start,end[ (bytes) of a VBO local copy, return the buffer name to draw with.
+	GLuint			commitStream		(SVBOStream& stream, GLenum target, u32 start, u32 end, const void* localCopy);
+	// Bytes and calls sent by commitStream during the last frame.
+	void			getVBOUploadStats	(u32& bytes, u32& calls)	{ bytes = m_lastUploadBytes; calls = m_lastUploadCalls; }
+
 	// ------------------------------------------------------------------------
 	// Rendering.
 	//
@@ -766,6 +834,25 @@ public:
 
 	CTexture*		createTexture		(s32 width, s32 height, GLenum pixelFormat, TEX_CHANNEL channelCount,void* data, s32 dataLength = 0, TEX_OPTION option = TEX_NONE, s32 depth = 0, CTexture* reload = NULL);
 	void			releaseTexture		(CTexture* texture);
+
+	// Texture residency.
+	// Textures with a residency callback are evicted least recently used first
+	// at the end of a frame while the resident bytes exceed the budget (0 : no budget),
+	// and uploaded again through the callback when drawn.
+	void			setTextureBudget	(u32 budgetBytes)	{ m_textureBudget = budgetBytes; }
+	void			setTextureResidency	(CTexture* pTexture, cbTextureResidency callback, void* ctx);
+	// Content patched at runtime can not be rebuilt by the callback : reload if evicted, then keep resident.
+	// Return false if the texture could not be reloaded.
+	bool			pinTexture			(CTexture* pTexture);
+	void			getTextureResidencyStats
+										(STextureResidencyStats* pStats);
+	inline
+	void			touchTexture		(CTextureUsage* pUsage) {
+		CTexture* pTexture = pUsage->pTexture->pMaster;
+		if (pTexture->lastUsedFrame != frame) {
+			stampTexture(pTexture);
+		}
+	}
 	
 	// Shaders.
 	CShader*		createShader		(SRenderState::RENDER_MODE, SHADER_TYPE type, const SParam* listParam);
@@ -773,8 +860,10 @@ public:
 	void			releaseShader		(CShader* pShader);
 
 	// Rendering Shader.
-	CShaderSet*		createShaderSet		(CShader* pVertexShader, CShader* pPixelShader);
+	// deferLink : program is linked later (endFrame, or first draw using it).
+	CShaderSet*		createShaderSet		(CShader* pVertexShader, CShader* pPixelShader, bool deferLink = false);
 	void			releaseShaderSet	(CShaderSet* pFullShader);
+	void			getShaderCacheStats	(SShaderCacheStats* pStats);
 
 	CBuffer*		createVertexBuffer	(s32 vertexCount, const SVertexEntry* listComponent, void* usingOutsideBuffer = NULL);
 	void			releaseVertexBuffer	(CBuffer* pBuffer);
@@ -793,8 +882,31 @@ private:
 
 	const char*		patch				(const char* shader, const char* glslTransform);
 
-	GLuint			arrayBufferID;
 	void			_glBindBuffer		(GLuint id);
+	bool			compileShader		(CShader* pShader);
+	bool			linkShaderSet		(CShaderSet* pSet);
+	void			linkPendingShaderSet();
+	void			initStream			(SVBOStream& stream, GLuint vboID, u32 byteSize);
+	void			releaseStream		(SVBOStream& stream);
+	void			stampTexture		(CTexture* pTexture);
+	void			unlinkLRU			(CTexture* pTexture);
+	void			evictTextures		();
+	void			dropResidency		(CTexture* pTexture);
+
+	CTexture*		m_pLRUHead;
+	CTexture*		m_pLRUTail;
+	u32				m_textureBudget;
+	u32				m_residentBytes;
+	u32				m_residentCount;
+	u32				m_evictions;
+	u32				m_reloads;
+	u32				m_reloadFailures;
+	u32				m_reloadStallUS;
+
+	u32				m_uploadBytes;
+	u32				m_uploadCalls;
+	u32				m_lastUploadBytes;
+	u32				m_lastUploadCalls;
 
 	USampler		samplerUnit[4];
 	s32				frame;